@@ -1,5 +1,9 @@
 #include "AlarmScheduler.h"
 #include "Config.h"
+#include "Log.h"
+#include "TimetableStore.h"
+
+extern TimetableStore timetable;
 
 void AlarmScheduler::init() {
     _currentDay = -1;
@@ -32,13 +36,11 @@ void AlarmScheduler::stopAlarmDurationTracking() {
     }
 }
 
-String AlarmScheduler::getLastAlarmDuration() {
+TimeText AlarmScheduler::getLastAlarmDuration() {
     if (_lastAlarmDuration == 0) return "--";
-    int m = _lastAlarmDuration / 60;
-    int s = _lastAlarmDuration % 60;
-    char buff[20];
-    sprintf(buff, "%dm %ds", m, s);
-    return String(buff);
+    TimeText text;
+    text.appendf("%lum %lus", _lastAlarmDuration / 60, _lastAlarmDuration % 60);
+    return text;
 }
 
 void AlarmScheduler::update(RamzanNetworkManager* network) {
@@ -60,9 +62,17 @@ void AlarmScheduler::update(RamzanNetworkManager* network) {
     int h = timeinfo.tm_hour;
     int m = timeinfo.tm_min;
     
+    uint16_t before = triggerMask();
+
+    // A new timetable was swapped in: reload today from it
+    if (timetable.getVersion() != _timetableVersion) {
+        _timetableVersion = timetable.getVersion();
+        rearm();
+    }
+
     // If new day, reload alarms
     if (todayDay != _currentDay || todayMonth != _currentMonth) {
-        Serial.println("New Day Detected! Loading Alarms...");
+        LOG_I("New Day Detected! Loading Alarms...");
         _currentDay = todayDay;
         _currentMonth = todayMonth;
         loadAlarmsForDate(_currentMonth, _currentDay);
@@ -77,6 +87,7 @@ void AlarmScheduler::update(RamzanNetworkManager* network) {
         _todayAlarms.asrTriggered = false;
         _todayAlarms.ishaTriggered = false;
         _alarmsLoadedForToday = true;
+        _scheduleVersion++;
     }
 
     // Auto-Mark Skipped/Completed Alarms based on current time
@@ -108,63 +119,128 @@ void AlarmScheduler::update(RamzanNetworkManager* network) {
     if (!_todayAlarms.ishaTriggered) {
         if (currentMins > (_todayAlarms.ishaHour * 60 + _todayAlarms.ishaMin)) _todayAlarms.ishaTriggered = true;
     }
+
+    if (triggerMask() != before) _scheduleVersion++;
+}
+
+uint16_t AlarmScheduler::triggerMask() {
+    return (_todayAlarms.sehriTriggered << 0) | (_todayAlarms.preSehriTriggered << 1) |
+           (_todayAlarms.sehriEndTriggered << 2) | (_todayAlarms.iftarTriggered << 3) |
+           (_todayAlarms.fajrTriggered << 4) | (_todayAlarms.zohrTriggered << 5) |
+           (_todayAlarms.asrTriggered << 6) | (_todayAlarms.ishaTriggered << 7);
+}
+
+static const char* const EVENT_NAMES[SCHED_EVENT_COUNT] = { "Pre-Sehri", "Sehri", "Fajr", "Zohr", "Asr", "Iftar", "Isha" };
+
+const char* scheduleEventName(uint8_t event) {
+    return event < SCHED_EVENT_COUNT ? EVENT_NAMES[event] : "?";
+}
+
+static int16_t wrapMinutes(int total) {
+    total %= 1440;
+    if (total < 0) total += 1440;
+    return total;
+}
+
+// The one place offsets are applied: today's alarms, tomorrow and the
+// month cache all come through here
+void AlarmScheduler::computeDay(const AlarmEntry* entry, DayEvents& out) {
+    const PrayerTimes& p = timetable.prayers();
+    out.minutes[SCHED_FAJR] = p.fajrHour * 60 + p.fajrMinute;
+    out.minutes[SCHED_ZOHR] = p.zohrHour * 60 + p.zohrMinute;
+    out.minutes[SCHED_ASR] = p.asrHour * 60 + p.asrMinute;
+    out.minutes[SCHED_ISHA] = p.ishaHour * 60 + p.ishaMinute;
+    if (!entry) {
+        out.minutes[SCHED_PRE_SEHRI] = out.minutes[SCHED_SEHRI] = out.minutes[SCHED_IFTAR] = -1;
+        return;
+    }
+    out.minutes[SCHED_SEHRI] = wrapMinutes(entry->sehriHour * 60 + entry->sehriMinute + _sehriOffset);
+    out.minutes[SCHED_PRE_SEHRI] = wrapMinutes(out.minutes[SCHED_SEHRI] - _preSehriOffsetMinutes);
+    out.minutes[SCHED_IFTAR] = wrapMinutes(entry->iftarHour * 60 + entry->iftarMinute + _iftarOffset);
 }
 
 void AlarmScheduler::loadAlarmsForDate(int month, int day) {
-    _todayAlarms.hasSehri = false;
-    _todayAlarms.hasIftar = false;
+    _hasTomorrow = false;
 
-    // Exhaustive search
-    for (int i = 0; i < TIMETABLE_SIZE; i++) {
-        if (ramzanTimetable[i].month == month && ramzanTimetable[i].day == day) {
-            _todayAlarms.hasSehri = true;
-            // Apply Sehri Offset
-            int sTotal = (ramzanTimetable[i].sehriHour * 60) + ramzanTimetable[i].sehriMinute + _sehriOffset;
-            if (sTotal < 0) sTotal += 1440;
-            if (sTotal >= 1440) sTotal %= 1440;
-            _todayAlarms.sehriHour = sTotal / 60;
-            _todayAlarms.sehriMin = sTotal % 60;
-            
-            _todayAlarms.hasIftar = true;
-            // Apply Iftar Offset
-            int iTotal = (ramzanTimetable[i].iftarHour * 60) + ramzanTimetable[i].iftarMinute + _iftarOffset;
-            if (iTotal < 0) iTotal += 1440;
-            if (iTotal >= 1440) iTotal %= 1440;
-            _todayAlarms.iftarHour = iTotal / 60;
-            _todayAlarms.iftarMin = iTotal % 60;
-            
-            Serial.print("Alarms Loaded (Day "); Serial.print(day); Serial.println("):");
-            Serial.print("Sehri: "); Serial.print(_todayAlarms.sehriHour); Serial.print(":"); Serial.print(_todayAlarms.sehriMin); 
-            Serial.print(" (Off: "); Serial.print(_sehriOffset); Serial.println(")");
-            
-            Serial.print("Iftar: "); Serial.print(_todayAlarms.iftarHour); Serial.print(":"); Serial.print(_todayAlarms.iftarMin);
-            Serial.print(" (Off: "); Serial.print(_iftarOffset); Serial.println(")");
-            
-            // Auto-calculate Prayer Times
-            // Fajr: 06:00
-            _todayAlarms.fajrHour = 6; _todayAlarms.fajrMin = 0;
-            
-            // Zohr: 1:00 PM (13:00)
-            _todayAlarms.zohrHour = 13; _todayAlarms.zohrMin = 0;
-            
-            // Asr: 5:05 PM (17:05)
-            _todayAlarms.asrHour = 17; _todayAlarms.asrMin = 5;
-            
-            // Isha: 8:00 PM (20:00)
-            _todayAlarms.ishaHour = 20; _todayAlarms.ishaMin = 0;
-            
-            Serial.printf("Prayers: Fajr %02d:%02d, Zohr %02d:%02d, Asr %02d:%02d, Isha %02d:%02d\n", 
-                _todayAlarms.fajrHour, _todayAlarms.fajrMin,
-                _todayAlarms.zohrHour, _todayAlarms.zohrMin,
-                _todayAlarms.asrHour, _todayAlarms.asrMin,
-                _todayAlarms.ishaHour, _todayAlarms.ishaMin);
+    // Indexed lookup in the active timetable (flash or built-in)
+    int i = timetable.indexOf(month, day);
+    AlarmEntry row;
+    bool found = i >= 0 && timetable.entry(i, row);
+    DayEvents today;
+    computeDay(found ? &row : nullptr, today);
+
+    _todayAlarms.hasSehri = _todayAlarms.hasIftar = found;
+    if (found) {
+        _todayAlarms.sehriHour = today.minutes[SCHED_SEHRI] / 60;
+        _todayAlarms.sehriMin = today.minutes[SCHED_SEHRI] % 60;
+        _todayAlarms.iftarHour = today.minutes[SCHED_IFTAR] / 60;
+        _todayAlarms.iftarMin = today.minutes[SCHED_IFTAR] % 60;
+
+        // Next row of the table, for the "tomorrow" screens and sleep planning
+        if (timetable.entry(i + 1, row)) {
+            computeDay(&row, _tomorrow);
+            _hasTomorrow = true;
+        }
+        
+        LOG_I("Alarms Loaded (Day %d): Sehri %02d:%02d (Off: %d), Iftar %02d:%02d (Off: %d)", day,
+              _todayAlarms.sehriHour, _todayAlarms.sehriMin, _sehriOffset,
+              _todayAlarms.iftarHour, _todayAlarms.iftarMin, _iftarOffset);
+    } else {
+        LOG_W("No Alarms found in timetable for today.");
+    }
+
+    // Fixed prayer times come with the timetable
+    _todayAlarms.fajrHour = today.minutes[SCHED_FAJR] / 60; _todayAlarms.fajrMin = today.minutes[SCHED_FAJR] % 60;
+    _todayAlarms.zohrHour = today.minutes[SCHED_ZOHR] / 60; _todayAlarms.zohrMin = today.minutes[SCHED_ZOHR] % 60;
+    _todayAlarms.asrHour = today.minutes[SCHED_ASR] / 60;   _todayAlarms.asrMin = today.minutes[SCHED_ASR] % 60;
+    _todayAlarms.ishaHour = today.minutes[SCHED_ISHA] / 60; _todayAlarms.ishaMin = today.minutes[SCHED_ISHA] % 60;
+    
+    LOG_D("Prayers: Fajr %02d:%02d, Zohr %02d:%02d, Asr %02d:%02d, Isha %02d:%02d",
+          _todayAlarms.fajrHour, _todayAlarms.fajrMin,
+          _todayAlarms.zohrHour, _todayAlarms.zohrMin,
+          _todayAlarms.asrHour, _todayAlarms.asrMin,
+          _todayAlarms.ishaHour, _todayAlarms.ishaMin);
+}
+
+void AlarmScheduler::getDayEvents(uint16_t year, uint8_t month, uint8_t day, DayEvents& out) {
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        computeDay(nullptr, out);
+        return;
+    }
+    for (uint8_t s = 0; s < 2; s++) {
+        MonthEvents& c = _months[s];
+        if (c.month == month && c.year == year && c.configVersion == _configVersion && c.timetableVersion == timetable.getVersion()) {
+            _lastMonth = s;
+            out = c.days[day - 1];
             return;
         }
     }
-    Serial.println("No Alarms found in timetable for today.");
+
+    // Miss: rebuild the slot not used last from one read of the month
+    uint8_t s = _lastMonth ^ 1;
+    MonthEvents& c = _months[s];
+    AlarmEntry rows[31];
+    uint8_t n = timetable.readMonth(month, rows);
+    for (uint8_t d = 0; d < 31; d++) computeDay(nullptr, c.days[d]);
+    for (uint8_t i = 0; i < n; i++) {
+        if (rows[i].day >= 1 && rows[i].day <= 31) computeDay(&rows[i], c.days[rows[i].day - 1]);
+    }
+    c.year = year;
+    c.month = month;
+    c.configVersion = _configVersion;
+    c.timetableVersion = timetable.getVersion();
+    _lastMonth = s;
+    LOG_D("Schedule: %u-%02u cached, %u timetable days", year, month, n);
+    out = c.days[day - 1];
 }
 
 int AlarmScheduler::checkAlarmTriggers(RamzanNetworkManager* network) {
+    int code = evaluateTriggers(network);
+    if (code != 0) _scheduleVersion++;
+    return code;
+}
+
+int AlarmScheduler::evaluateTriggers(RamzanNetworkManager* network) {
     if (!_alarmsLoadedForToday || !network->isTimeSynced()) return 0;
     
     int h = network->getCurrentHour();
@@ -224,45 +300,62 @@ int AlarmScheduler::checkAlarmTriggers(RamzanNetworkManager* network) {
     return 0;
 }
 
-String AlarmScheduler::getNextAlarmTime() {
+static void printRow(Print& out, const char* name, int h, int m, bool fired) {
+    out.printf("  %-10s %02d:%02d  %s\n", name, h, m, fired ? "fired/passed" : "pending");
+}
+
+void AlarmScheduler::printToday(Print& out) {
+    if (!_alarmsLoadedForToday) {
+        out.println("No alarms loaded yet (clock not set?)");
+        return;
+    }
+    out.printf("Alarms for %02d/%02d (Sehri %+d, Iftar %+d min, Pre-Sehri %d min before)\n",
+               _currentDay, _currentMonth, _sehriOffset, _iftarOffset, _preSehriOffsetMinutes);
+    const DailyAlarms& a = _todayAlarms;
+    if (a.hasSehri) {
+        int pre = a.sehriHour * 60 + a.sehriMin - _preSehriOffsetMinutes;
+        if (pre < 0) pre += 1440;
+        printRow(out, "Pre-Sehri", pre / 60, pre % 60, a.preSehriTriggered);
+        printRow(out, "Sehri", a.sehriHour, a.sehriMin, a.sehriTriggered);
+        printRow(out, "Sehri End", a.sehriHour, a.sehriMin, a.sehriEndTriggered);
+    }
+    printRow(out, "Fajr", a.fajrHour, a.fajrMin, a.fajrTriggered);
+    printRow(out, "Zohr", a.zohrHour, a.zohrMin, a.zohrTriggered);
+    printRow(out, "Asr", a.asrHour, a.asrMin, a.asrTriggered);
+    if (a.hasIftar) printRow(out, "Iftar", a.iftarHour, a.iftarMin, a.iftarTriggered);
+    printRow(out, "Isha", a.ishaHour, a.ishaMin, a.ishaTriggered);
+}
+
+static TimeText hhmm(int h, int m) {
+    TimeText text;
+    text.appendf("%02d:%02d", h, m);
+    return text;
+}
+
+TimeText AlarmScheduler::getNextAlarmTime() {
     if (!_alarmsLoadedForToday) return "--:--";
     
-    char buff[10];
-    
     // Check Pre-Sehri first
     if (_todayAlarms.hasSehri && !_todayAlarms.preSehriTriggered) {
         int sehriTotalMins = _todayAlarms.sehriHour * 60 + _todayAlarms.sehriMin;
         int preTotalMins = sehriTotalMins - _preSehriOffsetMinutes;
         if (preTotalMins < 0) preTotalMins += 1440;
-        sprintf(buff, "%02d:%02d", preTotalMins / 60, preTotalMins % 60);
-        return String(buff);
+        return hhmm(preTotalMins / 60, preTotalMins % 60);
     }
     
-    if (_todayAlarms.hasSehri && !_todayAlarms.sehriTriggered) {
-        sprintf(buff, "%02d:%02d", _todayAlarms.sehriHour, _todayAlarms.sehriMin); return String(buff);
-    }
-    if (!_todayAlarms.fajrTriggered) {
-        sprintf(buff, "%02d:%02d", _todayAlarms.fajrHour, _todayAlarms.fajrMin); return String(buff);
-    }
-    if (!_todayAlarms.zohrTriggered) {
-        sprintf(buff, "%02d:%02d", _todayAlarms.zohrHour, _todayAlarms.zohrMin); return String(buff);
-    }
-    if (!_todayAlarms.asrTriggered) {
-        sprintf(buff, "%02d:%02d", _todayAlarms.asrHour, _todayAlarms.asrMin); return String(buff);
-    }
-    if (_todayAlarms.hasIftar && !_todayAlarms.iftarTriggered) {
-        sprintf(buff, "%02d:%02d", _todayAlarms.iftarHour, _todayAlarms.iftarMin); return String(buff);
-    }
-    if (!_todayAlarms.ishaTriggered) {
-        sprintf(buff, "%02d:%02d", _todayAlarms.ishaHour, _todayAlarms.ishaMin); return String(buff);
-    }
+    if (_todayAlarms.hasSehri && !_todayAlarms.sehriTriggered) return hhmm(_todayAlarms.sehriHour, _todayAlarms.sehriMin);
+    if (!_todayAlarms.fajrTriggered) return hhmm(_todayAlarms.fajrHour, _todayAlarms.fajrMin);
+    if (!_todayAlarms.zohrTriggered) return hhmm(_todayAlarms.zohrHour, _todayAlarms.zohrMin);
+    if (!_todayAlarms.asrTriggered) return hhmm(_todayAlarms.asrHour, _todayAlarms.asrMin);
+    if (_todayAlarms.hasIftar && !_todayAlarms.iftarTriggered) return hhmm(_todayAlarms.iftarHour, _todayAlarms.iftarMin);
+    if (!_todayAlarms.ishaTriggered) return hhmm(_todayAlarms.ishaHour, _todayAlarms.ishaMin);
     
     // If all done today, show Tomorrow Sehri (Wait, tomorrow pre-sehri is better if we have the offset logic)
     // For simplicity, let's keep tomorrow sehri for now.
     return getTomorrowSehriTime(); 
 }
 
-String AlarmScheduler::getNextAlarmName() {
+const char* AlarmScheduler::getNextAlarmName() {
     if (!_alarmsLoadedForToday) return "Loading";
     
     if (_todayAlarms.hasSehri && !_todayAlarms.preSehriTriggered) return "Pre-Sehri";
@@ -276,49 +369,27 @@ String AlarmScheduler::getNextAlarmName() {
     return "Sehri (Tom)"; 
 }
 
-String AlarmScheduler::getTodaySehriTime() {
+TimeText AlarmScheduler::getTodaySehriTime() {
     if (!_alarmsLoadedForToday || !_todayAlarms.hasSehri) return "--:--";
-    char buff[10];
-    sprintf(buff, "%02d:%02d", _todayAlarms.sehriHour, _todayAlarms.sehriMin);
-    return String(buff);
+    return hhmm(_todayAlarms.sehriHour, _todayAlarms.sehriMin);
 }
 
-String AlarmScheduler::getTodayIftarTime() {
+TimeText AlarmScheduler::getTodayIftarTime() {
     if (!_alarmsLoadedForToday || !_todayAlarms.hasIftar) return "--:--";
-    char buff[10];
-    sprintf(buff, "%02d:%02d", _todayAlarms.iftarHour, _todayAlarms.iftarMin);
-    return String(buff);
+    return hhmm(_todayAlarms.iftarHour, _todayAlarms.iftarMin);
 }
 
-String AlarmScheduler::getTomorrowSehriTime() {
-    // Find current day index
-    for (int i = 0; i < TIMETABLE_SIZE; i++) {
-        if (ramzanTimetable[i].month == _currentMonth && ramzanTimetable[i].day == _currentDay) {
-            // Found Today. Tomorrow is i+1?
-            if (i + 1 < TIMETABLE_SIZE) {
-                char buff[10];
-                sprintf(buff, "%02d:%02d", ramzanTimetable[i+1].sehriHour, ramzanTimetable[i+1].sehriMinute);
-                return String(buff);
-            }
-        }
-    }
-    return "--:--";
+TimeText AlarmScheduler::getTomorrowSehriTime() {
+    if (!_alarmsLoadedForToday || !_hasTomorrow) return "--:--";
+    return hhmm(_tomorrow.minutes[SCHED_SEHRI] / 60, _tomorrow.minutes[SCHED_SEHRI] % 60);
 }
 
-String AlarmScheduler::getTomorrowIftarTime() {
-    for (int i = 0; i < TIMETABLE_SIZE; i++) {
-        if (ramzanTimetable[i].month == _currentMonth && ramzanTimetable[i].day == _currentDay) {
-            if (i + 1 < TIMETABLE_SIZE) {
-                char buff[10];
-                sprintf(buff, "%02d:%02d", ramzanTimetable[i+1].iftarHour, ramzanTimetable[i+1].iftarMinute);
-                return String(buff);
-            }
-        }
-    }
-    return "--:--";
+TimeText AlarmScheduler::getTomorrowIftarTime() {
+    if (!_alarmsLoadedForToday || !_hasTomorrow) return "--:--";
+    return hhmm(_tomorrow.minutes[SCHED_IFTAR] / 60, _tomorrow.minutes[SCHED_IFTAR] % 60);
 }
 
-String AlarmScheduler::getPrayerWarningDuration() {
+const char* AlarmScheduler::getPrayerWarningDuration() {
     if (!_alarmsLoadedForToday || !_todayAlarms.hasSehri || _todayAlarms.sehriTriggered) return "--";
 
     // Warning is 1 hour before Sehri
@@ -326,42 +397,29 @@ String AlarmScheduler::getPrayerWarningDuration() {
     return "1 Hr Before"; 
 }
 
-String AlarmScheduler::getUpcomingScheduleJson() {
-    String json = "[";
+static void scheduleEntry(StrBuf& json, const char* day, const char* name, const TimeText& time) {
+    if (json.length() > 0 && json.c_str()[json.length() - 1] == '}') json += ',';
+    json.appendf("{\"day\":\"%s\", \"name\":\"%s\", \"time\":\"%s\"}", day, name, time.c_str());
+}
+
+void AlarmScheduler::writeUpcomingScheduleJson(StrBuf& json) {
+    json += '[';
     
     // Today
     if(_alarmsLoadedForToday) {
-        char buff[10];
-        
-        // Sehri
-        json += "{\"day\":\"Today\", \"name\":\"Sehri\", \"time\":\"" + getTodaySehriTime() + "\"},";
-        
-        // Fajr
-        sprintf(buff, "%02d:%02d", _todayAlarms.fajrHour, _todayAlarms.fajrMin);
-        json += "{\"day\":\"Today\", \"name\":\"Fajr\", \"time\":\"" + String(buff) + "\"},";
-        
-        // Zohr
-        sprintf(buff, "%02d:%02d", _todayAlarms.zohrHour, _todayAlarms.zohrMin);
-        json += "{\"day\":\"Today\", \"name\":\"Zohr\", \"time\":\"" + String(buff) + "\"},";
-        
-        // Asr
-        sprintf(buff, "%02d:%02d", _todayAlarms.asrHour, _todayAlarms.asrMin);
-        json += "{\"day\":\"Today\", \"name\":\"Asr\", \"time\":\"" + String(buff) + "\"},";
-        
-        // Iftar
-        json += "{\"day\":\"Today\", \"name\":\"Iftar\", \"time\":\"" + getTodayIftarTime() + "\"},";
-        
-        // Isha
-        sprintf(buff, "%02d:%02d", _todayAlarms.ishaHour, _todayAlarms.ishaMin);
-        json += "{\"day\":\"Today\", \"name\":\"Isha\", \"time\":\"" + String(buff) + "\"},";
+        scheduleEntry(json, "Today", "Sehri", getTodaySehriTime());
+        scheduleEntry(json, "Today", "Fajr", hhmm(_todayAlarms.fajrHour, _todayAlarms.fajrMin));
+        scheduleEntry(json, "Today", "Zohr", hhmm(_todayAlarms.zohrHour, _todayAlarms.zohrMin));
+        scheduleEntry(json, "Today", "Asr", hhmm(_todayAlarms.asrHour, _todayAlarms.asrMin));
+        scheduleEntry(json, "Today", "Iftar", getTodayIftarTime());
+        scheduleEntry(json, "Today", "Isha", hhmm(_todayAlarms.ishaHour, _todayAlarms.ishaMin));
     }
     
     // Tomorrow (Just Sehri/Iftar for brevity, or full if needed)
-    json += "{\"day\":\"Tom\", \"name\":\"Sehri\", \"time\":\"" + getTomorrowSehriTime() + "\"},";
-    json += "{\"day\":\"Tom\", \"name\":\"Iftar\", \"time\":\"" + getTomorrowIftarTime() + "\"}";
+    scheduleEntry(json, "Tom", "Sehri", getTomorrowSehriTime());
+    scheduleEntry(json, "Tom", "Iftar", getTomorrowIftarTime());
     
-    json += "]";
-    return json;
+    json += ']';
 }
 
 long AlarmScheduler::getSecondsToNextAlarm() {
@@ -392,21 +450,13 @@ long AlarmScheduler::getSecondsToNextAlarm() {
     else if (!_todayAlarms.ishaTriggered) nextTriggerSecs = getSecs(_todayAlarms.ishaHour, _todayAlarms.ishaMin);
     
     // 2. If no more today, look for Tomorrow's first alarm (Pre-Sehri)
-    if (nextTriggerSecs == -1) {
-        for (int i = 0; i < TIMETABLE_SIZE; i++) {
-            if (ramzanTimetable[i].month == _currentMonth && ramzanTimetable[i].day == _currentDay) {
-                if (i + 1 < TIMETABLE_SIZE) {
-                    int tomSehriMins = (ramzanTimetable[i+1].sehriHour * 60) + ramzanTimetable[i+1].sehriMinute + _sehriOffset;
-                    int tomPreSehriMins = tomSehriMins - _preSehriOffsetMinutes;
-                    if (tomPreSehriMins < 0) tomPreSehriMins += 1440;
-                    
-                    nextTriggerSecs = (long)tomPreSehriMins * 60;
-                    // For tomorrow, we add 24 hours to the calculation
-                    long diff = (86400 - nowSecs) + nextTriggerSecs;
-                    return diff;
-                }
-            }
-        }
+    if (nextTriggerSecs == -1 && _hasTomorrow) {
+        int tomPreSehriMins = _tomorrow.minutes[SCHED_PRE_SEHRI];
+        
+        nextTriggerSecs = (long)tomPreSehriMins * 60;
+        // For tomorrow, we add 24 hours to the calculation
+        long diff = (86400 - nowSecs) + nextTriggerSecs;
+        return diff;
     }
     
     if (nextTriggerSecs == -1) return -1;
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include "RamzanTimetable.h"
 #include "NetworkManager.h"
+#include "FixedString.h"
 
 // Forward declaration to avoid circular dependency if needed
 class RamzanNetworkManager;
@@ -28,6 +29,15 @@ struct DailyAlarms {
     int ishaHour, ishaMin; bool ishaTriggered;
 };
 
+// Everything that rings on one day, in the order it rings. Minutes after
+// midnight with the offsets applied; -1 = not on that day (no timetable row)
+enum ScheduleEvent : uint8_t { SCHED_PRE_SEHRI, SCHED_SEHRI, SCHED_FAJR, SCHED_ZOHR,
+                               SCHED_ASR, SCHED_IFTAR, SCHED_ISHA, SCHED_EVENT_COUNT };
+struct DayEvents {
+    int16_t minutes[SCHED_EVENT_COUNT];
+};
+const char* scheduleEventName(uint8_t event);
+
 class AlarmScheduler {
 public:
     void init();
@@ -38,35 +48,53 @@ public:
     int checkAlarmTriggers(RamzanNetworkManager* network);
     
     // Getters for display
-    String getNextAlarmTime();
-    String getNextAlarmName();
+    TimeText getNextAlarmTime();
+    const char* getNextAlarmName();
     
     // New: Look ahead
-    String getTodaySehriTime();
-    String getTodayIftarTime();
-    String getTomorrowSehriTime();
-    String getTomorrowIftarTime();
+    TimeText getTodaySehriTime();
+    TimeText getTodayIftarTime();
+    TimeText getTomorrowSehriTime();
+    TimeText getTomorrowIftarTime();
     
     // Global Configuration
-    void setOffsets(int sehri, int iftar) { _sehriOffset = sehri; _iftarOffset = iftar; }
-    void setPreSehriOffset(int minutes) { _preSehriOffsetMinutes = minutes; }
+    void setOffsets(int sehri, int iftar) { _sehriOffset = sehri; _iftarOffset = iftar; _scheduleVersion++; _configVersion++; }
+    void setPreSehriOffset(int minutes) { _preSehriOffsetMinutes = minutes; _scheduleVersion++; _configVersion++; }
     int getSehriOffset() { return _sehriOffset; }
     int getIftarOffset() { return _iftarOffset; }
     int getPreSehriOffset() { return _preSehriOffsetMinutes; }
     
-    String getPrayerWarningDuration();
-    String getUpcomingScheduleJson(); // New method for Web UI
+    const char* getPrayerWarningDuration();
+    void writeUpcomingScheduleJson(StrBuf& json); // JSON array for the Web UI
+
+    // Any date's events, for /api/schedule. Served from a cache of whole
+    // months, rebuilt only when the offsets or the timetable change.
+    void getDayEvents(uint16_t year, uint8_t month, uint8_t day, DayEvents& out);
 
     // Duration Tracking
     void startAlarmDurationTracking();
     void stopAlarmDurationTracking();
-    String getLastAlarmDuration();
+    TimeText getLastAlarmDuration();
     
     // Sleep Mode Helper
     long getSecondsToNextAlarm();
+
+    void loadAlarmsForDate(int month, int day); // Public for the benchmarks
+
+    // Clock or offsets changed: the next update() reloads today, so events
+    // still ahead of the clock can ring again
+    void rearm() { _currentDay = -1; _currentMonth = -1; }
+    void printToday(Print& out); // Console table: time and fired/pending per event
+
+    // Bumped whenever today's alarms, their triggered flags or offsets change,
+    // so displays can tell when schedule-derived text needs redrawing
+    uint32_t getScheduleVersion() { return _scheduleVersion; }
     
 private:
     DailyAlarms _todayAlarms;
+    DayEvents _tomorrow;           // Next row of the timetable, offsets applied
+    bool _hasTomorrow = false;
+    uint32_t _timetableVersion = 0;
     int _currentDay;
     int _currentMonth;
     bool _alarmsLoadedForToday;
@@ -77,8 +105,26 @@ private:
     
     unsigned long _alarmStartTime;
     unsigned long _lastAlarmDuration; // in seconds
+
+    uint32_t _scheduleVersion = 0;
+    uint32_t _configVersion = 0;   // Offsets only, for the month cache
+
+    // Two months, so a range across a month end does not rebuild each day.
+    // Keyed with the year too: a range from December into January must not
+    // get one year's month for another's
+    struct MonthEvents {
+        uint16_t year = 0;
+        uint8_t month = 0;         // 0 = empty
+        uint32_t configVersion;
+        uint32_t timetableVersion;
+        DayEvents days[31];
+    };
+    MonthEvents _months[2];
+    uint8_t _lastMonth = 0;        // Slot used last; the other one is replaced
     
-    void loadAlarmsForDate(int month, int day);
+    void computeDay(const AlarmEntry* entry, DayEvents& out);
+    int evaluateTriggers(RamzanNetworkManager* network);
+    uint16_t triggerMask();
 };
 
 #endif
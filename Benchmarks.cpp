@@ -0,0 +1,173 @@
+#include "Benchmarks.h"
+#include "Config.h"
+#include <esp_timer.h>
+#include <esp_task_wdt.h>
+#include "AlarmScheduler.h"
+#include "NetworkManager.h"
+#include "DisplayManager.h"
+#include "WebServerManager.h"
+#include "ButtonEngine.h"
+#include "BuzzerEngine.h"
+#include "InputManager.h"
+
+// External references
+extern RamzanNetworkManager networkManager;
+extern AlarmScheduler alarmScheduler;
+extern DisplayManager displayManager;
+extern WebServerManager webServerManager;
+extern ButtonEngine btnHouseA;
+extern ButtonEngine btnHouseB;
+extern ButtonEngine btnNav;
+extern BuzzerEngine buzzerA;
+extern InputManager inputManager;
+
+// The alarm cases work on a copy, so a trigger that comes due while the
+// benchmark runs is not used up before the loop sees it
+static AlarmScheduler s_sched;
+static BuzzerEngine s_buzzer(PIN_BENCH_SCRATCH);
+static InputManager s_inputs; // Copy, so the real debounce counters are not stepped
+static uint32_t s_toggle = 0;
+static volatile uint32_t s_sink = 0; // Keeps results alive
+
+static void benchCheckTriggers() { s_sink += s_sched.checkAlarmTriggers(&networkManager); }
+static void benchNextAlarmTime() { s_sink += s_sched.getNextAlarmTime().length(); }
+static void benchSecondsToNext() { s_sink += s_sched.getSecondsToNextAlarm(); }
+static FixedString<WebServerManager::RESPONSE_SIZE> s_json;
+
+static void benchScheduleJson() {
+    s_json.clear();
+    s_sched.writeUpcomingScheduleJson(s_json);
+    s_sink += s_json.length();
+}
+
+static void benchStatusJson() {
+    s_json.clear();
+    webServerManager.buildStatusJson(s_json);
+    s_sink += s_json.length();
+}
+
+static void benchLoadForDate() {
+    // First and last entry: best and worst case of the table search
+    const AlarmEntry& e = ramzanTimetable[(s_toggle++ & 1) ? TIMETABLE_SIZE - 1 : 0];
+    s_sched.loadAlarmsForDate(e.month, e.day);
+}
+
+static void benchDayEvents() {
+    // Alternates between two months, both held in the cache
+    DayEvents ev;
+    s_sched.getDayEvents(2026, (s_toggle++ & 1) ? 2 : 3, 10, ev);
+    s_sink += ev.minutes[SCHED_SEHRI];
+}
+
+static void benchShowMessage() {
+    // Alternate so every call changes the frame
+    if (s_toggle++ & 1) displayManager.showMessage("Benchmark", "Frame A");
+    else displayManager.showMessage("Benchmark", "Frame B");
+}
+
+static void benchButtonUpdate() {
+    btnHouseA.update();
+    btnHouseB.update();
+    btnNav.update();
+}
+
+// One debounce step for all pins from one register read. ns x CPU MHz
+// gives cycles per scan; the device also reports its own average.
+static void benchInputScan() { s_inputs.scanNow(); }
+
+static void benchBuzzerIdle() { buzzerA.update(); }
+static void benchBuzzerRinging() { s_buzzer.update(); }
+
+struct BenchCase {
+    const char* name;
+    void (*fn)();
+};
+
+static const BenchCase CASES[] = {
+    { "alarm_check_triggers",  benchCheckTriggers },
+    { "alarm_next_time",       benchNextAlarmTime },
+    { "alarm_seconds_to_next", benchSecondsToNext },
+    { "alarm_load_for_date",   benchLoadForDate },
+    { "alarm_schedule_json",   benchScheduleJson },
+    { "alarm_day_events",      benchDayEvents },
+    { "web_status_json",       benchStatusJson },
+    { "display_show_message",  benchShowMessage },
+    { "button_update",         benchButtonUpdate },
+    { "input_scan",            benchInputScan },
+    { "buzzer_update_idle",    benchBuzzerIdle },
+    { "buzzer_update_ringing", benchBuzzerRinging },
+};
+static const uint8_t CASE_COUNT = sizeof(CASES) / sizeof(CASES[0]);
+
+static uint64_t defaultClock() { return (uint64_t)esp_timer_get_time() * 1000ULL; }
+
+Benchmarks::Benchmarks() : _clock(defaultClock), _minBatchNs(MIN_BATCH_MS * 1000000ULL) {}
+
+uint8_t Benchmarks::run(const char* filter) {
+    _count = 0;
+    s_sched = alarmScheduler;
+    s_inputs = inputManager;
+    s_buzzer.init();
+    s_buzzer.startPattern(PATTERN_SEHRI_IFTAR);
+
+    for (uint8_t i = 0; i < CASE_COUNT && _count < MAX_CASES; i++) {
+        if (filter && filter[0] && !strstr(CASES[i].name, filter)) continue;
+        measure(CASES[i].name, CASES[i].fn);
+    }
+
+    s_buzzer.stop();
+    return _count;
+}
+
+void Benchmarks::measure(const char* name, void (*fn)()) {
+    fn(); // Warm up (caches, first-time allocations)
+
+    uint32_t n = 1;
+    while (true) {
+        uint32_t allocsBefore = _allocs ? _allocs() : 0;
+        uint64_t start = _clock();
+        for (uint32_t i = 0; i < n; i++) fn();
+        uint64_t spent = _clock() - start;
+        uint32_t allocs = _allocs ? _allocs() - allocsBefore : 0;
+
+        esp_task_wdt_reset();
+        if (_batchHook) _batchHook();
+
+        if (spent >= _minBatchNs || n >= MAX_ITERATIONS) {
+            BenchResult& r = _results[_count++];
+            r.name = name;
+            r.iterations = n;
+            r.nsPerOp = (uint32_t)(spent / n);
+            r.allocsPerOp = _allocs ? (float)allocs / n : -1.0f;
+            r.maxNs = 0;
+            return;
+        }
+        n *= 2;
+    }
+}
+
+void Benchmarks::printTable(Print& out) {
+    out.printf("%-24s %10s %10s %10s %10s\n", "benchmark", "iters", "ns/op", "allocs/op", "max ns");
+    for (uint8_t i = 0; i < _count; i++) {
+        const BenchResult& r = _results[i];
+        out.printf("%-24s %10lu %10lu ", r.name, (unsigned long)r.iterations, (unsigned long)r.nsPerOp);
+        if (r.allocsPerOp < 0) out.printf("%10s ", "-");
+        else out.printf("%10.2f ", r.allocsPerOp);
+        if (r.maxNs) out.printf("%10lu\n", (unsigned long)r.maxNs);
+        else out.printf("%10s\n", "-");
+    }
+}
+
+void Benchmarks::printJson(Print& out, const char* platform) {
+    out.printf("{\"platform\":\"%s\",\"results\":[", platform);
+    for (uint8_t i = 0; i < _count; i++) {
+        const BenchResult& r = _results[i];
+        out.printf("%s{\"name\":\"%s\",\"iterations\":%lu,\"nsPerOp\":%lu,\"allocsPerOp\":",
+                   i ? "," : "", r.name, (unsigned long)r.iterations, (unsigned long)r.nsPerOp);
+        if (r.allocsPerOp < 0) out.print("null");
+        else out.printf("%.2f", r.allocsPerOp);
+        if (r.maxNs) out.printf(",\"maxNs\":%lu}", (unsigned long)r.maxNs);
+        else out.print("}");
+    }
+    out.println("]}");
+}
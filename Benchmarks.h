@@ -0,0 +1,61 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <Arduino.h>
+
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;
+    uint32_t nsPerOp;
+    float allocsPerOp; // -1 = no allocation counter on this platform
+    uint32_t maxNs;    // Slowest single call, 0 = not timed one by one
+};
+
+// Microbenchmarks for the code the loop runs all the time (alarm checks,
+// status JSON, LCD frames, button and buzzer updates). Each case runs in
+// doubling batches until one batch takes at least the minimum batch time,
+// then reports ns and heap allocations per call.
+//
+// Device: 'b' on the serial console (only while nothing is ringing).
+// Host:   ramzan_bench, which also writes the results as JSON.
+class Benchmarks {
+public:
+    typedef uint64_t (*ClockFn)();   // Monotonic nanoseconds
+    typedef uint32_t (*CounterFn)(); // Heap allocations so far
+    typedef void (*HookFn)();
+
+    Benchmarks();
+    void setClock(ClockFn fn) { _clock = fn; }
+    void setAllocCounter(CounterFn fn) { _allocs = fn; }
+    void setBatchHook(HookFn fn) { _batchHook = fn; } // Called between batches
+    void setMinBatchMs(uint32_t ms) { _minBatchNs = (uint64_t)ms * 1000000ULL; }
+
+    // Runs every case whose name contains filter (nullptr/"" = all)
+    uint8_t run(const char* filter = nullptr);
+
+    // A result measured outside run(), e.g. the host's loop comparison
+    void addResult(const BenchResult& r) { if (_count < MAX_CASES) _results[_count++] = r; }
+
+    void printTable(Print& out);
+    void printJson(Print& out, const char* platform);
+
+    uint8_t count() { return _count; }
+    const BenchResult& result(uint8_t i) { return _results[i]; }
+
+    static const uint8_t MAX_CASES = 16;
+    static const uint32_t MIN_BATCH_MS = 100;
+    static const uint32_t MAX_ITERATIONS = 1UL << 26; // Stops a clock that does not move
+
+private:
+    void measure(const char* name, void (*fn)());
+
+    ClockFn _clock;
+    CounterFn _allocs = nullptr;
+    HookFn _batchHook = nullptr;
+    uint64_t _minBatchNs;
+
+    BenchResult _results[MAX_CASES];
+    uint8_t _count = 0;
+};
+
+#endif
@@ -1,100 +1,120 @@
 // ButtonEngine.cpp
 #include "ButtonEngine.h"
+#include "InputManager.h"
+
+// Every time here is millis(), the same clock takeChange() stamps with.
+// A stamp a little ahead of now (the clocks were read at different
+// moments) counts as no time passed rather than as a wrap.
+static unsigned long elapsedMs(unsigned long now, unsigned long then) {
+    return (long)(now - then) > 0 ? now - then : 0;
+}
 
 ButtonEngine::ButtonEngine(uint8_t pin) {
     _pin = pin;
-    _currentState = HIGH; 
-    _confidence = 0; 
-    _lastSampleTime = 0;
+    _inputs = nullptr;
+    _currentState = HIGH;
+    _eventHead = 0;
+    _eventTail = 0;
 }
 
-void ButtonEngine::init() {
-    pinMode(_pin, INPUT_PULLUP);
-    _currentState = digitalRead(_pin);
-    
-    // Initialize confidence based on initial state
-    if (_currentState == HIGH) {
-        _confidence = CONFIDENCE_THRESHOLD; // Assume stable HIGH
-    } else {
-        _confidence = 0; // Assume stable LOW
-    }
-    
-    _lastSampleTime = millis();
+void ButtonEngine::init(InputManager* inputs) {
+    // Pin setup, edge capture and debouncing all live in InputManager
+    _inputs = inputs;
+    _currentState = _inputs->getLevel(_pin);
+
     _pressStartTime = 0;
     _longPressHandled = false;
     _stateChanged = false;
-    _currentEvent = BUTTON_NO_EVENT;
+
+    _pressCount = 0;
+    _lastGestureCount = 0;
+    _lastReleaseTime = 0;
+    _gesturePending = false;
+    _lastEventTime = 0;
 }
 
 void ButtonEngine::update() {
-    // 1. Throttle Sampling (Run every 2ms)
-    // This creates a consistent integration window regardless of loop speed
-    if (millis() - _lastSampleTime < 2) return;
-    _lastSampleTime = millis();
-
-    _currentEvent = BUTTON_NO_EVENT; // Reset per sample? No, keep steady until consumed or next update?
-    // Actually per-loop reset is tricky with throttled update. 
-    // Ideally update() should be called every loop, and we set event only when state changes.
-    // Let's rely on _stateChanged flag.
-    
-    if (_stateChanged) _stateChanged = false; // Clear previous change flag only on next process step
-    // Wait, if we return early above, we don't clear flags.
-    // So calling code must check flags. Ideally events are one-shot.
-    // If we return, no new event.
-    
-    int reading = digitalRead(_pin);
-
-    // 2. Integrate Reading (Counter Method)
-    if (reading == HIGH) {
-        if (_confidence < CONFIDENCE_THRESHOLD) _confidence++;
-    } else {
-        if (_confidence > 0) _confidence--;
-    }
+    _stateChanged = false;
 
-    // 3. Hysteresis / Threshold Logic
-    int previousState = _currentState;
-    
-    // If confidence hits 0, it's definitely LOW
-    if (_confidence == 0 && _currentState == HIGH) {
-        _currentState = LOW;
-        _stateChanged = true;
-        
-        // EVENT: PRESSED
-        _pressStartTime = millis();
-        _longPressHandled = false;
-        _currentEvent = BUTTON_PRESSED; 
-    }
-    // If confidence hits MAX, it's definitely HIGH
-    else if (_confidence == CONFIDENCE_THRESHOLD && _currentState == LOW) {
-        _currentState = HIGH;
-        _stateChanged = true;
-        
-        // EVENT: RELEASED
-        _currentEvent = BUTTON_RELEASED;
+    // 1. Consume debounced transitions in the order they settled
+    int level;
+    unsigned long changeTime;
+    while (_inputs->takeChange(_pin, &level, &changeTime)) {
+        if (level != _currentState) commitState(level, changeTime);
     }
-    else {
-        // No State Change this cycle (or still integrating)
-        // Reset event if it was set in a previous call that didn't get consumed? 
-        // No, typically update() is called once per loop.
-        // If we sample every 2ms, we might set event multiple times? No, state changes once.
-    }
-    
-    // 4. Check for Long Press (only while held down)
+
+    unsigned long now = millis();
+
+    // 2. Check for Long Press (only while held down)
     if (_currentState == LOW && !_longPressHandled) {
-        if ((millis() - _pressStartTime) > LONG_PRESS_DELAY) { 
-            _currentEvent = BUTTON_HELD;
+        if (elapsedMs(now, _pressStartTime) > LONG_PRESS_DELAY) {
             _longPressHandled = true;
             _stateChanged = true; // Signal change for handling
+            _pressCount = 0;      // A hold is not part of a click gesture
+            _gesturePending = false;
+            pushEvent(BUTTON_HELD, _pressStartTime + LONG_PRESS_DELAY);
         }
     }
+
+    // 3. Close a multi-press gesture once no further press arrived in time
+    if (_gesturePending && _currentState == HIGH && elapsedMs(now, _lastReleaseTime) > MULTI_PRESS_WINDOW) {
+        _gesturePending = false;
+        _lastGestureCount = _pressCount;
+        if (_pressCount == 2) pushEvent(BUTTON_DOUBLE_CLICK, _lastReleaseTime);
+        else if (_pressCount >= 3) pushEvent(BUTTON_MULTI_PRESS, _lastReleaseTime);
+        _pressCount = 0;
+    }
+}
+
+void ButtonEngine::commitState(int level, unsigned long timeMs) {
+    _currentState = level;
+    _stateChanged = true;
+
+    if (level == LOW) {
+        // EVENT: PRESSED
+        _pressStartTime = timeMs;
+        _longPressHandled = false;
+        if (_pressCount > 0 && elapsedMs(timeMs, _lastReleaseTime) <= MULTI_PRESS_WINDOW) _pressCount++;
+        else _pressCount = 1;
+        _gesturePending = false;
+        pushEvent(BUTTON_PRESSED, timeMs);
+    } else {
+        // EVENT: RELEASED
+        _lastReleaseTime = timeMs;
+        _gesturePending = (_pressCount > 0);
+        pushEvent(BUTTON_RELEASED, timeMs);
+    }
+}
+
+void ButtonEngine::pushEvent(ButtonEvent e, unsigned long timeMs) {
+    uint8_t next = (_eventHead + 1) & (EVENT_QUEUE_SIZE - 1);
+    if (next == _eventTail) {
+        // Full: drop the oldest so the newest state is never lost
+        _eventTail = (_eventTail + 1) & (EVENT_QUEUE_SIZE - 1);
+    }
+    _events[_eventHead] = e;
+    _eventTimes[_eventHead] = timeMs;
+    _eventHead = next;
 }
 
 ButtonEvent ButtonEngine::getEvent() {
-    ButtonEvent e = _currentEvent;
-    _currentEvent = BUTTON_NO_EVENT; // Clear after reading
+    if (_eventTail == _eventHead) return BUTTON_NO_EVENT;
+    ButtonEvent e = _events[_eventTail];
+    _lastEventTime = _eventTimes[_eventTail];
+    _eventTail = (_eventTail + 1) & (EVENT_QUEUE_SIZE - 1); // Clear after reading
     return e;
 }
 
+bool ButtonEngine::hasEvent() {
+    return _eventTail != _eventHead;
+}
+
+bool ButtonEngine::isIdle() {
+    // A held button still has a long-press deadline to meet
+    return !_gesturePending && (_currentState == HIGH || _longPressHandled) &&
+           _eventTail == _eventHead;
+}
+
 bool ButtonEngine::isPressed() {
     return _currentState == LOW;
 }
@@ -106,3 +126,11 @@ bool ButtonEngine::hasChanged() {
 int ButtonEngine::getState() {
     return _currentState;
 }
+
+uint8_t ButtonEngine::getPressCount() {
+    return _lastGestureCount;
+}
+
+unsigned long ButtonEngine::getEventTime() {
+    return _lastEventTime;
+}
@@ -5,37 +5,59 @@
 
 enum ButtonEvent {
     BUTTON_NO_EVENT,
-    BUTTON_PRESSED,   // Short press
-    BUTTON_HELD,      // Long press
-    BUTTON_RELEASED
+    BUTTON_PRESSED,      // Short press
+    BUTTON_HELD,         // Long press
+    BUTTON_RELEASED,
+    BUTTON_DOUBLE_CLICK, // Two presses inside MULTI_PRESS_WINDOW
+    BUTTON_MULTI_PRESS   // Three or more presses, count via getPressCount()
 };
 
+class InputManager;
+
+// Turns the debounced transitions from InputManager into button events
+// (press, release, hold and multi-press gestures).
 class ButtonEngine {
 public:
     ButtonEngine(uint8_t pin);
-    void init();
+    void init(InputManager* inputs);
     void update();
-    ButtonEvent getEvent();
+    ButtonEvent getEvent();        // Pops the oldest queued event (NO_EVENT if empty)
+    bool hasEvent();
+    bool isIdle();                 // Released, no gesture open, no queued events
     bool isPressed();
     bool hasChanged();
     int getState(); // Returns stable, debounced HIGH/LOW
-    
+    uint8_t getPressCount();       // Presses in the last completed multi-press gesture
+    unsigned long getEventTime();  // millis() at which the last popped event happened
+
 private:
+    void commitState(int level, unsigned long timeMs); // timeMs: millis() it settled at
+    void pushEvent(ButtonEvent e, unsigned long timeMs);
+
     uint8_t _pin;
+    InputManager* _inputs;
     int _currentState;      // Stable state
-    
-    // New Debounce Members
-    int _confidence;        // Integrity counter
-    unsigned long _lastSampleTime;
-    
+
     unsigned long _pressStartTime;
     bool _longPressHandled;
     bool _stateChanged;
-    
-    ButtonEvent _currentEvent;
-    
-    const int CONFIDENCE_THRESHOLD = 50; // 50 * 2ms = 100ms settling time
+
+    // Multi-press gesture tracking
+    uint8_t _pressCount;
+    uint8_t _lastGestureCount;
+    unsigned long _lastReleaseTime;
+    bool _gesturePending;
+
+    // Output event queue, so two events in one loop pass are both delivered
+    static const uint8_t EVENT_QUEUE_SIZE = 8; // Power of two
+    ButtonEvent _events[EVENT_QUEUE_SIZE];
+    unsigned long _eventTimes[EVENT_QUEUE_SIZE];
+    uint8_t _eventHead;
+    uint8_t _eventTail;
+    unsigned long _lastEventTime;
+
     const unsigned long LONG_PRESS_DELAY = 2000;
+    const unsigned long MULTI_PRESS_WINDOW = 400;   // Max release-to-press gap in a gesture
 };
 
 #endif
@@ -1,5 +1,8 @@
 #include "BuzzerEngine.h"
 #include "Config.h"
+#include "TimingStats.h"
+
+extern TimingStats timingStats;
 
 BuzzerEngine::BuzzerEngine(uint8_t pin) {
     _pin = pin;
@@ -67,12 +70,14 @@ void BuzzerEngine::startPattern(PatternType pattern) {
     _currentPattern = pattern;
     _stepIndex = 0;
     _lastStateChangeTime = millis();
+    _stepStartUs = micros();
     
     // Initial state setup based on pattern
     // For all patterns, we start immediately with ON usually
     // But update() handles transitions. Let's set initial state here for clarity.
     if (pattern != PATTERN_NONE) {
         setBuzzer(true); 
+        timingStats.onRelayOn();
     } else {
         setBuzzer(false);
     }
@@ -87,9 +92,6 @@ void BuzzerEngine::update() {
         return;
     }
 
-    unsigned long now = millis();
-    unsigned long elapsed = now - _lastStateChangeTime;
-
     switch (_currentPattern) {
         case PATTERN_PRE_SEHRI:
             handlePreSehri();
@@ -118,97 +120,64 @@ void BuzzerEngine::handleSehriIftar() {
     handleAutoOffPattern();
 }
 
-void BuzzerEngine::handleAutoOffPattern() {
-    unsigned long now = millis();
-    unsigned long elapsed = now - _lastStateChangeTime;
-    
-    // Steps:
-    // 0: ON 5000ms
-    // 1: OFF 500ms
-    // 2-11: 5 short rings (ON 200ms, OFF 200ms)
-    
-    unsigned long currentDuration = 0;
-    bool nextState = false;
-
-    switch (_stepIndex) {
-        case 0: currentDuration = 5000; nextState = false; break;
-        case 1: currentDuration = 500;  nextState = true;  break;
-        case 2: currentDuration = 200;  nextState = false; break;
-        case 3: currentDuration = 200;  nextState = true;  break;
-        case 4: currentDuration = 200;  nextState = false; break;
-        case 5: currentDuration = 200;  nextState = true;  break;
-        case 6: currentDuration = 200;  nextState = false; break;
-        case 7: currentDuration = 200;  nextState = true;  break;
-        case 8: currentDuration = 200;  nextState = false; break;
-        case 9: currentDuration = 200;  nextState = true;  break;
-        case 10: currentDuration = 200; nextState = false; break;
+// Length of the current step of the running pattern. Even steps are ON,
+// odd steps are OFF in every pattern.
+unsigned long BuzzerEngine::stepDuration() const {
+    switch (_currentPattern) {
+        case PATTERN_PRE_SEHRI:
+        case PATTERN_SEHRI_IFTAR:
+            // 0: ON 5000ms, 1: OFF 500ms, 2-10: short rings (200ms ON/OFF)
+            if (_stepIndex == 0) return 5000;
+            if (_stepIndex == 1) return 500;
+            return 200;
+        case PATTERN_IFTAR:
+            // 0: ON 3000ms, 1: OFF 500ms, 2-6: short rings (200ms ON/OFF)
+            if (_stepIndex == 0) return 3000;
+            if (_stepIndex == 1) return 500;
+            return 200;
+        case PATTERN_PRAYER:
+            return ((_stepIndex % 2) == 0) ? _prayerBeepDuration : _prayerBeepGap;
+        default:
+            return 0;
     }
+}
 
-    if (elapsed >= currentDuration) {
-        _stepIndex++;
-        if (_stepIndex > 10) {
-            stop();
-        } else {
-            setBuzzer(nextState);
-            _lastStateChangeTime = now;
-        }
-    }
+unsigned long BuzzerEngine::getMsToNextStep() const {
+    if (_currentPattern == PATTERN_NONE) return ULONG_MAX;
+    unsigned long elapsed = millis() - _lastStateChangeTime;
+    unsigned long duration = stepDuration();
+    return (elapsed >= duration) ? 0 : duration - elapsed;
 }
 
-// Iftar: 3s ON, 3x Short Rings (200ms ON, 200ms OFF), then off.
-void BuzzerEngine::handleIftar() {
+// Moves to the next step once the current one is over; stops after lastStep
+void BuzzerEngine::advanceStep(int lastStep) {
     unsigned long now = millis();
-    unsigned long elapsed = now - _lastStateChangeTime;
-    
-    unsigned long currentDuration = 0;
-    bool nextState = false;
-
-    switch (_stepIndex) {
-        case 0: currentDuration = 3000; nextState = false; break;
-        case 1: currentDuration = 500;  nextState = true;  break;
-        case 2: currentDuration = 200;  nextState = false; break;
-        case 3: currentDuration = 200;  nextState = true;  break;
-        case 4: currentDuration = 200;  nextState = false; break;
-        case 5: currentDuration = 200;  nextState = true;  break;
-        case 6: currentDuration = 200;  nextState = false; break;
+    if (now - _lastStateChangeTime < stepDuration()) return;
+
+    uint32_t nowUs = micros();
+    timingStats.onSegment(stepDuration(), nowUs - _stepStartUs);
+    _stepStartUs = nowUs;
+    _stepIndex++;
+    if (_stepIndex > lastStep) {
+        stop();
+    } else {
+        setBuzzer((_stepIndex % 2) == 0);
+        _lastStateChangeTime = now;
     }
+}
 
-    if (elapsed >= currentDuration) {
-        _stepIndex++;
-        if (_stepIndex > 6) {
-            stop();
-        } else {
-            setBuzzer(nextState);
-            _lastStateChangeTime = now;
-        }
-    }
+void BuzzerEngine::handleAutoOffPattern() {
+    advanceStep(10);
+}
+
+// Iftar: 3s ON, 3x Short Rings (200ms ON, 200ms OFF), then off.
+void BuzzerEngine::handleIftar() {
+    advanceStep(6);
 }
 
 // Configurable Prayer Pattern
 void BuzzerEngine::handlePrayer() {
-    unsigned long now = millis();
-    unsigned long elapsed = now - _lastStateChangeTime;
-
-    // Determine current step duration
-    // Even steps (0, 2, 4...) are ON -> Duration
-    // Odd steps (1, 3, 5...) are OFF -> Gap
-    
-    unsigned long duration = ((_stepIndex % 2) == 0) ? _prayerBeepDuration : _prayerBeepGap;
-
-    if (elapsed >= duration) {
-        _stepIndex++;
-        
-        // Total steps = (2 * Count) - 1
-        // e.g. Count=2 -> Steps 0(ON), 1(OFF), 2(ON). Done after 2 finishes.
-        int totalSteps = (_prayerBeepCount * 2) - 1;
-        
-        if (_stepIndex >= totalSteps) {
-            stop();
-        } else {
-            // If next step is even -> ON, odd -> OFF
-            bool nextState = ((_stepIndex % 2) == 0);
-            setBuzzer(nextState);
-            _lastStateChangeTime = now;
-        }
-    }
+    // Total steps = (2 * Count) - 1
+    // e.g. Count=2 -> Steps 0(ON), 1(OFF), 2(ON). Done after 2 finishes.
+    advanceStep((_prayerBeepCount * 2) - 2);
 }
@@ -23,11 +23,13 @@ public:
     void configurePrayerPattern(int count, int duration, int gap);
     void configureSehriPattern(int duration, int interval);
     bool getBuzzerState() const { return _buzzerState; }
+    unsigned long getMsToNextStep() const; // ULONG_MAX when silent
 
 private:
     uint8_t _pin;
     PatternType _currentPattern;
     unsigned long _lastStateChangeTime;
+    uint32_t _stepStartUs = 0; // micros() of the same change, to time the segment
     int _stepIndex;
     bool _buzzerState; // true = ON (HIGH), false = OFF (LOW)
 
@@ -45,6 +47,8 @@ private:
     void handleIftar();
     void handlePrayer();
     void handleAutoOffPattern();
+    unsigned long stepDuration() const;
+    void advanceStep(int lastStep);
 };
 
 #endif
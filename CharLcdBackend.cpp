@@ -0,0 +1,110 @@
+#include "CharLcdBackend.h"
+#include <Wire.h>
+
+void CharLcdBackend::drawRun(uint8_t row, uint8_t col, const char* text, uint8_t len) {
+    if (_cursorRow != row || _cursorCol != col) {
+        setAddress(col, row);
+    }
+    writeChars(text, len);
+    _cursorRow = row;
+    _cursorCol = col + len; // HD44780 auto-increments the address
+}
+
+// --- Parallel (LiquidCrystal) ---
+
+// LCD Pinout: RS, EN, D4, D5, D6, D7
+ParallelLcdBackend::ParallelLcdBackend()
+    : _lcd(PIN_LCD_RS, PIN_LCD_EN, PIN_LCD_D4, PIN_LCD_D5, PIN_LCD_D6, PIN_LCD_D7) {}
+
+bool ParallelLcdBackend::begin(uint8_t cols, uint8_t rows) {
+    _cols = cols;
+    _lcd.begin(cols, rows); // Clears the panel and homes the cursor
+    _cursorRow = 0;
+    _cursorCol = 0;
+    return true; // No way to read back in write-only 4-bit wiring
+}
+
+void ParallelLcdBackend::setAddress(uint8_t col, uint8_t row) {
+    _lcd.setCursor(col, row);
+    _busBytes++;
+}
+
+void ParallelLcdBackend::writeChars(const char* text, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) _lcd.write((uint8_t)text[i]);
+    _busBytes += len;
+}
+
+// --- PCF8574 I2C backpack ---
+// Expander bits: P0 RS, P1 RW, P2 EN, P3 backlight, P4..P7 D4..D7
+
+#define PCF_RS        0x01
+#define PCF_EN        0x04
+#define PCF_BACKLIGHT 0x08
+
+bool I2cLcdBackend::begin(uint8_t cols, uint8_t rows) {
+    _cols = cols;
+    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+    Wire.setClock(400000);
+
+    Wire.beginTransmission(_address);
+    bool found = (Wire.endTransmission() == 0);
+
+    // HD44780 power-on reset into 4-bit mode (datasheet figure 24)
+    delay(50);
+    initNibble(0x03); delayMicroseconds(4500);
+    initNibble(0x03); delayMicroseconds(4500);
+    initNibble(0x03); delayMicroseconds(150);
+    initNibble(0x02);
+
+    queueByte(rows > 1 ? 0x28 : 0x20, false); // 4-bit, lines, 5x8 font
+    queueByte(0x0C, false);                   // Display on, no cursor
+    queueByte(0x06, false);                   // Entry mode: increment
+    queueByte(0x01, false);                   // Clear
+    flushQueue();
+    delayMicroseconds(2000);                  // Clear is the one slow command
+
+    _cursorRow = 0;
+    _cursorCol = 0;
+    return found;
+}
+
+void I2cLcdBackend::setAddress(uint8_t col, uint8_t row) {
+    // Rows 2/3 of 20x4 panels continue rows 0/1 in DDRAM
+    static const uint8_t rowOffsets[4] = { 0x00, 0x40, 0x00, 0x40 };
+    uint8_t addr = col + rowOffsets[row & 3] + (row >= 2 ? _cols : 0);
+    queueByte(0x80 | addr, false);
+}
+
+void I2cLcdBackend::writeChars(const char* text, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) queueByte((uint8_t)text[i], true);
+    flushQueue();
+}
+
+void I2cLcdBackend::queueByte(uint8_t value, bool isData) {
+    uint8_t flags = PCF_BACKLIGHT | (isData ? PCF_RS : 0);
+    queueNibble(value & 0xF0, flags);
+    queueNibble((value << 4) & 0xF0, flags);
+}
+
+void I2cLcdBackend::queueNibble(uint8_t nibble, uint8_t flags) {
+    if (_queued + 2 > QUEUE_SIZE) flushQueue();
+    // Data is latched on EN's falling edge. At 400 kHz the four expander
+    // writes of one character take ~100us, well over the 37us the
+    // controller needs, so no extra waits between characters.
+    _queue[_queued++] = nibble | flags | PCF_EN;
+    _queue[_queued++] = nibble | flags;
+}
+
+void I2cLcdBackend::flushQueue() {
+    if (_queued == 0) return;
+    Wire.beginTransmission(_address);
+    Wire.write(_queue, _queued);
+    Wire.endTransmission();
+    _busBytes += 1 + _queued; // Address byte + payload
+    _queued = 0;
+}
+
+void I2cLcdBackend::initNibble(uint8_t nibble) {
+    queueNibble(nibble << 4, PCF_BACKLIGHT);
+    flushQueue();
+}
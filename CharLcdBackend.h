@@ -0,0 +1,65 @@
+#ifndef CHAR_LCD_BACKEND_H
+#define CHAR_LCD_BACKEND_H
+
+#include <Arduino.h>
+#include <LiquidCrystal.h>
+#include "DisplayBackend.h"
+
+// Common part of the HD44780 backends: tracks where the controller's
+// address counter points so a run that continues where the last one ended
+// needs no set-address command.
+class CharLcdBackend : public DisplayBackend {
+public:
+    void drawRun(uint8_t row, uint8_t col, const char* text, uint8_t len) override;
+
+protected:
+    virtual void setAddress(uint8_t col, uint8_t row) = 0;
+    virtual void writeChars(const char* text, uint8_t len) = 0;
+
+    uint8_t _cols = LCD_COLS;
+    int8_t _cursorRow = -1;
+    int8_t _cursorCol = -1;
+};
+
+// HD44780 on six GPIOs in 4-bit mode (the original wiring)
+class ParallelLcdBackend : public CharLcdBackend {
+public:
+    ParallelLcdBackend();
+    bool begin(uint8_t cols, uint8_t rows) override;
+    const char* name() override { return "lcd-parallel"; }
+
+protected:
+    void setAddress(uint8_t col, uint8_t row) override;
+    void writeChars(const char* text, uint8_t len) override;
+
+private:
+    LiquidCrystal _lcd;
+};
+
+// HD44780 behind a PCF8574 I2C expander (the usual "I2C backpack").
+// Frees the six LCD GPIOs. Every nibble costs two expander writes (EN high,
+// EN low), so a whole run is packed into as few I2C transactions as the
+// Wire buffer allows instead of one transaction per character.
+class I2cLcdBackend : public CharLcdBackend {
+public:
+    I2cLcdBackend(uint8_t address) : _address(address) {}
+    bool begin(uint8_t cols, uint8_t rows) override;
+    const char* name() override { return "lcd-i2c"; }
+
+protected:
+    void setAddress(uint8_t col, uint8_t row) override;
+    void writeChars(const char* text, uint8_t len) override;
+
+private:
+    void queueByte(uint8_t value, bool isData);
+    void queueNibble(uint8_t nibble, uint8_t flags);
+    void flushQueue();
+    void initNibble(uint8_t nibble);
+
+    static const uint8_t QUEUE_SIZE = 32; // Under the Wire TX buffer
+    uint8_t _address;
+    uint8_t _queue[QUEUE_SIZE];
+    uint8_t _queued = 0;
+};
+
+#endif
@@ -25,6 +25,10 @@
 #define PIN_BUTTON_HOUSE_A   16
 #define PIN_BUTTON_HOUSE_B   17
 
+// Free pin the benchmarks drive a throwaway BuzzerEngine on
+// (onboard LED on most DevKits, so it just blinks)
+#define PIN_BENCH_SCRATCH    2
+
 // --- LCD Pin Definitions (4-bit mode) ---
 #define PIN_LCD_RS    21
 #define PIN_LCD_EN    22
@@ -33,11 +37,71 @@
 #define PIN_LCD_D6    18
 #define PIN_LCD_D7    5
 
+// Panel geometry (16x2 or 20x4)
+#define LCD_COLS      16
+#define LCD_ROWS      2
+
+// --- Display Backend ---
+#define DISPLAY_PARALLEL_LCD 0 // HD44780 on the six pins above
+#define DISPLAY_I2C_LCD      1 // HD44780 with PCF8574 backpack (2 pins)
+#define DISPLAY_SSD1306      2 // 128x64 I2C OLED, text grid LCD_COLS x LCD_ROWS
+#define DISPLAY_TERMINAL     3 // ANSI terminal on Serial (bench / host build)
+
+#ifndef DISPLAY_BACKEND
+#define DISPLAY_BACKEND DISPLAY_PARALLEL_LCD
+#endif
+
+// I2C bus for the I2C backends
+#define PIN_I2C_SDA   21
+#define PIN_I2C_SCL   22
+#define I2C_LCD_ADDRESS  0x27 // 0x3F on some PCF8574A backpacks
+#define SSD1306_ADDRESS  0x3C
+
 // --- Timing Constants ---
 #define PRE_SEHRI_OFFSET_MINUTES 60
 #define SEHRI_WAKE_OFFSET_MINUTES 45 // Wake up 45 mins before end
 #define NTP_SYNC_INTERVAL_HOURS  12
 
+// Longest a single loop() pass may take before it counts as an overrun
+// (/api/tasks). The shortest buzzer steps are 50-200 ms, so stay well below.
+#define LOOP_PASS_BUDGET_US      20000
+
+// --- Power ---
+// Between passes the loop blocks until the next task is due. With tickless
+// idle in the ESP-IDF build the chip light-sleeps there (the button pins
+// are armed as GPIO wakeups), otherwise the CPU only drops to
+// CPU_FREQ_MIN_MHZ. IDLE_MAX_MS caps one nap so serial input and anything
+// without its own wakeup are still seen promptly.
+#define LIGHT_SLEEP_ENABLED      1
+#define CPU_FREQ_MAX_MHZ         240
+#define CPU_FREQ_MIN_MHZ         80  // Keeps the 80 MHz APB clock for UART/I2C
+#define IDLE_MAX_MS              100
+
+// Deep sleep wakes the measured boot-to-ready time plus this margin before
+// the next event. The RTC timer drift guard is wide until the first NTP
+// sync after a wake has measured the real drift.
+#define SLEEP_WAKE_MARGIN_SEC          30
+#define SLEEP_MIN_NAP_SEC              120
+#define SLEEP_DEFAULT_READY_MS         10000 // Until a boot has been measured
+#define SLEEP_DRIFT_GUARD_PPM          20000 // 2%
+#define SLEEP_DRIFT_GUARD_MEASURED_PPM 3000
+#define SLEEP_DRIFT_MIN_SAMPLE_SEC     1800  // Shorter naps are too noisy to measure
+
+// --- Logging ---
+// LOG_x() calls above LOG_LEVEL compile to nothing, arguments included.
+// The rest land in a RAM ring that a low priority task drains to Serial
+// and /api/log reads, so a full UART never holds up the loop.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#define LOG_RING_SIZE   4096 // Bytes; roughly the last 100 lines
+
 // --- Buzzer Pattern Definitions (in ms) ---
 #define TONE_SHORT_DURATION 300
 #define TONE_LONG_DURATION  800
@@ -60,6 +124,55 @@
 #define STATIC_DNS1    "8.8.8.8"
 #define STATIC_DNS2    "8.8.4.4"
 
+// --- MQTT (building management) ---
+// Alarm events, acks, the next event and device health go to this broker.
+// IPv4 address only (no DNS lookup in the loop); "" turns MQTT off.
+#ifndef MQTT_BROKER
+#define MQTT_BROKER         ""
+#endif
+#ifndef MQTT_PORT
+#define MQTT_PORT           1883
+#endif
+#define MQTT_USER           ""
+#define MQTT_PASSWORD       ""
+#define MQTT_TOPIC_PREFIX   "ramzan/alarm1"  // One per unit
+#define MQTT_KEEPALIVE_SEC  60
+#define MQTT_STATUS_INTERVAL_MS 60000        // Heap, RSSI, uptime
+#define MQTT_BATCH_MS       10000  // Low priority messages wait this long to share a send
+#define MQTT_TX_BUFFER      1024
+#define MQTT_CONNECT_TIMEOUT_MS 5000
+#define MQTT_RETRY_MIN_MS   2000   // Doubles per failed attempt
+#define MQTT_RETRY_MAX_MS   60000
+#define MQTT_REPLAY_MAX     16     // Acks from while the broker was away, sent late
+
+// --- Multi-unit sync ---
+// Units on the same LAN agree on one clock and start automatic alarms
+// together. Every unit in a building must use the same group and margin.
+#define SYNC_ENABLED        1
+#define SYNC_GROUP          "239.255.42.99"  // Site-local multicast
+#define SYNC_PORT           45999
+#define SYNC_BEACON_MS      1000
+#define SYNC_POLL_MS        1000   // Offset exchange with the leader
+#define SYNC_PEER_TIMEOUT_MS 5000  // Silent this long = gone
+#define SYNC_SAMPLES        16     // Exchanges to pick the best one from
+#define SYNC_START_MARGIN_MS 2000  // Alarms start this long into their minute
+
+// --- OTA ---
+// /update only takes images signed with this key by `ramzan_ota sign`
+// (HMAC-SHA256 over the image hash). Change it before the first flash and
+// build the host tool with the same Config.h; /update refuses every upload
+// while it is still OTA_SIGN_KEY_DEFAULT, which anyone can look up.
+#define OTA_SIGN_KEY_DEFAULT "change-me-ramzan-ota"
+#define OTA_SIGN_KEY        OTA_SIGN_KEY_DEFAULT
+#define OTA_HEALTHY_MS      60000  // Loop running this long without a stall confirms a new image
+#define OTA_LOOP_GAP_MS     2000   // Longer than this between ota task runs counts as a stall
+#define OTA_CONFIRM_MS      600000 // A new image not confirmed by then goes back to the old one
+#define OTA_BOOT_TRIES      3      // Or after this many boots without getting there
+
+// --- Schedule API ---
+#define SCHEDULE_DEFAULT_DAYS 7    // /api/schedule without ?days=
+#define SCHEDULE_MAX_DAYS     62   // Two months
+
 // --- Timezone Settings (NTP) ---
 // Adjust for your location. Example: India is UTC +5:30 = 5.5 * 3600 = 19800
 #define GMT_OFFSET_SEC      19800 
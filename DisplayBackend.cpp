@@ -0,0 +1,17 @@
+#include "DisplayBackend.h"
+#include "CharLcdBackend.h"
+#include "OledBackend.h"
+#include "TerminalBackend.h"
+
+DisplayBackend* createDisplayBackend() {
+#if DISPLAY_BACKEND == DISPLAY_I2C_LCD
+    static I2cLcdBackend backend(I2C_LCD_ADDRESS);
+#elif DISPLAY_BACKEND == DISPLAY_SSD1306
+    static Ssd1306Backend backend(SSD1306_ADDRESS);
+#elif DISPLAY_BACKEND == DISPLAY_TERMINAL
+    static TerminalBackend backend;
+#else
+    static ParallelLcdBackend backend;
+#endif
+    return &backend;
+}
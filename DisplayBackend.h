@@ -0,0 +1,35 @@
+#ifndef DISPLAY_BACKEND_H
+#define DISPLAY_BACKEND_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// A character-grid display. DisplayManager keeps the shadow copy and only
+// hands the backend runs of cells that actually changed, so a backend just
+// has to put `len` characters at (col, row) as cheaply as its bus allows.
+class DisplayBackend {
+public:
+    virtual ~DisplayBackend() {}
+
+    // Returns false if the panel did not answer (drawing then goes nowhere)
+    virtual bool begin(uint8_t cols, uint8_t rows) = 0;
+
+    virtual void drawRun(uint8_t row, uint8_t col, const char* text, uint8_t len) = 0;
+
+    // Called once after all runs of a frame. Buffered backends push here.
+    virtual void present() {}
+
+    virtual const char* name() = 0;
+
+    // Bytes put on the panel bus since begin() (commands + data, incl. I2C
+    // addressing), so backends can be compared by actual wire cost
+    uint32_t getBusBytes() { return _busBytes; }
+
+protected:
+    uint32_t _busBytes = 0;
+};
+
+// Backend selected by DISPLAY_BACKEND in Config.h
+DisplayBackend* createDisplayBackend();
+
+#endif
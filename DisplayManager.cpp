@@ -1,68 +1,164 @@
 #include "DisplayManager.h"
-#include "Config.h"
+#include "StallMonitor.h"
+#include "Log.h"
 
-// Initialize the library with the numbers of the interface pins
-// LCD Pinout: RS, EN, D4, D5, D6, D7
-LiquidCrystal lcd(PIN_LCD_RS, PIN_LCD_EN, PIN_LCD_D4, PIN_LCD_D5, PIN_LCD_D6, PIN_LCD_D7);
+static_assert(LCD_ROWS >= 2 && LCD_ROWS <= 4 && LCD_COLS <= 20, "Supported panels: 16x2 .. 20x4");
 
-// LCD Pinout: RS, EN, D4, D5, D6, D7
-// Ensure Config.h is included if needed for pins, but usually pins are passed to constructor or defined globally.
-// Assuming global pins or fixed pins. The original code has hardcoded pins in constructor call.
+// Guards _frame between the posting task (loop) and the LCD writer task
+static portMUX_TYPE s_frameLock = portMUX_INITIALIZER_UNLOCKED;
 
 void DisplayManager::init() {
-    // Initialize LCD (16 columns, 2 rows)
-    lcd.begin(16, 2);
-    
-    lcd.setCursor(0, 0);
-    lcd.print("Ramzan Alarm    ");
-    lcd.setCursor(0, 1);
-    lcd.print("System Booting  ");
-    
-    _currentL1 = "Ramzan Alarm";
-    _currentL2 = "System Booting";
-    
-    delay(2000);
+    _backend = createDisplayBackend();
+    if (!_backend->begin(LCD_COLS, LCD_ROWS)) {
+        LOG_W("Display: no panel answering on %s", _backend->name());
+    } else {
+        LOG_I("Display: %s", _backend->name());
+    }
+
+    // begin() leaves the panel blank
+    memset(_shadow, ' ', sizeof(_shadow));
+    memset(_frame, ' ', sizeof(_frame));
+    _busBytesAtMinuteStart = _backend->getBusBytes();
+    _minuteStart = millis();
+
+    // Writer runs on core 0 at low priority, so it only uses time WiFi
+    // leaves idle. If it cannot be created we fall back to drawing inline.
+    if (xTaskCreatePinnedToCore(lcdTask, "lcd", 2048, this, 1, &_task, 0) != pdPASS) {
+        _task = nullptr;
+    }
+
+    // Splash stays up for 2 s while setup() carries on underneath
+    setOverrideMessage("Ramzan Alarm", "System Booting", 2000);
 }
 
-void DisplayManager::update(String timeStr, String statusMsg) {
+void DisplayManager::update(const char* timeStr, const char* statusMsg) {
     if (isMessageActive()) return;
     showMessage(timeStr, statusMsg);
 }
 
-void DisplayManager::showMessage(String line1, String line2) {
-    if (isMessageActive() && !line1.startsWith("WiFi")) return;
+void DisplayManager::showMessage(const char* line1, const char* line2) {
+    const char* lines[2] = { line1, line2 };
+    showLines(lines, 2);
+}
 
-    // Optimization: Don't redraw if content is exactly the same
-    if (line1 == _currentL1 && line2 == _currentL2) return;
+void DisplayManager::showLines(const char* const* lines, uint8_t count) {
+    if (isMessageActive() && !(count > 0 && lines[0] && strncmp(lines[0], "WiFi", 4) == 0)) return;
 
-    // Pad Line 1
-    String p1 = line1;
-    while(p1.length() < 16) p1 += " ";
-    if (p1.length() > 16) p1 = p1.substring(0, 16);
+    uint32_t start = micros();
 
-    // Pad Line 2
-    String p2 = line2;
-    while(p2.length() < 16) p2 += " ";
-    if (p2.length() > 16) p2 = p2.substring(0, 16);
+    // Pad / truncate on the stack, no String temporaries
+    char frame[LCD_ROWS][LCD_COLS];
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        const char* text = row < count ? lines[row] : "";
+        uint8_t n = 0;
+        if (text) {
+            while (n < LCD_COLS && text[n]) { frame[row][n] = text[n]; n++; }
+        }
+        while (n < LCD_COLS) frame[row][n++] = ' ';
+    }
 
-    // Write if changed
-    if (p1 != _currentL1) {
-        lcd.setCursor(0, 0);
-        lcd.print(p1);
-        _currentL1 = p1;
+    bool changed = false;
+    portENTER_CRITICAL(&s_frameLock);
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        if (memcmp(frame[row], _frame[row], LCD_COLS) != 0) {
+            // The old renderer re-sent the whole line whenever anything changed
+            _legacyBytes += 1 + LCD_COLS;
+            memcpy(_frame[row], frame[row], LCD_COLS);
+            changed = true;
+        }
     }
-    
-    if (p2 != _currentL2) {
-        lcd.setCursor(0, 1);
-        lcd.print(p2);
-        _currentL2 = p2;
+    portEXIT_CRITICAL(&s_frameLock);
+
+    if (changed) {
+        if (_task) xTaskNotifyGive(_task); // Latest frame wins; writer picks it up
+        else flushFrame();
     }
+
+    uint32_t spent = micros() - start;
+    _callMicros += spent;
+    _callCount++;
+    if (spent > _maxCallMicros) _maxCallMicros = spent;
 }
 
-void DisplayManager::setOverrideMessage(String l1, String l2, unsigned long durationMs) {
-    _messageExpiry = millis() + durationMs;
-    // Clear and Write immediately
+void DisplayManager::lcdTask(void* arg) {
+    DisplayManager* self = (DisplayManager*)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->flushFrame();
+    }
+}
+
+// Brings the glass up to date with the latest frame
+void DisplayManager::flushFrame() {
+    Breadcrumb crumb(STAGE_LCD_FLUSH);
+    uint32_t start = micros();
+
+    char frame[LCD_ROWS][LCD_COLS];
+    portENTER_CRITICAL(&s_frameLock);
+    memcpy(frame, _frame, sizeof(frame));
+    portEXIT_CRITICAL(&s_frameLock);
+
+    rollBusCounters();
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        renderRow(row, frame[row]);
+    }
+    _backend->present();
+
+    _flushMicros += (uint32_t)(micros() - start);
+    _flushCount++;
+}
+
+// Sends only the cells of `row` that differ from the shadow copy.
+// Changed cells separated by a single unchanged cell are sent as one run,
+// since on the character LCDs rewriting that cell costs the same bus byte
+// as another set-address command.
+void DisplayManager::renderRow(uint8_t row, const char* target) {
+    char* shadow = _shadow[row];
+    if (memcmp(target, shadow, LCD_COLS) == 0) return;
+
+    uint8_t col = 0;
+    while (col < LCD_COLS) {
+        if (target[col] == shadow[col]) { col++; continue; }
+
+        uint8_t end = col + 1;
+        while (end < LCD_COLS) {
+            if (target[end] != shadow[end]) { end++; continue; }
+            if (end + 1 < LCD_COLS && target[end + 1] != shadow[end + 1]) { end += 2; continue; }
+            break;
+        }
+
+        _backend->drawRun(row, col, &target[col], end - col);
+        memcpy(&shadow[col], &target[col], end - col);
+        col = end;
+    }
+}
+
+void DisplayManager::rollBusCounters() {
+    if (millis() - _minuteStart < 60000) return;
+    uint32_t busBytes = _backend->getBusBytes();
+    _busBytesLastMinute = busBytes - _busBytesAtMinuteStart;
+    _busBytesAtMinuteStart = busBytes;
+    portENTER_CRITICAL(&s_frameLock);
+    _legacyBytesLastMinute = _legacyBytes; // Counted on the posting side
+    _legacyBytes = 0;
+    portEXIT_CRITICAL(&s_frameLock);
+    _minuteStart = millis();
+}
+
+void DisplayManager::setOverrideMessage(const char* l1, const char* l2, unsigned long durationMs) {
+    // Clear and Write immediately (lift any older override first so the
+    // new text is not blocked by it)
+    _messageExpiry = 0;
     showMessage(l1, l2);
+    _messageExpiry = millis() + durationMs;
+}
+
+FixedString<LCD_COLS + 1> DisplayManager::getCurrentLine(uint8_t row) {
+    FixedString<LCD_COLS + 1> line;
+    portENTER_CRITICAL(&s_frameLock);
+    line.append(_frame[row], LCD_COLS);
+    portEXIT_CRITICAL(&s_frameLock);
+    return line;
 }
 
 bool DisplayManager::isMessageActive() {
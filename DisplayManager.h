@@ -2,28 +2,75 @@
 #define DISPLAY_MANAGER_H
 
 #include <Arduino.h>
-#include <Arduino.h>
-#include <LiquidCrystal.h>
+#include "Config.h"
+#include "DisplayBackend.h"
+#include "FixedString.h"
 
+// LCD front end. showMessage()/showLines() only post a frame and return;
+// a background task hands the changed cells to the display backend
+// (see DisplayBackend.h) so bus waits never run inside loop(). If frames
+// arrive faster than the bus can take them, only the latest one is drawn.
 class DisplayManager {
 public:
     void init();
-    void update(String timeStr, String statusMsg);
-    void showMessage(String line1, String line2);
-    
+    void update(const char* timeStr, const char* statusMsg);
+    void showMessage(const char* line1, const char* line2);
+
+    // Full-screen variant for 20x4 panels (rows beyond `count` are blanked)
+    void showLines(const char* const* lines, uint8_t count);
+
     // New methods for message override and live preview (PUBLIC)
-    void setOverrideMessage(String l1, String l2, unsigned long durationMs = 5000);
+    void setOverrideMessage(const char* l1, const char* l2, unsigned long durationMs = 5000);
     bool isMessageActive();
-    
-    // Current display content (for preview)
-    String getCurrentLine1() { return _currentL1; }
-    String getCurrentLine2() { return _currentL2; }
+
+    // Current display content (for preview): the latest posted frame
+    FixedString<LCD_COLS + 1> getCurrentLine1() { return getCurrentLine(0); }
+    FixedString<LCD_COLS + 1> getCurrentLine2() { return getCurrentLine(1); }
+    FixedString<LCD_COLS + 1> getCurrentLine(uint8_t row);
+
+    // Bus traffic: bytes (commands + characters) the backend sent during the
+    // last full minute, and what the old whole-line renderer would have sent.
+    uint32_t getBusBytesPerMinute() { return _busBytesLastMinute; }
+    uint32_t getLegacyBusBytesPerMinute() { return _legacyBytesLastMinute; }
+
+    // Loop time spent inside showMessage()/showLines(), and writer task time
+    uint32_t getAverageCallMicros() { return _callCount ? (uint32_t)(_callMicros / _callCount) : 0; }
+    uint32_t getMaxCallMicros() { return _maxCallMicros; }
+    uint32_t getAverageFlushMicros() { return _flushCount ? (uint32_t)(_flushMicros / _flushCount) : 0; }
+    bool isAsync() { return _task != nullptr; }
+    const char* getBackendName() { return _backend->name(); }
 
 private:
+    static void lcdTask(void* arg);
+    void flushFrame();
+    void renderRow(uint8_t row, const char* target);
+    void rollBusCounters();
+
     unsigned long _lastUpdate;
     unsigned long _messageExpiry = 0;
-    String _currentL1;
-    String _currentL2;
+
+    // Latest requested frame (written by the caller, read by the writer task)
+    char _frame[LCD_ROWS][LCD_COLS];
+
+    // What is currently on the glass, cell by cell. Only cells that differ
+    // from the requested frame are sent over the bus. Owned by the writer.
+    char _shadow[LCD_ROWS][LCD_COLS];
+
+    DisplayBackend* _backend = nullptr;
+
+    TaskHandle_t _task = nullptr;
+
+    uint32_t _busBytesAtMinuteStart = 0;
+    uint32_t _legacyBytes = 0;
+    volatile uint32_t _busBytesLastMinute = 0;
+    volatile uint32_t _legacyBytesLastMinute = 0;
+    unsigned long _minuteStart = 0;
+
+    uint64_t _callMicros = 0;
+    uint32_t _callCount = 0;
+    uint32_t _maxCallMicros = 0;
+    uint64_t _flushMicros = 0;
+    uint32_t _flushCount = 0;
 };
 
 #endif
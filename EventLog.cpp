@@ -0,0 +1,212 @@
+#include "EventLog.h"
+#include "StallMonitor.h"
+#include "Log.h"
+#include <sys/time.h>
+
+const char* eventTypeName(uint8_t type) {
+    switch (type) {
+        case EVENT_BOOT:        return "boot";
+        case EVENT_ALARM_START: return "alarm_start";
+        case EVENT_ALARM_STOP:  return "alarm_stop";
+        case EVENT_ACK:         return "ack";
+        case EVENT_OTA_START:   return "ota_start";
+        case EVENT_OTA_DONE:    return "ota_done";
+        case EVENT_OTA_FAIL:    return "ota_fail";
+        case EVENT_DEEP_SLEEP:  return "deep_sleep";
+        case EVENT_SETTINGS:    return "settings";
+        case EVENT_STALL:       return "stall";
+        case EVENT_OTA_ROLLBACK: return "ota_rollback";
+        default:                return "unknown";
+    }
+}
+
+bool EventLog::init() {
+    _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "evlog");
+    if (!_part || _part->size < 2 * SECTOR_SIZE) {
+        LOG_W("EventLog: no 'evlog' partition, history disabled");
+        _part = nullptr;
+        return false;
+    }
+    _sectors = _part->size / SECTOR_SIZE;
+    uint32_t total = (uint32_t)_sectors * RECORDS_PER_SECTOR;
+
+    // Newest sector = highest first seq; the oldest one bounds getCount()
+    int32_t newest = -1;
+    uint32_t newestSeq = 0;
+    _oldestSeq = UINT32_MAX;
+    for (uint16_t s = 0; s < _sectors; s++) {
+        uint32_t seq = firstSeqIn(s);
+        if (seq == UINT32_MAX) continue;
+        if (newest < 0 || seq > newestSeq) { newest = s; newestSeq = seq; }
+        if (seq < _oldestSeq) _oldestSeq = seq;
+    }
+
+    if (newest < 0) {
+        // Empty (or never formatted)
+        _head = 0;
+        _nextSeq = 1;
+        _oldestSeq = 1;
+        if (!sectorBlank(0)) eraseSector(0);
+    } else {
+        // Head = one past the last written slot of the newest sector
+        _nextSeq = newestSeq + 1;
+        _head = (uint32_t)newest * RECORDS_PER_SECTOR;
+        EventRecord rec;
+        for (uint16_t i = 0; i < RECORDS_PER_SECTOR; i++) {
+            uint32_t slot = (uint32_t)newest * RECORDS_PER_SECTOR + i;
+            if (!readSlot(slot, rec)) continue;
+            if (isBlank(rec)) break;
+            _head = slot + 1;
+            if (isValid(rec) && rec.seq >= _nextSeq) _nextSeq = rec.seq + 1;
+        }
+        _head %= total;
+
+        // Newest sector was full: the next one has to be usable right away
+        if (_head % RECORDS_PER_SECTOR == 0 && !sectorBlank(_head / RECORDS_PER_SECTOR)) {
+            eraseSector(_head / RECORDS_PER_SECTOR);
+        }
+    }
+
+    // Keep the sector after the head erased (a power cut may have torn it)
+    uint16_t ahead = (_head / RECORDS_PER_SECTOR + 1) % _sectors;
+    if (!sectorBlank(ahead)) _eraseSector = ahead;
+
+    LOG_I("EventLog: %lu events, next #%lu, %u sectors",
+          (unsigned long)getCount(), (unsigned long)_nextSeq, _sectors);
+    return true;
+}
+
+bool EventLog::append(uint8_t type, uint8_t house, uint8_t detail,
+                      uint32_t durationMs, uint32_t ackLatencyMs) {
+    if (!_part) return false;
+    unsigned long start = micros();
+
+    uint32_t total = (uint32_t)_sectors * RECORDS_PER_SECTOR;
+    if (_head % RECORDS_PER_SECTOR == 0) {
+        // Entering a new sector; update() should have erased it already
+        uint16_t sector = _head / RECORDS_PER_SECTOR;
+        if (_eraseSector == sector) {
+            eraseSector(sector);
+        }
+        _eraseSector = (sector + 1) % _sectors;
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+
+    EventRecord rec;
+    rec.seq = _nextSeq;
+    rec.time = (tv.tv_sec > 1600000000) ? (uint32_t)tv.tv_sec : 0;
+    rec.durationDs = (uint16_t)min(durationMs / 100, (uint32_t)0xFFFF);
+    rec.ackLatencyDs = (uint16_t)min(ackLatencyMs / 100, (uint32_t)0xFFFF);
+    rec.type = type;
+    rec.house = house;
+    rec.detail = detail;
+    rec.crc = crc8((const uint8_t*)&rec, sizeof(rec) - 1);
+
+    esp_err_t err = esp_partition_write(_part, _head * sizeof(EventRecord), &rec, sizeof(rec));
+    // The slot is used up even if the write failed
+    _head = (_head + 1) % total;
+    _nextSeq++;
+
+    uint32_t spent = micros() - start;
+    if (spent > _maxAppendUs) _maxAppendUs = spent;
+    return err == ESP_OK;
+}
+
+void EventLog::update() {
+    if (_eraseSector < 0) return;
+    uint16_t sector = _eraseSector;
+    _eraseSector = -1;
+    // First lap over the partition: nothing to erase
+    if (!sectorBlank(sector)) {
+        Breadcrumb crumb(STAGE_FLASH_ERASE);
+        eraseSector(sector);
+    }
+}
+
+uint32_t EventLog::begin() {
+    // Oldest data starts right after the erased sector ahead of the head
+    return ((_head / RECORDS_PER_SECTOR + 1) % _sectors) * (uint32_t)RECORDS_PER_SECTOR;
+}
+
+uint16_t EventLog::read(uint32_t& cursor, EventRecord* out, uint16_t max) {
+    if (!_part || max == 0) return 0;
+    uint32_t total = (uint32_t)_sectors * RECORDS_PER_SECTOR;
+    uint16_t got = 0;
+
+    while (got == 0 && cursor != _head) {
+        uint32_t inSector = RECORDS_PER_SECTOR - cursor % RECORDS_PER_SECTOR;
+        uint32_t toHead = (_head + total - cursor) % total;
+        uint16_t n = (uint16_t)min(min(inSector, toHead), (uint32_t)max);
+        if (esp_partition_read(_part, cursor * sizeof(EventRecord), out, n * sizeof(EventRecord)) != ESP_OK) {
+            return 0;
+        }
+        // Sectors are filled front to back: blank at the start = empty sector
+        if (cursor % RECORDS_PER_SECTOR == 0 && isBlank(out[0])) {
+            cursor = (cursor + inSector) % total;
+            continue;
+        }
+        for (uint16_t i = 0; i < n; i++) {
+            if (isValid(out[i])) out[got++] = out[i];
+        }
+        cursor = (cursor + n) % total;
+    }
+    return got;
+}
+
+// --- Flash helpers ---
+
+uint8_t EventLog::crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+    return crc;
+}
+
+bool EventLog::readSlot(uint32_t slot, EventRecord& rec) {
+    return esp_partition_read(_part, slot * sizeof(EventRecord), &rec, sizeof(rec)) == ESP_OK;
+}
+
+bool EventLog::isValid(const EventRecord& rec) {
+    if (rec.type < EVENT_BOOT || rec.type >= EVENT_TYPE_COUNT) return false;
+    return rec.crc == crc8((const uint8_t*)&rec, sizeof(rec) - 1);
+}
+
+bool EventLog::isBlank(const EventRecord& rec) {
+    const uint32_t* w = (const uint32_t*)&rec;
+    return (w[0] & w[1] & w[2] & w[3]) == 0xFFFFFFFF;
+}
+
+bool EventLog::sectorBlank(uint16_t sector) {
+    uint32_t buf[64];
+    for (uint32_t off = 0; off < SECTOR_SIZE; off += sizeof(buf)) {
+        if (esp_partition_read(_part, sector * SECTOR_SIZE + off, buf, sizeof(buf)) != ESP_OK) return false;
+        for (uint8_t i = 0; i < 64; i++) {
+            if (buf[i] != 0xFFFFFFFF) return false;
+        }
+    }
+    return true;
+}
+
+void EventLog::eraseSector(uint16_t sector) {
+    esp_partition_erase_range(_part, sector * SECTOR_SIZE, SECTOR_SIZE);
+    _erases++;
+
+    // Whatever was in it is gone; the next sector now holds the oldest events
+    uint32_t first = firstSeqIn((sector + 1) % _sectors);
+    if (first != UINT32_MAX && first > _oldestSeq) _oldestSeq = first;
+}
+
+// Seq of the first valid record in a sector, UINT32_MAX if it has none
+uint32_t EventLog::firstSeqIn(uint16_t sector) {
+    EventRecord rec;
+    for (uint16_t i = 0; i < RECORDS_PER_SECTOR; i++) {
+        if (!readSlot((uint32_t)sector * RECORDS_PER_SECTOR + i, rec)) return UINT32_MAX;
+        if (isBlank(rec)) return UINT32_MAX;
+        if (isValid(rec)) return rec.seq;
+    }
+    return UINT32_MAX;
+}
@@ -0,0 +1,97 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+enum EventType : uint8_t {
+    EVENT_BOOT = 1,      // detail = esp_reset_reason()
+    EVENT_ALARM_START,   // detail = SystemState that rang
+    EVENT_ALARM_STOP,    // detail = SystemState, duration = ring time
+    EVENT_ACK,           // detail = SystemState, house = who, ackLatency = since ring start
+    EVENT_OTA_START,
+    EVENT_OTA_DONE,
+    EVENT_OTA_FAIL,
+    EVENT_DEEP_SLEEP,
+    EVENT_SETTINGS,
+    EVENT_STALL,         // detail = StallStage running at the reset, duration = time in it
+    EVENT_OTA_ROLLBACK,  // detail = OtaManager::RollbackReason
+    EVENT_TYPE_COUNT     // One past the last type: new types go above this
+};
+
+enum EventHouse : uint8_t {
+    HOUSE_NONE = 0,
+    HOUSE_A = 1,
+    HOUSE_B = 2,
+    HOUSE_BOTH = 3
+};
+
+const char* eventTypeName(uint8_t type);
+
+// One fixed-size record; an erased slot reads as all 0xFF
+struct EventRecord {
+    uint32_t seq;          // Increments forever, finds the head after boot
+    uint32_t time;         // Epoch seconds, 0 = clock not set yet
+    uint16_t durationDs;   // Deciseconds
+    uint16_t ackLatencyDs; // Deciseconds
+    uint8_t type;
+    uint8_t house;
+    uint8_t detail;
+    uint8_t crc;           // CRC-8 of the bytes above; catches torn writes
+};
+static_assert(sizeof(EventRecord) == 16, "EventRecord must stay 16 bytes");
+
+// Append-only event history in the "evlog" flash partition (partitions.csv).
+// The partition is a ring of 4 KB sectors written front to back, so every
+// sector is erased equally often. The sector after the head is kept erased
+// ahead of time (update(), from a low priority task), so append() is one
+// 16-byte flash write. A record cut short by a power loss fails its CRC and
+// is skipped; boot finds the head by reading the first record per sector.
+class EventLog {
+public:
+    bool init();
+    bool isReady() { return _part != nullptr; }
+
+    bool append(uint8_t type, uint8_t house = HOUSE_NONE, uint8_t detail = 0,
+                uint32_t durationMs = 0, uint32_t ackLatencyMs = 0);
+
+    // Erases the next sector if the head has moved into a new one
+    bool needsErase() { return _eraseSector >= 0; }
+    void update();
+
+    // Reading, oldest first. cursor starts at begin(); read() fills up to
+    // max valid records and returns how many (0 = reached the head).
+    uint32_t begin();
+    uint32_t end() { return _head; } // Cursor for "only records appended from now on"
+    uint16_t read(uint32_t& cursor, EventRecord* out, uint16_t max);
+
+    uint32_t getCount() { return _nextSeq - _oldestSeq; }
+    uint32_t getCapacity() { return (_sectors - 1) * RECORDS_PER_SECTOR; }
+    uint32_t getNextSeq() { return _nextSeq; }
+    uint32_t getMaxAppendMicros() { return _maxAppendUs; }
+    uint32_t getEraseCount() { return _erases; }
+
+    static const uint32_t SECTOR_SIZE = 4096;
+    static const uint16_t RECORDS_PER_SECTOR = SECTOR_SIZE / sizeof(EventRecord);
+
+private:
+    static uint8_t crc8(const uint8_t* data, size_t len);
+    bool readSlot(uint32_t slot, EventRecord& rec);
+    bool isValid(const EventRecord& rec);
+    bool isBlank(const EventRecord& rec);
+    bool sectorBlank(uint16_t sector);
+    void eraseSector(uint16_t sector);
+    uint32_t firstSeqIn(uint16_t sector);
+
+    const esp_partition_t* _part = nullptr;
+    uint16_t _sectors = 0;
+    uint32_t _head = 0;       // Next slot to write
+    uint32_t _nextSeq = 0;
+    uint32_t _oldestSeq = 0;
+    int32_t _eraseSector = -1; // Sector to erase ahead of the head, -1 = none
+
+    uint32_t _maxAppendUs = 0;
+    uint32_t _erases = 0;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "FixedString.h"
+#include <stdarg.h>
+
+StrBuf& StrBuf::append(const char* s) {
+    return s ? append(s, strlen(s)) : *this;
+}
+
+StrBuf& StrBuf::append(const char* s, size_t n) {
+    size_t room = _size - 1 - _len;
+    if (n > room) {
+        n = room;
+        _truncated = true;
+    }
+    memcpy(_buf + _len, s, n);
+    _len += n;
+    _buf[_len] = '\0';
+    return *this;
+}
+
+StrBuf& StrBuf::append(char c) {
+    return append(&c, 1);
+}
+
+StrBuf& StrBuf::appendf(const char* fmt, ...) {
+    size_t room = _size - _len;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(_buf + _len, room, fmt, args);
+    va_end(args);
+    if (n < 0) {
+        _buf[_len] = '\0';
+        return *this;
+    }
+    if ((size_t)n >= room) {
+        _truncated = true;
+        n = room - 1;
+    }
+    _len += n;
+    return *this;
+}
+
+StrBuf& StrBuf::jsonKey(const char* key) {
+    if (_len > 0 && _buf[_len - 1] != '{' && _buf[_len - 1] != '[') append(',');
+    append('"');
+    append(key);
+    return append("\":", 2);
+}
+
+StrBuf& StrBuf::json(const char* key, const char* value) {
+    jsonKey(key);
+    append('"');
+    appendEscaped(value);
+    return append('"');
+}
+
+StrBuf& StrBuf::json(const char* key, bool value) {
+    jsonKey(key);
+    return append(value ? "true" : "false");
+}
+
+StrBuf& StrBuf::jsonSigned(const char* key, long long value) {
+    jsonKey(key);
+    return appendf("%lld", value);
+}
+
+StrBuf& StrBuf::jsonUnsigned(const char* key, unsigned long long value) {
+    jsonKey(key);
+    return appendf("%llu", value);
+}
+
+// Enough for LCD text and names: quotes, backslashes and control characters
+StrBuf& StrBuf::appendEscaped(const char* s, size_t maxLen) {
+    if (!s) return *this;
+    for (size_t i = 0; i < maxLen && s[i]; i++) {
+        char c = s[i];
+        if (c == '"' || c == '\\') {
+            append('\\');
+            append(c);
+        } else if ((uint8_t)c < 0x20) {
+            appendf("\\u%04x", (uint8_t)c);
+        } else {
+            append(c);
+        }
+    }
+    return *this;
+}
@@ -0,0 +1,74 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+
+// Append-only text in a buffer someone else owns (usually a FixedString on
+// the stack). Never allocates: whatever does not fit is cut off and
+// truncated() is set, the result always stays NUL-terminated.
+// Functions that build text take a StrBuf& so the caller picks the size.
+class StrBuf {
+public:
+    StrBuf(char* buf, size_t size) : _buf(buf), _size(size) { clear(); }
+
+    const char* c_str() const { return _buf; }
+    size_t length() const { return _len; }
+    size_t capacity() const { return _size - 1; }
+    bool truncated() const { return _truncated; }
+    bool isEmpty() const { return _len == 0; }
+
+    void clear() { _len = 0; _buf[0] = '\0'; _truncated = false; }
+    StrBuf& append(const char* s);
+    StrBuf& append(const char* s, size_t n);
+    StrBuf& append(char c);
+    StrBuf& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    // JSON helpers: "key":value, with a comma before every key but the first
+    // one after '{' or '['
+    StrBuf& jsonKey(const char* key);
+    StrBuf& json(const char* key, const char* value);   // Quoted and escaped
+    StrBuf& json(const char* key, bool value);
+    StrBuf& json(const char* key, int value) { return jsonSigned(key, value); }
+    StrBuf& json(const char* key, long value) { return jsonSigned(key, value); }
+    StrBuf& json(const char* key, long long value) { return jsonSigned(key, value); }
+    StrBuf& json(const char* key, unsigned int value) { return jsonUnsigned(key, value); }
+    StrBuf& json(const char* key, unsigned long value) { return jsonUnsigned(key, value); }
+    StrBuf& json(const char* key, unsigned long long value) { return jsonUnsigned(key, value); }
+    StrBuf& jsonSigned(const char* key, long long value);
+    StrBuf& jsonUnsigned(const char* key, unsigned long long value);
+    StrBuf& appendEscaped(const char* s, size_t maxLen = SIZE_MAX);
+
+    StrBuf& operator+=(const char* s) { return append(s); }
+    StrBuf& operator+=(char c) { return append(c); }
+    StrBuf& operator+=(const StrBuf& s) { return append(s.c_str(), s.length()); }
+    bool operator==(const char* s) const { return strcmp(_buf, s) == 0; }
+
+protected:
+    char* _buf;
+    size_t _size;
+    size_t _len;
+    bool _truncated;
+};
+
+// StrBuf with its own storage of N bytes (N - 1 characters). Copies copy the
+// text, so it can be returned by value in place of a String.
+template <size_t N>
+class FixedString : public StrBuf {
+public:
+    FixedString() : StrBuf(_storage, N) {}
+    FixedString(const char* s) : StrBuf(_storage, N) { append(s); }
+    FixedString(const FixedString& o) : StrBuf(_storage, N) { append(o.c_str(), o.length()); _truncated = o._truncated; }
+    FixedString& operator=(const FixedString& o) {
+        if (this != &o) { clear(); append(o.c_str(), o.length()); _truncated = o._truncated; }
+        return *this;
+    }
+    FixedString& operator=(const char* s) { clear(); append(s); return *this; }
+
+private:
+    char _storage[N];
+};
+
+// "HH:MM:SS", "HH:MM", "DD/MM", "--:--"
+typedef FixedString<12> TimeText;
+
+#endif
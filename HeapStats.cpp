@@ -0,0 +1,70 @@
+#include "HeapStats.h"
+#include "Log.h"
+#include <esp_heap_caps.h>
+
+static volatile uint32_t s_allocs = 0;
+static volatile uint32_t s_loopAllocs = 0;
+static TaskHandle_t s_loopTask = nullptr;
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+// Called by the heap for every successful allocation, from any task or ISR
+void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+    __atomic_fetch_add(&s_allocs, 1, __ATOMIC_RELAXED);
+    if (s_loopTask && xTaskGetCurrentTaskHandle() == s_loopTask) s_loopAllocs++;
+}
+
+bool HeapStats::hasCounter() { return true; }
+#else
+bool HeapStats::hasCounter() { return false; }
+#endif
+uint32_t HeapStats::getLoopAllocCount() { return s_loopAllocs; }
+uint32_t HeapStats::getAllocCount() { return s_allocs; }
+
+void HeapStats::init() {
+    s_loopTask = xTaskGetCurrentTaskHandle();
+    _mark = s_loopAllocs;
+    _windowStart = millis();
+    if (!hasCounter()) LOG_W("Heap: no allocation hook (CONFIG_HEAP_USE_HOOKS), counting disabled");
+}
+
+void HeapStats::onPass() {
+    uint32_t now = s_loopAllocs;
+    uint32_t n = now - _mark;
+    _mark = now;
+
+    _passes++;
+    if (n) {
+        _allocs += n;
+        _allocPasses++;
+        if (n > _maxPerPass) _maxPerPass = n;
+        _quietPasses = 0;
+    } else {
+        _quietPasses++;
+    }
+
+    if (millis() - _windowStart >= WINDOW_MS) {
+        _lastAllocs = _allocs;
+        _lastPasses = _passes;
+        _lastAllocPasses = _allocPasses;
+        _lastMaxPerPass = _maxPerPass;
+        _allocs = _passes = _allocPasses = _maxPerPass = 0;
+        _windowStart = millis();
+    }
+}
+
+void HeapStats::writeJson(StrBuf& json) {
+    json += '{';
+    json.json("counter", hasCounter());
+    json.json("allocs", getAllocCount());
+    json.json("loopAllocs", getLoopAllocCount());
+    json.json("windowMs", WINDOW_MS);
+    json.json("windowLoopAllocs", _lastAllocs);
+    json.json("windowPasses", _lastPasses);
+    json.json("windowAllocPasses", _lastAllocPasses);
+    json.json("windowMaxPerPass", _lastMaxPerPass);
+    json.json("quietPasses", _quietPasses);
+    json.json("freeHeap", ESP.getFreeHeap());
+    json.json("minFreeHeap", ESP.getMinFreeHeap());
+    json.json("largestBlock", ESP.getMaxAllocHeap());
+    json += '}';
+}
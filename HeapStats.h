@@ -0,0 +1,39 @@
+#ifndef HEAP_STATS_H
+#define HEAP_STATS_H
+
+#include <Arduino.h>
+#include "FixedString.h"
+
+// Counts heap allocations, to show the loop has stopped churning the heap.
+// Needs the ESP-IDF allocation hook (CONFIG_HEAP_USE_HOOKS, set in the
+// host build); without it only free / largest-block figures are reported.
+//
+// Allocations made on the loop task are counted separately from the
+// total, since the WiFi and lwIP tasks allocate for every packet anyway.
+class HeapStats {
+public:
+    void init();    // From setup(), on the loop task
+    void onPass();  // Once per loop() pass
+
+    static bool hasCounter();
+    static uint32_t getLoopAllocCount(); // Since boot, loop task only
+    static uint32_t getAllocCount();     // Since boot, all tasks
+
+    // Last full window: loop task allocations, passes, passes that allocated
+    uint32_t getWindowAllocs() { return _lastAllocs; }
+    uint32_t getWindowPasses() { return _lastPasses; }
+    uint32_t getWindowAllocPasses() { return _lastAllocPasses; }
+
+    void writeJson(StrBuf& json);
+
+    static const uint32_t WINDOW_MS = 10000;
+
+private:
+    uint32_t _mark = 0;
+    unsigned long _windowStart = 0;
+    uint32_t _allocs = 0, _passes = 0, _allocPasses = 0, _maxPerPass = 0;
+    uint32_t _lastAllocs = 0, _lastPasses = 0, _lastAllocPasses = 0, _lastMaxPerPass = 0;
+    uint32_t _quietPasses = 0; // Passes since the loop last allocated
+};
+
+#endif
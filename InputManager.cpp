@@ -1,76 +1,192 @@
 #include "InputManager.h"
 #include "Config.h"
+#include <soc/gpio_reg.h>
 
-// Simple debounce implementation
-struct Debouncer {
-    uint8_t pin;
-    bool stableState;
-    bool lastState;
-    unsigned long lastDebounceTime;
-    const unsigned long debounceDelay = 50; 
-
-    void init(uint8_t p) {
-        pin = p;
-        pinMode(pin, INPUT_PULLUP); // Assuming pull-up, user can change if needed
-        stableState = digitalRead(pin);
-        lastState = stableState;
-        lastDebounceTime = 0;
+// All scanned inputs must live in GPIO_IN_REG (GPIO 0-31)
+static_assert(PIN_SWITCH_PRE_SEHRI < 32 && PIN_BUTTON_HOUSE_A < 32 &&
+              PIN_BUTTON_HOUSE_B < 32 && PIN_BUTTON_NAV < 32,
+              "InputManager scans GPIO_IN_REG only (pins 0-31)");
+
+void InputManager::init() {
+    const uint8_t pins[INPUT_SLOTS] = {
+        PIN_SWITCH_PRE_SEHRI, PIN_BUTTON_HOUSE_A, PIN_BUTTON_HOUSE_B, PIN_BUTTON_NAV
+    };
+
+    _pinMask = 0;
+    for (int i = 0; i < INPUT_SLOTS; i++) {
+        _slotPin[i] = pins[i];
+        _changeHead[i] = 0;
+        _changeTail[i] = 0;
+        pinMode(pins[i], INPUT_PULLUP);
+        _pinMask |= (1UL << pins[i]);
+    }
+
+    // Assume whatever we read at boot is already settled
+    _stable = REG_READ(GPIO_IN_REG) & _pinMask;
+    _sample = _stable;
+    _ct0 = 0xFFFFFFFF;
+    _ct1 = 0xFFFFFFFF;
+    _lastTickUs = micros();
+
+    _wakeTask = nullptr;
+    _snapHead = 0;
+    _snapTail = 0;
+    _droppedSnapshots = 0;
+    _scanCount = 0;
+    _scanCycles = 0;
+
+    for (int i = 0; i < INPUT_SLOTS; i++) {
+        attachInterruptArg(pins[i], onEdge, this, CHANGE);
+    }
+}
+
+void IRAM_ATTR InputManager::onEdge(void* arg) {
+    InputManager* self = (InputManager*)arg;
+    if (self->_wakeTask) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(self->_wakeTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+    uint8_t head = self->_snapHead;
+    uint8_t next = (head + 1) & (SNAPSHOT_QUEUE_SIZE - 1);
+    if (next == self->_snapTail) {
+        self->_droppedSnapshots++; // update() falls back to the live register
+        return;
     }
+    self->_snapLevels[head] = REG_READ(GPIO_IN_REG) & self->_pinMask;
+    self->_snapTimeUs[head] = micros();
+    self->_snapHead = next;
+}
 
-    void update() {
-        bool reading = digitalRead(pin);
-        if (reading != lastState) {
-            lastDebounceTime = millis();
+// One debounce step for every pin at once (vertical counter, counts 4 samples)
+void InputManager::scanTick(unsigned long tickMs) {
+    uint32_t delta = _sample ^ _stable;
+    _ct0 = ~(_ct0 & delta);
+    _ct1 = _ct0 ^ (_ct1 & delta);
+    uint32_t toggle = delta & _ct0 & _ct1;
+    _stable ^= toggle;
+    _scanCount++;
+
+    if (!toggle) return;
+    for (int i = 0; i < INPUT_SLOTS; i++) {
+        uint32_t bit = 1UL << _slotPin[i];
+        if (!(toggle & bit)) continue;
+        uint8_t head = _changeHead[i];
+        uint8_t next = (head + 1) & (CHANGE_QUEUE_SIZE - 1);
+        if (next == _changeTail[i]) {
+            _changeTail[i] = (_changeTail[i] + 1) & (CHANGE_QUEUE_SIZE - 1); // Drop oldest
         }
+        _changeLevel[i][head] = (_stable & bit) ? HIGH : LOW;
+        _changeTime[i][head] = tickMs;
+        _changeHead[i] = next;
+    }
+}
+
+void InputManager::update() {
+    uint32_t nowUs = micros();
+    if ((nowUs - _lastTickUs) < SCAN_PERIOD_US) return;
+    // Ticks run on micros(), which wraps every 71.6 min; stamps are
+    // millis(), counted back from now so the two never drift apart
+    unsigned long nowMs = millis();
+
+    uint32_t startCycles = ESP.getCycleCount();
+    uint32_t ranBefore = _scanCount;
 
-        if ((millis() - lastDebounceTime) > debounceDelay) {
-            if (reading != stableState) {
-                stableState = reading;
+    // The one register read for this update; used once the history is replayed
+    uint32_t live = REG_READ(GPIO_IN_REG) & _pinMask;
+
+    while ((nowUs - _lastTickUs) >= SCAN_PERIOD_US) {
+        // Settled with the next edge still ahead (we slept through the
+        // gap): the ticks before it are no-ops, so jump to the edge
+        if (_sample == _stable && _snapTail != _snapHead) {
+            int32_t gapUs = (int32_t)(_snapTimeUs[_snapTail] - _lastTickUs);
+            if (gapUs > (int32_t)SCAN_PERIOD_US) {
+                uint32_t skip = (uint32_t)(gapUs - 1) / SCAN_PERIOD_US;
+                uint32_t maxSkip = (nowUs - _lastTickUs) / SCAN_PERIOD_US;
+                _lastTickUs += (skip < maxSkip ? skip : maxSkip) * SCAN_PERIOD_US;
+                _ct0 = 0xFFFFFFFF;
+                _ct1 = 0xFFFFFFFF;
+                if ((nowUs - _lastTickUs) < SCAN_PERIOD_US) break;
             }
         }
-        lastState = reading;
+
+        uint32_t tickUs = _lastTickUs + SCAN_PERIOD_US;
+
+        // Apply every edge snapshot that happened up to this tick
+        bool pending = false;
+        while (_snapTail != _snapHead) {
+            uint8_t tail = _snapTail;
+            if ((int32_t)(_snapTimeUs[tail] - tickUs) > 0) { pending = true; break; }
+            _sample = _snapLevels[tail];
+            _snapTail = (tail + 1) & (SNAPSHOT_QUEUE_SIZE - 1);
+        }
+        if (!pending && _snapTail == _snapHead) {
+            // Nothing queued before now: the pin has held its live level
+            // (this also repairs any edge lost to a full queue)
+            _sample = live;
+        }
+
+        scanTick(nowMs - (nowUs - tickUs) / 1000);
+        _lastTickUs = tickUs;
+
+        // Once settled with no queued edges, every remaining tick is a no-op
+        if (!pending && _snapTail == _snapHead && _sample == _stable) {
+            uint32_t skip = (nowUs - _lastTickUs) / SCAN_PERIOD_US;
+            _lastTickUs += skip * SCAN_PERIOD_US;
+            _ct0 = 0xFFFFFFFF;
+            _ct1 = 0xFFFFFFFF;
+        }
     }
-};
 
-Debouncer switchPreSehri;
-Debouncer buttonA;
-Debouncer buttonB;
-Debouncer buttonNav;
+    if (_scanCount != ranBefore) {
+        _scanCycles += (uint32_t)(ESP.getCycleCount() - startCycles);
+    }
+}
 
-void InputManager::init() {
-    switchPreSehri.init(PIN_SWITCH_PRE_SEHRI);
-    buttonA.init(PIN_BUTTON_HOUSE_A);
-    buttonB.init(PIN_BUTTON_HOUSE_B);
-    buttonNav.init(PIN_BUTTON_NAV);
+void InputManager::scanNow() {
+    _sample = REG_READ(GPIO_IN_REG) & _pinMask;
+    scanTick(millis());
 }
 
-void InputManager::update() {
-    switchPreSehri.update();
-    buttonA.update();
-    buttonB.update();
-    buttonNav.update();
+bool InputManager::isSettled() {
+    if (_snapTail != _snapHead || _sample != _stable) return false;
+    return (REG_READ(GPIO_IN_REG) & _pinMask) == _stable;
+}
+
+int InputManager::getLevel(uint8_t pin) {
+    return (_stable & (1UL << pin)) ? HIGH : LOW;
 }
 
 bool InputManager::readSwitchPreSehri() {
-    return switchPreSehri.stableState;
+    return getLevel(PIN_SWITCH_PRE_SEHRI) == HIGH;
 }
 
 bool InputManager::readButtonA() {
-    return buttonA.stableState;
+    return getLevel(PIN_BUTTON_HOUSE_A) == HIGH;
 }
 
 bool InputManager::readButtonB() {
-    return buttonB.stableState;
+    return getLevel(PIN_BUTTON_HOUSE_B) == HIGH;
 }
 
 bool InputManager::readButtonNav() {
-    return buttonNav.stableState;
+    return getLevel(PIN_BUTTON_NAV) == HIGH;
 }
 
 bool InputManager::hasStateChanged(int pin, bool referenceState) {
-    if (pin == PIN_SWITCH_PRE_SEHRI) return switchPreSehri.stableState != referenceState;
-    if (pin == PIN_BUTTON_HOUSE_A) return buttonA.stableState != referenceState;
-    if (pin == PIN_BUTTON_HOUSE_B) return buttonB.stableState != referenceState;
-    if (pin == PIN_BUTTON_NAV) return buttonNav.stableState != referenceState;
+    if (pin < 0 || pin >= 32 || !(_pinMask & (1UL << pin))) return false;
+    return (getLevel(pin) == HIGH) != referenceState;
+}
+
+bool InputManager::takeChange(uint8_t pin, int* level, unsigned long* timeMs) {
+    for (int i = 0; i < INPUT_SLOTS; i++) {
+        if (_slotPin[i] != pin) continue;
+        uint8_t tail = _changeTail[i];
+        if (tail == _changeHead[i]) return false;
+        *level = _changeLevel[i][tail];
+        *timeMs = _changeTime[i][tail];
+        _changeTail[i] = (tail + 1) & (CHANGE_QUEUE_SIZE - 1);
+        return true;
+    }
     return false;
 }
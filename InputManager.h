@@ -3,22 +3,86 @@
 
 #include <Arduino.h>
 
+// Single scanner for every digital input (switch + buttons).
+// All pins are sampled together from one GPIO_IN_REG read and debounced in
+// parallel with 2-bit vertical counters: a pin's stable level flips after
+// it has read the same new value for DEBOUNCE_TICKS consecutive scans.
+//
+// GPIO edge interrupts push timestamped register snapshots into a ring
+// buffer, and update() replays the scan ticks that elapsed since the last
+// call against that history. A busy loop therefore delays events but never
+// loses or reshapes them.
 class InputManager {
 public:
     void init();
-    void update(); // Call frequently for debouncing if needed
+    void update(); // Call every loop; runs all scan ticks that are due
 
-    // Direct reads (debounced optional, for now raw is okay given "edge detection" logic but debounce is safer)
+    // Debounced levels (true = HIGH / open, false = LOW / grounded)
     bool readSwitchPreSehri();
     bool readButtonA();
     bool readButtonB();
     bool readButtonNav();
+    int getLevel(uint8_t pin);          // Debounced HIGH/LOW for any scanned pin
+    uint32_t getStableMask() { return _stable; }
+
+    // True when no edge is queued, every pin has settled and the live
+    // levels still match, so update() has nothing to do. The live check
+    // catches edges the interrupt missed while the CPU was in light sleep.
+    bool isSettled();
+
+    // Task to notify on every edge (wakes the loop out of light sleep)
+    void setWakeTask(TaskHandle_t task) { _wakeTask = task; }
 
     // Helper to check if state changed from a reference
     bool hasStateChanged(int pin, bool referenceState);
 
+    // Pops the oldest debounced transition for `pin`.
+    // Returns false when there is none. timeMs is the millis() of the scan
+    // tick that settled it, comparable with millis() across micros() wraps.
+    bool takeChange(uint8_t pin, int* level, unsigned long* timeMs);
+
+    // One scan tick now against the live register, outside the tick
+    // schedule and without replaying edges (benchmarks, on a copy)
+    void scanNow();
+
+    // Scan cost (CPU cycles per executed scan tick, averaged)
+    uint32_t getScanCount() { return _scanCount; }
+    uint32_t getAverageScanCycles() { return _scanCount ? (uint32_t)(_scanCycles / _scanCount) : 0; }
+    uint32_t getDroppedSnapshots() { return _droppedSnapshots; }
+
+    static const uint32_t SCAN_PERIOD_US = 10000; // 10ms tick
+    static const uint8_t DEBOUNCE_TICKS = 4;      // Fixed by the 2-bit counters
+
 private:
-    // Simple debounce could happen here if needed
+    static void IRAM_ATTR onEdge(void* arg);
+    void scanTick(unsigned long tickMs);
+
+    uint32_t _pinMask;   // Bits of GPIO_IN_REG we scan
+    uint32_t _stable;    // Debounced levels
+    uint32_t _ct0, _ct1; // Vertical counter bit planes
+    uint32_t _sample;    // Raw levels as of the tick being replayed
+    uint32_t _lastTickUs;
+    TaskHandle_t _wakeTask;
+
+    // Snapshot queue: ISR producer, update() consumer
+    static const uint8_t SNAPSHOT_QUEUE_SIZE = 32; // Power of two
+    volatile uint32_t _snapTimeUs[SNAPSHOT_QUEUE_SIZE];
+    volatile uint32_t _snapLevels[SNAPSHOT_QUEUE_SIZE];
+    volatile uint8_t _snapHead;
+    volatile uint8_t _snapTail;
+    volatile uint32_t _droppedSnapshots;
+
+    // Debounced transitions waiting to be taken, per input slot
+    static const uint8_t INPUT_SLOTS = 4;
+    static const uint8_t CHANGE_QUEUE_SIZE = 8; // Power of two
+    uint8_t _slotPin[INPUT_SLOTS];
+    uint8_t _changeLevel[INPUT_SLOTS][CHANGE_QUEUE_SIZE];
+    unsigned long _changeTime[INPUT_SLOTS][CHANGE_QUEUE_SIZE];
+    uint8_t _changeHead[INPUT_SLOTS];
+    uint8_t _changeTail[INPUT_SLOTS];
+
+    uint32_t _scanCount;
+    uint64_t _scanCycles;
 };
 
 #endif
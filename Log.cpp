@@ -0,0 +1,141 @@
+#include "Log.h"
+#include "FixedString.h"
+#include <stdarg.h>
+
+// Ring of variable-length records: seq, ms, level, length, text (no NUL).
+// Positions count bytes written since boot and are only taken modulo the
+// size when touching the buffer, so a reader can tell it was overtaken.
+struct LogHeader {
+    uint32_t seq;
+    uint32_t ms;
+    uint8_t level;
+    uint8_t len;
+} __attribute__((packed));
+
+static uint8_t s_ring[LOG_RING_SIZE];
+static uint32_t s_head = 0;      // Where the next record goes
+static uint32_t s_tail = 0;      // Oldest record kept
+static uint32_t s_nextSeq = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Drain state: the line being sent and how far it got
+static uint32_t s_drainPos = 0;
+static uint32_t s_drainSeq = 0;  // Next seq the drain expects
+static uint32_t s_overwritten = 0;
+static char s_line[Log::MAX_LINE + 64]; // Room for the prefix and a "lines lost" notice
+static uint16_t s_lineLen = 0;
+
+static void ringPut(uint32_t pos, const void* data, size_t len) {
+    const uint8_t* src = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) s_ring[(pos + i) % LOG_RING_SIZE] = src[i];
+}
+
+static void ringGet(uint32_t pos, void* data, size_t len) {
+    uint8_t* dst = (uint8_t*)data;
+    for (size_t i = 0; i < len; i++) dst[i] = s_ring[(pos + i) % LOG_RING_SIZE];
+}
+
+void Log::write(uint8_t level, const char* fmt, ...) {
+    char text[MAX_LINE + 1];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    if (n < 0) return;
+    size_t len = (size_t)n < MAX_LINE ? (size_t)n : MAX_LINE;
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r')) len--; // The drain adds its own
+
+    LogHeader h;
+    h.ms = millis();
+    h.level = level;
+    h.len = (uint8_t)len;
+    size_t need = sizeof(h) + len;
+
+    portENTER_CRITICAL(&s_lock);
+    // Make room by dropping the oldest records
+    while (s_head - s_tail + need > LOG_RING_SIZE) {
+        LogHeader old;
+        ringGet(s_tail, &old, sizeof(old));
+        s_tail += sizeof(old) + old.len;
+    }
+    h.seq = s_nextSeq++;
+    ringPut(s_head, &h, sizeof(h));
+    ringPut(s_head + sizeof(h), text, len);
+    s_head += need;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t Log::begin() {
+    portENTER_CRITICAL(&s_lock);
+    uint32_t pos = s_tail;
+    portEXIT_CRITICAL(&s_lock);
+    return pos;
+}
+
+bool Log::next(uint32_t& pos, LogEntry& entry) {
+    portENTER_CRITICAL(&s_lock);
+    if ((int32_t)(pos - s_tail) < 0) pos = s_tail; // Overtaken
+    bool more = pos != s_head;
+    if (more) {
+        LogHeader h;
+        ringGet(pos, &h, sizeof(h));
+        ringGet(pos + sizeof(h), entry.text, h.len);
+        entry.text[h.len] = '\0';
+        entry.seq = h.seq;
+        entry.ms = h.ms;
+        entry.level = h.level;
+        pos += sizeof(h) + h.len;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return more;
+}
+
+bool Log::pending() {
+    return s_lineLen > 0 || s_drainPos != s_head;
+}
+
+void Log::drain(Print& out) {
+    while (true) {
+        if (s_lineLen == 0) {
+            LogEntry e;
+            if (!next(s_drainPos, e)) return;
+            FixedString<sizeof(s_line)> line;
+            if (e.seq != s_drainSeq) {
+                s_overwritten += e.seq - s_drainSeq;
+                line.appendf("[log: %lu lines lost]\n", (unsigned long)(e.seq - s_drainSeq));
+            }
+            line.appendf("[%6lu.%03lu] %c %s\n", (unsigned long)(e.ms / 1000), (unsigned long)(e.ms % 1000),
+                         levelLetter(e.level), e.text);
+            s_drainSeq = e.seq + 1;
+            memcpy(s_line, line.c_str(), line.length());
+            s_lineLen = line.length();
+        }
+        // Whole lines only, so the console never shows half of one
+        if (out.availableForWrite() < s_lineLen) return;
+        out.write((const uint8_t*)s_line, s_lineLen);
+        s_lineLen = 0;
+    }
+}
+
+uint32_t Log::getNextSeq() { return s_nextSeq; }
+uint32_t Log::getOverwritten() { return s_overwritten; }
+
+const char* Log::levelName(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return "error";
+        case LOG_LEVEL_WARN:  return "warn";
+        case LOG_LEVEL_INFO:  return "info";
+        case LOG_LEVEL_DEBUG: return "debug";
+        default:              return "?";
+    }
+}
+
+char Log::levelLetter(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return 'E';
+        case LOG_LEVEL_WARN:  return 'W';
+        case LOG_LEVEL_INFO:  return 'I';
+        case LOG_LEVEL_DEBUG: return 'D';
+        default:              return '?';
+    }
+}
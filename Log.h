@@ -0,0 +1,70 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Levelled logging without blocking. LOG_E/W/I/D("fmt", ...) format the
+// line into a RAM ring (seq, millis, level, text) and return; the "log"
+// task, lowest priority, later hands whole lines to the serial console
+// while it has room. /api/log reads the same ring.
+//
+// Levels above LOG_LEVEL (Config.h) are removed by the preprocessor, so a
+// disabled message costs nothing, not even its arguments. When the ring
+// is full the oldest lines go first; the serial output says how many it
+// missed. Not for use from interrupts.
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...) Log::write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...) Log::write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_W(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...) Log::write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...) Log::write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) do {} while (0)
+#endif
+
+struct LogEntry;
+
+class Log {
+public:
+    static const uint8_t MAX_LINE = 120; // Longer lines are cut
+
+    static void write(uint8_t level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    // Drain: moves whole lines to out while out.availableForWrite() has room
+    static bool pending();
+    static void drain(Print& out);
+
+    // Reading: pos starts at begin(); next() returns false at the newest line.
+    // A reader that fell behind skips to the oldest line still kept.
+    static uint32_t begin();
+    static bool next(uint32_t& pos, LogEntry& entry);
+
+    static uint32_t getNextSeq();
+    static uint32_t getOverwritten();   // Lines dropped before the drain saw them
+    static const char* levelName(uint8_t level);
+    static char levelLetter(uint8_t level);
+};
+
+struct LogEntry {
+    uint32_t seq;
+    uint32_t ms;     // millis() when logged
+    uint8_t level;
+    char text[Log::MAX_LINE + 1];
+};
+
+#endif
@@ -0,0 +1,439 @@
+#include "MqttPublisher.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include "AlarmScheduler.h"
+#include "EventLog.h"
+#include "StateMachine.h"
+#include "Log.h"
+
+extern AlarmScheduler alarmScheduler;
+extern EventLog eventLog;
+extern StateMachine stateMachine;
+
+// MQTT 3.1.1 packet types (upper nibble of the fixed header)
+static const uint8_t MQTT_CONNECT    = 0x10;
+static const uint8_t MQTT_CONNACK    = 0x20;
+static const uint8_t MQTT_PUBLISH    = 0x30;
+static const uint8_t MQTT_PINGREQ    = 0xC0;
+static const uint8_t MQTT_PINGRESP   = 0xD0;
+static const uint8_t MQTT_RETAIN     = 0x01;
+
+static const char* const HOUSE_TOPICS[2] = { "house/a", "house/b" };
+
+static size_t putString(uint8_t* at, const char* s) {
+    size_t len = strlen(s);
+    at[0] = len >> 8;
+    at[1] = len & 0xFF;
+    memcpy(at + 2, s, len);
+    return 2 + len;
+}
+
+void MqttPublisher::init() {
+    _enabled = MQTT_BROKER[0] != '\0';
+    if (!_enabled) return;
+
+    // Client id from the MAC, so two units on one broker do not kick each other off
+    String mac = WiFi.macAddress();
+    _clientId = "ramzan-";
+    for (unsigned i = 0; i < mac.length(); i++) {
+        if (mac[i] != ':') _clientId.append(mac[i]);
+    }
+
+    _eventCursor = eventLog.end();
+    _eventSeq = eventLog.getNextSeq();
+    _state = MQTT_WAITING;
+    _stateSince = millis();
+    _retryMs = 0;
+    LOG_I("MQTT: broker %s:%d, topics %s/...", MQTT_BROKER, MQTT_PORT, MQTT_TOPIC_PREFIX);
+}
+
+const char* MqttPublisher::getStateName() {
+    switch (_state) {
+        case MQTT_OFF:        return "off";
+        case MQTT_WAITING:    return "waiting";
+        case MQTT_CONNECTING: return "connecting";
+        case MQTT_HANDSHAKE:  return "handshake";
+        case MQTT_CONNECTED:  return "connected";
+        default:              return "?";
+    }
+}
+
+void MqttPublisher::update() {
+    if (!_enabled) return;
+    uint32_t now = millis();
+
+    if (WiFi.status() != WL_CONNECTED) {
+        if (_state != MQTT_WAITING) disconnect("WiFi lost");
+        return;
+    }
+
+    switch (_state) {
+        case MQTT_WAITING:
+            if (now - _stateSince >= _retryMs) startConnect();
+            return;
+        case MQTT_CONNECTING:
+            pollConnect();
+            return;
+        case MQTT_HANDSHAKE:
+            readInput();
+            if (_state == MQTT_HANDSHAKE && now - _stateSince > MQTT_CONNECT_TIMEOUT_MS) disconnect("no CONNACK");
+            return;
+        default:
+            break;
+    }
+
+    readInput();
+    if (_state != MQTT_CONNECTED) return;
+
+    queueEvents();
+    queueState();
+    queueNextEvent();
+    queueStatus();
+
+    // Keepalive: the broker drops us after 1.5x without a packet
+    if (_txLen == _txSent && !_pingOut && now - _lastTxMs >= MQTT_KEEPALIVE_SEC * 500UL) {
+        if (reserve(MQTT_PINGREQ, 0)) {
+            _pingOut = true;
+            _urgent = true;
+        }
+    }
+    if (_pingOut && now - _lastRxMs > MQTT_KEEPALIVE_SEC * 1500UL) {
+        disconnect("no PINGRESP");
+        return;
+    }
+
+    // Alarm traffic goes now; the rest waits for company or MQTT_BATCH_MS
+    if (_txLen > _txSent &&
+        (_urgent || now - _txQueuedMs >= MQTT_BATCH_MS || _txLen > sizeof(_tx) / 2)) {
+        flush();
+    }
+}
+
+// --- Connection ---
+
+void MqttPublisher::startConnect() {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(MQTT_PORT);
+    if (inet_pton(AF_INET, MQTT_BROKER, &addr.sin_addr) != 1) {
+        LOG_E("MQTT: '%s' is not an IPv4 address, MQTT off", MQTT_BROKER);
+        _enabled = false;
+        _state = MQTT_OFF;
+        return;
+    }
+
+    _sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_sock < 0) {
+        disconnect("no socket");
+        return;
+    }
+    fcntl(_sock, F_SETFL, fcntl(_sock, F_GETFL, 0) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // We batch ourselves
+
+    _state = MQTT_CONNECTING;
+    _stateSince = millis();
+    if (connect(_sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        disconnect("connect failed");
+    }
+}
+
+void MqttPublisher::pollConnect() {
+    // Zero timeout: only asks whether the TCP handshake has finished
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(_sock, &writable);
+    struct timeval tv = { 0, 0 };
+    if (select(_sock + 1, nullptr, &writable, nullptr, &tv) <= 0) {
+        if (millis() - _stateSince > MQTT_CONNECT_TIMEOUT_MS) disconnect("connect timeout");
+        return;
+    }
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(_sock, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err) {
+        disconnect("connection refused");
+        return;
+    }
+
+    // CONNECT with a retained "0" on online as the last will
+    FixedString<64> willTopic;
+    willTopic.append(MQTT_TOPIC_PREFIX).append("/online");
+    uint8_t flags = 0x02 | 0x04 | 0x20; // Clean session, will, will retain
+    size_t len2 = 10 + 2 + _clientId.length() + 2 + willTopic.length() + 2 + 1;
+    if (MQTT_USER[0]) { flags |= 0x80; len2 += 2 + strlen(MQTT_USER); }
+    if (MQTT_PASSWORD[0]) { flags |= 0x40; len2 += 2 + strlen(MQTT_PASSWORD); }
+
+    _txLen = _txSent = 0;
+    _txPackets = 0;
+    uint8_t* p = reserve(MQTT_CONNECT, len2);
+    if (!p) {
+        disconnect("CONNECT too long");
+        return;
+    }
+    static const uint8_t PROTOCOL[] = { 0, 4, 'M', 'Q', 'T', 'T', 4 };
+    memcpy(p, PROTOCOL, sizeof(PROTOCOL));
+    p += sizeof(PROTOCOL);
+    *p++ = flags;
+    *p++ = MQTT_KEEPALIVE_SEC >> 8;
+    *p++ = MQTT_KEEPALIVE_SEC & 0xFF;
+    p += putString(p, _clientId.c_str());
+    p += putString(p, willTopic.c_str());
+    p += putString(p, "0");
+    if (MQTT_USER[0]) p += putString(p, MQTT_USER);
+    if (MQTT_PASSWORD[0]) p += putString(p, MQTT_PASSWORD);
+
+    _state = MQTT_HANDSHAKE;
+    _stateSince = millis();
+    _rxLen = 0;
+    flush();
+}
+
+void MqttPublisher::readInput() {
+    int n = recv(_sock, _rx + _rxLen, sizeof(_rx) - _rxLen, MSG_DONTWAIT);
+    if (n == 0) {
+        disconnect("closed by broker");
+        return;
+    }
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) disconnect("recv failed");
+        return;
+    }
+    _rxLen += n;
+    _lastRxMs = millis();
+
+    // Only CONNACK and PINGRESP can arrive, both tiny
+    while (_rxLen >= 2) {
+        size_t packetLen = 2 + _rx[1];
+        if ((_rx[1] & 0x80) || packetLen > sizeof(_rx)) {
+            disconnect("unexpected packet");
+            return;
+        }
+        if (_rxLen < packetLen) return;
+
+        uint8_t type = _rx[0] & 0xF0;
+        if (type == MQTT_CONNACK && _state == MQTT_HANDSHAKE) {
+            uint8_t rc = packetLen >= 4 ? _rx[3] : 0xFF;
+            if (rc != 0) {
+                LOG_E("MQTT: broker refused the connection (rc %u)", rc);
+                disconnect("refused");
+                return;
+            }
+            _state = MQTT_CONNECTED;
+            _stateSince = millis();
+            _retryMs = 0;
+            _pingOut = false;
+            _connects++;
+            LOG_I("MQTT: connected as %s", _clientId.c_str());
+
+            // The broker may hold stale retained state from before a reset
+            FixedString<4> online("1");
+            publish("online", online, true);
+            _houseDirty = 0x03;
+            _nextDirty = !_nextName.isEmpty();
+            _lastStatusMs = millis() - MQTT_STATUS_INTERVAL_MS;
+            _urgent = true;
+        } else if (type == MQTT_PINGRESP) {
+            _pingOut = false;
+        }
+        memmove(_rx, _rx + packetLen, _rxLen - packetLen);
+        _rxLen -= packetLen;
+    }
+}
+
+void MqttPublisher::disconnect(const char* why) {
+    if (_sock >= 0) {
+        close(_sock);
+        _sock = -1;
+    }
+    if (_state == MQTT_CONNECTED || _state == MQTT_HANDSHAKE) LOG_W("MQTT: disconnected (%s)", why);
+    else LOG_D("MQTT: %s", why);
+
+    // Whatever did not make it out is lost; retained state goes again on connect
+    _dropped += _txPackets;
+    _txLen = _txSent = 0;
+    _txPackets = 0;
+    _urgent = false;
+    _rxLen = 0;
+
+    // Back off up to MQTT_RETRY_MAX_MS between attempts
+    if (_state != MQTT_CONNECTED) {
+        _retryMs = _retryMs ? _retryMs * 2 : MQTT_RETRY_MIN_MS;
+        if (_retryMs > MQTT_RETRY_MAX_MS) _retryMs = MQTT_RETRY_MAX_MS;
+    } else {
+        _retryMs = MQTT_RETRY_MIN_MS;
+    }
+    _state = MQTT_WAITING;
+    _stateSince = millis();
+}
+
+// Hands the queue to the socket, as much as it takes without waiting
+bool MqttPublisher::flush() {
+    while (_txSent < _txLen) {
+        int n = send(_sock, _tx + _txSent, _txLen - _txSent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true; // TCP window full, later
+            disconnect("send failed");
+            return false;
+        }
+        _txSent += n;
+        _bytesSent += n;
+        _lastTxMs = millis();
+    }
+    _sends++;
+    _txLen = _txSent = 0;
+    _txPackets = 0;
+    _urgent = false;
+    return true;
+}
+
+// --- Queue ---
+
+// Room for one packet: writes the fixed header, returns where the len
+// bytes of body go, or nullptr (counted as dropped) if the queue is full
+uint8_t* MqttPublisher::reserve(uint8_t header, size_t len) {
+    size_t lenBytes = len < 128 ? 1 : 2;
+    size_t need = 1 + lenBytes + len;
+    if (len >= 16384 || need > sizeof(_tx) - _txLen) {
+        if (_txSent > 0) {
+            memmove(_tx, _tx + _txSent, _txLen - _txSent);
+            _txLen -= _txSent;
+            _txSent = 0;
+        }
+        if (len >= 16384 || need > sizeof(_tx) - _txLen) {
+            _dropped++;
+            return nullptr;
+        }
+    }
+    if (_txLen == _txSent) _txQueuedMs = millis();
+
+    uint8_t* p = _tx + _txLen;
+    *p++ = header;
+    if (lenBytes == 1) {
+        *p++ = len;
+    } else {
+        *p++ = (len & 0x7F) | 0x80;
+        *p++ = len >> 7;
+    }
+    _txLen += need;
+    _txPackets++;
+    return p;
+}
+
+bool MqttPublisher::publish(const char* suffix, const StrBuf& payload, bool retain) {
+    FixedString<64> topic;
+    topic.append(MQTT_TOPIC_PREFIX).append('/').append(suffix);
+    uint8_t* p = reserve(MQTT_PUBLISH | (retain ? MQTT_RETAIN : 0), 2 + topic.length() + payload.length());
+    if (!p) return false;
+    p += putString(p, topic.c_str());
+    memcpy(p, payload.c_str(), payload.length());
+    _published++;
+    return true;
+}
+
+// Alarm starts/stops become retained house state, acks go out as they are.
+// Reads the event log one record at a time so a full queue loses nothing.
+void MqttPublisher::queueEvents() {
+    uint32_t head = eventLog.getNextSeq();
+    if (head - _eventSeq > eventLog.getCapacity()) {
+        // Overwritten while we were away
+        _eventCursor = eventLog.end();
+        _eventSeq = head;
+        return;
+    }
+
+    for (uint8_t n = 0; n < 4 && _eventSeq != head; n++) {
+        uint32_t cursor = _eventCursor;
+        EventRecord r;
+        if (eventLog.read(cursor, &r, 1) == 0) {
+            _eventCursor = cursor;
+            _eventSeq = head;
+            return;
+        }
+
+        for (uint8_t h = 0; h < 2; h++) {
+            if (!(r.house & (1 << h))) continue;
+            if (r.type == EVENT_ALARM_START || r.type == EVENT_ALARM_STOP) {
+                _ringing[h] = r.type == EVENT_ALARM_START;
+                _ringEvent[h] = r.detail;
+                _ringTime[h] = r.time;
+                _ringDurationMs[h] = (uint32_t)r.durationDs * 100;
+                _houseDirty |= 1 << h;
+            } else if (r.type == EVENT_ACK && r.seq + MQTT_REPLAY_MAX >= head) {
+                FixedString<128> json;
+                json.append('{');
+                json.json("event", stateName((SystemState)r.detail));
+                json.json("latencyMs", (uint32_t)r.ackLatencyDs * 100);
+                json.json("time", r.time);
+                json.json("seq", r.seq);
+                json.append('}');
+                FixedString<16> suffix;
+                suffix.append(HOUSE_TOPICS[h]).append("/ack");
+                if (!publish(suffix.c_str(), json, false)) return; // Same record again next pass
+                _urgent = true;
+            }
+        }
+        _eventCursor = cursor;
+        _eventSeq = r.seq + 1;
+    }
+}
+
+void MqttPublisher::queueState() {
+    for (uint8_t h = 0; h < 2; h++) {
+        if (!(_houseDirty & (1 << h))) continue;
+        FixedString<128> json;
+        json.append('{');
+        json.json("ringing", _ringing[h]);
+        json.json("event", _ringEvent[h] ? stateName((SystemState)_ringEvent[h]) : "");
+        json.json("time", _ringTime[h]);
+        if (!_ringing[h] && _ringEvent[h]) json.json("durationMs", _ringDurationMs[h]);
+        json.append('}');
+        FixedString<16> suffix;
+        suffix.append(HOUSE_TOPICS[h]).append("/alarm");
+        if (!publish(suffix.c_str(), json, true)) return;
+        _houseDirty &= ~(1 << h);
+        _urgent = true;
+    }
+}
+
+void MqttPublisher::queueNextEvent() {
+    uint32_t now = millis();
+    if (now - _lastNextCheckMs >= 1000) {
+        _lastNextCheckMs = now;
+        const char* name = alarmScheduler.getNextAlarmName();
+        TimeText at = alarmScheduler.getNextAlarmTime();
+        if (!(_nextName == name) || !(_nextAt == at.c_str())) {
+            _nextName = name;
+            _nextAt = at;
+            _nextDirty = true;
+        }
+    }
+    if (!_nextDirty) return;
+
+    FixedString<64> json;
+    json.append('{');
+    json.json("event", _nextName.c_str());
+    json.json("at", _nextAt.c_str());
+    json.append('}');
+    if (publish("next", json, true)) _nextDirty = false;
+}
+
+void MqttPublisher::queueStatus() {
+    uint32_t now = millis();
+    if (now - _lastStatusMs < MQTT_STATUS_INTERVAL_MS) return;
+    _lastStatusMs = now;
+
+    FixedString<160> json;
+    json.append('{');
+    json.json("uptimeS", now / 1000);
+    json.json("heap", ESP.getFreeHeap());
+    json.json("minHeap", ESP.getMinFreeHeap());
+    json.json("rssi", (int)WiFi.RSSI());
+    json.json("state", stateName(stateMachine.getState()));
+    json.json("dropped", _dropped);
+    json.append('}');
+    publish("status", json, false);
+}
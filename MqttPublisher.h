@@ -0,0 +1,100 @@
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "FixedString.h"
+
+// Publishes alarm events and device health to an MQTT 3.1.1 broker for the
+// building-management system. Topics, under MQTT_TOPIC_PREFIX:
+//   online              "1" / "0", retained; the broker sends "0" (last
+//                       will) when the device drops off
+//   house/a|b/alarm     retained {"ringing","event","time"}
+//   house/a|b/ack       {"event","latencyMs","time","seq"}
+//   next                retained {"event","at"}
+//   status              {"uptimeS","heap","minHeap","rssi","state"}
+//
+// Alarm starts, stops and acks are read back from the event log, so the
+// ones that happen while the broker is away go out after the reconnect
+// (up to MQTT_REPLAY_MAX). Retained state is kept as dirty flags and sent
+// again on every connect.
+//
+// Never waits on the network: the socket is non-blocking, connect() is
+// polled, and packets are queued in one buffer that is handed to send()
+// whole. Alarm messages flush it at once; status and next-event changes
+// wait up to MQTT_BATCH_MS so they share a send (and a radio wakeup).
+// QoS 0 only, nothing is subscribed.
+class MqttPublisher {
+public:
+    void init();
+    void update();
+    bool isEnabled() { return _enabled; }
+    bool isConnected() { return _state == MQTT_CONNECTED; }
+
+    const char* getStateName();
+    uint32_t getConnects() { return _connects; }
+    uint32_t getPublished() { return _published; }
+    uint32_t getDropped() { return _dropped; }
+    uint32_t getBytesSent() { return _bytesSent; }
+    uint32_t getSends() { return _sends; }
+
+private:
+    enum State : uint8_t { MQTT_OFF, MQTT_WAITING, MQTT_CONNECTING, MQTT_HANDSHAKE, MQTT_CONNECTED };
+
+    void startConnect();
+    void pollConnect();
+    void readInput();
+    void disconnect(const char* why);
+    bool flush();
+
+    void queueState();
+    void queueEvents();
+    void queueNextEvent();
+    void queueStatus();
+
+    bool publish(const char* suffix, const StrBuf& payload, bool retain);
+    uint8_t* reserve(uint8_t header, size_t len);
+
+    bool _enabled = false;
+    State _state = MQTT_OFF;
+    int _sock = -1;
+    uint32_t _stateSince = 0;
+    uint32_t _retryMs = 0;
+    uint32_t _lastTxMs = 0;
+    uint32_t _lastRxMs = 0;
+    bool _pingOut = false;
+    FixedString<24> _clientId;
+
+    uint8_t _rx[8];
+    uint8_t _rxLen = 0;
+
+    uint8_t _tx[MQTT_TX_BUFFER];
+    size_t _txLen = 0;
+    size_t _txSent = 0;
+    uint32_t _txQueuedMs = 0;   // When the oldest unsent packet was queued
+    uint16_t _txPackets = 0;
+    bool _urgent = false;
+
+    // Retained state, resent on every connect
+    bool _ringing[2] = {};
+    uint8_t _ringEvent[2] = {};
+    uint32_t _ringTime[2] = {};
+    uint32_t _ringDurationMs[2] = {};
+    uint8_t _houseDirty = 0;    // Bit 0 = house A, bit 1 = house B
+    FixedString<16> _nextName;
+    TimeText _nextAt;
+    bool _nextDirty = false;
+
+    uint32_t _eventSeq = 0;     // Next event log record to publish
+    uint32_t _eventCursor = 0;
+    uint32_t _lastStatusMs = 0;
+    uint32_t _lastNextCheckMs = 0;
+
+    uint32_t _connects = 0;
+    uint32_t _published = 0;
+    uint32_t _dropped = 0;
+    uint32_t _bytesSent = 0;
+    uint32_t _sends = 0;
+};
+
+#endif
@@ -1,11 +1,12 @@
 #include "NetworkManager.h"
 #include "Config.h"
+#include "StallMonitor.h"
+#include "Log.h"
 
 const char* ntpServer = "pool.ntp.org";
 
 void RamzanNetworkManager::init() {
-    Serial.print("Connecting to WiFi: ");
-    Serial.println(WIFI_SSID);
+    LOG_I("Connecting to WiFi: %s", WIFI_SSID);
     
     #ifdef USE_STATIC_IP
     IPAddress local_IP, gateway, subnet, primaryDNS, secondaryDNS;
@@ -16,9 +17,9 @@ void RamzanNetworkManager::init() {
     primaryDNS.fromString(STATIC_DNS1);
     secondaryDNS.fromString(STATIC_DNS2);
         
-    Serial.print("Using Static IP: "); Serial.println(STATIC_IP_ADDR);
+    LOG_I("Using Static IP: %s", STATIC_IP_ADDR);
     if (!WiFi.config(local_IP, gateway, subnet, primaryDNS, secondaryDNS)) {
-            Serial.println("STA Failed to configure");
+            LOG_E("STA Failed to configure");
     }
     #endif
 
@@ -36,9 +37,8 @@ void RamzanNetworkManager::update() {
     if (WiFi.status() == WL_CONNECTED) {
         if (!_wifiConnected) {
             _wifiConnected = true;
-            Serial.println("\nWiFi Connected!");
-            Serial.print("IP Address: ");
-            Serial.println(WiFi.localIP());
+            IPAddress ip = WiFi.localIP();
+            LOG_I("WiFi Connected! IP Address: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
         }
         
         // Check for time sync if not yet synced
@@ -46,14 +46,14 @@ void RamzanNetworkManager::update() {
             struct tm timeinfo;
             if (getLocalTime(&timeinfo, 0)) { 
                 _timeSynced = true;
-                Serial.println("NTP Time Synced!");
+                LOG_I("NTP Time Synced!");
             }
         }
     } else {
         // DISCONNECTED LOGIC
         if (_wifiConnected) {
             _wifiConnected = false;
-            Serial.println("\nWiFi Lost! Will attempt reconnect...");
+            LOG_W("WiFi Lost! Will attempt reconnect...");
         }
 
         // Retry every 10 seconds
@@ -61,7 +61,8 @@ void RamzanNetworkManager::update() {
         unsigned long now = millis();
         if (now - lastReconnectAttempt > 10000) {
             lastReconnectAttempt = now;
-            Serial.println("Reconnecting to WiFi...");
+            LOG_I("Reconnecting to WiFi...");
+            Breadcrumb crumb(STAGE_WIFI_RECONNECT);
             WiFi.disconnect();
             WiFi.reconnect();
         }
@@ -76,24 +77,24 @@ bool RamzanNetworkManager::isTimeSynced() {
     return _timeSynced;
 }
 
-String RamzanNetworkManager::getFormattedTime() {
+TimeText RamzanNetworkManager::getFormattedTime() {
     struct tm timeinfo;
     if(!getLocalTime(&timeinfo)){
         return "00:00:00";
     }
-    char timeStringBuff[10];
-    strftime(timeStringBuff, sizeof(timeStringBuff), "%H:%M:%S", &timeinfo);
-    return String(timeStringBuff);
+    TimeText text;
+    text.appendf("%02d:%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+    return text;
 }
 
-String RamzanNetworkManager::getFormattedDate() {
+TimeText RamzanNetworkManager::getFormattedDate() {
     struct tm timeinfo;
     if(!getLocalTime(&timeinfo)){
         return "--/--";
     }
-    char dateStringBuff[10];
-    strftime(dateStringBuff, sizeof(dateStringBuff), "%d/%m", &timeinfo);
-    return String(dateStringBuff);
+    TimeText text;
+    text.appendf("%02d/%02d", timeinfo.tm_mday, timeinfo.tm_mon + 1);
+    return text;
 }
 
 int RamzanNetworkManager::getCurrentHour() {
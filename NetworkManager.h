@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include "time.h"
+#include "FixedString.h"
 
 class RamzanNetworkManager {
 public:
@@ -11,8 +12,8 @@ public:
     void update();
     bool isConnected();
     bool isTimeSynced();
-    String getFormattedTime();
-    String getFormattedDate(); // DD/MM
+    TimeText getFormattedTime();
+    TimeText getFormattedDate(); // DD/MM
     int getCurrentHour();
     int getCurrentMinute();
     int getCurrentSecond();
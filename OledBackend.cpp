@@ -0,0 +1,131 @@
+#include "OledBackend.h"
+#include <Wire.h>
+
+// Classic 5x7 font, ASCII 0x20..0x7E, one byte per column, LSB on top
+static const uint8_t font5x7[][5] PROGMEM = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14}, // ' ' ! " #
+    {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, // $ % & '
+    {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x14,0x08,0x3E,0x08,0x14}, {0x08,0x08,0x3E,0x08,0x08}, // ( ) * +
+    {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02}, // , - . /
+    {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, // 0 1 2 3
+    {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03}, // 4 5 6 7
+    {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00}, // 8 9 : ;
+    {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, // < = > ?
+    {0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22}, // @ A B C
+    {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A}, // D E F G
+    {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, // H I J K
+    {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E}, // L M N O
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31}, // P Q R S
+    {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, // T U V W
+    {0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00}, // X Y Z [
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40}, // \ ] ^ _
+    {0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78}, {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20}, // ` a b c
+    {0x38,0x44,0x44,0x48,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E}, // d e f g
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00}, // h i j k
+    {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, // l m n o
+    {0x7C,0x14,0x14,0x14,0x08}, {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20}, // p q r s
+    {0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C}, // t u v w
+    {0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, // x y z {
+    {0x00,0x00,0x7F,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08}                              // | } ~
+};
+static_assert(sizeof(font5x7) / sizeof(font5x7[0]) == 0x7F - 0x20, "font covers 0x20..0x7E");
+
+bool Ssd1306Backend::begin(uint8_t cols, uint8_t rows) {
+    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+    Wire.setClock(400000);
+
+    Wire.beginTransmission(_address);
+    bool found = (Wire.endTransmission() == 0);
+
+    static const uint8_t initCmds[] = {
+        0xAE,       // Display off
+        0xD5, 0x80, // Clock divide
+        0xA8, 0x3F, // Multiplex 64
+        0xD3, 0x00, // No display offset
+        0x40,       // Start line 0
+        0x8D, 0x14, // Charge pump on
+        0x20, 0x00, // Horizontal addressing (window wraps column -> page)
+        0xA1, 0xC8, // Rotate 180 to match the usual module orientation
+        0xDA, 0x12, // COM pins
+        0x81, 0xCF, // Contrast
+        0xD9, 0xF1, // Pre-charge
+        0xDB, 0x40, // VCOMH
+        0xA4, 0xA6, // Follow RAM, not inverted
+        0xAF        // Display on
+    };
+    sendCommands(initCmds, sizeof(initCmds));
+
+    _pageStep = PAGES / rows;
+    _pageOffset = (_pageStep - 1) / 2;
+    _xOffset = (WIDTH - cols * CELL_WIDTH) / 2;
+
+    // Panel RAM is random after power-up: clear everything once
+    memset(_buffer, 0, sizeof(_buffer));
+    markDirty(0, 0, WIDTH - 1);
+    markDirty(PAGES - 1, 0, WIDTH - 1);
+    present();
+
+    return found;
+}
+
+void Ssd1306Backend::drawRun(uint8_t row, uint8_t col, const char* text, uint8_t len) {
+    uint8_t page = row * _pageStep + _pageOffset;
+    if (page >= PAGES) return;
+
+    uint8_t x = _xOffset + col * CELL_WIDTH;
+    uint8_t x0 = x;
+    for (uint8_t i = 0; i < len && x + CELL_WIDTH <= WIDTH; i++) {
+        uint8_t c = (uint8_t)text[i];
+        if (c < 0x20 || c > 0x7E) c = '?';
+        const uint8_t* glyph = font5x7[c - 0x20];
+        for (uint8_t b = 0; b < 5; b++) _buffer[page][x++] = pgm_read_byte(&glyph[b]);
+        _buffer[page][x++] = 0x00; // Spacing column
+    }
+    if (x > x0) markDirty(page, x0, x - 1);
+}
+
+void Ssd1306Backend::markDirty(uint8_t page, uint8_t x0, uint8_t x1) {
+    if (x0 < _dirtyX0) _dirtyX0 = x0;
+    if (x1 > _dirtyX1) _dirtyX1 = x1;
+    if (page < _dirtyPage0) _dirtyPage0 = page;
+    if (page > _dirtyPage1) _dirtyPage1 = page;
+}
+
+void Ssd1306Backend::present() {
+    if (_dirtyX0 > _dirtyX1) return;
+
+    // Address window = dirty rectangle; the controller then wraps
+    // column -> page by itself, so the data is one continuous stream
+    uint8_t window[] = { 0x21, _dirtyX0, _dirtyX1, 0x22, _dirtyPage0, _dirtyPage1 };
+    sendCommands(window, sizeof(window));
+
+    uint8_t chunk = 0;
+    for (uint8_t page = _dirtyPage0; page <= _dirtyPage1; page++) {
+        for (uint8_t x = _dirtyX0; x <= _dirtyX1; x++) {
+            if (chunk == 0) {
+                Wire.beginTransmission(_address);
+                Wire.write(0x40); // Control byte: data stream
+                _busBytes += 2;
+            }
+            Wire.write(_buffer[page][x]);
+            _busBytes++;
+            if (++chunk == CHUNK) {
+                Wire.endTransmission();
+                chunk = 0;
+            }
+            if (x == WIDTH - 1) break; // uint8_t would wrap
+        }
+    }
+    if (chunk) Wire.endTransmission();
+
+    _dirtyX0 = WIDTH; _dirtyX1 = 0;
+    _dirtyPage0 = PAGES; _dirtyPage1 = 0;
+}
+
+void Ssd1306Backend::sendCommands(const uint8_t* cmds, uint8_t count) {
+    Wire.beginTransmission(_address);
+    Wire.write(0x00); // Control byte: command stream
+    Wire.write(cmds, count);
+    Wire.endTransmission();
+    _busBytes += 2 + count;
+}
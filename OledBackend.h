@@ -0,0 +1,41 @@
+#ifndef OLED_BACKEND_H
+#define OLED_BACKEND_H
+
+#include <Arduino.h>
+#include "DisplayBackend.h"
+
+// 128x64 SSD1306 over I2C, drawn as a text grid with a 5x7 font in 6x8
+// cells. Runs are rendered into a RAM framebuffer; present() then sends
+// only the bounding rectangle of what changed (column x page window), so
+// a ticking clock costs a few dozen bytes instead of the full 1 KB.
+class Ssd1306Backend : public DisplayBackend {
+public:
+    Ssd1306Backend(uint8_t address) : _address(address) {}
+    bool begin(uint8_t cols, uint8_t rows) override;
+    void drawRun(uint8_t row, uint8_t col, const char* text, uint8_t len) override;
+    void present() override;
+    const char* name() override { return "ssd1306"; }
+
+private:
+    static const uint8_t WIDTH = 128;
+    static const uint8_t PAGES = 8;       // 64 px / 8 px per page
+    static const uint8_t CELL_WIDTH = 6;
+    static const uint8_t CHUNK = 32;      // Data bytes per I2C transaction
+
+    void sendCommands(const uint8_t* cmds, uint8_t count);
+    void markDirty(uint8_t page, uint8_t x0, uint8_t x1);
+
+    uint8_t _address;
+    uint8_t _buffer[PAGES][WIDTH];
+
+    // Text grid placement (rows spread over the pages, grid centred)
+    uint8_t _pageStep = 1;
+    uint8_t _pageOffset = 0;
+    uint8_t _xOffset = 0;
+
+    // Dirty rectangle, empty when _dirtyX0 > _dirtyX1
+    uint8_t _dirtyX0 = WIDTH, _dirtyX1 = 0;
+    uint8_t _dirtyPage0 = PAGES, _dirtyPage1 = 0;
+};
+
+#endif
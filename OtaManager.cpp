@@ -0,0 +1,462 @@
+#include "OtaManager.h"
+#include "Config.h"
+#include "Log.h"
+#include "EventLog.h"
+#include <Update.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <esp_task_wdt.h>
+
+extern EventLog eventLog;
+extern Preferences prefs;
+
+static_assert(sizeof(OtaTrailer) == 72, "trailer layout is shared with the host tool");
+static_assert(sizeof(OtaDeltaHeader) == 44, "delta layout is shared with the host tool");
+
+static const char* sourceName(uint8_t source) {
+    switch (source) {
+        case OtaManager::SOURCE_WEB:         return "web";
+        case OtaManager::SOURCE_ARDUINO_OTA: return "arduino-ota";
+        default:                             return "none";
+    }
+}
+
+void OtaManager::makeTrailer(const uint8_t sha256[Sha256::HASH_SIZE], uint32_t imageSize, const char* key,
+                             OtaTrailer& out) {
+    out.magic = TRAILER_MAGIC;
+    out.imageSize = imageSize;
+    memcpy(out.sha256, sha256, Sha256::HASH_SIZE);
+    Sha256::hmac(key, strlen(key), &out, offsetof(OtaTrailer, mac), out.mac);
+}
+
+uint8_t OtaManager::percent(size_t done, size_t total) {
+    if (total == 0) return 100;
+    return (uint8_t)((uint64_t)done * 100 / total);
+}
+
+void OtaManager::init() {
+    prefs.begin("ota", true);
+    if (prefs.getBytes("last", &_stats, sizeof(_stats)) != sizeof(_stats)) _stats = {};
+    if (prefs.getBytes("guard", &_guard, sizeof(_guard)) != sizeof(_guard)) _guard = {};
+    _fullBps = prefs.getUInt("fullBps", 0);
+    prefs.end();
+    _stats.error[sizeof(_stats.error) - 1] = '\0';
+    _guard.previous[sizeof(_guard.previous) - 1] = '\0';
+    if (!_guard.pending) return;
+
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (!running || strcmp(running->label, _guard.previous) == 0) {
+        // The new image did not even boot; the bootloader is back on the old one
+        LOG_W("OTA: new image never started, still on %s", _guard.previous);
+        _guard.pending = false;
+        saveGuard(_guard);
+        eventLog.append(EVENT_OTA_ROLLBACK, HOUSE_NONE, ROLLBACK_BOOTLOADER);
+        return;
+    }
+    _guard.boots++;
+    saveGuard(_guard);
+    // From the second boot on, the reset was this image's own
+    esp_reset_reason_t reset = esp_reset_reason();
+    if (_guard.boots > 1 && (reset == ESP_RST_PANIC || reset == ESP_RST_INT_WDT ||
+                             reset == ESP_RST_TASK_WDT || reset == ESP_RST_WDT)) {
+        rollback(ROLLBACK_CRASH);
+        return;
+    }
+    if (_guard.boots > OTA_BOOT_TRIES) {
+        rollback(ROLLBACK_BOOTS);
+        return;
+    }
+    LOG_I("OTA: new image on %s, boot %u; needs %lu s without a stall", running->label, _guard.boots,
+          (unsigned long)(OTA_HEALTHY_MS / 1000));
+}
+
+void OtaManager::update() {
+    if (!_guard.pending) return;
+    uint32_t now = millis();
+    // The ota task runs every 100 ms; a long gap means the loop was stuck
+    if (_lastUpdateMs && now - _lastUpdateMs > OTA_LOOP_GAP_MS) {
+        LOG_W("OTA: loop stalled %lu ms, healthy run restarts", (unsigned long)(now - _lastUpdateMs));
+        _healthySinceMs = now;
+    }
+    _lastUpdateMs = now;
+    if (now - _healthySinceMs >= OTA_HEALTHY_MS) confirm();
+    else if (now > OTA_CONFIRM_MS) rollback(ROLLBACK_TIMEOUT); // Since boot
+}
+
+void OtaManager::confirm() {
+    _guard.pending = false;
+    saveGuard(_guard);
+    esp_ota_mark_app_valid_cancel_rollback(); // For bootloaders with rollback on
+    LOG_I("OTA: new image confirmed after %lu s", millis() / 1000);
+}
+
+void OtaManager::rollback(RollbackReason reason) {
+    _guard.pending = false;
+    saveGuard(_guard);
+    const esp_partition_t* old = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY,
+                                                          _guard.previous);
+    if (!old || esp_ota_set_boot_partition(old) != ESP_OK) {
+        LOG_E("OTA: cannot go back to %s, keeping this image", _guard.previous);
+        return;
+    }
+    const char* why = reason == ROLLBACK_TIMEOUT ? "no healthy run in time"
+                    : reason == ROLLBACK_CRASH   ? "crashed"
+                                                 : "too many boots";
+    LOG_E("OTA: new image did not settle (%s), back to %s", why, _guard.previous);
+    eventLog.append(EVENT_OTA_ROLLBACK, HOUSE_NONE, reason);
+    ESP.restart();
+}
+
+// From the next boot on a new image runs and has to prove itself. Only
+// NVS changes; this image is not the one on trial.
+void OtaManager::armGuard() {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (!running) return;
+    Guard g = {};
+    g.pending = true;
+    snprintf(g.previous, sizeof(g.previous), "%s", running->label);
+    saveGuard(g);
+}
+
+void OtaManager::saveGuard(const Guard& g) {
+    prefs.begin("ota", false);
+    prefs.putBytes("guard", &g, sizeof(g));
+    prefs.end();
+}
+
+// --- Web upload ---
+
+bool OtaManager::begin() {
+    _stats = {};
+    _stats.source = SOURCE_WEB;
+    _startMs = millis();
+    _sha.begin();
+    _tailLen = 0;
+    _active = false;
+    _delta = DELTA_OFF;
+    _headerLen = 0;
+    _wrongBase = false;
+    esp_task_wdt_reset(); // The erase can take a while
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+        finishStats(false, Update.errorString());
+        return false;
+    }
+    _active = true;
+    return true;
+}
+
+bool OtaManager::write(const uint8_t* data, size_t len) {
+    if (!_active) return false;
+    if (_stats.bytes == 0 && len) _delta = data[0] == IMAGE_MAGIC ? DELTA_OFF : DELTA_HEADER;
+    _stats.bytes += len;
+
+    // Everything but the last sizeof(OtaTrailer) bytes is surely image
+    size_t total = _tailLen + len;
+    if (total > sizeof(_tail)) {
+        size_t out = total - sizeof(_tail);
+        size_t fromTail = out < _tailLen ? out : _tailLen;
+        if (fromTail && !feed(_tail, fromTail)) return false;
+        memmove(_tail, _tail + fromTail, _tailLen - fromTail);
+        _tailLen -= fromTail;
+        size_t fromData = out - fromTail;
+        if (fromData && !feed(data, fromData)) return false;
+        data += fromData;
+        len -= fromData;
+    }
+    memcpy(_tail + _tailLen, data, len);
+    _tailLen += len;
+    return true;
+}
+
+bool OtaManager::feed(const uint8_t* data, size_t len) {
+    return _delta == DELTA_OFF ? writeImage(data, len) : feedDelta(data, len);
+}
+
+bool OtaManager::writeImage(const uint8_t* data, size_t len) {
+    int64_t t0 = esp_timer_get_time();
+    _sha.update(data, len);
+    int64_t t1 = esp_timer_get_time();
+    size_t written = Update.write((uint8_t*)data, len);
+    int64_t t2 = esp_timer_get_time();
+
+    _stats.hashUs += t1 - t0;
+    _stats.flashUs += t2 - t1;
+    if (t2 - t1 > _stats.maxWriteUs) _stats.maxWriteUs = t2 - t1;
+    _stats.imageBytes += written;
+    if (written != len) {
+        abort(Update.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool OtaManager::end() {
+    if (!_active) return false;
+
+    OtaTrailer t;
+    if (_tailLen != sizeof(t)) {
+        abort("image too short");
+        return false;
+    }
+    memcpy(&t, _tail, sizeof(t));
+    if (t.magic != TRAILER_MAGIC) {
+        abort("not signed (ramzan_ota sign)");
+        return false;
+    }
+    if (_delta != DELTA_OFF && _delta != DELTA_ADD_LEN) {
+        abort("delta cut short");
+        return false;
+    }
+    if (t.imageSize != _stats.imageBytes) {
+        abort("size does not match");
+        return false;
+    }
+    uint8_t sha[Sha256::HASH_SIZE];
+    _sha.finish(sha);
+    if (!Sha256::equal(sha, t.sha256, sizeof(sha))) {
+        abort("SHA-256 does not match");
+        return false;
+    }
+    OtaTrailer expected;
+    makeTrailer(sha, t.imageSize, OTA_SIGN_KEY, expected);
+    if (!Sha256::equal(expected.mac, t.mac, sizeof(t.mac))) {
+        abort("bad signature");
+        return false;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    bool ok = Update.end(true);
+    _stats.flashUs += esp_timer_get_time() - t0;
+    _active = false;
+    if (!ok) {
+        finishStats(false, Update.errorString());
+        return false;
+    }
+    char hex[2 * Sha256::HASH_SIZE + 1];
+    Sha256::toHex(sha, hex);
+    LOG_I("OTA: %lu bytes verified, sha256 %.16s...", (unsigned long)_stats.imageBytes, hex);
+    armGuard();
+    finishStats(true, "");
+    return true;
+}
+
+// --- Delta ---
+
+bool OtaManager::feedDelta(const uint8_t* data, size_t len) {
+    while (len) {
+        if (_delta == DELTA_HEADER) {
+            size_t n = sizeof(_deltaHeader) - _headerLen;
+            if (n > len) n = len;
+            memcpy((uint8_t*)&_deltaHeader + _headerLen, data, n);
+            _headerLen += n;
+            data += n;
+            len -= n;
+            if (_headerLen == sizeof(_deltaHeader) && !startDelta()) return false;
+        } else if (_delta == DELTA_ADD) {
+            size_t n = _addLeft < len ? _addLeft : len;
+            if (!writeImage(data, n)) return false;
+            _addLeft -= n;
+            _basePos += n;
+            data += n;
+            len -= n;
+            if (!_addLeft) _delta = DELTA_SEEK;
+        } else {
+            uint8_t b = *data++;
+            len--;
+            if (_fieldShift == 28 && b > 0x0F) { // Past 32 bits
+                abort("bad delta");
+                return false;
+            }
+            _field |= (uint32_t)(b & 0x7F) << _fieldShift;
+            if (b & 0x80) {
+                _fieldShift += 7;
+                continue;
+            }
+            uint32_t value = _field;
+            _field = 0;
+            _fieldShift = 0;
+            if (!deltaField(value)) return false;
+        }
+    }
+    return true;
+}
+
+// The running image has to be the one the delta was made from, or the
+// copies would build something else. Checked before anything is written.
+bool OtaManager::startDelta() {
+    if (_deltaHeader.magic != DELTA_MAGIC) {
+        abort("not a firmware image or delta");
+        return false;
+    }
+    _base = esp_ota_get_running_partition();
+    bool same = false;
+    if (_base && _deltaHeader.baseSize <= _base->size) {
+        int64_t t0 = esp_timer_get_time();
+        Sha256 sha;
+        sha.begin();
+        for (uint32_t off = 0; off < _deltaHeader.baseSize; off += sizeof(_buf)) {
+            uint32_t n = _deltaHeader.baseSize - off;
+            if (n > sizeof(_buf)) n = sizeof(_buf);
+            if (esp_partition_read(_base, off, _buf, n) != ESP_OK) break;
+            sha.update(_buf, n);
+            esp_task_wdt_reset();
+        }
+        uint8_t hash[Sha256::HASH_SIZE];
+        sha.finish(hash);
+        same = Sha256::equal(hash, _deltaHeader.baseSha256, sizeof(hash));
+        _stats.baseHashUs = esp_timer_get_time() - t0;
+    }
+    if (!same) {
+        _wrongBase = true;
+        abort("delta is for another image");
+        return false;
+    }
+    LOG_I("OTA: delta on %s, %lu -> %lu bytes", _base->label, (unsigned long)_deltaHeader.baseSize,
+          (unsigned long)_deltaHeader.targetSize);
+    _stats.delta = true;
+    _basePos = 0;
+    _field = 0;
+    _fieldShift = 0;
+    _delta = DELTA_ADD_LEN;
+    return true;
+}
+
+bool OtaManager::deltaField(uint32_t value) {
+    uint32_t room = _deltaHeader.targetSize - _stats.imageBytes;
+    if (_delta == DELTA_ADD_LEN) {
+        if (value > room) {
+            abort("bad delta");
+            return false;
+        }
+        _addLeft = value;
+        _delta = value ? DELTA_ADD : DELTA_SEEK;
+    } else if (_delta == DELTA_SEEK) {
+        int64_t pos = (int64_t)_basePos + (int32_t)((value >> 1) ^ -(value & 1)); // Zigzag
+        if (pos < 0 || pos > _deltaHeader.baseSize) {
+            abort("bad delta");
+            return false;
+        }
+        _basePos = pos;
+        _delta = DELTA_COPY_LEN;
+    } else {
+        if (value > room || value > _deltaHeader.baseSize - _basePos) {
+            abort("bad delta");
+            return false;
+        }
+        _delta = DELTA_ADD_LEN;
+        return copyFromBase(value);
+    }
+    return true;
+}
+
+bool OtaManager::copyFromBase(uint32_t len) {
+    while (len) {
+        uint32_t n = len < sizeof(_buf) ? len : sizeof(_buf);
+        int64_t t0 = esp_timer_get_time();
+        if (esp_partition_read(_base, _basePos, _buf, n) != ESP_OK) {
+            abort("cannot read running image");
+            return false;
+        }
+        _stats.readUs += esp_timer_get_time() - t0;
+        if (!writeImage(_buf, n)) return false;
+        _basePos += n;
+        _stats.copiedBytes += n;
+        len -= n;
+        esp_task_wdt_reset(); // One long copy is all flash work, no network in between
+    }
+    return true;
+}
+
+void OtaManager::abort(const char* why) {
+    if (_active) Update.abort(); // The boot partition stays as it is
+    _active = false;
+    LOG_E("OTA: %s", why);
+    finishStats(false, why);
+}
+
+void OtaManager::finishStats(bool ok, const char* error) {
+    _stats.ok = ok;
+    _stats.uploadMs = millis() - _startMs;
+    strncpy(_stats.error, error, sizeof(_stats.error) - 1);
+    struct tm t;
+    _stats.time = getLocalTime(&t, 0) ? (uint32_t)time(nullptr) : 0;
+    prefs.begin("ota", false);
+    prefs.putBytes("last", &_stats, sizeof(_stats));
+    if (ok && _stats.source == SOURCE_WEB && !_stats.delta && _stats.uploadMs) {
+        _fullBps = (uint64_t)_stats.bytes * 1000 / _stats.uploadMs;
+        prefs.putUInt("fullBps", _fullBps);
+    }
+    prefs.end();
+    if (_stats.delta) {
+        LOG_I("OTA: delta of %lu bytes built %lu (%lu copied)", (unsigned long)_stats.bytes,
+              (unsigned long)_stats.imageBytes, (unsigned long)_stats.copiedBytes);
+    }
+    if (_stats.uploadMs) {
+        LOG_I("OTA: %s %s, %lu bytes in %lu ms (%lu B/s), flash %lu ms", sourceName(_stats.source),
+              ok ? "done" : "failed", (unsigned long)_stats.bytes, (unsigned long)_stats.uploadMs,
+              (unsigned long)((uint64_t)_stats.bytes * 1000 / _stats.uploadMs),
+              (unsigned long)(_stats.flashUs / 1000));
+    }
+}
+
+// How the delta compares with sending the whole image
+void OtaManager::writeDeltaJson(StrBuf& json) {
+    json.jsonKey("delta");
+    json.append('{');
+    json.json("copiedBytes", (unsigned long)_stats.copiedBytes);
+    json.json("addedBytes", (unsigned long)(_stats.imageBytes - _stats.copiedBytes));
+    json.json("baseHashMs", (unsigned long)(_stats.baseHashUs / 1000));
+    json.json("readMs", (unsigned long)(_stats.readUs / 1000));
+    json.json("sentPct", _stats.imageBytes ? (unsigned long)((uint64_t)_stats.bytes * 100 / _stats.imageBytes) : 0UL);
+    // At the rate the last full upload got
+    if (_fullBps) json.json("fullUploadMs", (unsigned long)((uint64_t)_stats.imageBytes * 1000 / _fullBps));
+    json.append('}');
+}
+
+// --- ArduinoOTA ---
+
+void OtaManager::onArduinoStart() {
+    _stats = {};
+    _stats.source = SOURCE_ARDUINO_OTA;
+    _startMs = millis();
+}
+
+void OtaManager::onArduinoEnd(bool ok) {
+    _stats.bytes = _stats.imageBytes = Update.progress();
+    if (ok) armGuard();
+    finishStats(ok, ok ? "" : "arduino-ota error");
+}
+
+void OtaManager::writeJson(StrBuf& json) {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* boot = esp_ota_get_boot_partition();
+    json.append('{');
+    json.json("running", running ? running->label : "");
+    json.json("boot", boot ? boot->label : "");
+    json.json("confirmPending", _guard.pending);
+    if (_guard.pending) {
+        json.json("rollbackTo", _guard.previous);
+        json.json("boots", (unsigned)_guard.boots);
+        json.json("healthyS", (unsigned long)((millis() - _healthySinceMs) / 1000));
+        json.json("rollbackInS", millis() < OTA_CONFIRM_MS ? (unsigned long)((OTA_CONFIRM_MS - millis()) / 1000) : 0UL);
+    }
+    json.jsonKey("last");
+    json.append('{');
+    json.json("source", sourceName(_stats.source));
+    if (_stats.source != SOURCE_NONE) {
+        json.json("ok", _stats.ok);
+        if (!_stats.ok) json.json("error", _stats.error);
+        json.json("time", (unsigned long)_stats.time);
+        json.json("bytes", (unsigned long)_stats.bytes);
+        json.json("imageBytes", (unsigned long)_stats.imageBytes);
+        json.json("uploadMs", (unsigned long)_stats.uploadMs);
+        json.json("bytesPerSec", _stats.uploadMs ? (unsigned long)((uint64_t)_stats.bytes * 1000 / _stats.uploadMs) : 0UL);
+        json.json("flashWriteMs", (unsigned long)(_stats.flashUs / 1000));
+        json.json("maxWriteUs", (unsigned long)_stats.maxWriteUs);
+        json.json("hashMs", (unsigned long)(_stats.hashUs / 1000));
+        if (_stats.delta) writeDeltaJson(json);
+    }
+    json.append("}}");
+}
@@ -0,0 +1,145 @@
+#ifndef OTA_MANAGER_H
+#define OTA_MANAGER_H
+
+#include <Arduino.h>
+#include "FixedString.h"
+#include "Sha256.h"
+#include <esp_partition.h>
+
+// What `ramzan_ota sign` appends to a firmware image. The image itself is
+// untouched, so it is still a normal app to the bootloader.
+struct OtaTrailer {
+    uint32_t magic;                     // "ROTA"
+    uint32_t imageSize;
+    uint8_t sha256[Sha256::HASH_SIZE];  // Of the image
+    uint8_t mac[Sha256::HASH_SIZE];     // HMAC-SHA256 with OTA_SIGN_KEY of the fields above
+} __attribute__((packed));
+
+// What `ramzan_ota diff` writes: this header, then records of
+//   varint add, add bytes, zigzag varint seek, varint copy
+// and last the OtaTrailer of the image it builds. A record writes its add
+// bytes and moves the read position in the running image past as many,
+// since they mostly replace changed bytes. Then it moves the position by
+// seek and copies copy bytes from there. Varints are LEB128.
+struct OtaDeltaHeader {
+    uint32_t magic;                        // "RDLT"
+    uint32_t baseSize;
+    uint32_t targetSize;
+    uint8_t baseSha256[Sha256::HASH_SIZE]; // Of the first baseSize bytes of the running partition
+} __attribute__((packed));
+
+// Firmware updates: checking a web upload as it streams, giving up on a new
+// image that never settles, and how long updates take.
+//
+// A web upload goes to Update a chunk at a time and through SHA-256 on the
+// way; only the last sizeof(OtaTrailer) bytes are held back, since they
+// may be the trailer. The boot partition only changes once size, hash and
+// signature all match, so a bad image is never booted.
+//
+// A delta is told apart from an image by its first byte. It is rebuilt into
+// the OTA partition from the running one through a 1 KB buffer. It only
+// starts once the running image hashes to the delta's base. If it does not,
+// wantsFullImage() is set and the full image has to be sent instead.
+//
+// A new image is confirmed once the loop has run for OTA_HEALTHY_MS with
+// no gap over OTA_LOOP_GAP_MS between ota task runs. WiFi and NTP do not
+// count, so an outage cannot roll back a good image. If that does not
+// happen within OTA_CONFIRM_MS and OTA_BOOT_TRIES boots, or the image
+// crashes (watchdog or panic), the old partition is made the boot
+// partition again. This does not need a bootloader built with rollback
+// support.
+class OtaManager {
+public:
+    enum Source : uint8_t { SOURCE_NONE, SOURCE_WEB, SOURCE_ARDUINO_OTA };
+    enum RollbackReason : uint8_t { ROLLBACK_TIMEOUT = 1, ROLLBACK_BOOTS, ROLLBACK_BOOTLOADER, ROLLBACK_CRASH };
+
+    void init();                        // After eventLog.init()
+    void update();                      // From the ota task
+
+    // Web upload of a signed image
+    bool begin();
+    bool write(const uint8_t* data, size_t len);
+    bool end();                         // Verify, then switch the boot partition
+    void abort(const char* why);
+    const char* getError() { return _stats.error; }
+    bool wantsFullImage() { return _wrongBase; } // Delta was made against another image
+
+    // ArduinoOTA writes on its own (espota password); only timed and guarded here
+    void onArduinoStart();
+    void onArduinoEnd(bool ok);
+    static uint8_t percent(size_t done, size_t total);
+
+    bool isConfirmPending() { return _guard.pending; }
+    void writeJson(StrBuf& json);
+
+    static void makeTrailer(const uint8_t sha256[Sha256::HASH_SIZE], uint32_t imageSize, const char* key,
+                            OtaTrailer& out);
+    static const uint32_t TRAILER_MAGIC = 0x41544F52; // "ROTA"
+    static const uint32_t DELTA_MAGIC = 0x544C4452;   // "RDLT"
+    static const uint8_t IMAGE_MAGIC = 0xE9;          // First byte of an app image
+
+private:
+    // Last update, kept in NVS since a good one ends in a reboot
+    struct Stats {
+        uint8_t source;
+        bool ok;
+        bool delta;
+        uint32_t bytes;        // Received, trailer included
+        uint32_t imageBytes;   // Written to flash
+        uint32_t copiedBytes;  // Of those, copied from the running image
+        uint32_t readUs;       // Reading the running image for copies
+        uint32_t baseHashUs;   // Checking the delta's base
+        uint32_t uploadMs;     // Start to end of the upload
+        uint32_t flashUs;      // Inside Update.write() / end()
+        uint32_t maxWriteUs;   // Slowest single write
+        uint32_t hashUs;
+        uint32_t time;         // Epoch seconds, 0 = clock not set
+        char error[32];
+    };
+    // The image in the boot partition still has to prove itself
+    struct Guard {
+        bool pending;
+        uint8_t boots;
+        char previous[17];     // Partition label to go back to
+    };
+
+    // Past the trailer hold-back, bytes go to one of these
+    enum DeltaState : uint8_t { DELTA_OFF, DELTA_HEADER, DELTA_ADD_LEN, DELTA_ADD, DELTA_SEEK, DELTA_COPY_LEN };
+
+    bool feed(const uint8_t* data, size_t len);
+    bool writeImage(const uint8_t* data, size_t len);
+    bool feedDelta(const uint8_t* data, size_t len);
+    bool startDelta();
+    bool deltaField(uint32_t value);
+    bool copyFromBase(uint32_t len);
+    void finishStats(bool ok, const char* error);
+    void writeDeltaJson(StrBuf& json);
+    void armGuard();
+    void saveGuard(const Guard& g);
+    void confirm();
+    void rollback(RollbackReason reason);
+
+    Stats _stats = {};
+    Guard _guard = {};
+    uint32_t _healthySinceMs = 0; // Start of the current run without a stall
+    uint32_t _lastUpdateMs = 0;
+    bool _active = false;
+    uint32_t _startMs = 0;
+    Sha256 _sha;
+    uint8_t _tail[sizeof(OtaTrailer)];
+    uint8_t _tailLen = 0;
+    uint32_t _fullBps = 0;     // Rate of the last full web upload, to compare a delta with
+
+    DeltaState _delta = DELTA_OFF;
+    OtaDeltaHeader _deltaHeader;
+    uint8_t _headerLen = 0;
+    bool _wrongBase = false;
+    const esp_partition_t* _base = nullptr;
+    uint32_t _basePos = 0;
+    uint32_t _field = 0;       // Varint so far
+    uint8_t _fieldShift = 0;
+    uint32_t _addLeft = 0;
+    uint8_t _buf[1024];        // Running image reads
+};
+
+#endif
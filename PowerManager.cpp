@@ -0,0 +1,277 @@
+#include "PowerManager.h"
+#include "Config.h"
+#include "Log.h"
+#include <WiFi.h>
+#include <driver/gpio.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <esp_sntp.h>
+#include <soc/gpio_reg.h>
+#include <sys/time.h>
+
+// Survives deep sleep (not power loss)
+struct RtcSleepState {
+    uint32_t magic;
+    uint32_t readyEwmaMs;     // Boot to IDLE, averaged over timer wakes
+    uint16_t readySamples;
+    int32_t driftPpm;         // RTC sleep timer error (+ = slept longer)
+    uint16_t driftSamples;
+    int64_t sleepStartMs;     // Epoch ms when we went to sleep, 0 = none
+    uint64_t plannedUs;       // What we wanted to sleep (before correction)
+    int64_t eventEpoch;       // The event we woke up for
+    uint32_t deepSleeps;
+    int32_t awakeDay;         // Local days since the epoch, -1 = unknown
+    uint32_t awakeTodayMs;    // Awake time of earlier boots today
+    uint32_t awakeYesterdayMs;
+};
+
+static const uint32_t RTC_SLEEP_MAGIC = 0x52534C50; // "RSLP"
+
+// Inputs that end a light sleep (the edge interrupts do not run in it)
+static const uint8_t WAKE_PINS[] = { PIN_BUTTON_NAV, PIN_BUTTON_HOUSE_A, PIN_BUTTON_HOUSE_B };
+RTC_DATA_ATTR static RtcSleepState rtcSleep;
+static bool s_driftMeasured = false;
+
+static int64_t epochMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+void PowerManager::init() {
+    _loopTask = xTaskGetCurrentTaskHandle(); // init() runs from setup() on the loop task
+
+    // Radio sleeps between beacons; it still wakes for every DTIM so
+    // incoming HTTP/OTA traffic is received
+    WiFi.setSleep(WIFI_PS_MIN_MODEM);
+
+    esp_pm_config_t pm = {};
+    pm.max_freq_mhz = CPU_FREQ_MAX_MHZ;
+    pm.min_freq_mhz = CPU_FREQ_MIN_MHZ;
+    pm.light_sleep_enable = LIGHT_SLEEP_ENABLED;
+
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err == ESP_OK) {
+        _mode = LIGHT_SLEEP_ENABLED ? PM_LIGHT_SLEEP : PM_DFS;
+    } else if (pm.light_sleep_enable) {
+        // Stock Arduino builds have no tickless idle: keep frequency scaling
+        pm.light_sleep_enable = false;
+        if (esp_pm_configure(&pm) == ESP_OK) _mode = PM_DFS;
+    }
+    if (_mode == PM_LIGHT_SLEEP) esp_sleep_enable_gpio_wakeup();
+    LOG_I("Power: %s (%d-%d MHz)", getModeName(), CPU_FREQ_MIN_MHZ, CPU_FREQ_MAX_MHZ);
+
+    if (rtcSleep.magic != RTC_SLEEP_MAGIC) {
+        memset(&rtcSleep, 0, sizeof(rtcSleep));
+        rtcSleep.magic = RTC_SLEEP_MAGIC;
+        rtcSleep.readyEwmaMs = SLEEP_DEFAULT_READY_MS;
+        rtcSleep.awakeDay = -1;
+    }
+    _wokeFromSleep = rtcSleep.sleepStartMs != 0 &&
+                     esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+    if (!_wokeFromSleep) rtcSleep.sleepStartMs = 0; // NAV wake or reset: no drift sample
+    sntp_set_time_sync_notification_cb(onTimeSync);
+
+    _lastWakeUs = micros();
+    _windowStart = millis();
+    _awakeMark = millis();
+}
+
+void PowerManager::idle(uint32_t ms) {
+    if (ms > IDLE_MAX_MS) ms = IDLE_MAX_MS;
+
+    uint32_t sleepStart = micros();
+    uint32_t active = sleepStart - _lastWakeUs;
+    _activeUs += active;
+    _windowActiveUs += active;
+
+    // Too short to be worth a context switch
+    if (ms >= 2) {
+        if (_mode == PM_LIGHT_SLEEP) armWakePins();
+        // Returns early when an ISR notifies the loop task
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+        if (_mode == PM_LIGHT_SLEEP) disarmWakePins();
+        _sleepCount++;
+    }
+
+    _lastWakeUs = micros();
+    uint32_t slept = _lastWakeUs - sleepStart;
+    _idleUs += slept;
+    _windowIdleUs += slept;
+
+    unsigned long now = millis();
+    if (now - _windowStart >= WINDOW_MS) closeWindow(now);
+}
+
+// GPIO wakeup is level triggered only. A released button (HIGH) wakes on
+// LOW; a house switch left ON is armed for HIGH instead, otherwise it
+// would wake the chip again the moment it dozes off.
+//
+// The wakeup shares the pin's interrupt type register with InputManager's
+// edge ISR, and a level interrupt re-fires for as long as the level holds.
+// So the pins are only armed for the nap, with their interrupt masked; the
+// nap then ends on its timeout and InputManager picks the new level up
+// from the live register.
+void PowerManager::armWakePins() {
+    uint32_t in = REG_READ(GPIO_IN_REG);
+    for (uint8_t i = 0; i < sizeof(WAKE_PINS); i++) {
+        gpio_num_t pin = (gpio_num_t)WAKE_PINS[i];
+        gpio_intr_disable(pin);
+        gpio_wakeup_enable(pin, (in & (1UL << pin)) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    }
+}
+
+// Back to the CHANGE interrupt InputManager attached
+void PowerManager::disarmWakePins() {
+    for (uint8_t i = 0; i < sizeof(WAKE_PINS); i++) {
+        gpio_num_t pin = (gpio_num_t)WAKE_PINS[i];
+        gpio_wakeup_disable(pin);
+        gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+        gpio_intr_enable(pin);
+    }
+}
+
+void PowerManager::closeWindow(unsigned long now) {
+    uint32_t total = _windowActiveUs + _windowIdleUs;
+    _activePctLastWindow = total ? (uint8_t)((uint64_t)_windowActiveUs * 100 / total) : 100;
+    _windowActiveUs = 0;
+    _windowIdleUs = 0;
+    _windowStart = now;
+    checkDay();
+}
+
+// --- Deep sleep ---
+
+void PowerManager::markReady() {
+    if (_ready) return;
+    _ready = true;
+    _readyMs = millis();
+
+    // Cold boots (no cached WiFi channel, user watching) only seed the average
+    if (_wokeFromSleep || rtcSleep.readySamples == 0) {
+        if (rtcSleep.readySamples == 0) rtcSleep.readyEwmaMs = _readyMs;
+        else rtcSleep.readyEwmaMs += ((int32_t)_readyMs - (int32_t)rtcSleep.readyEwmaMs) / 4;
+        rtcSleep.readySamples++;
+    }
+    if (_wokeFromSleep && rtcSleep.eventEpoch) {
+        _readyEarlySecs = (long)(rtcSleep.eventEpoch - epochMs() / 1000);
+    }
+    checkDay();
+    LOG_I("Power: ready in %lu ms (avg %lu ms)", (unsigned long)_readyMs, (unsigned long)rtcSleep.readyEwmaMs);
+}
+
+// First NTP answer after a timer wake: compare the real time we woke at
+// with what the RTC timer was asked for
+void PowerManager::onTimeSync(struct timeval* tv) {
+    if (s_driftMeasured || rtcSleep.sleepStartMs == 0) return;
+    s_driftMeasured = true;
+    if (rtcSleep.plannedUs < (uint64_t)SLEEP_DRIFT_MIN_SAMPLE_SEC * 1000000ULL) return;
+
+    int64_t wokeAtMs = (int64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000 - millis();
+    int64_t sleptMs = wokeAtMs - rtcSleep.sleepStartMs;
+    int64_t plannedMs = rtcSleep.plannedUs / 1000;
+    int32_t ppm = (int32_t)((sleptMs - plannedMs) * 1000000LL / plannedMs);
+    if (ppm > 100000 || ppm < -100000) return; // Clock was not trustworthy
+
+    if (rtcSleep.driftSamples == 0) rtcSleep.driftPpm = ppm;
+    else rtcSleep.driftPpm += (ppm - rtcSleep.driftPpm) / 4;
+    rtcSleep.driftSamples++;
+}
+
+long PowerManager::planDeepSleep(long secToEvent) {
+    if (secToEvent <= 0) return 0;
+
+    // Timer error we still have to cover: wide until measured
+    uint32_t guardPpm = rtcSleep.driftSamples ? SLEEP_DRIFT_GUARD_MEASURED_PPM : SLEEP_DRIFT_GUARD_PPM;
+    long readySecs = (rtcSleep.readyEwmaMs + 999) / 1000;
+    long sleepSecs = (long)((int64_t)(secToEvent - readySecs - SLEEP_WAKE_MARGIN_SEC) * 1000000LL /
+                            (1000000LL + guardPpm));
+
+    // A boot costs about readySecs at full power; only sleep when it pays off
+    if (sleepSecs < SLEEP_MIN_NAP_SEC || sleepSecs < readySecs * 4) return 0;
+    return sleepSecs;
+}
+
+uint64_t PowerManager::prepareDeepSleep(long sleepSecs, long secToEvent) {
+    int64_t now = epochMs();
+    uint64_t plannedUs = (uint64_t)sleepSecs * 1000000ULL;
+
+    rtcSleep.sleepStartMs = now;
+    rtcSleep.plannedUs = plannedUs;
+    rtcSleep.eventEpoch = now / 1000 + secToEvent;
+    rtcSleep.deepSleeps++;
+    checkDay();
+    rtcSleep.awakeTodayMs += millis() - _awakeMark;
+    _awakeMark = millis();
+
+    // Correct for the measured drift: a timer that runs slow gets asked for less
+    return plannedUs * 1000000ULL / (uint64_t)(1000000LL + rtcSleep.driftPpm);
+}
+
+// Rolls the awake counter over at local midnight (once the time is known)
+void PowerManager::checkDay() {
+    struct tm timeinfo;
+    if (!getLocalTime(&timeinfo, 0)) return;
+    // Day numbers run on across new year, so yesterday is always day - 1
+    int32_t day = (int32_t)((time(nullptr) + GMT_OFFSET_SEC + DAYLIGHT_OFFSET_SEC) / 86400);
+    if (day == rtcSleep.awakeDay) return;
+
+    uint32_t awake = rtcSleep.awakeTodayMs + (millis() - _awakeMark);
+    rtcSleep.awakeYesterdayMs = (rtcSleep.awakeDay == day - 1) ? awake : 0;
+    rtcSleep.awakeTodayMs = 0;
+    rtcSleep.awakeDay = day;
+    _awakeMark = millis();
+}
+
+uint32_t PowerManager::getAwakeTodaySecs() {
+    return (rtcSleep.awakeTodayMs + (millis() - _awakeMark)) / 1000;
+}
+
+uint16_t PowerManager::idleMilliamps() {
+    switch (_mode) {
+        case PM_LIGHT_SLEEP: return LIGHT_SLEEP_MA;
+        case PM_DFS:         return DFS_IDLE_MA;
+        default:             return NO_PM_IDLE_MA;
+    }
+}
+
+uint32_t PowerManager::getEstimatedMilliamps() {
+    return (ACTIVE_MA * _activePctLastWindow + idleMilliamps() * (100 - _activePctLastWindow)) / 100;
+}
+
+const char* PowerManager::getModeName() {
+    switch (_mode) {
+        case PM_LIGHT_SLEEP: return "light-sleep";
+        case PM_DFS:         return "dfs";
+        default:             return "none";
+    }
+}
+
+void PowerManager::writeStatsJson(StrBuf& json) {
+    uint64_t totalUs = _activeUs + _idleUs;
+    // mAh = mA * us / 3.6e9
+    uint32_t usedMah = (uint32_t)((_activeUs * ACTIVE_MA + _idleUs * idleMilliamps()) / 3600000000ULL);
+    uint32_t baselineMah = (uint32_t)(totalUs * ACTIVE_MA / 3600000000ULL);
+
+    json += '{';
+    json.json("mode", getModeName());
+    json.json("activePct", _activePctLastWindow);
+    json.json("estMa", getEstimatedMilliamps());
+    json.json("baselineMa", ACTIVE_MA);
+    json.json("activeMs", (uint32_t)(_activeUs / 1000));
+    json.json("idleMs", (uint32_t)(_idleUs / 1000));
+    json.json("sleeps", _sleepCount);
+    json.json("usedMah", usedMah);
+    json.json("baselineMah", baselineMah);
+    // Deep sleep
+    json.json("wokeFromSleep", _wokeFromSleep);
+    json.json("readyMs", _readyMs);
+    json.json("readyAvgMs", rtcSleep.readyEwmaMs);
+    json.json("readyEarlyS", _readyEarlySecs);
+    json.json("driftPpm", rtcSleep.driftPpm);
+    json.json("driftSamples", rtcSleep.driftSamples);
+    json.json("deepSleeps", rtcSleep.deepSleeps);
+    json.json("awakeTodayS", getAwakeTodaySecs());
+    json.json("awakeYesterdayS", rtcSleep.awakeYesterdayMs / 1000);
+    json += '}';
+}
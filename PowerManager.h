@@ -0,0 +1,85 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "FixedString.h"
+
+enum PowerMode {
+    PM_NONE,        // esp_pm not available: idle only yields to the IDLE task
+    PM_DFS,         // CPU clock drops to the minimum between passes
+    PM_LIGHT_SLEEP  // Tickless idle: the chip light-sleeps between passes
+};
+
+// Lets the chip rest between loop() passes instead of spinning.
+// WiFi runs in modem sleep, esp_pm scales the CPU clock (and light-sleeps
+// when tickless idle is built in), and idle() blocks the loop task until
+// the next deadline or until something notifies it (button edge ISR, masked
+// while the buttons are armed as light sleep wakeups).
+//
+// Also counts how long the CPU was busy vs. idle and turns that into a
+// rough current estimate, compared against the old always-busy loop.
+//
+// Deep sleep: how long a boot takes to get back to IDLE (WiFi + time) and
+// how far the RTC sleep timer drifts are measured and kept in RTC memory,
+// so the device wakes that long (plus a margin) before the next event
+// instead of a fixed 30 minutes.
+class PowerManager {
+public:
+    void init();
+    void idle(uint32_t ms); // Block up to ms (capped at IDLE_MAX_MS)
+
+    // --- Deep sleep ---
+    void markReady();                     // System reached IDLE after boot (first call counts)
+    bool isReady() { return _ready; }
+    bool wokeFromDeepSleep() { return _wokeFromSleep; }
+    long planDeepSleep(long secToEvent);  // Seconds worth sleeping, 0 = stay up
+    uint64_t prepareDeepSleep(long sleepSecs, long secToEvent); // Timer us to program
+    uint32_t getAwakeTodaySecs();
+
+    TaskHandle_t getWakeTask() { return _loopTask; }
+    PowerMode getMode() { return _mode; }
+    const char* getModeName();
+
+    // Share of wall time spent running passes during the last window
+    uint8_t getActivePercent() { return _activePctLastWindow; }
+    uint32_t getSleepCount() { return _sleepCount; }
+    uint32_t getEstimatedMilliamps();   // Average over the last window
+    void writeStatsJson(StrBuf& json);
+
+    // Rough ESP32-WROOM figures with WiFi associated (mA)
+    static const uint16_t ACTIVE_MA = 68;      // 240 MHz, modem sleep
+    static const uint16_t DFS_IDLE_MA = 20;    // 80 MHz, waiting in IDLE task
+    static const uint16_t LIGHT_SLEEP_MA = 2;  // Average incl. DTIM wakeups
+    static const uint16_t NO_PM_IDLE_MA = 40;  // 240 MHz, waiting in IDLE task
+
+    static const uint32_t WINDOW_MS = 10000;
+
+private:
+    uint16_t idleMilliamps();
+    void armWakePins();
+    void disarmWakePins();
+    void closeWindow(unsigned long now);
+    void checkDay();
+    static void onTimeSync(struct timeval* tv);
+
+    bool _wokeFromSleep = false;
+    bool _ready = false;
+    uint32_t _readyMs = 0;
+    long _readyEarlySecs = 0;   // How long before the event we were up
+    unsigned long _awakeMark = 0;
+
+    PowerMode _mode = PM_NONE;
+    TaskHandle_t _loopTask = nullptr;
+
+    uint32_t _lastWakeUs = 0;
+    uint64_t _activeUs = 0;   // Since boot
+    uint64_t _idleUs = 0;
+    uint32_t _sleepCount = 0;
+
+    uint32_t _windowActiveUs = 0;
+    uint32_t _windowIdleUs = 0;
+    unsigned long _windowStart = 0;
+    uint8_t _activePctLastWindow = 100;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include <esp_task_wdt.h> 
+#include <esp_system.h> // esp_reset_reason() for the boot event
 #include <ArduinoOTA.h> 
 #include <Preferences.h> // Added for Persistent Settings
 #include "Config.h"
@@ -11,6 +12,23 @@
 #include "AlarmScheduler.h"
 #include "ButtonEngine.h"
 #include "WebServerManager.h" 
+#include "ScreenRegistry.h"
+#include "TaskScheduler.h"
+#include "TransitionManager.h"
+#include "StateMachine.h"
+#include "PowerManager.h"
+#include "EventLog.h"
+#include "Benchmarks.h"
+#include "HeapStats.h"
+#include "StallMonitor.h"
+#include "SerialConsole.h"
+#include "Log.h"
+#include "MqttPublisher.h"
+#include "UnitSync.h"
+#include "TimingStats.h"
+#include "TimetableStore.h"
+#include "OtaManager.h"
+#include <sys/time.h>
 
 // --- Global Objects ---
 BuzzerEngine buzzerA(PIN_BUZZER_HOUSE_A);
@@ -19,17 +37,30 @@ BuzzerEngine buzzerB(PIN_BUZZER_HOUSE_B);
 ButtonEngine btnHouseA(PIN_BUTTON_HOUSE_A);
 ButtonEngine btnHouseB(PIN_BUTTON_HOUSE_B);
 ButtonEngine btnNav(PIN_BUTTON_NAV);
+InputManager inputManager; // Shared scanner/debouncer behind all buttons
 
 RamzanNetworkManager networkManager;
 DisplayManager displayManager;
 AlarmScheduler alarmScheduler;
 WebServerManager webServerManager; 
+TaskScheduler taskScheduler;
+TransitionManager transitionManager; // Timed messages instead of delay()
+PowerManager powerManager;
+EventLog eventLog; // Persistent history in the "evlog" flash partition
+HeapStats heapStats; // Proves the loop no longer allocates
+StallMonitor stallMonitor; // Which subsystem was running when the watchdog hit
+SerialConsole serialConsole; // Line commands; output is buffered, never blocks
+MqttPublisher mqttPublisher; // Events and health for the building-management system
+UnitSync unitSync; // Rings in step with the other units on the LAN
+TimingStats timingStats; // How late alarms start, how long segments really last
+TimetableStore timetable; // Uploaded timetable in flash, or the built-in one
+OtaManager otaManager; // Signed web updates, rollback of images that never settle
 Preferences prefs; // Global Preferences for NVS
 
 // --- System State ---
-SystemState currentState = STATE_BOOT;
+StateMachine stateMachine; // Owns the SystemState; see registerStateActions()
 unsigned long bootTime = 0;
-String bootTimeString = "Loading...";
+TimeText bootTimeString = "Loading...";
 
 // --- Switch Logic State ---
 bool initialSwitchStatePreSehri = false;
@@ -40,95 +71,96 @@ bool preSehriActive = false;
 // --- Display State ---
 int currentScreen = 0; 
 unsigned long lastScreenAutoCycle = 0;
-const int SCREEN_COUNT = 7; 
+ScreenRegistry screenRegistry;
+
+// --- Cached Config (mirrors NVS, so hot paths never read prefs) ---
+int prayerBeepCount = 2;
+int prayerBeepDuration = 300;
+int prayerBeepGap = 300;
 
 // --- Status Tracking ---
-String lastActionDescription = "Boot Done";
+const char* lastActionDescription = "Boot Done";
 bool wifiWasConnected = true;
 unsigned long lastSleepCheck = 0;
+long pendingSleepSecs = 0;
+unsigned long ringStartMs = 0; // For the event log's ring duration / ack latency
+uint8_t ackedHouses = 0;       // EventHouse bits acked during this ring
 bool sleepModeEnabled = true; // Hardcoded or from prefs? Let's check prefs below.
 
 // --- Function Prototypes ---
-void handleSerialCommands();
+void registerCommands();
+void loadSettings();
 void checkStopConditions();
+bool buzzersRinging();
 void handleDisplay();
+void updateScreenDependencies();
+void registerScreens();
+void registerTasks();
+void registerStateActions();
 void handleButtons();
 void startPreSehriAlarm();
 void startSehriAlarm();
 void startIftarAlarm();
 void startPrayerBeep();
 void startTestMode();
+void resumeCarousel();
+void enterDeepSleep();
 void startSehriEndBeep();
 void setupOTA();
 void updatePrayerPattern(int count, int dur, int gap); 
 void updateSehriPattern(int dur, int interval); 
 void updatePreSehriOffset(int minutes); 
+void runBenchmarks(const char* filter, Print& out);
 
 void setup() {
     Serial.begin(115200);
-    delay(2000);
-    Serial.println("\n\n--- RAMZAN ALARM SYSTEM FINAL v3 (OTA + Prefs) ---");
+    serialConsole.init(Serial);
+    LOG_I("--- RAMZAN ALARM SYSTEM FINAL v3 (OTA + Prefs) ---");
     bootTime = millis();
+    stallMonitor.init();
+    heapStats.init();
+    registerStateActions();
     
     // Init Drivers
     buzzerA.init();
     buzzerB.init();
     
-    btnHouseA.init();
-    btnHouseB.init();
-    btnNav.init();
-    
-    // Pin Modes
-    pinMode(PIN_SWITCH_PRE_SEHRI, INPUT_PULLUP);
-    pinMode(PIN_BUTTON_HOUSE_A, INPUT_PULLUP); 
-    pinMode(PIN_BUTTON_HOUSE_B, INPUT_PULLUP);
+    // Pin Modes: InputManager configures every input pin and its edge
+    // interrupt. Calling pinMode() on them again would disable the interrupts.
+    inputManager.init();
+    btnHouseA.init(&inputManager);
+    btnHouseB.init(&inputManager);
+    btnNav.init(&inputManager);
+
+    eventLog.init();
+    eventLog.append(EVENT_BOOT, HOUSE_NONE, esp_reset_reason());
+    if (stallMonitor.lastResetWasStall()) {
+        const StallMonitor::ResetRecord& r = stallMonitor.getLastReset();
+        eventLog.append(EVENT_STALL, HOUSE_NONE, r.depth ? r.stack[r.depth - 1] : STAGE_NONE, r.inStageMs);
+    }
+    timetable.init();
+    otaManager.init(); // May go back to the previous image and restart
 
     displayManager.init();
+    registerScreens();
     displayManager.showMessage("Ramzan Alarm", "Starting...");
     
     networkManager.init();
+    stateMachine.transition(STATE_WIFI_CONNECTING);
     alarmScheduler.init();
     webServerManager.init(); 
+    mqttPublisher.init();
+    unitSync.init();
     
-    // Load Settings from NVS
-    prefs.begin("ramzan", false); // Namespace "ramzan", ReadWrite
-    int sOff = prefs.getInt("sOff", 0);
-    int iOff = prefs.getInt("iOff", 0);
-    
-    // Prayer Beep Settings
-    int pCount = prefs.getInt("pCount", 2);
-    int pDur = prefs.getInt("pDur", 300);
-    int pGap = prefs.getInt("pGap", 300);
-    
-    // Sehri Pattern Settings
-    int sDur = prefs.getInt("sDur", 5000);
-    int sInt = prefs.getInt("sInt", 10000);
-
-    // Loading Pre-Sehri Offset
-    int preOff = prefs.getInt("preOff", 60);
-
-    Serial.print("Loaded Offsets -> Sehri: "); Serial.print(sOff);
-    Serial.print(", Iftar: "); Serial.print(iOff);
-    Serial.print(", Pre-Sehri: "); Serial.println(preOff);
-    Serial.printf("Prayer Pattern -> Count: %d, Dur: %d, Gap: %d\n", pCount, pDur, pGap);
-    Serial.printf("Sehri Pattern -> Dur: %d, Int: %d\n", sDur, sInt);
-
-    alarmScheduler.setOffsets(sOff, iOff);
-    alarmScheduler.setPreSehriOffset(preOff);
-    sleepModeEnabled = prefs.getBool("sleep", false); // Default OFF for safety
-    updatePrayerPattern(pCount, pDur, pGap);
-    updateSehriPattern(sDur, sInt);
-    
-    prefs.end();
+    loadSettings(); // From NVS
     
     // Setup OTA
     setupOTA();
 
-    currentState = STATE_IDLE; 
-    Serial.println("System Ready. Mode: IDLE");
+    LOG_I("System Ready. Waiting for WiFi/NTP");
     
     // WDT
-    Serial.println("Initializing WDT (8s)...");
+    LOG_I("Initializing WDT (8s)...");
     esp_task_wdt_config_t wdt_config = {
         .timeout_ms = 8000,
         .idle_core_mask = (1 << 0), 
@@ -137,64 +169,144 @@ void setup() {
     esp_task_wdt_init(&wdt_config);
     esp_task_wdt_add(NULL);     
 
+    registerTasks();
+    registerCommands();
+
+    // Modem sleep + DFS/light sleep; button edges wake the idle loop
+    powerManager.init();
+    inputManager.setWakeTask(powerManager.getWakeTask());
+
     lastActionDescription = "Boot Done";
+    stallMonitor.exit(STAGE_SETUP);
 }
 
 void loop() {
     esp_task_wdt_reset();
+    taskScheduler.run();
+    heapStats.onPass();
 
-    ArduinoOTA.handle(); 
-    webServerManager.handleClient();
-    networkManager.update(); 
+    // Sleep until the next periodic task or buzzer step is due
+    uint32_t nextMs = taskScheduler.getMsToNextDue();
+    if (buzzersRinging()) {
+        nextMs = min(nextMs, (uint32_t)min(buzzerA.getMsToNextStep(), buzzerB.getMsToNextStep()));
+    }
+    nextMs = min(nextMs, unitSync.getMsToStart());
+    Breadcrumb crumb(STAGE_IDLE);
+    powerManager.idle(nextMs);
+}
 
-    btnHouseA.update();
-    btnHouseB.update();
-    btnNav.update();
+// --- Tasks ---
+// Priority 0 (alarm, buzzers) always runs first in a pass. Periods are
+// what each subsystem actually needs; anything that only reacts to input
+// has a ready() check so idle passes do not call it at all.
+
+bool buzzersRinging() { return buzzerA.isRinging() || buzzerB.isRinging(); }
+
+void buzzerTask() {
+    Breadcrumb crumb(STAGE_BUZZER);
     buzzerA.update();
     buzzerB.update();
+    checkStopConditions();
+}
+
+void startScheduledAlarm(int code) {
+    if (code == 1) startSehriAlarm();
+    else if (code == 2) startIftarAlarm();
+    else if (code == 3) startPreSehriAlarm();
+    else if (code == 4) startPrayerBeep(); 
+    else if (code == 5) {
+        LOG_I("AUTO-TRIGGER: Sehri Ends (3s Ring)");
+        startSehriEndBeep(); 
+    }
+}
+
+void alarmTask() {
+    Breadcrumb crumb(STAGE_ALARM);
     alarmScheduler.update(&networkManager);
-    
+
+    // A trigger waiting for the group start is not checked again
+    if (stateMachine.getState() == STATE_IDLE && networkManager.isTimeSynced() && !unitSync.hasPendingStart()) {
+        int code = alarmScheduler.checkAlarmTriggers(&networkManager);
+        if (code) {
+            timingStats.onTrigger(code);
+            if (unitSync.scheduleStart(code)) timingStats.setPlannedStart(unitSync.getStartMicros());
+            else startScheduledAlarm(code);
+        }
+    }
+}
+
+// Runs the moment the agreed start comes; the loop wakes for it
+void syncStartTask() {
+    Breadcrumb crumb(STAGE_ALARM);
+    int code = unitSync.takeDueStart();
+    if (code && stateMachine.getState() == STATE_IDLE) startScheduledAlarm(code);
+}
+
+bool syncStartDue() { return unitSync.isStartDue(); }
+
+// Buttons still settling, a gesture or long press still open, or an edge
+// the ISR slept through
+bool inputsBusy() {
+    return !inputManager.isSettled() || !btnHouseA.isIdle() ||
+           !btnHouseB.isIdle() || !btnNav.isIdle();
+}
+
+void inputTask() {
+    Breadcrumb crumb(STAGE_INPUT);
+    inputManager.update();
+    btnHouseA.update();
+    btnHouseB.update();
+    btnNav.update();
+    handleButtons();
+}
+
+void networkTask() {
+    Breadcrumb crumb(STAGE_NETWORK);
+    networkManager.update(); 
+
+    // Boot phases: WiFi, then NTP, then IDLE
+    if (stateMachine.getState() == STATE_WIFI_CONNECTING && networkManager.isConnected()) {
+        stateMachine.transition(STATE_TIME_SYNC);
+    }
+    if (stateMachine.getState() == STATE_TIME_SYNC) {
+        if (networkManager.isTimeSynced()) stateMachine.transition(STATE_IDLE);
+        else if (!networkManager.isConnected()) stateMachine.transition(STATE_WIFI_CONNECTING);
+    }
+    // Boot-to-ready time for deep sleep planning: the first IDLE with the
+    // clock set, however we got there (an alarm rung during boot ends in
+    // IDLE before NTP has synced)
+    if (stateMachine.getState() == STATE_IDLE && networkManager.isTimeSynced()) powerManager.markReady();
+
     static bool bootTimeCaptured = false;
     if (!bootTimeCaptured && networkManager.isTimeSynced()) {
         bootTimeString = networkManager.getFormattedTime();
         bootTimeCaptured = true;
     }
+}
 
-    handleButtons();
-    checkStopConditions();
-    
-    if (currentState == STATE_IDLE && networkManager.isTimeSynced()) {
-        int code = alarmScheduler.checkAlarmTriggers(&networkManager);
-        if (code == 1) startSehriAlarm();
-        else if (code == 2) startIftarAlarm();
-        else if (code == 3) startPreSehriAlarm();
-        else if (code == 4) startPrayerBeep(); 
-        else if (code == 5) {
-            Serial.println("AUTO-TRIGGER: Sehri Ends (3s Ring)");
-            startSehriEndBeep(); 
-        }
+void mqttTask() {
+    Breadcrumb crumb(STAGE_MQTT);
+    mqttPublisher.update();
+}
 
-        // --- Deep Sleep Logic ---
-        // Stay awake for at least 2 minutes after boot/reset for OTA/Settings
-        const unsigned long GRACE_PERIOD = 120000; 
-        if (sleepModeEnabled && currentState == STATE_IDLE && (millis() > GRACE_PERIOD) && (millis() - lastSleepCheck > 60000)) {
-            lastSleepCheck = millis();
-            long secToNext = alarmScheduler.getSecondsToNextAlarm();
-            if (secToNext > (3 * 3600)) { // More than 3 hours
-                long sleepSecs = secToNext - (30 * 60); // Wake 30 mins before
-                if (sleepSecs > 300) { // Safety: at least 5 mins sleep
-                    Serial.printf("DEEP SLEEP: Target in %ld s. Sleeping for %ld s.\n", secToNext, sleepSecs);
-                    displayManager.showMessage("SLEEP MODE", "Press NAV to wake");
-                    delay(3000);
-                    // Add wakeup from Navigation Button (GPIO 4 / PIN_BUTTON_NAV)
-                    esp_sleep_enable_ext0_wakeup(GPIO_NUM_4, 0); // 0 = Wake on LOW (Press)
-                    esp_sleep_enable_timer_wakeup((uint64_t)sleepSecs * 1000000ULL);
-                    esp_deep_sleep_start();
-                }
-            }
-        }
-    }
+void syncTask() {
+    Breadcrumb crumb(STAGE_SYNC);
+    unitSync.update();
+}
+
+void webTask() {
+    Breadcrumb crumb(STAGE_WEB);
+    webServerManager.handleClient();
+}
 
+void otaTask() {
+    Breadcrumb crumb(STAGE_OTA);
+    ArduinoOTA.handle();
+    otaManager.update();
+}
+
+void displayTask() {
+    Breadcrumb crumb(STAGE_DISPLAY);
     // --- WiFi Warning Logic ---
     bool currentWifi = networkManager.isConnected();
     if (wifiWasConnected && !currentWifi) {
@@ -203,51 +315,136 @@ void loop() {
         displayManager.setOverrideMessage("WiFi LOST", "Connect WiFi", 5000);
     } else if (!wifiWasConnected && currentWifi) {
         wifiWasConnected = true;
-        displayManager.setOverrideMessage("WiFi RESTORED", networkManager.getFormattedTime(), 3000);
+        displayManager.setOverrideMessage("WiFi RESTORED", networkManager.getFormattedTime().c_str(), 3000);
     }
 
     if (!currentWifi && millis() % 10000 < 2000) {
         displayManager.showMessage("WiFi ERROR", "Connect WiFi");
-        
-        // Periodic short beep if WiFi lost (Every 30 seconds)
-        static unsigned long lastWifiChirp = 0;
-        if (millis() - lastWifiChirp > 30000) {
-            lastWifiChirp = millis();
-            // buzzerA logic removed
-        }
     } else {
         handleDisplay();
     }
-    handleSerialCommands();
+}
+
+void serialTask() {
+    Breadcrumb crumb(STAGE_SERIAL);
+    serialConsole.update();
+}
+
+bool serialPending() { return serialConsole.hasWork(); }
+
+// Last in line: log lines wait in RAM until everything else is done
+void logTask() {
+    Log::drain(serialConsole);
+}
+
+bool logPending() { return Log::pending(); }
+
+void sleepTask() {
+    Breadcrumb crumb(STAGE_SLEEP);
+    // --- Deep Sleep Logic ---
+    // Stay awake for at least 2 minutes after boot/reset for OTA/Settings.
+    // A timer wake goes straight back to sleep once its event is done.
+    const unsigned long GRACE_PERIOD = 120000; 
+    if (!sleepModeEnabled || stateMachine.getState() != STATE_IDLE || !networkManager.isTimeSynced()) return;
+    if (unitSync.hasPendingStart()) return;
+    if (!powerManager.wokeFromDeepSleep() && millis() <= GRACE_PERIOD) return;
+    if (millis() - lastSleepCheck <= 10000 || transitionManager.isPending()) return;
+
+    lastSleepCheck = millis();
+    long secToNext = alarmScheduler.getSecondsToNextAlarm();
+    long sleepSecs = powerManager.planDeepSleep(secToNext);
+    if (sleepSecs > 0) {
+        LOG_I("DEEP SLEEP: Target in %ld s. Sleeping for %ld s.", secToNext, sleepSecs);
+        pendingSleepSecs = sleepSecs;
+        transitionManager.show("SLEEP MODE", "Press NAV to wake", 3000, enterDeepSleep);
+    }
+}
+
+void enterDeepSleep() {
+    // Something may have started ringing while the notice was up
+    // Re-plan: the notice itself took a few seconds
+    long secToNext = alarmScheduler.getSecondsToNextAlarm();
+    pendingSleepSecs = powerManager.planDeepSleep(secToNext);
+    if (stateMachine.getState() != STATE_IDLE || pendingSleepSecs <= 0) {
+        LOG_I("DEEP SLEEP: Aborted");
+        return;
+    }
+    // Add wakeup from Navigation Button (GPIO 4 / PIN_BUTTON_NAV)
+    esp_sleep_enable_ext0_wakeup(GPIO_NUM_4, 0); // 0 = Wake on LOW (Press)
+    esp_sleep_enable_timer_wakeup(powerManager.prepareDeepSleep(pendingSleepSecs, secToNext));
+    eventLog.append(EVENT_DEEP_SLEEP);
+    // Nothing runs after this, so send what is still queued
+    Log::drain(serialConsole);
+    serialConsole.flush();
+    esp_deep_sleep_start();
+}
+
+void transitionTask() {
+    Breadcrumb crumb(STAGE_UI);
+    transitionManager.update();
+}
+
+void eventLogTask() {
+    Breadcrumb crumb(STAGE_EVENTLOG);
+    eventLog.update();
+}
+
+bool eventLogErasePending() { return eventLog.needsErase(); }
+bool transitionPending() { return transitionManager.isPending(); }
+
+void registerTasks() {
+    taskScheduler.setPassBudget(LOOP_PASS_BUDGET_US);
+
+    //                 name       fn           prio period deadline budget
+    taskScheduler.add("buzzer",  buzzerTask,  0,   0,     0,      500,   buzzersRinging);
+    taskScheduler.add("alarm",   alarmTask,   0,   250,   500,    2000);
+    taskScheduler.add("syncstart", syncStartTask, 0, 0,   0,      2000,  syncStartDue);
+    taskScheduler.add("input",   inputTask,   1,   10,    20,     1000,  inputsBusy);
+    taskScheduler.add("ui",      transitionTask, 1, 10,   50,     500,   transitionPending);
+    taskScheduler.add("web",     webTask,     2,   20,    50,     20000);
+    taskScheduler.add("ota",     otaTask,     2,   100,   200,    5000);
+    taskScheduler.add("network", networkTask, 2,   100,   500,    5000);
+    taskScheduler.add("display", displayTask, 3,   100,   500,    3000);
+    taskScheduler.add("mqtt",    mqttTask,    3,   100,   0,      2000);
+    // Without the receiver task, arrival times are only as good as the poll
+    taskScheduler.add("sync",    syncTask,    3,   unitSync.hasRxTask() ? 100 : 2, 0, 2000);
+    taskScheduler.add("serial",  serialTask,  4,   0,     0,      5000,  serialPending);
+    taskScheduler.add("sleep",   sleepTask,   5,   1000,  0,      0);
+    taskScheduler.add("eventlog", eventLogTask, 5, 1000,  0,      0,     eventLogErasePending);
+    taskScheduler.add("log",     logTask,     5,   0,     0,      0,     logPending);
 }
 
 void setupOTA() {
-    Serial.println("Configuring OTA...");
+    LOG_D("Configuring OTA...");
     ArduinoOTA.setHostname("RamzanAlarm-Device");
     
     ArduinoOTA.onStart([]() {
-        String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
-        Serial.println("Start updating " + type);
+        const char* type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
+        LOG_I("OTA: Start updating %s", type);
+        otaManager.onArduinoStart();
         displayManager.showMessage("SYSTEM UPDATE", "Do Not Power Off");
-        buzzerA.setBuzzer(true); delay(100); buzzerA.setBuzzer(false);
+        stateMachine.transition(STATE_OTA_MODE);
     });
     
     ArduinoOTA.onEnd([]() {
-        Serial.println("\nEnd");
+        LOG_I("OTA: End");
+        otaManager.onArduinoEnd(true);
+        eventLog.append(EVENT_OTA_DONE);
         displayManager.showMessage("UPDATE DONE", "Rebooting...");
     });
     
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-        Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+        LOG_D("OTA: Progress: %u%%", OtaManager::percent(progress, total));
     });
     
     ArduinoOTA.onError([](ota_error_t error) {
-        Serial.printf("Error[%u]: ", error);
-        displayManager.showMessage("UPDATE FAILED", "Check Serial");
+        LOG_E("OTA: Error[%u]", error);
+        otaManager.onArduinoEnd(false);
+        stateMachine.transition(STATE_ERROR);
     });
 
     ArduinoOTA.begin();
-    Serial.println("OTA Ready");
+    LOG_I("OTA Ready");
 }
 
 void handleButtons() {
@@ -255,27 +452,44 @@ void handleButtons() {
     
     if (navEvent == BUTTON_PRESSED) {
         currentScreen++;
-        if (currentScreen >= SCREEN_COUNT) currentScreen = 0;
+        if (currentScreen >= screenRegistry.count()) currentScreen = 0;
         lastScreenAutoCycle = millis(); 
-        Serial.print("Screen changed to: "); Serial.println(currentScreen);
+        LOG_D("Screen changed to: %d", currentScreen);
     }
     else if (navEvent == BUTTON_HELD) {
-        Serial.println("Long Press: Test Mode");
+        LOG_I("Long Press: Test Mode");
         startTestMode();
     }
+    else if (navEvent == BUTTON_DOUBLE_CLICK) {
+        // Double click jumps back to the main clock screen
+        currentScreen = 0;
+        lastScreenAutoCycle = millis();
+        LOG_D("Double Click: Home Screen");
+    }
+
+    // Read each queue exactly once per pass; events are drained even while
+    // ringing so stale switch flips are not replayed when we return to IDLE.
+    ButtonEvent evA = btnHouseA.getEvent();
+    ButtonEvent evB = btnHouseB.getEvent();
 
-    if (currentState == STATE_IDLE) {
-        if (btnHouseA.getEvent() == BUTTON_PRESSED || btnHouseA.getEvent() == BUTTON_RELEASED) {
-             bool isOn = (digitalRead(PIN_BUTTON_HOUSE_A) == LOW);
-             displayManager.showMessage("House A", isOn ? "ON (GND)" : "OFF (OPEN)");
-             delay(500);
-             lastScreenAutoCycle = millis();
+    if (stateMachine.isRinging()) {
+        // First press per house during a ring counts as its acknowledgement
+        if (evA == BUTTON_PRESSED && !(ackedHouses & HOUSE_A)) {
+            ackedHouses |= HOUSE_A;
+            eventLog.append(EVENT_ACK, HOUSE_A, stateMachine.getState(), 0, btnHouseA.getEventTime() - ringStartMs);
         }
-        if (btnHouseB.getEvent() == BUTTON_PRESSED || btnHouseB.getEvent() == BUTTON_RELEASED) {
-             bool isOn = (digitalRead(PIN_BUTTON_HOUSE_B) == LOW);
-             displayManager.showMessage("House B", isOn ? "ON (GND)" : "OFF (OPEN)");
-             delay(500);
-             lastScreenAutoCycle = millis();
+        if (evB == BUTTON_PRESSED && !(ackedHouses & HOUSE_B)) {
+            ackedHouses |= HOUSE_B;
+            eventLog.append(EVENT_ACK, HOUSE_B, stateMachine.getState(), 0, btnHouseB.getEventTime() - ringStartMs);
+        }
+    } else {
+        if (evA == BUTTON_PRESSED || evA == BUTTON_RELEASED) {
+             bool isOn = (evA == BUTTON_PRESSED);
+             transitionManager.show("House A", isOn ? "ON (GND)" : "OFF (OPEN)", 500, resumeCarousel);
+        }
+        if (evB == BUTTON_PRESSED || evB == BUTTON_RELEASED) {
+             bool isOn = (evB == BUTTON_PRESSED);
+             transitionManager.show("House B", isOn ? "ON (GND)" : "OFF (OPEN)", 500, resumeCarousel);
         }
     }
 }
@@ -285,143 +499,265 @@ void handleDisplay() {
     
     if (millis() - lastScreenAutoCycle > 5000) {
         currentScreen++;
-        if (currentScreen >= SCREEN_COUNT) currentScreen = 0;
+        if (currentScreen >= screenRegistry.count()) currentScreen = 0;
         lastScreenAutoCycle = millis();
     }
 
     if (millis() - lastUpdate > 1000) {
         lastUpdate = millis();
-        String line1, line2;
         
-        if (currentState != STATE_IDLE && currentState != STATE_PRAYER_BEEP) {
-            line1 = "ALARM ACTIVE!";
-            if (currentState == STATE_PRE_SEHRI_RINGING) line2 = "PRE-SEHRI (SW)";
-            else if (currentState == STATE_SEHRI_RINGING) line2 = "SEHRI TIME";
-            else if (currentState == STATE_IFTAR_RINGING) line2 = "IFTAR TIME";
-            else line2 = "Check Device";
+        SystemState state = stateMachine.getState();
+        if (stateMachine.isRinging() && state != STATE_PRAYER_BEEP) {
+            const char* line2 = "Check Device";
+            if (state == STATE_PRE_SEHRI_RINGING) line2 = "PRE-SEHRI (SW)";
+            else if (state == STATE_SEHRI_RINGING) line2 = "SEHRI TIME";
+            else if (state == STATE_IFTAR_RINGING) line2 = "IFTAR TIME";
+            displayManager.showMessage("ALARM ACTIVE!", line2);
         } 
-        else if (currentState == STATE_PRAYER_BEEP) {
-             line1 = "  PRAYER TIME   ";
-             line2 = "   (2 Beeps)    ";
+        else if (state == STATE_PRAYER_BEEP) {
+            displayManager.showMessage("  PRAYER TIME   ", "   (2 Beeps)    ");
+        }
+        else if (state == STATE_OTA_MODE || state == STATE_ERROR) {
+            // Entry action's message stays up
         }
         else {
-            switch(currentScreen) {
-                case 0: // Main
-                    line1 = networkManager.getFormattedTime();
-                    // Show Uptime on Line 2
-                    {
-                        unsigned long upSec = (millis() - bootTime) / 1000;
-                        int upH = upSec / 3600;
-                        int upM = (upSec % 3600) / 60;
-                        char upBuff[16];
-                        sprintf(upBuff, "UP: %02dh %02dm", upH, upM);
-                        line2 = upBuff;
-                    }
-                    break;
-                case 1: // Alarm Info
-                    {
-                         bool swA = (digitalRead(PIN_BUTTON_HOUSE_A) == LOW); 
-                         bool swB = (digitalRead(PIN_BUTTON_HOUSE_B) == LOW); 
-                         line1 = "A:" + String(swA?"ON":"OFF") + " B:" + String(swB?"ON":"OFF");
-                         line2 = "Next: " + alarmScheduler.getNextAlarmTime();
-                    }
-                    break;
-                case 2: // WiFi
-                    if (currentScreen == 2 && millis() % 6000 < 3000) { 
-                         line1 = "IP: " + WiFi.localIP().toString();
-                         line2 = "Web Port: 80";
-                    } else {
-                         line1 = String("SSID:") + String(WiFi.SSID().substring(0,11)); 
-                         line2 = "Sig:" + String(WiFi.RSSI()) + "dBm " + (WiFi.status() == WL_CONNECTED ? "Con" : "Dis");
-                    }
-                    break;
-                case 3: // Status
-                    {
-                        // Show Next Prayer Beep Schedule
-                        line1 = "Beep: " + String(prefs.getInt("pCount", 2)) + "x" + String(prefs.getInt("pDur", 300)) + "ms";
-                        line2 = "Gap: " + String(prefs.getInt("pGap", 300)) + "ms"; 
-                    }
-                    break;
-                case 4: // Family - Scrolling
-                    line1 = "Arham Yusuf Anik"; 
-                    if (millis() % 4000 < 2000) line2 = "Hasnain Sadiya";
-                    else line2 = "Ramzan Mubarak!";
-                    break;
-                case 5: // Tomorrow
-                    line1 = "Tom S: " + alarmScheduler.getTomorrowSehriTime();
-                    line2 = "Tom I: " + alarmScheduler.getTomorrowIftarTime();
-                    break;
-                case 6: // Today
-                    line1 = "Td S: " + alarmScheduler.getTodaySehriTime();
-                    line2 = "Td I: " + alarmScheduler.getTodayIftarTime();
-                    break;
-            }
+            // Only re-render the screen if something it shows has changed
+            updateScreenDependencies();
+            screenRegistry.render(currentScreen);
+            displayManager.showMessage(screenRegistry.line1(currentScreen), screenRegistry.line2(currentScreen));
         }
-        displayManager.showMessage(line1, line2); 
     }
 }
 
-void checkStopConditions() {
-    if (currentState == STATE_PRE_SEHRI_RINGING || 
-        currentState == STATE_SEHRI_RINGING || 
-        currentState == STATE_IFTAR_RINGING || 
-        currentState == STATE_PRAYER_BEEP) {
-        
-        if (!buzzerA.isRinging() && !buzzerB.isRinging()) {
-            currentState = STATE_IDLE;
-            alarmScheduler.stopAlarmDurationTracking();
+// Cheap change detection for the data the carousel screens depend on
+void updateScreenDependencies() {
+    static int lastMinute = -1;
+    static bool lastWifi = false;
+    static int lastRssi = 0;
+    static unsigned long lastRssiCheck = 0;
+    static uint32_t lastScheduleVersion = 0;
+    static bool lastSwA = false, lastSwB = false;
+
+    uint8_t changed = DEP_CLOCK_SECOND; // Called once per second
+
+    struct tm timeinfo;
+    if (getLocalTime(&timeinfo, 0) && timeinfo.tm_min != lastMinute) {
+        lastMinute = timeinfo.tm_min;
+        changed |= DEP_CLOCK_MINUTE;
+    }
+
+    bool wifi = networkManager.isConnected();
+    if (wifi != lastWifi) {
+        lastWifi = wifi;
+        changed |= DEP_WIFI;
+    }
+    if (wifi && millis() - lastRssiCheck > 5000) { // RSSI is a driver call, poll it slowly
+        lastRssiCheck = millis();
+        int rssi = WiFi.RSSI();
+        if (rssi != lastRssi) {
+            lastRssi = rssi;
+            changed |= DEP_WIFI;
         }
     }
+
+    uint32_t scheduleVersion = alarmScheduler.getScheduleVersion();
+    if (scheduleVersion != lastScheduleVersion) {
+        lastScheduleVersion = scheduleVersion;
+        changed |= DEP_SCHEDULE;
+    }
+
+    bool swA = btnHouseA.isPressed();
+    bool swB = btnHouseB.isPressed();
+    if (swA != lastSwA || swB != lastSwB) {
+        lastSwA = swA;
+        lastSwB = swB;
+        changed |= DEP_INPUTS;
+    }
+
+    screenRegistry.invalidate(changed);
 }
 
-void startPreSehriAlarm() {
-    if (currentState != STATE_IDLE) return;
-    lastActionDescription = "Pre-Sehri";
-    initialSwitchStatePreSehri = digitalRead(PIN_SWITCH_PRE_SEHRI);
+// --- LCD Carousel Screens ---
+void renderMainScreen(char* line1, char* line2) {
+    snprintf(line1, SCREEN_LINE_LEN, "%s", networkManager.getFormattedTime().c_str());
+    // Show Uptime on Line 2
+    unsigned long upSec = (millis() - bootTime) / 1000;
+    int upH = upSec / 3600;
+    int upM = (upSec % 3600) / 60;
+    snprintf(line2, SCREEN_LINE_LEN, "UP: %02dh %02dm", upH, upM);
+}
+
+void renderAlarmInfoScreen(char* line1, char* line2) {
+    bool swA = btnHouseA.isPressed();
+    bool swB = btnHouseB.isPressed();
+    snprintf(line1, SCREEN_LINE_LEN, "A:%s B:%s", swA ? "ON" : "OFF", swB ? "ON" : "OFF");
+    snprintf(line2, SCREEN_LINE_LEN, "Next: %s", alarmScheduler.getNextAlarmTime().c_str());
+}
+
+void renderWifiScreen(char* line1, char* line2) {
+    if (millis() % 6000 < 3000) {
+        IPAddress ip = WiFi.localIP();
+        FixedString<16> ipText; // IPAddress::toString() would allocate
+        ipText.appendf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        snprintf(line1, SCREEN_LINE_LEN, "IP: %s", ipText.c_str());
+        snprintf(line2, SCREEN_LINE_LEN, "Web Port: 80");
+    } else {
+        snprintf(line1, SCREEN_LINE_LEN, "SSID:%.*s", LCD_COLS - 5, WIFI_SSID); // WiFi.SSID() would allocate
+        snprintf(line2, SCREEN_LINE_LEN, "Sig:%ddBm %s", WiFi.RSSI(), WiFi.status() == WL_CONNECTED ? "Con" : "Dis");
+    }
+}
+
+void renderPatternScreen(char* line1, char* line2) {
+    // Show Next Prayer Beep Schedule (cached config, no NVS access)
+    snprintf(line1, SCREEN_LINE_LEN, "Beep: %dx%dms", prayerBeepCount, prayerBeepDuration);
+    snprintf(line2, SCREEN_LINE_LEN, "Gap: %dms", prayerBeepGap);
+}
+
+void renderFamilyScreen(char* line1, char* line2) {
+    snprintf(line1, SCREEN_LINE_LEN, "Arham Yusuf Anik");
+    snprintf(line2, SCREEN_LINE_LEN, "%s", (millis() % 4000 < 2000) ? "Hasnain Sadiya" : "Ramzan Mubarak!");
+}
+
+void renderTomorrowScreen(char* line1, char* line2) {
+    snprintf(line1, SCREEN_LINE_LEN, "Tom S: %s", alarmScheduler.getTomorrowSehriTime().c_str());
+    snprintf(line2, SCREEN_LINE_LEN, "Tom I: %s", alarmScheduler.getTomorrowIftarTime().c_str());
+}
+
+void renderTodayScreen(char* line1, char* line2) {
+    snprintf(line1, SCREEN_LINE_LEN, "Td S: %s", alarmScheduler.getTodaySehriTime().c_str());
+    snprintf(line2, SCREEN_LINE_LEN, "Td I: %s", alarmScheduler.getTodayIftarTime().c_str());
+}
+
+void registerScreens() {
+    screenRegistry.add("Main",     DEP_CLOCK_SECOND, renderMainScreen);
+    screenRegistry.add("Alarms",   DEP_INPUTS | DEP_SCHEDULE, renderAlarmInfoScreen);
+    screenRegistry.add("WiFi",     DEP_WIFI, renderWifiScreen, 3000);
+    screenRegistry.add("Pattern",  DEP_CONFIG, renderPatternScreen);
+    screenRegistry.add("Family",   0, renderFamilyScreen, 2000);
+    screenRegistry.add("Tomorrow", DEP_SCHEDULE | DEP_CONFIG, renderTomorrowScreen);
+    screenRegistry.add("Today",    DEP_SCHEDULE | DEP_CONFIG, renderTodayScreen);
+}
+
+void checkStopConditions() {
+    if (stateMachine.isRinging() && !buzzerA.isRinging() && !buzzerB.isRinging()) {
+        stateMachine.transition(STATE_IDLE);
+    }
+}
+
+// --- State Entry / Exit Actions ---
+void logRingStart() {
+    ringStartMs = millis();
+    ackedHouses = 0;
+    eventLog.append(EVENT_ALARM_START, HOUSE_BOTH, stateMachine.getState());
+}
+
+void enterPreSehri() {
+    logRingStart();
     buzzerA.startPattern(PATTERN_PRE_SEHRI);
     buzzerB.startPattern(PATTERN_PRE_SEHRI);
-    currentState = STATE_PRE_SEHRI_RINGING;
+}
+
+void enterSehri() {
+    logRingStart();
+    buzzerA.startPattern(PATTERN_SEHRI_IFTAR);
+    buzzerB.startPattern(PATTERN_SEHRI_IFTAR);
+    alarmScheduler.startAlarmDurationTracking();
+}
+
+void enterIftar() {
+    logRingStart();
+    buzzerA.startPattern(PATTERN_IFTAR);
+    buzzerB.startPattern(PATTERN_IFTAR);
+    alarmScheduler.startAlarmDurationTracking();
+}
+
+void enterPrayer() {
+    // Pattern was configured by the caller (prayer vs. Sehri-end beep)
+    logRingStart();
+    buzzerA.startPattern(PATTERN_PRAYER);
+    buzzerB.startPattern(PATTERN_PRAYER);
+}
+
+void exitRinging() {
+    // Normally the buzzers are already done; not when OTA or a louder
+    // alarm takes over
+    buzzerA.stop();
+    buzzerB.stop();
+    alarmScheduler.stopAlarmDurationTracking();
+    timingStats.onRingStop();
+    eventLog.append(EVENT_ALARM_STOP, HOUSE_BOTH, stateMachine.getState(), millis() - ringStartMs);
+}
+
+void enterOta() {
+    eventLog.append(EVENT_OTA_START);
+    displayManager.showMessage("SYSTEM UPDATE", "Do Not Power Off");
+}
+
+void leaveError() { stateMachine.transition(STATE_IDLE); }
+
+void enterError() {
+    eventLog.append(EVENT_OTA_FAIL); // OTA is the only way into ERROR
+    if (transitionManager.show("UPDATE FAILED", "Check Serial", 5000, leaveError)) return;
+    // Queue full: without leaveError we would refuse every alarm until a
+    // reboot, so drop the queued steps instead (can't transition from here)
+    transitionManager.cancel();
+    transitionManager.show("UPDATE FAILED", "Check Serial", 5000, leaveError);
+}
+
+void registerStateActions() {
+    stateMachine.setActions(STATE_PRE_SEHRI_RINGING, enterPreSehri, exitRinging);
+    stateMachine.setActions(STATE_SEHRI_RINGING,     enterSehri,    exitRinging);
+    stateMachine.setActions(STATE_IFTAR_RINGING,     enterIftar,    exitRinging);
+    stateMachine.setActions(STATE_PRAYER_BEEP,       enterPrayer,   exitRinging);
+    stateMachine.setActions(STATE_OTA_MODE,          enterOta);
+    stateMachine.setActions(STATE_ERROR,             enterError);
+}
+
+// Returns false (and says why) if `state` cannot be entered right now
+bool alarmAllowed(SystemState state) {
+    if (stateMachine.canTransition(state)) return true;
+    LOG_W("ALARM: %s ignored in %s", stateName(state), stateName(stateMachine.getState()));
+    return false;
+}
+
+void startPreSehriAlarm() {
+    if (!alarmAllowed(STATE_PRE_SEHRI_RINGING)) return;
+    lastActionDescription = "Pre-Sehri";
+    initialSwitchStatePreSehri = inputManager.readSwitchPreSehri(); // Debounced
+    stateMachine.transition(STATE_PRE_SEHRI_RINGING);
 }
 
 void startSehriAlarm() { 
+    if (!alarmAllowed(STATE_SEHRI_RINGING)) return;
     lastActionDescription = "Sehri";
     // Capture Debounced States
     initialSwitchStateA = btnHouseA.getState();
     initialSwitchStateB = btnHouseB.getState();
-    buzzerA.startPattern(PATTERN_SEHRI_IFTAR);
-    buzzerB.startPattern(PATTERN_SEHRI_IFTAR);
-    currentState = STATE_SEHRI_RINGING;
-    alarmScheduler.startAlarmDurationTracking();
+    stateMachine.transition(STATE_SEHRI_RINGING);
 }
 
 void startIftarAlarm() {
+    if (!alarmAllowed(STATE_IFTAR_RINGING)) return;
     lastActionDescription = "Iftar";
     initialSwitchStateA = btnHouseA.getState();
     initialSwitchStateB = btnHouseB.getState();
-    buzzerA.startPattern(PATTERN_IFTAR);
-    buzzerB.startPattern(PATTERN_IFTAR);
-    currentState = STATE_IFTAR_RINGING;
-    alarmScheduler.startAlarmDurationTracking();
+    stateMachine.transition(STATE_IFTAR_RINGING);
 }
 
 void startPrayerBeep() { 
+    if (!alarmAllowed(STATE_PRAYER_BEEP)) return;
     lastActionDescription = "Prayer";
     initialSwitchStateA = btnHouseA.getState();
     initialSwitchStateB = btnHouseB.getState();
     
     // Use the user-configured prayer pattern (Beep Count, etc)
-    int pCount = prefs.getInt("pCount", 2);
-    int pDur = prefs.getInt("pDur", 300);
-    int pGap = prefs.getInt("pGap", 300);
-    buzzerA.configurePrayerPattern(pCount, pDur, pGap);
-    buzzerB.configurePrayerPattern(pCount, pDur, pGap);
-    
-    buzzerA.startPattern(PATTERN_PRAYER);
-    buzzerB.startPattern(PATTERN_PRAYER);
-    currentState = STATE_PRAYER_BEEP;
+    buzzerA.configurePrayerPattern(prayerBeepCount, prayerBeepDuration, prayerBeepGap);
+    buzzerB.configurePrayerPattern(prayerBeepCount, prayerBeepDuration, prayerBeepGap);
+    stateMachine.transition(STATE_PRAYER_BEEP);
 }
 
 void startSehriEndBeep() { 
+    if (!alarmAllowed(STATE_PRAYER_BEEP)) return;
     lastActionDescription = "SehriEnd";
     initialSwitchStateA = btnHouseA.getState();
     initialSwitchStateB = btnHouseB.getState();
@@ -429,28 +765,314 @@ void startSehriEndBeep() {
     // Configure for a single 3-second beep
     buzzerA.configurePrayerPattern(1, 3000, 100);
     buzzerB.configurePrayerPattern(1, 3000, 100);
-    
-    buzzerA.startPattern(PATTERN_PRAYER);
-    buzzerB.startPattern(PATTERN_PRAYER);
-    currentState = STATE_PRAYER_BEEP;
+    stateMachine.transition(STATE_PRAYER_BEEP);
 }
 
 void startTestMode() {
-    Serial.println("TEST MODE: Simulating Sehri Alarm!");
-    displayManager.showMessage("TEST MODE", "Simulating Sehri");
-    delay(1000);
-    startSehriAlarm(); 
+    LOG_I("TEST MODE: Simulating Sehri Alarm!");
+    transitionManager.show("TEST MODE", "Simulating Sehri", 1000, startSehriAlarm);
+}
+
+// Give the current carousel screen a full slot after a transient message
+void resumeCarousel() {
+    lastScreenAutoCycle = millis();
+}
+
+// --- Settings (NVS namespace "ramzan", shared with the web settings page) ---
+struct ConfigKey {
+    const char* key;
+    int defaultValue;
+    bool isBool;
+    const char* help;
+};
+
+static const ConfigKey CONFIG_KEYS[] = {
+    { "sOff",   0,     false, "Sehri offset (min)" },
+    { "iOff",   0,     false, "Iftar offset (min)" },
+    { "preOff", 60,    false, "Pre-Sehri alarm, min before Sehri" },
+    { "pCount", 2,     false, "Prayer beeps" },
+    { "pDur",   300,   false, "Prayer beep length (ms)" },
+    { "pGap",   300,   false, "Prayer beep gap (ms)" },
+    { "sDur",   5000,  false, "Sehri ring length (ms)" },
+    { "sInt",   10000, false, "Sehri ring interval (ms)" },
+    { "sleep",  0,     true,  "Deep sleep between events (0/1)" }, // Default OFF for safety
+};
+
+const ConfigKey* findConfigKey(const char* key) {
+    for (const ConfigKey& k : CONFIG_KEYS) {
+        if (!strcmp(k.key, key)) return &k;
+    }
+    return nullptr;
+}
+
+// prefs must be open
+int getSetting(const ConfigKey& k) {
+    return k.isBool ? prefs.getBool(k.key, k.defaultValue) : prefs.getInt(k.key, k.defaultValue);
+}
+
+int getSetting(const char* key) { return getSetting(*findConfigKey(key)); }
+
+void loadSettings() {
+    prefs.begin("ramzan", false); // Namespace "ramzan", ReadWrite
+    int sOff = getSetting("sOff");
+    int iOff = getSetting("iOff");
+    
+    // Prayer Beep Settings
+    int pCount = getSetting("pCount");
+    int pDur = getSetting("pDur");
+    int pGap = getSetting("pGap");
+    
+    // Sehri Pattern Settings
+    int sDur = getSetting("sDur");
+    int sInt = getSetting("sInt");
+
+    // Loading Pre-Sehri Offset
+    int preOff = getSetting("preOff");
+
+    LOG_I("Loaded Offsets -> Sehri: %d, Iftar: %d, Pre-Sehri: %d", sOff, iOff, preOff);
+    LOG_I("Prayer Pattern -> Count: %d, Dur: %d, Gap: %d", pCount, pDur, pGap);
+    LOG_I("Sehri Pattern -> Dur: %d, Int: %d", sDur, sInt);
+
+    alarmScheduler.setOffsets(sOff, iOff);
+    alarmScheduler.setPreSehriOffset(preOff);
+    sleepModeEnabled = getSetting("sleep");
+    updatePrayerPattern(pCount, pDur, pGap);
+    updateSehriPattern(sDur, sInt);
+    
+    prefs.end();
+}
+
+// --- Serial Console ---
+// Commands print into the console, which hands the text to the UART as it
+// drains. Type "help" for the list.
+
+// Local date/time (fixed GMT_OFFSET_SEC) to epoch seconds, without mktime()
+// and the TZ environment
+time_t localToEpoch(int year, int month, int day, int hour, int minute, int second) {
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long days = (long)era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+    return (time_t)days * 86400 + hour * 3600 + minute * 60 + second - GMT_OFFSET_SEC - DAYLIGHT_OFFSET_SEC;
+}
+
+void printLocalTime(Print& out, time_t epoch) {
+    time_t local = epoch + GMT_OFFSET_SEC + DAYLIGHT_OFFSET_SEC;
+    struct tm t;
+    gmtime_r(&local, &t);
+    out.printf("%04d-%02d-%02d %02d:%02d:%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+               t.tm_hour, t.tm_min, t.tm_sec);
+}
+
+void cmdToday(int argc, char** argv, Print& out) { alarmScheduler.printToday(out); }
+
+void cmdLog(int argc, char** argv, Print& out) {
+    uint32_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10;
+    uint32_t next = eventLog.getNextSeq();
+    uint32_t since = next > n ? next - n : 0;
+
+    out.printf("%-6s %-19s %-11s %5s %6s %8s %8s\n", "seq", "time", "type", "house", "detail", "durMs", "ackMs");
+    const uint8_t BATCH = 8;
+    EventRecord recs[BATCH];
+    uint32_t cursor = eventLog.begin();
+    uint16_t got;
+    while ((got = eventLog.read(cursor, recs, BATCH)) > 0) {
+        for (uint16_t i = 0; i < got; i++) {
+            const EventRecord& r = recs[i];
+            if (r.seq < since) continue;
+            out.printf("%-6lu ", (unsigned long)r.seq);
+            if (r.time) printLocalTime(out, r.time);
+            else out.printf("%-19s", "-");
+            out.printf(" %-11s %5u %6u %8lu %8lu\n", eventTypeName(r.type), r.house, r.detail,
+                       (unsigned long)r.durationDs * 100, (unsigned long)r.ackLatencyDs * 100);
+        }
+        esp_task_wdt_reset();
+    }
+}
+
+// time                      show
+// time +90m / -2h / +30     warp (s, m, h or d)
+// time 2026-03-01 18:29:50  set (local time)
+// NTP puts the clock back at its next sync
+void cmdTime(int argc, char** argv, Print& out) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    bool valid = true;
+
+    if (argc == 2 && (argv[1][0] == '+' || argv[1][0] == '-')) {
+        char* unit;
+        long n = strtol(argv[1], &unit, 10);
+        if (*unit == 'm') n *= 60;
+        else if (*unit == 'h') n *= 3600;
+        else if (*unit == 'd') n *= 86400;
+        else if (*unit && *unit != 's') valid = false;
+        tv.tv_sec += n;
+    } else if (argc == 3) {
+        int y, mo, d, h, mi, s = 0;
+        valid = sscanf(argv[1], "%d-%d-%d", &y, &mo, &d) == 3 && sscanf(argv[2], "%d:%d:%d", &h, &mi, &s) >= 2;
+        if (valid) {
+            tv.tv_sec = localToEpoch(y, mo, d, h, mi, s);
+            tv.tv_usec = 0;
+        }
+    } else if (argc != 1) {
+        valid = false;
+    }
+
+    if (!valid) {
+        out.println("Usage: time [+-N[s|m|h|d] | YYYY-MM-DD HH:MM[:SS]]");
+        return;
+    }
+    if (argc > 1) {
+        settimeofday(&tv, nullptr);
+        alarmScheduler.rearm(); // Events ahead of the new time ring again
+    }
+    out.print("Clock: ");
+    printLocalTime(out, tv.tv_sec);
+    out.println();
+}
+
+struct FireCommand {
+    const char* name;
+    void (*fn)();
+};
+
+static const FireCommand FIRE_COMMANDS[] = {
+    { "presehri", startPreSehriAlarm },
+    { "sehri",    startSehriAlarm },
+    { "sehriend", startSehriEndBeep },
+    { "prayer",   startPrayerBeep },
+    { "iftar",    startIftarAlarm },
+    { "test",     startTestMode },
+};
+
+void cmdFire(int argc, char** argv, Print& out) {
+    for (const FireCommand& f : FIRE_COMMANDS) {
+        if (argc > 1 && !strcmp(argv[1], f.name)) {
+            out.printf("Firing %s\n", f.name);
+            f.fn();
+            return;
+        }
+    }
+    out.print("Usage: fire");
+    for (const FireCommand& f : FIRE_COMMANDS) out.printf(" %s", f.name);
+    out.println();
+}
+
+void cmdStats(int argc, char** argv, Print& out) {
+    out.printf("%-9s %8s %8s %7s %7s %5s %6s\n", "task", "runs", "skips", "avgUs", "maxUs", "over", "lateMs");
+    for (uint8_t i = 0; i < taskScheduler.count(); i++) {
+        const TaskScheduler::Stats& s = taskScheduler.stats(i);
+        out.printf("%-9s %8lu %8lu %7lu %7lu %5lu %6lu\n", taskScheduler.name(i),
+                   (unsigned long)s.runs, (unsigned long)s.skips,
+                   (unsigned long)(s.runs ? s.totalRunUs / s.runs : 0), (unsigned long)s.maxRunUs,
+                   (unsigned long)s.overruns, (unsigned long)s.maxLateMs);
+    }
+    out.printf("Passes: %lu/s, busy %lu us/s, longest %lu us, %lu over budget\n",
+               (unsigned long)taskScheduler.getPassesPerSecond(), (unsigned long)taskScheduler.getBusyMicrosPerSecond(),
+               (unsigned long)taskScheduler.getMaxPassMicros(), (unsigned long)taskScheduler.getPassOverruns());
+
+    out.print("Longest stage (us):");
+    for (uint8_t s = STAGE_NONE + 1; s < STAGE_COUNT; s++) {
+        uint32_t us = stallMonitor.getMaxUs((StallStage)s);
+        if (us) out.printf(" %s %lu", StallMonitor::stageName(s), (unsigned long)us);
+    }
+    out.println();
+
+    out.printf("Heap: %lu free, %lu min, %lu largest block, %lu loop allocs in the last %lu s\n",
+               (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+               (unsigned long)ESP.getMaxAllocHeap(), (unsigned long)heapStats.getWindowAllocs(),
+               (unsigned long)(HeapStats::WINDOW_MS / 1000));
+    out.printf("Power: %s, %u%% active, ~%lu mA\n", powerManager.getModeName(),
+               powerManager.getActivePercent(), (unsigned long)powerManager.getEstimatedMilliamps());
+    out.printf("Event log: %lu records, %lu erases, longest append %lu us\n",
+               (unsigned long)eventLog.getCount(), (unsigned long)eventLog.getEraseCount(),
+               (unsigned long)eventLog.getMaxAppendMicros());
+    if (mqttPublisher.isEnabled()) {
+        out.printf("MQTT: %s, %lu connects, %lu published, %lu dropped, %lu bytes in %lu sends\n",
+                   mqttPublisher.getStateName(), (unsigned long)mqttPublisher.getConnects(),
+                   (unsigned long)mqttPublisher.getPublished(), (unsigned long)mqttPublisher.getDropped(),
+                   (unsigned long)mqttPublisher.getBytesSent(), (unsigned long)mqttPublisher.getSends());
+    }
+    const Histogram& relay = timingStats.getRelayLate();
+    const Histogram& seg = timingStats.getSegmentError();
+    out.printf("Alarm timing: relay late p50 %lu p99 %lu max %lu us (%lu), segment error p50 %lu p99 %lu max %lu us (%lu)\n",
+               (unsigned long)relay.percentile(50), (unsigned long)relay.percentile(99), (unsigned long)relay.max(),
+               (unsigned long)relay.count(), (unsigned long)seg.percentile(50), (unsigned long)seg.percentile(99),
+               (unsigned long)seg.max(), (unsigned long)seg.count());
+    if (unitSync.isEnabled()) {
+        out.printf("Sync: unit %08lx, leader %08lx, offset %ld us (rtt %lu us), last start %ld us late\n",
+                   (unsigned long)unitSync.getId(), (unsigned long)unitSync.getLeaderId(),
+                   (long)unitSync.getOffsetUs(), (unsigned long)unitSync.getDelayUs(),
+                   (long)unitSync.getLastStartLateUs());
+    }
+    out.printf("Console: %lu bytes dropped, log: %lu lines, %lu lost\n",
+               (unsigned long)serialConsole.getDroppedBytes(), (unsigned long)Log::getNextSeq(),
+               (unsigned long)Log::getOverwritten());
+}
+
+void cmdGet(int argc, char** argv, Print& out) {
+    prefs.begin("ramzan", true); // ReadOnly
+    for (const ConfigKey& k : CONFIG_KEYS) {
+        if (argc > 1 && strcmp(argv[1], k.key)) continue;
+        out.printf("%-7s %6d  %s\n", k.key, getSetting(k), k.help);
+    }
+    prefs.end();
+}
+
+void cmdSet(int argc, char** argv, Print& out) {
+    const ConfigKey* k = argc == 3 ? findConfigKey(argv[1]) : nullptr;
+    char* end = nullptr;
+    long value = k ? strtol(argv[2], &end, 10) : 0;
+    if (!k || *end) {
+        out.println("Usage: set <key> <value> (see 'get')");
+        return;
+    }
+    prefs.begin("ramzan", false);
+    if (k->isBool) prefs.putBool(k->key, value != 0);
+    else prefs.putInt(k->key, (int)value);
+    prefs.end();
+
+    loadSettings();
+    alarmScheduler.rearm(); // New offsets apply today
+    eventLog.append(EVENT_SETTINGS);
+    out.printf("%s = %ld\n", k->key, value);
+}
+
+void cmdBench(int argc, char** argv, Print& out) { runBenchmarks(argc > 1 ? argv[1] : nullptr, out); }
+
+void registerCommands() {
+    //                 name      usage                      help
+    serialConsole.add("today",  "",                        "Today's alarms and which have fired", cmdToday);
+    serialConsole.add("log",    "[n]",                     "Last n event log records (10)", cmdLog);
+    serialConsole.add("time",   "[+-N[smhd] | DATE TIME]", "Show, warp or set the clock", cmdTime);
+    serialConsole.add("fire",   "<event>",                 "Start an alarm/beep now", cmdFire);
+    serialConsole.add("stats",  "",                        "Task timing, heap, power", cmdStats);
+    serialConsole.add("get",    "[key]",                   "Show settings", cmdGet);
+    serialConsole.add("set",    "<key> <value>",           "Change a setting (saved)", cmdSet);
+    serialConsole.add("bench",  "[filter]",                "Run the microbenchmarks", cmdBench);
+    serialConsole.add("reboot", "",                        "Restart", [](int, char**, Print&) { ESP.restart(); });
+
+    // The old single-key commands (now followed by Enter)
+    serialConsole.add("1", nullptr, nullptr, [](int, char**, Print&) { startPreSehriAlarm(); });
+    serialConsole.add("2", nullptr, nullptr, [](int, char**, Print&) { startSehriAlarm(); });
+    serialConsole.add("3", nullptr, nullptr, [](int, char**, Print&) { startIftarAlarm(); });
+    serialConsole.add("t", nullptr, nullptr, [](int, char**, Print&) { startTestMode(); });
+    serialConsole.add("b", nullptr, nullptr, [](int, char**, Print& out) { runBenchmarks(nullptr, out); });
+    serialConsole.add("r", nullptr, nullptr, [](int, char**, Print&) { ESP.restart(); });
 }
 
-void handleSerialCommands() {
-    if (Serial.available()) {
-        char c = Serial.read();
-        if (c == '1') startPreSehriAlarm();
-        else if (c == '2') startSehriAlarm();
-        else if (c == '3') startIftarAlarm();
-        else if (c == 't') startTestMode();
-        else if (c == 'r') ESP.restart(); 
+void runBenchmarks(const char* filter, Print& out) {
+    if (buzzersRinging() || stateMachine.getState() != STATE_IDLE) {
+        out.println("BENCH: only while idle");
+        return;
     }
+    out.println("BENCH: running...");
+    Benchmarks bench;
+    if (HeapStats::hasCounter()) bench.setAllocCounter(HeapStats::getLoopAllocCount);
+    bench.run(filter);
+    bench.printTable(out);
+    bench.printJson(out, "esp32");
 }
 
 void updatePrayerPattern(int count, int dur, int gap) {
@@ -458,8 +1080,12 @@ void updatePrayerPattern(int count, int dur, int gap) {
     if (dur < 50) dur = 50;
     if (gap < 50) gap = 50;
     
+    prayerBeepCount = count;
+    prayerBeepDuration = dur;
+    prayerBeepGap = gap;
     buzzerA.configurePrayerPattern(count, dur, gap);
     buzzerB.configurePrayerPattern(count, dur, gap);
+    screenRegistry.invalidate(DEP_CONFIG);
 }
 
 void updateSehriPattern(int dur, int interval) {
@@ -467,8 +1093,10 @@ void updateSehriPattern(int dur, int interval) {
     if (interval < 100) interval = 100;
     buzzerA.configureSehriPattern(dur, interval);
     buzzerB.configureSehriPattern(dur, interval);
+    screenRegistry.invalidate(DEP_CONFIG);
 }
 
 void updatePreSehriOffset(int minutes) {
     alarmScheduler.setPreSehriOffset(minutes);
+    screenRegistry.invalidate(DEP_CONFIG);
 }
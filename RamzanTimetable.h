@@ -63,4 +63,28 @@ const AlarmEntry ramzanTimetable[] = {
 
 const int TIMETABLE_SIZE = sizeof(ramzanTimetable) / sizeof(AlarmEntry);
 
+// Days are in date order and carry no year, but a Ramadan around new year
+// runs from December on into January. Returns the sort key of `e` after a
+// day keyed lastKey (0 before the first day), or 0 if `e` cannot follow it.
+// Once past December the months continue as 13, 14, ... up to the one the
+// table started in, so a month and day never appear twice.
+inline uint16_t timetableDateKey(uint16_t lastKey, uint8_t firstMonth, const AlarmEntry& e) {
+    uint16_t key = e.month * 32 + e.day;
+    if (lastKey >= 12 * 32 && e.month < firstMonth) key += 12 * 32;
+    return key > lastKey ? key : 0;
+}
+
+// Fixed daily prayer beeps, the same every day of the timetable
+struct PrayerTimes {
+    uint8_t fajrHour, fajrMinute;
+    uint8_t zohrHour, zohrMinute;
+    uint8_t asrHour, asrMinute;
+    uint8_t ishaHour, ishaMinute;
+};
+
+const PrayerTimes defaultPrayerTimes = { 6, 0, 13, 0, 17, 5, 20, 0 };
+
+// The compiled-in table is only the fallback: an uploaded one
+// (TimetableStore, /api/timetable) replaces it without reflashing
+
 #endif
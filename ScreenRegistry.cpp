@@ -0,0 +1,49 @@
+#include "ScreenRegistry.h"
+
+uint8_t ScreenRegistry::add(const char* name, uint8_t deps, ScreenRenderFn render, uint16_t phaseMs) {
+    if (_count >= MAX_SCREENS) return _count - 1;
+    Screen& s = _screens[_count];
+    s.name = name;
+    s.deps = deps;
+    s.render = render;
+    s.phaseMs = phaseMs;
+    s.renderedAt = 0;
+    s.phase = 0;
+    s.line1[0] = '\0';
+    s.line2[0] = '\0';
+    return _count++;
+}
+
+void ScreenRegistry::invalidate(uint8_t deps) {
+    if (!deps) return;
+    _epoch++;
+    for (uint8_t bit = 0; bit < DEP_BITS; bit++) {
+        if (deps & (1 << bit)) _changedAt[bit] = _epoch;
+    }
+}
+
+bool ScreenRegistry::render(uint8_t screen) {
+    if (screen >= _count) return false;
+    Screen& s = _screens[screen];
+
+    bool stale = (s.renderedAt == 0);
+    for (uint8_t bit = 0; bit < DEP_BITS && !stale; bit++) {
+        if ((s.deps & (1 << bit)) && _changedAt[bit] > s.renderedAt) stale = true;
+    }
+
+    uint32_t phase = s.phaseMs ? (millis() / s.phaseMs) : 0;
+    if (phase != s.phase) stale = true;
+
+    if (!stale) {
+        _skips++;
+        return false;
+    }
+
+    s.render(s.line1, s.line2);
+    s.line1[SCREEN_LINE_LEN - 1] = '\0';
+    s.line2[SCREEN_LINE_LEN - 1] = '\0';
+    s.renderedAt = _epoch;
+    s.phase = phase;
+    _renders++;
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef SCREEN_REGISTRY_H
+#define SCREEN_REGISTRY_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Data sources a carousel screen can depend on
+enum ScreenDependency {
+    DEP_CLOCK_SECOND = (1 << 0), // Wall clock seconds (and uptime)
+    DEP_CLOCK_MINUTE = (1 << 1), // Wall clock minutes
+    DEP_WIFI         = (1 << 2), // Connection state, SSID, IP, RSSI bucket
+    DEP_CONFIG       = (1 << 3), // Offsets and buzzer patterns
+    DEP_SCHEDULE     = (1 << 4), // Loaded alarms / which ones already fired
+    DEP_INPUTS       = (1 << 5)  // House switch positions
+};
+
+// Fills line1/line2 (each SCREEN_LINE_LEN bytes incl. terminator)
+typedef void (*ScreenRenderFn)(char* line1, char* line2);
+
+#define SCREEN_LINE_LEN (LCD_COLS + 1)
+
+// Registry of LCD carousel screens. Each screen declares what it depends on
+// (plus an optional animation period) and keeps its last rendered lines.
+// render() only calls the screen's render function again if one of those
+// dependencies was invalidated since, so an unchanged screen costs nothing.
+class ScreenRegistry {
+public:
+    // Returns the screen index. phaseMs > 0 re-renders every phaseMs for
+    // screens that alternate content on their own.
+    uint8_t add(const char* name, uint8_t deps, ScreenRenderFn render, uint16_t phaseMs = 0);
+
+    // Marks data as changed; screens depending on any of `deps` re-render
+    void invalidate(uint8_t deps);
+
+    // Brings the cached lines of `screen` up to date. Returns true if it rendered.
+    bool render(uint8_t screen);
+
+    const char* line1(uint8_t screen) { return _screens[screen].line1; }
+    const char* line2(uint8_t screen) { return _screens[screen].line2; }
+    const char* name(uint8_t screen) { return _screens[screen].name; }
+    uint8_t count() { return _count; }
+
+    uint32_t getRenderCount() { return _renders; }
+    uint32_t getSkipCount() { return _skips; }
+
+    static const uint8_t MAX_SCREENS = 8;
+
+private:
+    struct Screen {
+        const char* name;
+        uint8_t deps;
+        ScreenRenderFn render;
+        uint16_t phaseMs;
+        uint32_t renderedAt; // _epoch when last rendered (0 = never)
+        uint32_t phase;      // millis() / phaseMs at last render
+        char line1[SCREEN_LINE_LEN];
+        char line2[SCREEN_LINE_LEN];
+    };
+
+    Screen _screens[MAX_SCREENS];
+    uint8_t _count = 0;
+
+    // _changedAt[bit] is the epoch at which that dependency last changed
+    static const uint8_t DEP_BITS = 6;
+    uint32_t _changedAt[DEP_BITS] = {0};
+    uint32_t _epoch = 1;
+
+    uint32_t _renders = 0;
+    uint32_t _skips = 0;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "SerialConsole.h"
+#include "FixedString.h"
+
+void SerialConsole::init(Stream& port) {
+    _port = &port;
+    _lineLen = 0;
+    _outTail = 0;
+    _outLen = 0;
+}
+
+bool SerialConsole::add(const char* name, const char* usage, const char* help, CommandFn fn) {
+    if (_count >= MAX_COMMANDS) return false;
+    _commands[_count++] = { name, usage, help, fn };
+    return true;
+}
+
+bool SerialConsole::hasWork() {
+    return _outLen > 0 || (_port && _port->available() > 0);
+}
+
+void SerialConsole::update() {
+    if (!_port) return;
+
+    // Bounded, so a paste or a flood of noise cannot keep the task busy
+    for (uint16_t n = 0; n < MAX_READ_PER_PASS && _port->available() > 0; n++) {
+        char c = (char)_port->read();
+        if (c == '\r' || c == '\n') {
+            if (_lineOverflow) {
+                println("Line too long");
+            } else if (_lineLen > 0) {
+                _line[_lineLen] = '\0';
+                execute(_line);
+            }
+            _lineLen = 0;
+            _lineOverflow = false;
+        } else if (c == '\b' || c == 0x7F) {
+            if (_lineLen > 0) _lineLen--;
+        } else if (_lineLen < LINE_SIZE - 1) {
+            _line[_lineLen++] = c;
+        } else {
+            _lineOverflow = true;
+        }
+    }
+
+    drain();
+}
+
+void SerialConsole::execute(char* line) {
+    char* argv[MAX_ARGS];
+    int argc = 0;
+    char* p = line;
+    while (argc < MAX_ARGS) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+        argv[argc++] = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+        if (*p) *p++ = '\0';
+    }
+    if (argc == 0) return;
+
+    if (!strcmp(argv[0], "help") || !strcmp(argv[0], "?")) {
+        printHelp();
+        return;
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+        if (!strcmp(argv[0], _commands[i].name)) {
+            _commands[i].fn(argc, argv, *this);
+            return;
+        }
+    }
+    printf("Unknown command '%s', try 'help'\n", argv[0]);
+}
+
+void SerialConsole::printHelp() {
+    for (uint8_t i = 0; i < _count; i++) {
+        const Command& c = _commands[i];
+        if (!c.help) continue;
+        FixedString<40> usage;
+        usage.appendf("%s %s", c.name, c.usage ? c.usage : "");
+        printf("  %-28s %s\n", usage.c_str(), c.help);
+    }
+}
+
+size_t SerialConsole::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t SerialConsole::write(const uint8_t* buffer, size_t size) {
+    size_t room = OUT_SIZE - _outLen;
+    if (size > room) {
+        _dropped += size - room;
+        size = room;
+    }
+    size_t head = (_outTail + _outLen) % OUT_SIZE;
+    size_t first = OUT_SIZE - head;
+    if (first > size) first = size;
+    memcpy(_out + head, buffer, first);
+    memcpy(_out, buffer + first, size - first);
+    _outLen += size;
+    return size;
+}
+
+void SerialConsole::drain() {
+    if (_dropped != _droppedReported && OUT_SIZE - _outLen >= 48) {
+        uint32_t lost = _dropped - _droppedReported;
+        _droppedReported = _dropped;
+        printf("\n[console: %lu bytes dropped]\n", (unsigned long)lost);
+    }
+
+    // Only what the UART takes without waiting
+    int room = _port->availableForWrite();
+    while (_outLen > 0 && room > 0) {
+        // Up to the end of the ring, then from the start
+        size_t chunk = OUT_SIZE - _outTail;
+        if (chunk > _outLen) chunk = _outLen;
+        if (chunk > (size_t)room) chunk = room;
+        size_t written = _port->write(_out + _outTail, chunk);
+        if (written == 0) break;
+        _outTail = (_outTail + written) % OUT_SIZE;
+        _outLen -= written;
+        room -= written;
+    }
+}
+
+void SerialConsole::flush() {
+    if (!_port) return;
+    while (_outLen > 0) drain();
+    _port->flush();
+}
@@ -0,0 +1,64 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+
+// Line-based command shell on the serial port. update() takes whatever has
+// arrived without waiting, runs a command once its line is complete, and
+// moves buffered output to the UART only as fast as the TX FIFO has room,
+// so a slow or disconnected terminal never holds up the loop.
+//
+// Commands print into the console itself (it is a Print). Output that does
+// not fit the ring is dropped and counted rather than blocking.
+class SerialConsole : public Print {
+public:
+    typedef void (*CommandFn)(int argc, char** argv, Print& out);
+
+    void init(Stream& port);
+    // help = nullptr hides the command from "help" (single-key aliases)
+    bool add(const char* name, const char* usage, const char* help, CommandFn fn);
+
+    void update();          // Read input, run complete lines, drain output
+    bool hasWork();         // Input waiting or output still buffered
+    uint32_t getDroppedBytes() { return _dropped; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int availableForWrite() override { return OUT_SIZE - _outLen; }
+    void flush() override;  // Blocks until all is sent; only before sleep/restart
+    using Print::write;
+
+    static const uint8_t MAX_COMMANDS = 24;
+    static const uint8_t MAX_ARGS = 6;
+    static const size_t LINE_SIZE = 96;
+    static const size_t OUT_SIZE = 4096;
+    static const uint16_t MAX_READ_PER_PASS = 64;
+
+private:
+    struct Command {
+        const char* name;
+        const char* usage;
+        const char* help;
+        CommandFn fn;
+    };
+
+    void execute(char* line);
+    void printHelp();
+    void drain();
+
+    Stream* _port = nullptr;
+    Command _commands[MAX_COMMANDS];
+    uint8_t _count = 0;
+
+    char _line[LINE_SIZE];
+    size_t _lineLen = 0;
+    bool _lineOverflow = false;
+
+    uint8_t _out[OUT_SIZE];  // Ring: _outLen bytes starting at _outTail
+    size_t _outTail = 0;
+    size_t _outLen = 0;
+    uint32_t _dropped = 0;
+    uint32_t _droppedReported = 0;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "Sha256.h"
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, uint8_t n) { return (x >> n) | (x << (32 - n)); }
+
+void Sha256::begin() {
+    static const uint32_t H0[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(_h, H0, sizeof(_h));
+    _bufLen = 0;
+    _total = 0;
+}
+
+void Sha256::block(const uint8_t* p) {
+    uint32_t w[64];
+    for (uint8_t i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (uint8_t i = 16; i < 64; i++) {
+        uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+    for (uint8_t i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d;
+    _h[4] += e; _h[5] += f; _h[6] += g; _h[7] += h;
+}
+
+void Sha256::update(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    _total += len;
+    if (_bufLen) {
+        size_t n = BLOCK_SIZE - _bufLen;
+        if (n > len) n = len;
+        memcpy(_buf + _bufLen, p, n);
+        _bufLen += n;
+        p += n;
+        len -= n;
+        if (_bufLen < BLOCK_SIZE) return;
+        block(_buf);
+        _bufLen = 0;
+    }
+    // Whole blocks straight from the caller's buffer
+    while (len >= BLOCK_SIZE) {
+        block(p);
+        p += BLOCK_SIZE;
+        len -= BLOCK_SIZE;
+    }
+    memcpy(_buf, p, len);
+    _bufLen = len;
+}
+
+void Sha256::finish(uint8_t out[HASH_SIZE]) {
+    uint64_t bits = _total * 8;
+    uint8_t pad = 0x80;
+    update(&pad, 1);
+    pad = 0;
+    while (_bufLen != BLOCK_SIZE - 8) update(&pad, 1);
+    uint8_t len[8];
+    for (uint8_t i = 0; i < 8; i++) len[i] = bits >> (56 - 8 * i);
+    update(len, 8);
+    for (uint8_t i = 0; i < 8; i++) {
+        out[4 * i] = _h[i] >> 24;
+        out[4 * i + 1] = _h[i] >> 16;
+        out[4 * i + 2] = _h[i] >> 8;
+        out[4 * i + 3] = _h[i];
+    }
+}
+
+void Sha256::hash(const void* data, size_t len, uint8_t out[HASH_SIZE]) {
+    Sha256 s;
+    s.begin();
+    s.update(data, len);
+    s.finish(out);
+}
+
+// RFC 2104
+void Sha256::hmac(const void* key, size_t keyLen, const void* data, size_t len, uint8_t out[HASH_SIZE]) {
+    uint8_t k[BLOCK_SIZE] = {};
+    if (keyLen > BLOCK_SIZE) hash(key, keyLen, k);
+    else memcpy(k, key, keyLen);
+
+    uint8_t pad[BLOCK_SIZE];
+    Sha256 s;
+    for (uint8_t i = 0; i < BLOCK_SIZE; i++) pad[i] = k[i] ^ 0x36;
+    s.begin();
+    s.update(pad, BLOCK_SIZE);
+    s.update(data, len);
+    uint8_t inner[HASH_SIZE];
+    s.finish(inner);
+
+    for (uint8_t i = 0; i < BLOCK_SIZE; i++) pad[i] = k[i] ^ 0x5c;
+    s.begin();
+    s.update(pad, BLOCK_SIZE);
+    s.update(inner, HASH_SIZE);
+    s.finish(out);
+}
+
+void Sha256::toHex(const uint8_t hash[HASH_SIZE], char out[2 * HASH_SIZE + 1]) {
+    static const char digits[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < HASH_SIZE; i++) {
+        out[2 * i] = digits[hash[i] >> 4];
+        out[2 * i + 1] = digits[hash[i] & 0x0F];
+    }
+    out[2 * HASH_SIZE] = '\0';
+}
+
+bool Sha256::equal(const uint8_t* a, const uint8_t* b, size_t len) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
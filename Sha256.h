@@ -0,0 +1,32 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <Arduino.h>
+
+// SHA-256 and HMAC-SHA256, fed a piece at a time. Plain C++ so the host
+// build runs exactly what the device runs; it keeps well ahead of an
+// upload over WiFi.
+class Sha256 {
+public:
+    static const uint8_t HASH_SIZE = 32;
+    static const uint8_t BLOCK_SIZE = 64;
+
+    void begin();
+    void update(const void* data, size_t len);
+    void finish(uint8_t out[HASH_SIZE]);
+
+    static void hash(const void* data, size_t len, uint8_t out[HASH_SIZE]);
+    static void hmac(const void* key, size_t keyLen, const void* data, size_t len, uint8_t out[HASH_SIZE]);
+    static void toHex(const uint8_t hash[HASH_SIZE], char out[2 * HASH_SIZE + 1]);
+    static bool equal(const uint8_t* a, const uint8_t* b, size_t len); // Same time whatever differs
+
+private:
+    void block(const uint8_t* p);
+
+    uint32_t _h[8];
+    uint8_t _buf[BLOCK_SIZE];
+    uint8_t _bufLen = 0;
+    uint64_t _total = 0;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "StallMonitor.h"
+#include "Log.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+
+extern StallMonitor stallMonitor;
+
+// Not cleared by a reset (panic, watchdog, esp_restart, deep sleep);
+// garbage after power-on, hence the magic
+struct RtcStallState {
+    uint32_t magic;
+    uint32_t boots;
+    uint8_t stack[StallMonitor::STACK_DEPTH];
+    uint8_t depth;                 // Can exceed STACK_DEPTH, only the bottom is kept
+    uint8_t background;
+    uint32_t enteredMs[StallMonitor::STACK_DEPTH];
+    uint32_t lastMarkMs;
+    uint32_t maxUs[STAGE_COUNT];   // Since power-on
+    uint16_t stalls[STAGE_COUNT];  // Watchdog/panic resets while this stage was on top
+    StallMonitor::ResetRecord history[StallMonitor::HISTORY];
+    uint8_t historyHead;
+    uint8_t historyCount;
+};
+
+static const uint32_t RTC_STALL_MAGIC = 0x5253544C; // "RSTL"
+RTC_NOINIT_ATTR static RtcStallState rtcStall;
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "none", "setup", "idle", "buzzer", "alarm", "input", "ui", "web", "ota",
+    "network", "display", "serial", "sleep", "eventlog", "wifi_reconnect",
+    "ota_write", "flash_erase", "lcd_flush", "mqtt", "sync"
+};
+
+// esp_reset_reason_t order
+static const char* const RESET_NAMES[] = {
+    "unknown", "poweron", "ext", "sw", "panic", "int_wdt", "task_wdt", "wdt",
+    "deepsleep", "brownout", "sdio", "usb", "jtag", "efuse", "pwr_glitch", "cpu_lockup"
+};
+
+// The task watchdog calls this from its interrupt right before the panic.
+// The stuck stage never reaches exit(), so this is the only mark that
+// says how long it hung. esp_timer because millis() may not be in IRAM.
+extern "C" void IRAM_ATTR esp_task_wdt_isr_user_handler(void) {
+    rtcStall.lastMarkMs = (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+const char* StallMonitor::stageName(uint8_t stage) {
+    return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+const char* StallMonitor::resetReasonName(uint8_t reason) {
+    return reason < sizeof(RESET_NAMES) / sizeof(RESET_NAMES[0]) ? RESET_NAMES[reason] : "unknown";
+}
+
+void StallMonitor::init() {
+    _loopTask = xTaskGetCurrentTaskHandle(); // init() runs from setup() on the loop task
+    _last = {};
+    _last.reason = (uint8_t)esp_reset_reason();
+
+    bool valid = rtcStall.magic == RTC_STALL_MAGIC &&
+                 rtcStall.historyHead < HISTORY && rtcStall.historyCount <= HISTORY;
+    if (!valid) {
+        memset(&rtcStall, 0, sizeof(rtcStall));
+        rtcStall.magic = RTC_STALL_MAGIC;
+    } else {
+        // Where the previous boot was when it went down
+        uint8_t kept = rtcStall.depth < STACK_DEPTH ? rtcStall.depth : STACK_DEPTH;
+        for (uint8_t i = 0; i < kept; i++) _last.stack[i] = rtcStall.stack[i] < STAGE_COUNT ? rtcStall.stack[i] : STAGE_NONE;
+        _last.depth = kept;
+        _last.background = rtcStall.background < STAGE_COUNT ? rtcStall.background : STAGE_NONE;
+        _last.uptimeMs = rtcStall.lastMarkMs;
+        if (kept) _last.inStageMs = rtcStall.lastMarkMs - rtcStall.enteredMs[kept - 1];
+
+        if (lastResetWasStall()) {
+            // Loop task idle means it was fine; then the other task is the suspect
+            uint8_t blamed = kept ? _last.stack[kept - 1] : STAGE_NONE;
+            if ((blamed == STAGE_NONE || blamed == STAGE_IDLE) && _last.background != STAGE_NONE) {
+                blamed = _last.background;
+            }
+            if (rtcStall.stalls[blamed] < UINT16_MAX) rtcStall.stalls[blamed]++;
+        }
+    }
+
+    rtcStall.history[rtcStall.historyHead] = _last;
+    rtcStall.historyHead = (rtcStall.historyHead + 1) % HISTORY;
+    if (rtcStall.historyCount < HISTORY) rtcStall.historyCount++;
+    rtcStall.boots++;
+
+    rtcStall.depth = 0;
+    rtcStall.background = STAGE_NONE;
+    enter(STAGE_SETUP);
+
+    if (lastResetWasStall()) {
+        LOG_W("Stall: last reset %s in %s (%lu ms in stage, up %lu ms)",
+              resetReasonName(_last.reason),
+              stageName(_last.depth ? _last.stack[_last.depth - 1] : STAGE_NONE),
+              (unsigned long)_last.inStageMs, (unsigned long)_last.uptimeMs);
+    }
+}
+
+void StallMonitor::enter(StallStage stage) {
+    uint32_t nowMs = millis();
+    if (_loopTask && xTaskGetCurrentTaskHandle() != _loopTask) {
+        rtcStall.background = stage;
+        _bgEnterUs = micros();
+    } else {
+        uint8_t d = rtcStall.depth;
+        if (d < STACK_DEPTH) {
+            // Slot first, then depth: a reset in between still reads consistent
+            rtcStall.stack[d] = stage;
+            rtcStall.enteredMs[d] = nowMs;
+            _enterUs[d] = micros();
+        }
+        if (d < UINT8_MAX) rtcStall.depth = d + 1;
+    }
+    rtcStall.lastMarkMs = nowMs;
+}
+
+void StallMonitor::exit(StallStage stage) {
+    uint32_t spent = 0;
+    bool measured = false;
+    if (_loopTask && xTaskGetCurrentTaskHandle() != _loopTask) {
+        if (rtcStall.background == stage) {
+            spent = micros() - _bgEnterUs;
+            measured = true;
+            rtcStall.background = STAGE_NONE;
+        }
+    } else if (rtcStall.depth > 0) {
+        uint8_t d = rtcStall.depth - 1;
+        if (d < STACK_DEPTH && rtcStall.stack[d] == stage) {
+            spent = micros() - _enterUs[d];
+            measured = true;
+        }
+        rtcStall.depth = d;
+    }
+    if (measured && spent > rtcStall.maxUs[stage]) rtcStall.maxUs[stage] = spent;
+    rtcStall.lastMarkMs = millis();
+}
+
+bool StallMonitor::lastResetWasStall() {
+    switch (_last.reason) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t StallMonitor::getBootCount() { return rtcStall.boots; }
+uint32_t StallMonitor::getMaxUs(StallStage stage) { return stage < STAGE_COUNT ? rtcStall.maxUs[stage] : 0; }
+uint16_t StallMonitor::getStallCount(StallStage stage) { return stage < STAGE_COUNT ? rtcStall.stalls[stage] : 0; }
+
+static void writeStack(StrBuf& json, const char* key, const uint8_t* stack, uint8_t depth) {
+    json.jsonKey(key).append('[');
+    for (uint8_t i = 0; i < depth; i++) {
+        json.appendf("%s\"%s\"", i ? "," : "", StallMonitor::stageName(stack[i]));
+    }
+    json.append(']');
+}
+
+static void writeRecord(StrBuf& json, const StallMonitor::ResetRecord& r) {
+    json.append('{');
+    json.json("reason", StallMonitor::resetReasonName(r.reason));
+    json.json("stage", StallMonitor::stageName(r.depth ? r.stack[r.depth - 1] : STAGE_NONE));
+    writeStack(json, "stack", r.stack, r.depth);
+    json.json("background", StallMonitor::stageName(r.background));
+    json.json("inStageMs", r.inStageMs);
+    json.json("uptimeMs", r.uptimeMs);
+    json.append('}');
+}
+
+void StallMonitor::writeJson(StrBuf& json) {
+    json.append('{');
+    json.json("boots", rtcStall.boots);
+    json.json("resetReason", resetReasonName(_last.reason));
+    json.json("stall", lastResetWasStall());
+    json.jsonKey("lastReset");
+    writeRecord(json, _last);
+
+    json.jsonKey("current").append('{');
+    writeStack(json, "stack", rtcStall.stack, rtcStall.depth < STACK_DEPTH ? rtcStall.depth : STACK_DEPTH);
+    json.json("background", stageName(rtcStall.background));
+    json.append('}');
+
+    json.jsonKey("stages").append('[');
+    for (uint8_t s = STAGE_NONE + 1; s < STAGE_COUNT; s++) {
+        json.append(s > STAGE_NONE + 1 ? ",{" : "{");
+        json.json("name", stageName(s));
+        json.json("maxUs", rtcStall.maxUs[s]);
+        json.json("stalls", rtcStall.stalls[s]);
+        json.append('}');
+    }
+    json.append(']');
+
+    // Newest first; the first entry is this boot
+    json.jsonKey("history").append('[');
+    for (uint8_t i = 0; i < rtcStall.historyCount; i++) {
+        uint8_t idx = (rtcStall.historyHead + HISTORY - 1 - i) % HISTORY;
+        if (i) json.append(',');
+        writeRecord(json, rtcStall.history[idx]);
+    }
+    json.append("]}");
+}
+
+Breadcrumb::Breadcrumb(StallStage stage) : _stage(stage) { stallMonitor.enter(stage); }
+Breadcrumb::~Breadcrumb() { stallMonitor.exit(_stage); }
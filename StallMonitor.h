@@ -0,0 +1,85 @@
+#ifndef STALL_MONITOR_H
+#define STALL_MONITOR_H
+
+#include <Arduino.h>
+#include "FixedString.h"
+
+// What the firmware is doing right now, at subsystem granularity
+enum StallStage : uint8_t {
+    STAGE_NONE = 0,
+    STAGE_SETUP,
+    STAGE_IDLE,           // powerManager.idle() between passes
+    STAGE_BUZZER,
+    STAGE_ALARM,
+    STAGE_INPUT,
+    STAGE_UI,
+    STAGE_WEB,            // server.handleClient() and the handlers
+    STAGE_OTA,            // ArduinoOTA.handle()
+    STAGE_NETWORK,
+    STAGE_DISPLAY,
+    STAGE_SERIAL,
+    STAGE_SLEEP,
+    STAGE_EVENTLOG,
+    STAGE_WIFI_RECONNECT, // WiFi.disconnect() + reconnect()
+    STAGE_OTA_WRITE,      // Update.begin/write/end of a web upload
+    STAGE_FLASH_ERASE,    // Event log sector erase
+    STAGE_LCD_FLUSH,      // Runs on the LCD task when there is one
+    STAGE_MQTT,
+    STAGE_SYNC,
+    STAGE_COUNT
+};
+
+// Breadcrumbs for watchdog resets. Every subsystem marks entry and exit;
+// the marks live in RTC memory that is not cleared on a reset, so after a
+// task watchdog (or any other panic) the next boot can tell which stage
+// was running when it hit. Also keeps the longest time seen per stage.
+//
+// The loop task keeps a small stack of nested stages (web -> OTA write).
+// Other tasks (the LCD writer) get one slot of their own.
+// Reported on /api/diag. Survives resets, not power loss.
+class StallMonitor {
+public:
+    static const uint8_t STACK_DEPTH = 4;
+    static const uint8_t HISTORY = 8;
+
+    struct ResetRecord {
+        uint8_t reason;         // esp_reset_reason_t
+        uint8_t stack[STACK_DEPTH];
+        uint8_t depth;
+        uint8_t background;     // Stage of the other task, STAGE_NONE = none
+        uint32_t inStageMs;     // Top stage: entry to the last mark before the reset
+        uint32_t uptimeMs;      // millis() at the last mark
+    };
+
+    void init();                    // First thing in setup(), on the loop task
+
+    void enter(StallStage stage);
+    void exit(StallStage stage);
+
+    bool lastResetWasStall();       // Watchdog or panic
+    const ResetRecord& getLastReset() { return _last; }
+    uint32_t getBootCount();
+    uint32_t getMaxUs(StallStage stage);
+    uint16_t getStallCount(StallStage stage);
+
+    static const char* stageName(uint8_t stage);
+    static const char* resetReasonName(uint8_t reason);
+    void writeJson(StrBuf& json);
+
+private:
+    ResetRecord _last = {};
+    void* _loopTask = nullptr;
+    uint32_t _enterUs[STACK_DEPTH] = {};
+    uint32_t _bgEnterUs = 0;
+};
+
+// Marks a stage for the rest of the scope
+class Breadcrumb {
+public:
+    explicit Breadcrumb(StallStage stage);
+    ~Breadcrumb();
+private:
+    StallStage _stage;
+};
+
+#endif
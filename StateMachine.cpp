@@ -0,0 +1,166 @@
+#include "StateMachine.h"
+#include "Log.h"
+
+static const char* const stateNames[STATE_COUNT] = {
+    "BOOT", "WIFI_CONNECTING", "TIME_SYNC", "IDLE", "PRE_SEHRI_ARMED",
+    "PRE_SEHRI_RINGING", "SEHRI_RINGING", "IFTAR_RINGING", "PRAYER_BEEP",
+    "PARTIAL_ACK", "ALL_ACK", "OTA_MODE", "ERROR"
+};
+
+const char* stateName(SystemState state) {
+    return (state < STATE_COUNT) ? stateNames[state] : "?";
+}
+
+struct Transition {
+    SystemState from;
+    SystemState to;
+};
+
+// Every legal transition. PRE_SEHRI_ARMED, PARTIAL_ACK and ALL_ACK have
+// no rows: nothing enters them yet.
+static const Transition transitionTable[] = {
+    // Boot: WiFi, then NTP. Before the clock is set only the manual
+    // Sehri/Iftar triggers (serial, web test, NAV hold) can ring.
+    { STATE_BOOT,              STATE_WIFI_CONNECTING },
+    { STATE_WIFI_CONNECTING,   STATE_TIME_SYNC },
+    { STATE_TIME_SYNC,         STATE_WIFI_CONNECTING }, // Lost WiFi before sync
+    { STATE_TIME_SYNC,         STATE_IDLE },
+    { STATE_WIFI_CONNECTING,   STATE_SEHRI_RINGING },
+    { STATE_WIFI_CONNECTING,   STATE_IFTAR_RINGING },
+    { STATE_TIME_SYNC,         STATE_SEHRI_RINGING },
+    { STATE_TIME_SYNC,         STATE_IFTAR_RINGING },
+
+    // Scheduled and manual alarms start from idle
+    { STATE_IDLE,              STATE_PRE_SEHRI_RINGING },
+    { STATE_IDLE,              STATE_SEHRI_RINGING },
+    { STATE_IDLE,              STATE_IFTAR_RINGING },
+    { STATE_IDLE,              STATE_PRAYER_BEEP },
+
+    // Sehri/Iftar take over from the softer patterns and can restart
+    { STATE_PRE_SEHRI_RINGING, STATE_SEHRI_RINGING },
+    { STATE_PRE_SEHRI_RINGING, STATE_IFTAR_RINGING },
+    { STATE_PRAYER_BEEP,       STATE_SEHRI_RINGING },
+    { STATE_PRAYER_BEEP,       STATE_IFTAR_RINGING },
+    { STATE_SEHRI_RINGING,     STATE_SEHRI_RINGING },
+    { STATE_SEHRI_RINGING,     STATE_IFTAR_RINGING },
+    { STATE_IFTAR_RINGING,     STATE_IFTAR_RINGING },
+    { STATE_IFTAR_RINGING,     STATE_SEHRI_RINGING },
+
+    // Buzzers finished (auto-off or acknowledged)
+    { STATE_PRE_SEHRI_RINGING, STATE_IDLE },
+    { STATE_SEHRI_RINGING,     STATE_IDLE },
+    { STATE_IFTAR_RINGING,     STATE_IDLE },
+    { STATE_PRAYER_BEEP,       STATE_IDLE },
+
+    // Firmware update wins over everything; a failed one shows ERROR
+    { STATE_WIFI_CONNECTING,   STATE_OTA_MODE },
+    { STATE_TIME_SYNC,         STATE_OTA_MODE },
+    { STATE_IDLE,              STATE_OTA_MODE },
+    { STATE_PRE_SEHRI_RINGING, STATE_OTA_MODE },
+    { STATE_SEHRI_RINGING,     STATE_OTA_MODE },
+    { STATE_IFTAR_RINGING,     STATE_OTA_MODE },
+    { STATE_PRAYER_BEEP,       STATE_OTA_MODE },
+    { STATE_OTA_MODE,          STATE_ERROR },
+    { STATE_ERROR,             STATE_IDLE },
+};
+
+static const uint8_t TRANSITION_COUNT = sizeof(transitionTable) / sizeof(transitionTable[0]);
+
+bool StateMachine::isAllowed(SystemState from, SystemState to) {
+    for (uint8_t i = 0; i < TRANSITION_COUNT; i++) {
+        if (transitionTable[i].from == from && transitionTable[i].to == to) return true;
+    }
+    return false;
+}
+
+uint8_t StateMachine::getTransitionCount() {
+    return TRANSITION_COUNT;
+}
+
+void StateMachine::getTransition(uint8_t index, SystemState* from, SystemState* to) {
+    *from = transitionTable[index].from;
+    *to = transitionTable[index].to;
+}
+
+bool StateMachine::isRingingState(SystemState state) {
+    return state == STATE_PRE_SEHRI_RINGING || state == STATE_SEHRI_RINGING ||
+           state == STATE_IFTAR_RINGING || state == STATE_PRAYER_BEEP;
+}
+
+void StateMachine::setActions(SystemState state, StateAction onEnter, StateAction onExit) {
+    _onEnter[state] = onEnter;
+    _onExit[state] = onExit;
+}
+
+bool StateMachine::transition(SystemState to) {
+    SystemState from = _state;
+
+    // An entry/exit action asking for another transition is a bug in the
+    // actions, not something to nest
+    if (_inTransition || !isAllowed(from, to)) {
+        _rejected++;
+        LOG_W("STATE: rejected %s -> %s", stateName(from), stateName(to));
+        return false;
+    }
+
+    unsigned long now = millis();
+    unsigned long held = now - _enteredAt;
+
+    _inTransition = true;
+    if (_onExit[from]) _onExit[from]();
+    _totalMs[from] += held;
+    _state = to;
+    _enteredAt = now;
+    _entries[to]++;
+    if (_onEnter[to]) _onEnter[to]();
+    _inTransition = false;
+
+    Record& r = _history[_historyHead];
+    r.atMs = now;
+    r.heldMs = held;
+    r.from = from;
+    r.to = to;
+    _historyHead = (_historyHead + 1) % HISTORY_SIZE;
+    if (_historyCount < HISTORY_SIZE) _historyCount++;
+
+    LOG_I("STATE: %s -> %s at %lu ms (%lu ms in %s)",
+          stateName(from), stateName(to), now, held, stateName(from));
+    return true;
+}
+
+unsigned long StateMachine::getTotalMs(SystemState state) {
+    unsigned long total = _totalMs[state];
+    if (state == _state) total += millis() - _enteredAt;
+    return total;
+}
+
+void StateMachine::writeStatsJson(StrBuf& json) {
+    json += '{';
+    json.json("state", stateName(_state));
+    json.json("inStateMs", getTimeInStateMs());
+    json.json("rejected", _rejected);
+
+    json.jsonKey("totals") += '{';
+    for (uint8_t s = 0; s < STATE_COUNT; s++) {
+        if (_entries[s] == 0 && _totalMs[s] == 0 && s != _state) continue;
+        json.jsonKey(stateNames[s]) += '{';
+        json.json("ms", getTotalMs((SystemState)s));
+        json.json("entries", _entries[s]);
+        json += '}';
+    }
+    json += '}';
+
+    // Oldest first
+    json.jsonKey("history") += '[';
+    for (uint8_t i = 0; i < _historyCount; i++) {
+        const Record& r = _history[(_historyHead + HISTORY_SIZE - _historyCount + i) % HISTORY_SIZE];
+        if (i) json += ',';
+        json += '{';
+        json.json("at", r.atMs);
+        json.json("from", stateNames[r.from]);
+        json.json("to", stateNames[r.to]);
+        json.json("heldMs", r.heldMs);
+        json += '}';
+    }
+    json += "]}";
+}
@@ -0,0 +1,70 @@
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include <Arduino.h>
+#include "FixedString.h"
+#include "SystemState.h"
+
+#define STATE_COUNT (STATE_ERROR + 1)
+
+const char* stateName(SystemState state);
+
+// The one place currentState changes. Which state may follow which is a
+// fixed table (see StateMachine.cpp); anything else is rejected and
+// logged. Each state can have entry/exit actions, and the machine keeps
+// how long the unit has spent in every state plus a short history.
+class StateMachine {
+public:
+    typedef void (*StateAction)();
+
+    struct Record {
+        unsigned long atMs;   // millis() when the transition happened
+        unsigned long heldMs; // Time spent in `from`
+        uint8_t from;
+        uint8_t to;
+    };
+
+    void setActions(SystemState state, StateAction onEnter, StateAction onExit = nullptr);
+
+    // Moves to `to` if the table allows it: exit(from), enter(to).
+    // `to == from` re-enters the state if that is allowed (restart).
+    bool transition(SystemState to);
+    bool canTransition(SystemState to) { return isAllowed(_state, to); }
+    static bool isAllowed(SystemState from, SystemState to);
+
+    SystemState getState() { return _state; }
+    bool isRinging() { return isRingingState(_state); }
+    static bool isRingingState(SystemState state);
+
+    unsigned long getTimeInStateMs() { return millis() - _enteredAt; }
+    // Total time spent in `state` since boot, including the current stay
+    unsigned long getTotalMs(SystemState state);
+    uint32_t getEntryCount(SystemState state) { return _entries[state]; }
+    uint32_t getRejectedCount() { return _rejected; }
+
+    // Table access, so callers can enumerate every legal transition
+    static uint8_t getTransitionCount();
+    static void getTransition(uint8_t index, SystemState* from, SystemState* to);
+
+    void writeStatsJson(StrBuf& json);
+
+    static const uint8_t HISTORY_SIZE = 16;
+
+private:
+    SystemState _state = STATE_BOOT;
+    unsigned long _enteredAt = 0;
+    bool _inTransition = false;
+
+    StateAction _onEnter[STATE_COUNT] = {};
+    StateAction _onExit[STATE_COUNT] = {};
+
+    unsigned long _totalMs[STATE_COUNT] = {};
+    uint32_t _entries[STATE_COUNT] = {};
+    uint32_t _rejected = 0;
+
+    Record _history[HISTORY_SIZE];
+    uint8_t _historyHead = 0;
+    uint8_t _historyCount = 0;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "TaskScheduler.h"
+
+bool TaskScheduler::add(const char* name, TaskFn fn, uint8_t priority, uint32_t periodMs,
+                         uint32_t deadlineMs, uint32_t budgetUs, TaskReadyFn ready) {
+    if (_count >= MAX_TASKS) return false;
+
+    // Insert after all tasks of the same or higher priority, so equal
+    // priorities keep registration order
+    uint8_t pos = _count;
+    while (pos > 0 && _tasks[pos - 1].priority > priority) {
+        _tasks[pos] = _tasks[pos - 1];
+        pos--;
+    }
+
+    Task& t = _tasks[pos];
+    t.name = name;
+    t.fn = fn;
+    t.ready = ready;
+    t.priority = priority;
+    t.periodMs = periodMs;
+    t.deadlineMs = deadlineMs;
+    t.budgetUs = budgetUs;
+    t.nextDue = millis();
+    memset(&t.stats, 0, sizeof(t.stats));
+    _count++;
+    return true;
+}
+
+void TaskScheduler::run() {
+    unsigned long now = millis();
+    unsigned long passStart = micros();
+
+    for (uint8_t i = 0; i < _count; i++) {
+        Task& t = _tasks[i];
+
+        if (!_runAll) {
+            if ((long)(now - t.nextDue) < 0) continue;
+
+            uint32_t lateMs = now - t.nextDue;
+            t.nextDue = (t.periodMs && lateMs < t.periodMs) ? t.nextDue + t.periodMs : now + t.periodMs;
+
+            if (t.ready && !t.ready()) {
+                t.stats.skips++;
+                continue;
+            }
+
+            // Periodic tasks only: an every-pass task is never "late"
+            if (t.periodMs) {
+                if (lateMs > t.stats.maxLateMs) t.stats.maxLateMs = lateMs;
+                if (t.deadlineMs && lateMs > t.deadlineMs) t.stats.deadlineMisses++;
+            }
+        }
+
+        unsigned long start = micros();
+        t.fn();
+        uint32_t spent = micros() - start;
+
+        t.stats.runs++;
+        t.stats.totalRunUs += spent;
+        if (spent > t.stats.maxRunUs) t.stats.maxRunUs = spent;
+        if (t.budgetUs && spent > t.budgetUs) t.stats.overruns++;
+        _busyUs += spent;
+
+        now = millis(); // Later tasks see the time after this one ran
+    }
+
+    uint32_t passUs = micros() - passStart;
+    if (passUs > _maxPassUs) _maxPassUs = passUs;
+    if (_passBudgetUs && passUs > _passBudgetUs) _passOverruns++;
+
+    _passes++;
+    if (now - _secondStart >= 1000) {
+        _busyUsLastSecond = _busyUs;
+        _passesLastSecond = _passes;
+        _busyUs = 0;
+        _passes = 0;
+        _secondStart = now;
+    }
+}
+
+uint32_t TaskScheduler::getMsToNextDue() {
+    unsigned long now = millis();
+    uint32_t next = UINT32_MAX;
+    for (uint8_t i = 0; i < _count; i++) {
+        Task& t = _tasks[i];
+        // Event-driven tasks (every pass + ready check) are woken by their
+        // event source, and a periodic task with no work can wait for one
+        if (t.ready && (t.periodMs == 0 || !t.ready())) continue;
+        long wait = (long)(t.nextDue - now);
+        if (wait <= 0) return 0;
+        if ((uint32_t)wait < next) next = wait;
+    }
+    return next;
+}
+
+void TaskScheduler::writeStatsJson(StrBuf& json) {
+    json += '{';
+    json.json("busyUsPerSec", _busyUsLastSecond);
+    json.json("passesPerSec", _passesLastSecond);
+    json.json("maxPassUs", _maxPassUs);
+    json.json("passOverruns", _passOverruns);
+    json.jsonKey("tasks") += '[';
+    for (uint8_t i = 0; i < _count; i++) {
+        Task& t = _tasks[i];
+        if (i) json += ',';
+        json += '{';
+        json.json("name", t.name);
+        json.json("prio", t.priority);
+        json.json("periodMs", t.periodMs);
+        json.json("runs", t.stats.runs);
+        json.json("skips", t.stats.skips);
+        json.json("overruns", t.stats.overruns);
+        json.json("deadlineMisses", t.stats.deadlineMisses);
+        json.json("avgUs", t.stats.runs ? (uint32_t)(t.stats.totalRunUs / t.stats.runs) : 0);
+        json.json("maxUs", t.stats.maxRunUs);
+        json.json("maxLateMs", t.stats.maxLateMs);
+        json += '}';
+    }
+    json += "]}";
+}
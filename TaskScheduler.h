@@ -0,0 +1,91 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+#include "FixedString.h"
+
+typedef void (*TaskFn)();
+typedef bool (*TaskReadyFn)();
+
+// Cooperative scheduler for loop(). Each subsystem registers how often it
+// needs to run, how late it may start, how long a run may take and a
+// priority. run() goes through the due tasks in priority order; a task
+// that has a ready() check and nothing to do is skipped without being
+// called. Nothing is preempted: a slow task only shows up as an overrun.
+class TaskScheduler {
+public:
+    struct Stats {
+        uint32_t runs;
+        uint32_t skips;          // Due, but ready() said there was no work
+        uint32_t overruns;       // Run took longer than the budget
+        uint32_t deadlineMisses; // Started later than deadlineMs after due
+        uint32_t maxRunUs;
+        uint32_t maxLateMs;
+        uint64_t totalRunUs;
+    };
+
+    // priority: 0 runs first. periodMs 0 = every pass.
+    // deadlineMs 0 = no deadline. budgetUs 0 = no budget.
+    // Returns false if the table is full.
+    bool add(const char* name, TaskFn fn, uint8_t priority, uint32_t periodMs,
+               uint32_t deadlineMs, uint32_t budgetUs, TaskReadyFn ready = nullptr);
+
+    // One pass over all due tasks
+    void run();
+
+    // Superloop mode: every task runs on every pass, ignoring periods and
+    // ready checks (for comparing against the old loop)
+    void setRunAll(bool runAll) { _runAll = runAll; }
+
+    // Milliseconds until the earliest periodic task with work is due
+    // (0 = now). Tasks gated by a ready() check that reports no work are
+    // left out: whatever gives them work has to wake the loop itself.
+    uint32_t getMsToNextDue();
+
+    // Longest single pass (all tasks run by one run() call) and how many
+    // passes went over the pass budget. A blocking call anywhere shows here.
+    void setPassBudget(uint32_t budgetUs) { _passBudgetUs = budgetUs; }
+    uint32_t getMaxPassMicros() { return _maxPassUs; }
+    uint32_t getPassOverruns() { return _passOverruns; }
+
+    // Time spent inside tasks during the last full second
+    uint32_t getBusyMicrosPerSecond() { return _busyUsLastSecond; }
+    uint32_t getPassesPerSecond() { return _passesLastSecond; }
+
+    uint8_t count() { return _count; }
+    const char* name(uint8_t id) { return _tasks[id].name; }
+    const Stats& stats(uint8_t id) { return _tasks[id].stats; }
+
+    void writeStatsJson(StrBuf& json);
+
+    static const uint8_t MAX_TASKS = 16;
+
+private:
+    struct Task {
+        const char* name;
+        TaskFn fn;
+        TaskReadyFn ready;
+        uint8_t priority;
+        uint32_t periodMs;
+        uint32_t deadlineMs;
+        uint32_t budgetUs;
+        unsigned long nextDue;
+        Stats stats;
+    };
+
+    Task _tasks[MAX_TASKS]; // Kept sorted by priority
+    uint8_t _count = 0;
+    bool _runAll = false;
+
+    uint32_t _passBudgetUs = 0;
+    uint32_t _maxPassUs = 0;
+    uint32_t _passOverruns = 0;
+
+    uint32_t _busyUs = 0;
+    uint32_t _passes = 0;
+    uint32_t _busyUsLastSecond = 0;
+    uint32_t _passesLastSecond = 0;
+    unsigned long _secondStart = 0;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "TerminalBackend.h"
+
+// Box drawn at the top-left: border on terminal row 1, panel rows from 2
+#define TERM_TOP  2
+#define TERM_LEFT 2
+
+bool TerminalBackend::begin(uint8_t cols, uint8_t rows) {
+    _rows = rows;
+    char border[LCD_COLS + 3];
+    border[0] = '+';
+    memset(border + 1, '-', cols);
+    border[cols + 1] = '+';
+    border[cols + 2] = '\0';
+
+    char buff[48];
+    emit("\x1b[2J", 4); // Clear screen
+    int n = snprintf(buff, sizeof(buff), "\x1b[%d;1H%s", TERM_TOP - 1, border);
+    emit(buff, n);
+    for (uint8_t r = 0; r < rows; r++) {
+        n = snprintf(buff, sizeof(buff), "\x1b[%d;1H|\x1b[%d;%dH|", TERM_TOP + r, TERM_TOP + r, TERM_LEFT + cols);
+        emit(buff, n);
+    }
+    n = snprintf(buff, sizeof(buff), "\x1b[%d;1H%s", TERM_TOP + rows, border);
+    emit(buff, n);
+    _pending = true;
+    present();
+    return true;
+}
+
+void TerminalBackend::drawRun(uint8_t row, uint8_t col, const char* text, uint8_t len) {
+    char buff[16];
+    int n = snprintf(buff, sizeof(buff), "\x1b[%d;%dH", TERM_TOP + row, TERM_LEFT + col);
+    emit(buff, n);
+    emit(text, len);
+    _pending = true;
+}
+
+void TerminalBackend::present() {
+    if (!_pending) return;
+    // Park the cursor below the box so log output does not overwrite it
+    char buff[16];
+    int n = snprintf(buff, sizeof(buff), "\x1b[%d;1H", TERM_TOP + _rows + 1);
+    emit(buff, n);
+    _pending = false;
+}
+
+size_t TerminalBackend::emit(const char* text, size_t len) {
+    _busBytes += len;
+    return Serial.write((const uint8_t*)text, len);
+}
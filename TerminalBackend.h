@@ -0,0 +1,24 @@
+#ifndef TERMINAL_BACKEND_H
+#define TERMINAL_BACKEND_H
+
+#include <Arduino.h>
+#include "DisplayBackend.h"
+
+// Draws the panel in a boxed area of an ANSI/VT100 terminal on Serial.
+// For bench work without a panel and for the host build, where Serial is
+// stdout. Log output shares the same stream, so a chatty log will scroll
+// the box away; only changed cells are redrawn afterwards.
+class TerminalBackend : public DisplayBackend {
+public:
+    bool begin(uint8_t cols, uint8_t rows) override;
+    void drawRun(uint8_t row, uint8_t col, const char* text, uint8_t len) override;
+    void present() override;
+    const char* name() override { return "terminal"; }
+
+private:
+    size_t emit(const char* text, size_t len);
+    uint8_t _rows = LCD_ROWS;
+    bool _pending = false;
+};
+
+#endif
@@ -0,0 +1,373 @@
+#include "TimetableParser.h"
+
+static const char* const MONTH_NAMES[] = {
+    "january", "february", "march", "april", "may", "june",
+    "july", "august", "september", "october", "november", "december"
+};
+static const uint8_t DAYS_IN_MONTH[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+static char lower(char c) { return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c; }
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+static bool equalsNoCase(const char* a, const char* b) {
+    while (*a && lower(*a) == lower(*b)) { a++; b++; }
+    return *a == '\0' && *b == '\0';
+}
+
+// "5:42" or "05:42"
+bool TimetableParser::parseTime(const char* s, uint8_t& hour, uint8_t& minute) {
+    int h = 0, i = 0;
+    while (i < 2 && isDigit(s[i])) h = h * 10 + (s[i++] - '0');
+    if (i == 0 || s[i] != ':') return false;
+    s += i + 1;
+    if (!isDigit(s[0]) || !isDigit(s[1]) || s[2] != '\0') return false;
+    int m = (s[0] - '0') * 10 + (s[1] - '0');
+    if (h > 23 || m > 59) return false;
+    hour = h;
+    minute = m;
+    return true;
+}
+
+// "19 Feb", "01 March" or "2026-02-19". The year is not kept.
+bool TimetableParser::parseDate(const char* s, uint8_t& month, uint8_t& day) {
+    int m = 0, d = 0;
+    if (isDigit(s[0]) && isDigit(s[1]) && isDigit(s[2]) && isDigit(s[3]) && s[4] == '-') {
+        if (!isDigit(s[5]) || !isDigit(s[6]) || s[7] != '-' || !isDigit(s[8]) || !isDigit(s[9]) || s[10]) return false;
+        m = (s[5] - '0') * 10 + (s[6] - '0');
+        d = (s[8] - '0') * 10 + (s[9] - '0');
+    } else {
+        int i = 0;
+        while (i < 2 && isDigit(s[i])) d = d * 10 + (s[i++] - '0');
+        if (i == 0 || s[i] != ' ') return false;
+        while (s[i] == ' ') i++;
+        const char* word = s + i;
+        int len = 0;
+        while (word[len] && word[len] != ' ') len++;
+        if (len < 3 || word[len]) return false;
+        // Any abbreviation of at least three letters
+        for (int k = 0; k < 12 && !m; k++) {
+            int j = 0;
+            while (j < len && MONTH_NAMES[k][j] && lower(word[j]) == MONTH_NAMES[k][j]) j++;
+            if (j == len) m = k + 1;
+        }
+    }
+    if (m < 1 || m > 12 || d < 1 || d > DAYS_IN_MONTH[m - 1]) return false;
+    month = m;
+    day = d;
+    return true;
+}
+
+TimetableParser::Key TimetableParser::keyOf(const char* s) {
+    if (equalsNoCase(s, "location")) return KEY_LOCATION;
+    if (equalsNoCase(s, "prayer_fixed_times")) return KEY_PRAYERS;
+    if (equalsNoCase(s, "timetable")) return KEY_TIMETABLE;
+    if (equalsNoCase(s, "date")) return KEY_DATE;
+    if (equalsNoCase(s, "sehri")) return KEY_SEHRI;
+    if (equalsNoCase(s, "iftar")) return KEY_IFTAR;
+    if (equalsNoCase(s, "fajr")) return KEY_FAJR;
+    if (equalsNoCase(s, "zuhr") || equalsNoCase(s, "zohr")) return KEY_ZOHR;
+    if (equalsNoCase(s, "asr")) return KEY_ASR;
+    if (equalsNoCase(s, "isha")) return KEY_ISHA;
+    return KEY_OTHER;
+}
+
+void TimetableParser::begin(EntryFn fn, void* ctx) {
+    *this = TimetableParser();
+    _fn = fn;
+    _ctx = ctx;
+}
+
+bool TimetableParser::fail(const char* why) {
+    if (!_error) {
+        _error = why;
+        _errorLine = _line;
+    }
+    return false;
+}
+
+bool TimetableParser::feed(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len && !_error; i++) {
+        char c = (char)data[i];
+        if (_format == FORMAT_UNKNOWN) {
+            // Skip a UTF-8 byte order mark and leading blank lines
+            if (isSpace(c) || (uint8_t)c == 0xEF || (uint8_t)c == 0xBB || (uint8_t)c == 0xBF) {
+                if (c == '\n') _line++;
+                continue;
+            }
+            _format = (c == '{' || c == '[') ? FORMAT_JSON : FORMAT_CSV;
+        }
+
+        if (_format == FORMAT_JSON) {
+            jsonChar(c);
+        } else if (c == '\n') {
+            csvLine();
+            _csvLen = 0;
+        } else if (c != '\r') {
+            if (_csvLen >= CSV_LINE_MAX) fail("line too long");
+            else _csv[_csvLen++] = c;
+        }
+        if (c == '\n') _line++;
+    }
+    return !_error;
+}
+
+bool TimetableParser::finish() {
+    if (_error) return false;
+    if (_format == FORMAT_UNKNOWN) return fail("empty body");
+    if (_format == FORMAT_JSON) {
+        if (_lex != LEX_NONE || _expect != EXPECT_NOTHING) return fail("body ends early");
+    } else if (_csvLen > 0 && !csvLine()) {
+        return false;
+    }
+    if (_entries == 0) return fail("no days in the timetable");
+    return true;
+}
+
+// --- JSON ---
+
+bool TimetableParser::jsonChar(char c) {
+    switch (_lex) {
+        case LEX_STRING:
+            if (c == '"') {
+                _lex = LEX_NONE;
+                return jsonToken(true);
+            }
+            if (c == '\\') {
+                _lex = LEX_ESCAPE;
+                return true;
+            }
+            if ((uint8_t)c < 0x20) return fail("control character in a string");
+            break;
+        case LEX_ESCAPE:
+            _lex = LEX_STRING;
+            switch (c) {
+                case '"': case '\\': case '/': break;
+                case 'b': case 'f': case 'n': case 'r': case 't': c = ' '; break;
+                case 'u': _lex = LEX_UNICODE; _hexLeft = 4; c = '?'; break;
+                default: return fail("bad escape in a string");
+            }
+            break;
+        case LEX_UNICODE:
+            if (!isDigit(c) && !(lower(c) >= 'a' && lower(c) <= 'f')) return fail("bad \\u escape");
+            if (--_hexLeft == 0) _lex = LEX_STRING;
+            return true;
+        case LEX_LITERAL:
+            if (isDigit(c) || (lower(c) >= 'a' && lower(c) <= 'z') || c == '-' || c == '+' || c == '.') break;
+            _lex = LEX_NONE;
+            if (!jsonToken(false)) return false;
+            return jsonChar(c); // The character that ended it
+        case LEX_NONE:
+            if (isSpace(c)) return true;
+            if (_expect == EXPECT_NOTHING) return fail("text after the end");
+            if (c == '"') {
+                if (_expect == EXPECT_KEY || _expect == EXPECT_KEY_OR_END) _isKey = true;
+                else if (_expect == EXPECT_VALUE || _expect == EXPECT_VALUE_OR_END) _isKey = false;
+                else return fail("unexpected string");
+                _tokLen = 0;
+                _tokLong = false;
+                _lex = LEX_STRING;
+                return true;
+            }
+            if (c == ':') {
+                if (_expect != EXPECT_COLON) return fail("unexpected ':'");
+                _expect = EXPECT_VALUE;
+                return true;
+            }
+            if (c == ',') {
+                if (_expect != EXPECT_COMMA_OR_END) return fail("unexpected ','");
+                _expect = _stack[_depth - 1] == '{' ? EXPECT_KEY : EXPECT_VALUE;
+                return true;
+            }
+            if (c == '{' || c == '[') {
+                if (_expect != EXPECT_VALUE && _expect != EXPECT_VALUE_OR_END) return fail("unexpected '{' or '['");
+                return jsonOpen(c);
+            }
+            if (c == '}' || c == ']') {
+                char open = c == '}' ? '{' : '[';
+                bool empty = _expect == (c == '}' ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END);
+                if ((!empty && _expect != EXPECT_COMMA_OR_END) || _depth == 0 || _stack[_depth - 1] != open) {
+                    return fail("unexpected '}' or ']'");
+                }
+                return jsonClose(c);
+            }
+            if (isDigit(c) || c == '-' || (c >= 'a' && c <= 'z')) {
+                if (_expect != EXPECT_VALUE && _expect != EXPECT_VALUE_OR_END) return fail("unexpected value");
+                _isKey = false;
+                _tokLen = 0;
+                _tokLong = false;
+                _lex = LEX_LITERAL;
+                break;
+            }
+            return fail("unexpected character");
+    }
+
+    if (_tokLen < TOKEN_MAX) _tok[_tokLen++] = c;
+    else _tokLong = true;
+    return true;
+}
+
+bool TimetableParser::jsonOpen(char c) {
+    if (_depth >= MAX_DEPTH) return fail("nested too deep");
+    if (_depth == 0 && c != '{') return fail("expected a JSON object");
+    // A new day in the "timetable" array
+    if (c == '{' && _depth == 2 && _topKey == KEY_TIMETABLE && _stack[1] == '[') {
+        _cur = {};
+        _curMask = 0;
+    }
+    _stack[_depth++] = c;
+    _expect = c == '{' ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+    return true;
+}
+
+bool TimetableParser::jsonClose(char c) {
+    if (c == '}' && _depth == 3 && _topKey == KEY_TIMETABLE && _stack[1] == '[' && !emitEntry()) return false;
+    _depth--;
+    afterValue();
+    return true;
+}
+
+void TimetableParser::afterValue() {
+    _expect = _depth == 0 ? EXPECT_NOTHING : EXPECT_COMMA_OR_END;
+}
+
+bool TimetableParser::jsonToken(bool isString) {
+    _tok[_tokLen] = '\0';
+    if (_isKey) {
+        Key key = _tokLong ? KEY_OTHER : keyOf(_tok);
+        if (_depth == 1) _topKey = key;
+        else if (_depth <= 3) _fieldKey = key;
+        _expect = EXPECT_COLON;
+        return true;
+    }
+
+    if (!isString) {
+        bool ok = !strcmp(_tok, "true") || !strcmp(_tok, "false") || !strcmp(_tok, "null");
+        if (!ok) {
+            // Loose number check: digits, sign, point, exponent
+            bool digit = false;
+            ok = !_tokLong;
+            for (uint8_t i = 0; i < _tokLen && ok; i++) {
+                char c = _tok[i];
+                digit |= isDigit(c);
+                ok = isDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+            }
+            ok = ok && digit;
+        }
+        if (!ok) return fail("bad value");
+    }
+
+    bool inDay = _depth == 3 && _topKey == KEY_TIMETABLE && _stack[1] == '[' && _stack[2] == '{';
+    bool inPrayers = _depth == 2 && _topKey == KEY_PRAYERS && _stack[1] == '{';
+    bool wanted = (inDay && (_fieldKey == KEY_DATE || _fieldKey == KEY_SEHRI || _fieldKey == KEY_IFTAR)) ||
+                  (inPrayers && _fieldKey >= KEY_FAJR && _fieldKey <= KEY_ISHA);
+    if (wanted) {
+        if (!isString) return fail("expected a string");
+        if (_tokLong) return fail("value too long");
+        if (!setField(_fieldKey, _tok)) return false;
+    } else if (_depth == 1 && _topKey == KEY_LOCATION && isString) {
+        uint8_t n = _tokLen < LOCATION_MAX ? _tokLen : LOCATION_MAX;
+        memcpy(_location, _tok, n);
+        _location[n] = '\0';
+    }
+    afterValue();
+    return true;
+}
+
+// --- CSV ---
+
+bool TimetableParser::csvLine() {
+    _csv[_csvLen] = '\0';
+    char* r = _csv;
+    while (*r == ' ' || *r == '\t') r++;
+    if (*r == '\0' || *r == '#') return true;
+
+    // Split in place; quotes may wrap a field, "" inside them is a quote
+    const uint8_t MAX_FIELDS = 8;
+    char* fields[MAX_FIELDS];
+    uint8_t n = 0;
+    while (n < MAX_FIELDS) {
+        while (*r == ' ' || *r == '\t') r++;
+        char* start = r;
+        char* w = r;
+        bool quoted = *r == '"';
+        if (quoted) r++;
+        while (*r && (quoted || *r != ',')) {
+            if (quoted && *r == '"') {
+                if (r[1] == '"') { *w++ = '"'; r += 2; }
+                else { quoted = false; r++; }
+                continue;
+            }
+            *w++ = *r++;
+        }
+        if (quoted) return fail("unterminated quote");
+        bool more = *r == ',';
+        while (w > start && (w[-1] == ' ' || w[-1] == '\t')) w--;
+        *w = '\0';
+        fields[n++] = start;
+        if (!more) break;
+        r++;
+    }
+
+    if (!_csvHeaderSeen) {
+        _csvHeaderSeen = true;
+        int8_t col[3] = { -1, -1, -1 };
+        bool header = false;
+        for (uint8_t i = 0; i < n; i++) {
+            Key key = keyOf(fields[i]);
+            if (key >= KEY_DATE && key <= KEY_IFTAR) {
+                col[key - KEY_DATE] = i;
+                header = true;
+            }
+        }
+        if (header) {
+            if (col[0] < 0 || col[1] < 0 || col[2] < 0) return fail("header needs date, sehri and iftar");
+            memcpy(_col, col, sizeof(_col));
+            return true;
+        }
+    }
+
+    for (uint8_t i = 0; i < 3; i++) {
+        if (_col[i] >= n) return fail("missing column");
+    }
+    _curMask = 0;
+    return setField(KEY_DATE, fields[_col[0]]) && setField(KEY_SEHRI, fields[_col[1]]) &&
+           setField(KEY_IFTAR, fields[_col[2]]) && emitEntry();
+}
+
+// --- Both ---
+
+bool TimetableParser::setField(Key key, const char* value) {
+    uint8_t h = 0, m = 0;
+    if (key == KEY_DATE) {
+        if (!parseDate(value, _cur.month, _cur.day)) return fail("bad date");
+        _curMask |= 1;
+        return true;
+    }
+    if (!parseTime(value, h, m)) return fail("bad time");
+    switch (key) {
+        case KEY_SEHRI: _cur.sehriHour = h; _cur.sehriMinute = m; _curMask |= 2; break;
+        case KEY_IFTAR: _cur.iftarHour = h; _cur.iftarMinute = m; _curMask |= 4; break;
+        case KEY_FAJR:  _prayers.fajrHour = h; _prayers.fajrMinute = m; _prayerMask |= 1; break;
+        case KEY_ZOHR:  _prayers.zohrHour = h; _prayers.zohrMinute = m; _prayerMask |= 2; break;
+        case KEY_ASR:   _prayers.asrHour = h; _prayers.asrMinute = m; _prayerMask |= 4; break;
+        case KEY_ISHA:  _prayers.ishaHour = h; _prayers.ishaMinute = m; _prayerMask |= 8; break;
+        default: break;
+    }
+    return true;
+}
+
+bool TimetableParser::emitEntry() {
+    if (_curMask != 7) return fail("day without date, sehri and iftar");
+    uint16_t key = timetableDateKey(_lastKey, _entries ? _first.month : _cur.month, _cur);
+    if (!key) return fail("days out of order or repeated");
+    if (_cur.sehriHour * 60 + _cur.sehriMinute >= _cur.iftarHour * 60 + _cur.iftarMinute) {
+        return fail("sehri not before iftar");
+    }
+    if (_fn && !_fn(_cur, _ctx)) return fail("too many days");
+    if (_entries == 0) _first = _cur;
+    _last = _cur;
+    _lastKey = key;
+    _entries++;
+    return true;
+}
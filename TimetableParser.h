@@ -0,0 +1,110 @@
+#ifndef TIMETABLE_PARSER_H
+#define TIMETABLE_PARSER_H
+
+#include <Arduino.h>
+#include "RamzanTimetable.h"
+
+// Reads an uploaded timetable as it arrives, a chunk at a time, without
+// ever holding the whole body. Two formats, told apart by the first
+// character:
+//
+//   JSON, as in timetable.txt: an object with "timetable" (array of
+//   {"date":"19 Feb","sehri":"05:42","iftar":"18:43"}), and optionally
+//   "prayer_fixed_times" ({"fajr","zuhr","asr","isha"}) and "location".
+//   Other keys are skipped, whatever they hold.
+//
+//   CSV: one day per line. A header line names the columns (date, sehri,
+//   iftar; others are ignored), otherwise they are date,sehri,iftar.
+//   Blank lines and lines starting with '#' are skipped.
+//
+// Dates are "19 Feb" / "01 March" or "2026-02-19"; times are "HH:MM".
+// Days must come in date order, each once. Every day is checked and handed
+// to the entry callback straight away; the first problem stops the parse
+// with a message and the line it was on.
+class TimetableParser {
+public:
+    typedef bool (*EntryFn)(const AlarmEntry& entry, void* ctx); // false = no room
+
+    void begin(EntryFn fn, void* ctx);
+    bool feed(const uint8_t* data, size_t len);  // false once there is an error
+    bool finish();                               // End of the body
+
+    bool hasError() { return _error != nullptr; }
+    const char* getError() { return _error ? _error : ""; }
+    uint32_t getErrorLine() { return _errorLine; }
+    uint16_t getEntries() { return _entries; }
+    const AlarmEntry& getFirst() { return _first; }
+    const AlarmEntry& getLast() { return _last; }
+    bool hasPrayerTimes() { return _prayerMask == 0x0F; }
+    const PrayerTimes& getPrayerTimes() { return _prayers; }
+    const char* getLocation() { return _location; }
+
+    static const uint8_t TOKEN_MAX = 48;
+    static const uint8_t CSV_LINE_MAX = 96;
+    static const uint8_t MAX_DEPTH = 8;
+    static const uint8_t LOCATION_MAX = 47;
+
+    static bool parseTime(const char* s, uint8_t& hour, uint8_t& minute);
+    static bool parseDate(const char* s, uint8_t& month, uint8_t& day);
+
+private:
+    enum Format : uint8_t { FORMAT_UNKNOWN, FORMAT_JSON, FORMAT_CSV };
+    enum Expect : uint8_t { EXPECT_VALUE, EXPECT_VALUE_OR_END, EXPECT_KEY, EXPECT_KEY_OR_END,
+                            EXPECT_COLON, EXPECT_COMMA_OR_END, EXPECT_NOTHING };
+    enum Lex : uint8_t { LEX_NONE, LEX_STRING, LEX_ESCAPE, LEX_UNICODE, LEX_LITERAL };
+    // Keys that matter; everything else is KEY_OTHER
+    enum Key : uint8_t { KEY_OTHER, KEY_LOCATION, KEY_PRAYERS, KEY_TIMETABLE,
+                         KEY_DATE, KEY_SEHRI, KEY_IFTAR, KEY_FAJR, KEY_ZOHR, KEY_ASR, KEY_ISHA };
+
+    bool fail(const char* why);
+    bool jsonChar(char c);
+    bool jsonToken(bool isString);
+    bool jsonOpen(char c);
+    bool jsonClose(char c);
+    void afterValue();
+    bool csvLine();
+    bool setField(Key key, const char* value);
+    bool emitEntry();
+    static Key keyOf(const char* s);
+
+    EntryFn _fn = nullptr;
+    void* _ctx = nullptr;
+    Format _format = FORMAT_UNKNOWN;
+    const char* _error = nullptr;
+    uint32_t _line = 1;
+    uint32_t _errorLine = 0;
+
+    // JSON
+    char _stack[MAX_DEPTH];
+    uint8_t _depth = 0;
+    Expect _expect = EXPECT_VALUE;
+    Lex _lex = LEX_NONE;
+    bool _isKey = false;
+    uint8_t _hexLeft = 0;
+    Key _topKey = KEY_OTHER;       // Key at depth 1
+    Key _fieldKey = KEY_OTHER;     // Key inside a day or the prayer times
+
+    char _tok[TOKEN_MAX + 1];
+    uint8_t _tokLen = 0;
+    bool _tokLong = false;
+
+    // CSV
+    char _csv[CSV_LINE_MAX + 1];
+    uint8_t _csvLen = 0;
+    bool _csvHeaderSeen = false;
+    int8_t _col[3] = { 0, 1, 2 };  // Column of date, sehri, iftar
+
+    // The day being read
+    AlarmEntry _cur;
+    uint8_t _curMask = 0;          // 1 = date, 2 = sehri, 4 = iftar
+
+    uint16_t _entries = 0;
+    AlarmEntry _first = {};
+    AlarmEntry _last = {};
+    uint16_t _lastKey = 0;         // timetableDateKey() of _last
+    PrayerTimes _prayers = defaultPrayerTimes;
+    uint8_t _prayerMask = 0;
+    char _location[LOCATION_MAX + 1] = "";
+};
+
+#endif
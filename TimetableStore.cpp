@@ -0,0 +1,209 @@
+#include "TimetableStore.h"
+#include "Log.h"
+#include <esp_task_wdt.h>
+
+static const uint32_t TTABLE_MAGIC = 0x42545452; // "RTTB"
+static const uint16_t TTABLE_VERSION = 1;
+
+static_assert(sizeof(TimetableStore::Header) == TimetableStore::HEADER_SIZE, "header must fill its 128 bytes");
+static_assert(sizeof(AlarmEntry) == 6, "entries are stored as raw 6-byte records");
+
+// The month index runs in table order: from the first month round to the one before it
+static uint8_t monthAt(uint8_t start, uint8_t rank) { return (start - 1 + rank) % 12 + 1; }
+static uint8_t rankOf(uint8_t start, uint8_t month) { return (month + 12 - start) % 12; }
+
+uint32_t TimetableStore::crc32(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (uint8_t b = 0; b < 8; b++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+void TimetableStore::init() {
+    _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "ttable");
+    if (!_part || _part->size < 2 * SLOT_SIZE) {
+        LOG_W("Timetable: no 'ttable' partition, uploads disabled");
+        _part = nullptr;
+        useBuiltIn();
+        return;
+    }
+
+    // Newest valid slot wins
+    Header h;
+    int8_t best = -1;
+    for (uint8_t s = 0; s < 2; s++) {
+        if (!readHeader(s, h)) continue;
+        if (best < 0 || h.generation > _header.generation) {
+            best = s;
+            _header = h;
+        }
+    }
+    if (best < 0) {
+        useBuiltIn();
+        LOG_I("Timetable: built-in, %u days", _count);
+        return;
+    }
+    _slot = best;
+    _count = _header.count;
+    _version++;
+    LOG_I("Timetable: uploaded #%lu, %u days (%s)", (unsigned long)_header.generation, _count, _header.location);
+}
+
+void TimetableStore::useBuiltIn() {
+    _slot = -1;
+    _header = {};
+    _header.count = _count = TIMETABLE_SIZE;
+    _header.prayers = defaultPrayerTimes;
+    strncpy(_header.location, "Built-in", sizeof(_header.location) - 1);
+    uint8_t start = ramzanTimetable[0].month;
+    uint8_t r = 0;
+    _header.monthFirst[0] = start;
+    for (uint16_t i = 0; i < _count; i++) {
+        uint8_t rank = rankOf(start, ramzanTimetable[i].month);
+        while (r <= rank) _header.monthFirst[monthAt(start, r++)] = i;
+    }
+    while (r < 12) _header.monthFirst[monthAt(start, r++)] = _count;
+    _version++;
+}
+
+bool TimetableStore::readHeader(uint8_t slot, Header& h) {
+    if (esp_partition_read(_part, slot * SLOT_SIZE, &h, sizeof(h)) != ESP_OK) return false;
+    if (h.magic != TTABLE_MAGIC || h.version != TTABLE_VERSION || h.count == 0 || h.count > MAX_ENTRIES ||
+        h.monthFirst[0] > 12) return false;
+    if (slotCrc(slot, h) != h.crc) return false;
+    h.location[sizeof(h.location) - 1] = '\0';
+    return true;
+}
+
+// Days first, then the header after its crc field: the order they are written in
+uint32_t TimetableStore::slotCrc(uint8_t slot, const Header& h) {
+    uint8_t buf[192];
+    uint32_t crc = 0;
+    uint32_t left = (uint32_t)h.count * sizeof(AlarmEntry);
+    uint32_t off = slot * SLOT_SIZE + HEADER_SIZE;
+    while (left) {
+        uint32_t n = left < sizeof(buf) ? left : sizeof(buf);
+        if (esp_partition_read(_part, off, buf, n) != ESP_OK) return ~h.crc;
+        crc = crc32(crc, buf, n);
+        off += n;
+        left -= n;
+    }
+    return crc32(crc, (const uint8_t*)&h + 8, HEADER_SIZE - 8);
+}
+
+bool TimetableStore::entry(uint16_t index, AlarmEntry& out) {
+    if (index >= _count) return false;
+    if (_slot < 0) {
+        out = ramzanTimetable[index];
+        return true;
+    }
+    return esp_partition_read(_part, _slot * SLOT_SIZE + HEADER_SIZE + index * sizeof(AlarmEntry),
+                              &out, sizeof(out)) == ESP_OK;
+}
+
+int TimetableStore::indexOf(uint8_t month, uint8_t day) {
+    AlarmEntry days[31];
+    uint16_t first;
+    uint8_t n = readMonth(month, days, &first);
+    for (uint8_t i = 0; i < n; i++) {
+        if (days[i].day == day) return first + i;
+    }
+    return -1;
+}
+
+// All the days of one month in a single read, thanks to the month index
+uint8_t TimetableStore::readMonth(uint8_t month, AlarmEntry* days, uint16_t* firstIndex) {
+    if (month < 1 || month > 12) return 0;
+    uint8_t start = _header.monthFirst[0] ? _header.monthFirst[0] : 1;
+    uint8_t next = month % 12 + 1;
+    uint16_t first = _header.monthFirst[month];
+    uint16_t end = next == start ? _count : _header.monthFirst[next];
+    if (end > _count || first >= end || end - first > 31) return 0;
+
+    if (_slot < 0) {
+        memcpy(days, &ramzanTimetable[first], (end - first) * sizeof(AlarmEntry));
+    } else if (esp_partition_read(_part, _slot * SLOT_SIZE + HEADER_SIZE + first * sizeof(AlarmEntry),
+                                  days, (end - first) * sizeof(AlarmEntry)) != ESP_OK) {
+        return 0;
+    }
+    if (firstIndex) *firstIndex = first;
+    // The index only covers well-formed tables; check rather than trust it
+    uint8_t n = 0;
+    while (n < end - first && days[n].month == month) n++;
+    return n;
+}
+
+bool TimetableStore::beginWrite() {
+    _writeSlot = -1;
+    if (!_part) return false;
+    int8_t slot = _slot == 0 ? 1 : 0;
+    esp_task_wdt_reset();
+    if (esp_partition_erase_range(_part, slot * SLOT_SIZE, SLOT_SIZE) != ESP_OK) return false;
+    _writing = {};
+    _writeCrc = 0;
+    _nextRank = 0;
+    _lastDate = 0;
+    _writeSlot = slot;
+    return true;
+}
+
+bool TimetableStore::add(const AlarmEntry& e) {
+    if (_writeSlot < 0 || _writing.count >= MAX_ENTRIES || e.month < 1 || e.month > 12) return false;
+    if (_writing.count == 0) _writing.monthFirst[0] = e.month;
+    uint8_t start = _writing.monthFirst[0];
+    uint16_t key = timetableDateKey(_lastDate, start, e);
+    if (!key) return false; // The month index needs date order
+    uint32_t at = _writeSlot * SLOT_SIZE + HEADER_SIZE + _writing.count * sizeof(AlarmEntry);
+    if (esp_partition_write(_part, at, &e, sizeof(e)) != ESP_OK) {
+        _writeSlot = -1;
+        return false;
+    }
+    _writeCrc = crc32(_writeCrc, &e, sizeof(e));
+    _lastDate = key;
+    uint8_t rank = rankOf(start, e.month);
+    while (_nextRank <= rank) _writing.monthFirst[monthAt(start, _nextRank++)] = _writing.count;
+    _writing.count++;
+    return true;
+}
+
+bool TimetableStore::commit(const PrayerTimes& prayers, const char* location) {
+    if (_writeSlot < 0 || _writing.count == 0) return false;
+    while (_nextRank < 12) _writing.monthFirst[monthAt(_writing.monthFirst[0], _nextRank++)] = _writing.count;
+    _writing.magic = TTABLE_MAGIC;
+    _writing.version = TTABLE_VERSION;
+    _writing.generation = (_slot < 0 ? 0 : _header.generation) + 1;
+    _writing.prayers = prayers;
+    strncpy(_writing.location, location, sizeof(_writing.location) - 1);
+    memset(_writing.reserved, 0xFF, sizeof(_writing.reserved));
+    _writing.crc = crc32(_writeCrc, (const uint8_t*)&_writing + 8, HEADER_SIZE - 8);
+
+    int8_t slot = _writeSlot;
+    _writeSlot = -1;
+    if (esp_partition_write(_part, slot * SLOT_SIZE, &_writing, sizeof(_writing)) != ESP_OK) return false;
+
+    // Read back what readers will see
+    Header h;
+    if (!readHeader(slot, h) || h.generation != _writing.generation) {
+        LOG_E("Timetable: slot %d did not verify after writing", slot);
+        return false;
+    }
+    _header = h;
+    _slot = slot;
+    _count = h.count;
+    _version++;
+    LOG_I("Timetable: swapped in #%lu, %u days (%s)", (unsigned long)h.generation, _count, h.location);
+    return true;
+}
+
+bool TimetableStore::reset() {
+    if (!_part) return false;
+    _writeSlot = -1;
+    esp_task_wdt_reset();
+    if (esp_partition_erase_range(_part, 0, 2 * SLOT_SIZE) != ESP_OK) return false;
+    useBuiltIn();
+    LOG_I("Timetable: back to the built-in table");
+    return true;
+}
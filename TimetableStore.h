@@ -0,0 +1,80 @@
+#ifndef TIMETABLE_STORE_H
+#define TIMETABLE_STORE_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "RamzanTimetable.h"
+
+// The active timetable, kept in the "ttable" flash partition and read from
+// there directly; only the 128-byte header is held in RAM. With nothing
+// valid in flash the compiled-in ramzanTimetable[] is used.
+//
+// Two slots of one sector each: a 128-byte header, then the days in date
+// order, 6 bytes each. The header has the first day of every month, so
+// finding a date reads at most one month of entries. A table may run from
+// December into January (timetableDateKey()); the index then starts at the
+// table's first month and wraps round to the month before it. A new table goes into
+// the slot that is not in use, header last, with a higher generation; the
+// swap is that one header write. A power cut before it leaves the old
+// table in charge, a torn header fails its CRC.
+class TimetableStore {
+public:
+    void init();
+
+    uint16_t count() { return _count; }
+    bool entry(uint16_t index, AlarmEntry& out);
+    int indexOf(uint8_t month, uint8_t day);          // -1 if the date is not in the table
+    uint8_t readMonth(uint8_t month, AlarmEntry* days, uint16_t* first = nullptr); // Up to 31 days, one read
+    const PrayerTimes& prayers() { return _header.prayers; }
+    const char* location() { return _header.location; }
+    bool isBuiltIn() { return _slot < 0; }
+    uint32_t getGeneration() { return _slot < 0 ? 0 : _header.generation; }
+    uint32_t getVersion() { return _version; }        // Bumped by every swap
+
+    // Writing a new table: begin, one add() per day in date order, then
+    // commit() to swap it in. Nothing changes until commit() succeeds.
+    bool beginWrite();
+    bool add(const AlarmEntry& e);
+    bool commit(const PrayerTimes& prayers, const char* location);
+    static bool addEntry(const AlarmEntry& e, void* store) { return ((TimetableStore*)store)->add(e); }
+
+    bool reset();                                      // Back to the compiled-in table
+
+    static const uint32_t SLOT_SIZE = 4096;
+    static const uint32_t HEADER_SIZE = 128;
+    static const uint16_t MAX_ENTRIES = (SLOT_SIZE - HEADER_SIZE) / sizeof(AlarmEntry);
+
+    struct Header {
+        uint32_t magic;
+        uint32_t crc;              // CRC-32 of the rest of the header and the days
+        uint32_t generation;
+        uint16_t version;
+        uint16_t count;
+        uint16_t monthFirst[13];   // Index of the first day in month m (1-12); [0] = month the table
+                                   // starts in (0 in older tables, read as January)
+        PrayerTimes prayers;
+        char location[48];
+        uint8_t reserved[HEADER_SIZE - 4 - 4 - 4 - 2 - 2 - 26 - sizeof(PrayerTimes) - 48];
+    } __attribute__((packed));
+
+private:
+    bool readHeader(uint8_t slot, Header& h);
+    uint32_t slotCrc(uint8_t slot, const Header& h);
+    static uint32_t crc32(uint32_t crc, const void* data, size_t len);
+    void useBuiltIn();
+
+    const esp_partition_t* _part = nullptr;
+    Header _header = {};
+    int8_t _slot = -1;             // -1 = compiled-in table
+    uint16_t _count = 0;
+    uint32_t _version = 0;
+
+    // Table being written
+    int8_t _writeSlot = -1;
+    Header _writing = {};
+    uint32_t _writeCrc = 0;
+    uint8_t _nextRank = 0;         // Next monthFirst[] still to fill in, in months from the first
+    uint16_t _lastDate = 0;        // timetableDateKey() of the last day added
+};
+
+#endif
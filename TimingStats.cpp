@@ -0,0 +1,169 @@
+#include "TimingStats.h"
+#include <sys/time.h>
+
+// More than this after the planned start and it was not this alarm ringing
+static const int32_t MAX_RELAY_LATE_US = 10000000;
+
+static const char* const EVENT_NAMES[] = { "?", "sehri", "iftar", "pre_sehri", "prayer", "sehri_end" };
+
+// --- Histogram ---
+
+uint8_t Histogram::bucketOf(uint32_t us) {
+    if (us < 16) return us;
+    uint8_t octave = 31 - __builtin_clz(us);           // 4..31
+    uint8_t sub = (us >> (octave - 2)) & 3;            // The two bits under the top one
+    return 16 + (octave - 4) * 4 + sub;
+}
+
+uint32_t Histogram::bucketTop(uint8_t bucket) {
+    if (bucket < 16) return bucket;
+    uint8_t octave = 4 + (bucket - 16) / 4;
+    uint8_t sub = (bucket - 16) % 4;
+    uint64_t low = (uint64_t)(4 + sub) << (octave - 2);
+    uint64_t top = low + ((uint64_t)1 << (octave - 2)) - 1;
+    return top > UINT32_MAX ? UINT32_MAX : (uint32_t)top;
+}
+
+void Histogram::add(uint32_t us) {
+    _counts[bucketOf(us)]++;
+    _count++;
+    if (us > _max) _max = us;
+}
+
+void Histogram::clear() {
+    memset(_counts, 0, sizeof(_counts));
+    _count = 0;
+    _max = 0;
+}
+
+uint32_t Histogram::percentile(uint8_t p) const {
+    if (_count == 0) return 0;
+    uint32_t rank = ((uint64_t)_count * p + 99) / 100; // Nearest rank
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < BUCKETS; b++) {
+        seen += _counts[b];
+        if (seen >= rank) {
+            uint32_t top = bucketTop(b);
+            return top < _max ? top : _max;
+        }
+    }
+    return _max;
+}
+
+void Histogram::writeJson(StrBuf& json, const char* key) const {
+    json.jsonKey(key).append('{');
+    json.json("count", _count);
+    json.json("p50Us", percentile(50));
+    json.json("p99Us", percentile(99));
+    json.json("maxUs", _max);
+    json.append('}');
+}
+
+// --- TimingStats ---
+
+TimingStats::Record* TimingStats::current() {
+    return _count ? &_records[(_head + RECORDS - 1) % RECORDS] : nullptr;
+}
+
+void TimingStats::onTrigger(int code) {
+    if (_waitingRelay) _missed++; // The last one never got to ring
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    struct tm t = {};
+    getLocalTime(&t, 0);
+
+    // Triggers only fire inside their own minute. The timezone offset is
+    // whole minutes, so the epoch's seconds are the local ones.
+    Record& r = _records[_head];
+    r = {};
+    r.code = code;
+    r.hour = t.tm_hour;
+    r.minute = t.tm_min;
+    r.triggerLateUs = (uint32_t)((tv.tv_sec % 60) * 1000000UL + tv.tv_usec);
+    r.relayLateUs = -1;
+    _head = (_head + 1) % RECORDS;
+    if (_count < RECORDS) _count++;
+
+    _triggerLate.add(r.triggerLateUs);
+    _triggerUs = _plannedUs = micros();
+    _waitingRelay = true;
+    _collecting = false;
+}
+
+void TimingStats::setPlannedStart(uint32_t startUs) {
+    Record* r = current();
+    if (!r || !_waitingRelay) return;
+    _plannedUs = startUs;
+    r->plannedWaitUs = startUs - _triggerUs;
+}
+
+void TimingStats::onRelayOn() {
+    if (!_waitingRelay) return;
+    _waitingRelay = false;
+    // Early counts as on time; the planned start is in whole micros
+    int32_t late = (int32_t)(micros() - _plannedUs);
+    if (late < 0) late = 0;
+    if (late > MAX_RELAY_LATE_US) {
+        _missed++; // The alarm was refused; this is some later manual ring
+        return;
+    }
+    current()->relayLateUs = late;
+    _relayLate.add(late);
+    _collecting = true;
+}
+
+void TimingStats::onRingStop() {
+    _collecting = false;
+}
+
+void TimingStats::onSegment(uint32_t configuredMs, uint32_t actualUs) {
+    int32_t err = (int32_t)(actualUs - configuredMs * 1000UL);
+    _segmentError.add(err < 0 ? -err : err);
+    _segmentSum += err;
+
+    Record* r = current();
+    if (r && _collecting) {
+        if (r->segments < UINT16_MAX) r->segments++;
+        if ((err < 0 ? -err : err) > (r->worstSegmentUs < 0 ? -r->worstSegmentUs : r->worstSegmentUs)) {
+            r->worstSegmentUs = err;
+        }
+    }
+}
+
+void TimingStats::reset() {
+    _triggerLate.clear();
+    _relayLate.clear();
+    _segmentError.clear();
+    _head = _count = 0;
+    _waitingRelay = false;
+    _collecting = false;
+    _missed = 0;
+    _segmentSum = 0;
+}
+
+void TimingStats::writeJson(StrBuf& json) {
+    json.append('{');
+    _triggerLate.writeJson(json, "triggerLate");
+    _relayLate.writeJson(json, "relayLate");
+    _segmentError.writeJson(json, "segmentError");
+    json.json("segmentBiasUs", (long)(_segmentError.count() ? _segmentSum / _segmentError.count() : 0));
+    json.json("missed", _missed);
+
+    // Newest first
+    json.jsonKey("recent").append('[');
+    for (uint8_t i = 0; i < _count; i++) {
+        const Record& r = _records[(_head + RECORDS - 1 - i) % RECORDS];
+        json.append(i ? ",{" : "{");
+        json.json("event", EVENT_NAMES[r.code < 6 ? r.code : 0]);
+        json.appendf(",\"scheduled\":\"%02u:%02u\"", r.hour, r.minute);
+        json.json("triggerLateUs", r.triggerLateUs);
+        json.json("plannedWaitUs", r.plannedWaitUs);
+        json.json("relayLateUs", r.relayLateUs);
+        json.json("segments", r.segments);
+        json.json("worstSegmentUs", r.worstSegmentUs);
+        json.append('}');
+    }
+    json.append("]}");
+}
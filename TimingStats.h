@@ -0,0 +1,83 @@
+#ifndef TIMING_STATS_H
+#define TIMING_STATS_H
+
+#include <Arduino.h>
+#include "FixedString.h"
+
+// Log-scale histogram of microsecond values: exact below 16 us, then four
+// buckets per power of two, so percentiles are within 25% at any scale.
+// 512 bytes, no allocation.
+class Histogram {
+public:
+    void add(uint32_t us);
+    void clear();
+    uint32_t count() const { return _count; }
+    uint32_t max() const { return _max; }
+    uint32_t percentile(uint8_t p) const; // Upper edge of the bucket, capped at max()
+    void writeJson(StrBuf& json, const char* key) const;
+
+    static const uint8_t BUCKETS = 128;
+
+private:
+    static uint8_t bucketOf(uint32_t us);
+    static uint32_t bucketTop(uint8_t bucket);
+
+    uint32_t _counts[BUCKETS] = {};
+    uint32_t _count = 0;
+    uint32_t _max = 0;
+};
+
+// How punctual the alarms are, for /api/timing. For every automatic alarm:
+//   scheduled  the alarm's minute on the wall clock
+//   trigger    when the scheduler noticed it (the 250 ms poll, a busy loop)
+//   relay on   when the first relay switched, measured from the planned
+//              start: the trigger itself, or the group start (UnitSync)
+// and for every buzzer segment, how long it really lasted against its
+// configured length. Manual rings (console, test) only add segments.
+class TimingStats {
+public:
+    void onTrigger(int code);                // AlarmScheduler code just returned
+    void setPlannedStart(uint32_t startUs);  // micros() it will start at, when not at once
+    void onRelayOn();                        // A buzzer pattern started
+    void onRingStop();                       // Segments after this are not the alarm's
+    void onSegment(uint32_t configuredMs, uint32_t actualUs);
+
+    const Histogram& getTriggerLate() const { return _triggerLate; }
+    const Histogram& getRelayLate() const { return _relayLate; }
+    const Histogram& getSegmentError() const { return _segmentError; }
+    uint32_t getMissed() { return _missed; }
+
+    void reset();
+    void writeJson(StrBuf& json);
+
+    static const uint8_t RECORDS = 16;
+
+private:
+    struct Record {
+        uint8_t code;
+        uint8_t hour, minute;      // Scheduled
+        uint32_t triggerLateUs;    // Trigger - scheduled minute
+        uint32_t plannedWaitUs;    // Trigger to planned start (group start)
+        int32_t relayLateUs;       // Relay on - planned start, -1 = never rang
+        uint16_t segments;
+        int32_t worstSegmentUs;    // Actual - configured, largest either way
+    };
+
+    Record* current();
+
+    Histogram _triggerLate;
+    Histogram _relayLate;
+    Histogram _segmentError;       // |actual - configured|
+
+    Record _records[RECORDS] = {};
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+    bool _waitingRelay = false;    // Newest record has no relay edge yet
+    bool _collecting = false;      // Newest record is ringing, segments count towards it
+    uint32_t _triggerUs = 0;       // micros() of the newest trigger
+    uint32_t _plannedUs = 0;
+    uint32_t _missed = 0;          // Triggers that never rang
+    int64_t _segmentSum = 0;       // Signed, for the average bias
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "TransitionManager.h"
+#include "DisplayManager.h"
+
+extern DisplayManager displayManager;
+
+bool TransitionManager::show(const char* l1, const char* l2, unsigned long holdMs, Action then) {
+    return push(l1, l2, holdMs, then);
+}
+
+bool TransitionManager::after(unsigned long delayMs, Action then) {
+    return push(nullptr, nullptr, delayMs, then);
+}
+
+bool TransitionManager::push(const char* l1, const char* l2, unsigned long holdMs, Action then) {
+    if (_count >= MAX_STEPS) return false;
+
+    Step& s = _steps[(_head + _count) % MAX_STEPS];
+    s.hasMessage = (l1 != nullptr);
+    if (s.hasMessage) {
+        strncpy(s.line1, l1, LCD_COLS); s.line1[LCD_COLS] = '\0';
+        strncpy(s.line2, l2 ? l2 : "", LCD_COLS); s.line2[LCD_COLS] = '\0';
+    }
+    s.holdMs = holdMs;
+    s.then = then;
+    _count++;
+
+    // Show the first message right away rather than on the next update()
+    if (_count == 1) begin();
+    return true;
+}
+
+void TransitionManager::begin() {
+    Step& s = _steps[_head];
+    if (s.hasMessage) displayManager.setOverrideMessage(s.line1, s.line2, s.holdMs);
+    _stepStart = millis();
+    _started = true;
+}
+
+void TransitionManager::cancel() {
+    _count = 0;
+    _started = false;
+}
+
+void TransitionManager::update() {
+    while (_count > 0) {
+        if (!_started) begin();
+
+        Step& s = _steps[_head];
+        if (millis() - _stepStart < s.holdMs) return;
+
+        Action then = s.then;
+        _head = (_head + 1) % MAX_STEPS;
+        _count--;
+        _started = false;
+        if (then) then(); // May queue further steps
+    }
+}
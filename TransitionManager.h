@@ -0,0 +1,47 @@
+#ifndef TRANSITION_MANAGER_H
+#define TRANSITION_MANAGER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Timed UI transitions without delay(): "show this for N ms, then carry on".
+// Steps run one after another. While a step's message is up the carousel
+// is held off (via the display override), but loop() keeps running, so
+// buzzers keep stepping and alarms keep being checked.
+class TransitionManager {
+public:
+    typedef void (*Action)();
+
+    // Shows l1/l2 for holdMs, then calls `then` (may be null)
+    bool show(const char* l1, const char* l2, unsigned long holdMs, Action then = nullptr);
+
+    // Calls `then` once delayMs has passed (after any queued steps)
+    bool after(unsigned long delayMs, Action then);
+
+    // Drops all queued steps without running their actions
+    void cancel();
+
+    void update();
+    bool isPending() { return _count > 0; }
+
+private:
+    struct Step {
+        char line1[LCD_COLS + 1];
+        char line2[LCD_COLS + 1];
+        bool hasMessage;
+        unsigned long holdMs;
+        Action then;
+    };
+
+    bool push(const char* l1, const char* l2, unsigned long holdMs, Action then);
+    void begin();
+
+    static const uint8_t MAX_STEPS = 4;
+    Step _steps[MAX_STEPS];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+    bool _started = false;
+    unsigned long _stepStart = 0;
+};
+
+#endif
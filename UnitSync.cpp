@@ -0,0 +1,352 @@
+#include "UnitSync.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "NetworkManager.h"
+#include "Log.h"
+
+extern RamzanNetworkManager networkManager;
+
+static const uint32_t SYNC_MAGIC = 0x4E595352; // "RSYN"
+static const uint8_t SYNC_VERSION = 1;
+enum : uint8_t { SYNC_BEACON = 1, SYNC_REQ, SYNC_RESP };
+static const uint8_t SYNC_FLAG_CLOCK_SET = 0x01;
+
+// Filled by the receiver task, emptied by update() on the loop task
+static const uint8_t RX_QUEUE = 8;
+static UnitSync::Received s_rxQueue[RX_QUEUE];
+static uint8_t s_rxHead = 0;
+static uint8_t s_rxCount = 0;
+static uint32_t s_rxDropped = 0;
+static portMUX_TYPE s_rxLock = portMUX_INITIALIZER_UNLOCKED;
+
+int64_t UnitSync::epochMicros() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+void UnitSync::init() {
+    // Id from the low four bytes of the MAC: unique, and stable across boots
+    // so the same unit stays leader
+    String mac = WiFi.macAddress();
+    for (unsigned i = 0; i < mac.length(); i++) {
+        char c = mac[i];
+        int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'A' && c <= 'F') ? c - 'A' + 10 :
+                (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+        if (v >= 0) _id = (_id << 4) | v;
+    }
+
+    if (xTaskCreatePinnedToCore(rxTask, "sync", 3072, this, 5, &_rxTask, 0) != pdPASS) {
+        _rxTask = nullptr;
+    }
+    LOG_I("Sync: unit %08lx, %s", (unsigned long)_id, _enabled ? "enabled" : "disabled");
+}
+
+void UnitSync::setEnabled(bool enabled) {
+    _enabled = enabled;
+    if (!enabled) {
+        closeSocket();
+        _peerCount = 0;
+        _leaderId = 0;
+        _sampleCount = 0;
+        _offsetUs = 0;
+    }
+}
+
+bool UnitSync::openSocket() {
+    _lastOpenMs = millis();
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) return false;
+
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SYNC_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    IPAddress ip = WiFi.localIP();
+    struct ip_mreq mreq = {};
+    inet_pton(AF_INET, SYNC_GROUP, &mreq.imr_multiaddr);
+    mreq.imr_interface.s_addr = htonl((uint32_t)ip[0] << 24 | (uint32_t)ip[1] << 16 | (uint32_t)ip[2] << 8 | ip[3]);
+    uint8_t ttl = 1;    // This subnet only
+    uint8_t loop = 1;   // Several units on one host (the simulation)
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &mreq.imr_interface, sizeof(mreq.imr_interface)) < 0) {
+        LOG_W("Sync: cannot join %s:%d", SYNC_GROUP, SYNC_PORT);
+        close(sock);
+        return false;
+    }
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    _sock = sock;
+    return true;
+}
+
+void UnitSync::closeSocket() {
+    if (_sock < 0) return;
+    int sock = _sock;
+    _sock = -1; // The receiver task stops using it first
+    close(sock);
+}
+
+// Blocks in recv() so the arrival time is taken the moment the packet is
+// handed over, not whenever the loop gets round to it
+void UnitSync::rxTask(void* arg) {
+    UnitSync* self = (UnitSync*)arg;
+    Received rx;
+    for (;;) {
+        int sock = self->_sock;
+        if (sock < 0) {
+            vTaskDelay(pdMS_TO_TICKS(200));
+            continue;
+        }
+        int n = recv(sock, &rx.packet, sizeof(rx.packet), 0);
+        rx.rxUs = epochMicros();
+        if (n != sizeof(rx.packet)) {
+            if (n < 0) vTaskDelay(pdMS_TO_TICKS(50)); // Socket closed under us
+            continue;
+        }
+        portENTER_CRITICAL(&s_rxLock);
+        if (s_rxCount < RX_QUEUE) {
+            s_rxQueue[(s_rxHead + s_rxCount) % RX_QUEUE] = rx;
+            s_rxCount++;
+        } else {
+            s_rxDropped++;
+        }
+        portEXIT_CRITICAL(&s_rxLock);
+    }
+}
+
+bool UnitSync::receive(Received& rx) {
+    if (_rxTask) {
+        portENTER_CRITICAL(&s_rxLock);
+        bool got = s_rxCount > 0;
+        if (got) {
+            rx = s_rxQueue[s_rxHead];
+            s_rxHead = (s_rxHead + 1) % RX_QUEUE;
+            s_rxCount--;
+        }
+        portEXIT_CRITICAL(&s_rxLock);
+        return got;
+    }
+    // Polled: the timestamp is only as good as the poll period
+    for (;;) {
+        int n = recv(_sock, &rx.packet, sizeof(rx.packet), MSG_DONTWAIT);
+        if (n < 0) return false;
+        rx.rxUs = epochMicros();
+        if (n == sizeof(rx.packet)) return true;
+    }
+}
+
+void UnitSync::send(Packet& p) {
+    p.magic = SYNC_MAGIC;
+    p.version = SYNC_VERSION;
+    p.flags = networkManager.isTimeSynced() ? SYNC_FLAG_CLOCK_SET : 0;
+    p.from = _id;
+    struct sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(SYNC_PORT);
+    inet_pton(AF_INET, SYNC_GROUP, &to.sin_addr);
+    if (p.type == SYNC_RESP) p.t3 = epochMicros(); // As late as possible
+    sendto(_sock, &p, sizeof(p), 0, (struct sockaddr*)&to, sizeof(to));
+}
+
+void UnitSync::update() {
+    if (!_enabled) return;
+    if (WiFi.status() != WL_CONNECTED) {
+        closeSocket();
+        return;
+    }
+    if (_sock < 0) {
+        if (_lastOpenMs && millis() - _lastOpenMs < 10000) return;
+        if (!openSocket()) return;
+    }
+
+    Received rx;
+    for (uint8_t n = 0; n < RX_QUEUE && receive(rx); n++) handle(rx);
+    electLeader();
+
+    uint32_t now = millis();
+    if (now - _lastBeaconMs >= SYNC_BEACON_MS) {
+        _lastBeaconMs = now;
+        Packet p = {};
+        p.type = SYNC_BEACON;
+        p.to = _leaderId;
+        p.seq = ++_seq;
+        p.offsetUs = _offsetUs;
+        p.delayUs = _delayUs;
+        send(p);
+    }
+    if (_leaderId && !isLeader() && now - _lastReqMs >= SYNC_POLL_MS) {
+        _lastReqMs = now;
+        Packet p = {};
+        p.type = SYNC_REQ;
+        p.to = _leaderId;
+        p.seq = _reqSeq = ++_seq;
+        p.t1 = _reqT1 = epochMicros();
+        send(p);
+    }
+}
+
+void UnitSync::handle(const Received& rx) {
+    const Packet& p = rx.packet;
+    if (p.magic != SYNC_MAGIC || p.version != SYNC_VERSION || p.from == _id) return;
+
+    Peer* peer = nullptr;
+    for (uint8_t i = 0; i < _peerCount; i++) {
+        if (_peers[i].id == p.from) peer = &_peers[i];
+    }
+    if (!peer && _peerCount < MAX_PEERS) {
+        peer = &_peers[_peerCount++];
+        *peer = {};
+        peer->id = p.from;
+        LOG_I("Sync: peer %08lx joined", (unsigned long)p.from);
+    }
+    if (peer) {
+        peer->lastHeardMs = millis();
+        peer->synced = p.flags & SYNC_FLAG_CLOCK_SET;
+        if (p.type == SYNC_BEACON) {
+            peer->leaderId = p.to;
+            peer->offsetUs = p.offsetUs;
+            peer->delayUs = p.delayUs;
+        }
+    }
+
+    if (p.type == SYNC_REQ && p.to == _id && isLeader()) {
+        Packet r = {};
+        r.type = SYNC_RESP;
+        r.to = p.from;
+        r.seq = p.seq;
+        r.t1 = p.t1;
+        r.t2 = rx.rxUs;
+        send(r);
+    } else if (p.type == SYNC_RESP && p.to == _id && p.from == _leaderId && p.seq == _reqSeq && p.t1 == _reqT1) {
+        // Classic NTP: offset = ((t2 - t1) + (t3 - t4)) / 2, minus the leader's own turnaround
+        int64_t t4 = rx.rxUs;
+        int64_t offset = ((p.t2 - p.t1) + (p.t3 - t4)) / 2;
+        int64_t delay = (t4 - p.t1) - (p.t3 - p.t2);
+        _reqSeq = 0;
+        if (delay >= 0 && delay < 1000000 && offset > INT32_MIN && offset < INT32_MAX) {
+            addSample((int32_t)offset, (uint32_t)delay);
+        }
+    }
+}
+
+// Lowest id among the units with a set clock, ourselves included
+void UnitSync::electLeader() {
+    uint32_t now = millis();
+    uint32_t leader = networkManager.isTimeSynced() ? _id : 0;
+    for (uint8_t i = 0; i < _peerCount;) {
+        Peer& p = _peers[i];
+        if (now - p.lastHeardMs > SYNC_PEER_TIMEOUT_MS) {
+            LOG_I("Sync: peer %08lx gone", (unsigned long)p.id);
+            _peers[i] = _peers[--_peerCount];
+            continue;
+        }
+        if (p.synced && (leader == 0 || p.id < leader)) leader = p.id;
+        i++;
+    }
+
+    if (leader != _leaderId) {
+        if (leader) LOG_I("Sync: leader is %08lx%s", (unsigned long)leader, leader == _id ? " (us)" : "");
+        _leaderId = leader;
+        _sampleCount = 0;
+        _sampleNext = 0;
+        _offsetUs = 0;
+        _delayUs = 0;
+        _reqSeq = 0;
+    }
+}
+
+void UnitSync::addSample(int32_t offsetUs, uint32_t delayUs) {
+    _samples[_sampleNext] = { offsetUs, delayUs };
+    _sampleNext = (_sampleNext + 1) % SYNC_SAMPLES;
+    if (_sampleCount < SYNC_SAMPLES) _sampleCount++;
+    _exchanges++;
+
+    // The shortest round trip had the least queuing in it
+    const Sample* best = &_samples[0];
+    for (uint8_t i = 1; i < _sampleCount; i++) {
+        if (_samples[i].delayUs < best->delayUs) best = &_samples[i];
+    }
+    _offsetUs = best->offsetUs;
+    _delayUs = best->delayUs;
+}
+
+bool UnitSync::isGrouped() {
+    if (!_enabled || _sock < 0 || !_leaderId) return false;
+    return isLeader() ? _peerCount > 0 : _sampleCount > 0;
+}
+
+bool UnitSync::scheduleStart(int code) {
+    if (!isGrouped()) return false;
+
+    // Every unit triggers within the alarm's minute, so flooring our own
+    // clock gives the same epoch everywhere; the margin covers clock error
+    // and the trigger poll
+    int64_t now = epochMicros();
+    int64_t minute = now - now % 60000000LL;
+    int64_t wait = minute + SYNC_START_MARGIN_MS * 1000LL - _offsetUs - now;
+    if (wait <= 0 || wait > (SYNC_START_MARGIN_MS + 60000) * 1000LL) {
+        LOG_W("Sync: alarm %d triggered %ld ms too late to start in step", code, (long)(-wait / 1000));
+        _lastStartLateUs = wait < 0 ? (int32_t)(-wait > INT32_MAX ? INT32_MAX : -wait) : 0;
+        return false;
+    }
+    _pendingCode = code;
+    _startUs = micros() + (uint32_t)wait;
+    LOG_I("Sync: alarm %d starts in %ld ms (leader %08lx, offset %ld us)", code, (long)(wait / 1000),
+          (unsigned long)_leaderId, (long)_offsetUs);
+    return true;
+}
+
+bool UnitSync::isStartDue() {
+    return _pendingCode != 0 && (int32_t)(micros() - _startUs) >= 0;
+}
+
+uint32_t UnitSync::getMsToStart() {
+    if (!_pendingCode) return UINT32_MAX;
+    int32_t us = (int32_t)(_startUs - micros());
+    return us > 0 ? us / 1000 : 0;
+}
+
+int UnitSync::takeDueStart() {
+    if (!isStartDue()) return 0;
+    _lastStartLateUs = (int32_t)(micros() - _startUs);
+    int code = _pendingCode;
+    _pendingCode = 0;
+    return code;
+}
+
+void UnitSync::writeJson(StrBuf& json) {
+    json.append('{');
+    json.json("enabled", _enabled);
+    json.appendf(",\"id\":\"%08lx\",\"leader\":\"%08lx\"", (unsigned long)_id, (unsigned long)_leaderId);
+    json.json("isLeader", _leaderId != 0 && isLeader());
+    json.json("grouped", isGrouped());
+    json.json("offsetUs", _offsetUs);
+    json.json("delayUs", _delayUs);
+    json.json("samples", _sampleCount);
+    json.json("exchanges", _exchanges);
+    json.json("rxTask", _rxTask != nullptr);
+    json.json("rxDropped", s_rxDropped);
+    json.json("marginMs", SYNC_START_MARGIN_MS);
+    json.json("pendingAlarm", _pendingCode);
+    json.json("lastStartLateUs", _lastStartLateUs);
+    json.jsonKey("peers").append('[');
+    for (uint8_t i = 0; i < _peerCount; i++) {
+        const Peer& p = _peers[i];
+        json.append(i ? ",{" : "{");
+        json.appendf("\"id\":\"%08lx\",\"leader\":\"%08lx\"", (unsigned long)p.id, (unsigned long)p.leaderId);
+        json.json("clockSet", p.synced);
+        json.json("offsetUs", p.offsetUs);
+        json.json("delayUs", p.delayUs);
+        json.json("heardMsAgo", millis() - p.lastHeardMs);
+        json.append('}');
+    }
+    json.append("]}");
+}
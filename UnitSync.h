@@ -0,0 +1,128 @@
+#ifndef UNIT_SYNC_H
+#define UNIT_SYNC_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "FixedString.h"
+
+// Rings several units at the same instant. Units on one LAN talk over UDP
+// multicast (SYNC_GROUP:SYNC_PORT):
+//   - every unit beacons its id, whether its clock is set, and its current
+//     offset estimate; the lowest id with a set clock is the time leader
+//   - followers measure their offset to the leader NTP-style (t1..t4) once
+//     a second and keep the exchange with the shortest round trip out of
+//     the last SYNC_SAMPLES, which is the one least hurt by queuing
+//
+// An automatic alarm no longer starts the moment a unit notices it. Every
+// unit derives the same epoch from the timetable (the alarm's minute) and
+// starts at that epoch + SYNC_START_MARGIN_MS on the leader's clock. A unit
+// with nobody to sync with rings as soon as it triggers, as before.
+//
+// Packets are timestamped by a receiver task the moment they arrive, so
+// how late the loop gets to them does not matter. Without that task (host
+// build) the socket is polled.
+class UnitSync {
+public:
+    void init();
+    void update();                   // Beacons, exchanges, incoming packets
+
+    // Automatic alarm `code` (AlarmScheduler) just triggered in the current
+    // minute. Returns false if it should start right away.
+    bool scheduleStart(int code);
+    bool hasPendingStart() { return _pendingCode != 0; }
+    bool isStartDue();
+    uint32_t getMsToStart();         // UINT32_MAX = nothing pending
+    int takeDueStart();              // Alarm code whose start time has come, else 0
+    uint32_t getStartMicros() { return _startUs; }
+
+    void setEnabled(bool enabled);   // Off = not in the group, alarms start at once
+    bool isEnabled() { return _enabled; }
+    bool hasRxTask() { return _rxTask != nullptr; }
+    bool isGrouped();                // Someone to ring in step with
+    bool isLeader() { return _leaderId == _id; }
+    uint32_t getId() { return _id; }
+    uint32_t getLeaderId() { return _leaderId; }
+    int32_t getOffsetUs() { return _offsetUs; }   // Leader clock - ours
+    uint32_t getDelayUs() { return _delayUs; }    // Round trip of that estimate
+    int32_t getLastStartLateUs() { return _lastStartLateUs; }
+
+    void writeJson(StrBuf& json);
+
+    static const uint8_t MAX_PEERS = 8;
+
+    struct Packet {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t type;
+        uint8_t flags;
+        uint8_t reserved;
+        uint32_t from;
+        uint32_t to;       // REQ/RESP: the other side; BEACON: the leader it follows
+        uint32_t seq;
+        int32_t offsetUs;  // BEACON: sender's offset to its leader
+        uint32_t delayUs;
+        int64_t t1;        // Epoch microseconds
+        int64_t t2;
+        int64_t t3;
+    } __attribute__((packed));
+
+    struct Received {
+        Packet packet;
+        int64_t rxUs;      // Local epoch microseconds at arrival
+    };
+
+private:
+    struct Peer {
+        uint32_t id;
+        uint32_t lastHeardMs;
+        bool synced;
+        uint32_t leaderId;
+        int32_t offsetUs;
+        uint32_t delayUs;
+    };
+
+    struct Sample {
+        int32_t offsetUs;
+        uint32_t delayUs;
+    };
+
+    static void rxTask(void* arg);
+    static int64_t epochMicros();
+
+    bool openSocket();
+    void closeSocket();
+    bool receive(Received& rx);
+    void handle(const Received& rx);
+    void send(Packet& p);
+    void electLeader();
+    void addSample(int32_t offsetUs, uint32_t delayUs);
+
+    bool _enabled = SYNC_ENABLED;
+    int _sock = -1;
+    TaskHandle_t _rxTask = nullptr;
+    uint32_t _id = 0;
+
+    Peer _peers[MAX_PEERS] = {};
+    uint8_t _peerCount = 0;
+    uint32_t _leaderId = 0;
+
+    Sample _samples[SYNC_SAMPLES] = {};
+    uint8_t _sampleCount = 0;
+    uint8_t _sampleNext = 0;
+    int32_t _offsetUs = 0;
+    uint32_t _delayUs = 0;
+
+    uint32_t _seq = 0;
+    uint32_t _reqSeq = 0;
+    int64_t _reqT1 = 0;
+    uint32_t _lastBeaconMs = 0;
+    uint32_t _lastReqMs = 0;
+    uint32_t _lastOpenMs = 0;
+
+    int _pendingCode = 0;
+    uint32_t _startUs = 0;           // micros() at which it starts
+    int32_t _lastStartLateUs = 0;
+    uint32_t _exchanges = 0;
+};
+
+#endif
@@ -7,14 +7,27 @@
 #include "AlarmScheduler.h"
 #include "BuzzerEngine.h"
 #include "SystemState.h"
+#include "StateMachine.h"
 #include "DisplayManager.h"
 
 // External references
 extern RamzanNetworkManager networkManager;
 extern AlarmScheduler alarmScheduler;
-extern SystemState currentState;
+extern StateMachine stateMachine;
 extern DisplayManager displayManager; // Added DisplayManager
 #include "ButtonEngine.h"
+#include "ScreenRegistry.h"
+#include "TaskScheduler.h"
+#include "TransitionManager.h"
+#include "PowerManager.h"
+#include "EventLog.h"
+#include "HeapStats.h"
+#include "StallMonitor.h"
+#include "Log.h"
+#include "UnitSync.h"
+#include "TimingStats.h"
+#include "TimetableStore.h"
+#include "OtaManager.h"
 extern BuzzerEngine buzzerA;
 extern BuzzerEngine buzzerB;
 extern ButtonEngine btnHouseA;
@@ -24,11 +37,26 @@ extern void startTestMode();
 extern void updatePrayerPattern(int count, int dur, int gap); 
 extern void updateSehriPattern(int dur, int interval); 
 extern Preferences prefs; 
+extern ScreenRegistry screenRegistry;
+extern TaskScheduler taskScheduler;
+extern TransitionManager transitionManager;
+extern PowerManager powerManager;
+extern EventLog eventLog;
+extern HeapStats heapStats;
+extern StallMonitor stallMonitor;
+extern UnitSync unitSync;
+extern TimingStats timingStats;
+extern TimetableStore timetable;
+extern OtaManager otaManager;
+
+// Restart from the loop once the HTTP reply has gone out, instead of
+// blocking in delay() inside the handler
+static void restartDevice() { ESP.restart(); }
 
 WebServerManager::WebServerManager() : server(80) {}
 
 void WebServerManager::init() {
-    Serial.println("DEBUG: Init WebServer...");
+    LOG_D("WEB: Init WebServer...");
     
     // --- Define Routes ---
     
@@ -38,6 +66,30 @@ void WebServerManager::init() {
     // New Feature APIs
     server.on("/api/display", [this](){ handleDisplayJson(); });
     server.on("/api/message", [this](){ handleMessage(); });
+    server.on("/api/tasks", [this](){ handleTasks(); });
+    server.on("/api/state", [this](){ handleState(); });
+    server.on("/api/power", [this](){ handlePower(); });
+    server.on("/api/events", [this](){ handleEvents(); });
+    server.on("/api/heap", [this](){ handleHeap(); });
+    server.on("/api/diag", [this](){ handleDiag(); });
+    server.on("/api/log", [this](){ handleLog(); });
+    server.on("/api/sync", [this](){ handleSync(); });
+    server.on("/api/timing", [this](){ handleTiming(); });
+    server.on("/api/schedule", [this](){ handleSchedule(); });
+
+    // Timetable: GET downloads the active one, POST (multipart file) checks
+    // and swaps in a new one, /validate only checks, /reset goes back to the
+    // built-in table
+    server.on("/api/timetable", HTTP_GET, [this](){ handleTimetable(); });
+    server.on("/api/timetable", HTTP_POST, [this](){ handleTimetableDone(true); },
+              [this](){ handleTimetableUpload(true); });
+    server.on("/api/timetable/validate", HTTP_POST, [this](){ handleTimetableDone(false); },
+              [this](){ handleTimetableUpload(false); });
+    server.on("/api/timetable/reset", HTTP_POST, [this](){
+        bool ok = timetable.reset();
+        if (ok) eventLog.append(EVENT_SETTINGS);
+        server.send(ok ? 200 : 500, "text/plain", ok ? "Built-in timetable restored" : "No timetable partition");
+    });
 
     // Settings
     server.on("/settings", [this](){ handleSettings(); });
@@ -50,17 +102,23 @@ void WebServerManager::init() {
     // 2. POST /update -> Process File Upload
     server.on("/update", HTTP_POST, [this](){
         // When upload finishes
-        if (Update.hasError()) {
-            server.send(200, "text/plain", "Update Failed. Restarting...");
+        if (_otaRefused) {
+            // 403 until the signing key is set, 409 until the alarm or failed update is over
+            server.send(_otaRefusedCode, "text/plain", _otaRefused);
+        } else if (!_otaOk) {
+            _response.clear();
+            _response.appendf("Update Failed: %s", otaManager.getError());
+            // 409: a delta for another image; send the full one instead
+            server.send_P(otaManager.wantsFullImage() ? 409 : 400, "text/plain", _response.c_str(), _response.length());
         } else {
             server.send(200, "text/plain", "Update Success! Rebooting...");
-            delay(1000);
-            ESP.restart();
+            transitionManager.after(1000, restartDevice);
         }
     }, [this](){
         // During upload
         handleUpdateUpload();
     });
+    server.on("/api/ota", [this](){ handleOta(); });
 
     server.on("/trigger-test", [this](){
         handleTest();
@@ -68,8 +126,7 @@ void WebServerManager::init() {
 
     server.on("/api/reboot", [this](){
         server.send(200, "text/plain", "Rebooting...");
-        delay(500);
-        ESP.restart();
+        transitionManager.after(500, restartDevice);
     });
 
     server.onNotFound([this](){
@@ -77,11 +134,11 @@ void WebServerManager::init() {
     });
 
     server.begin();
-    Serial.println("WebServer Started on Port 80");
+    LOG_I("WebServer Started on Port 80");
 }
 
 void WebServerManager::handleTest() {
-    Serial.println("WEB: Triggering Test Mode");
+    LOG_I("WEB: Triggering Test Mode");
     startTestMode();
     server.send(200, "text/plain", "Test Triggered");
 }
@@ -90,8 +147,19 @@ void WebServerManager::handleClient() {
     server.handleClient();
 }
 
+// Sends _response without copying it into a String
+void WebServerManager::sendResponse(const char* contentType) {
+    if (_response.truncated()) {
+        LOG_W("WEB: %s response cut at %u bytes", server.uri().c_str(), (unsigned)_response.capacity());
+        server.send(500, "text/plain", "Response too large");
+        return;
+    }
+    server.send_P(200, contentType, _response.c_str(), _response.length());
+}
+
 void WebServerManager::handleRoot() {
-    String html = R"rawliteral(
+    // Constant page, sent straight from flash (no copy in RAM)
+    static const char html[] PROGMEM = R"rawliteral(
 <!DOCTYPE html>
 <html lang="en">
 <head>
@@ -470,68 +538,408 @@ void WebServerManager::handleRoot() {
 </body>
 </html>
 )rawliteral";
-    server.send(200, "text/html", html);
+    server.send_P(200, "text/html", html);
 }
 
 void WebServerManager::handleDisplayJson() {
-    String json = "{";
-    json += "\"l1\":\"" + displayManager.getCurrentLine1() + "\",";
-    json += "\"l2\":\"" + displayManager.getCurrentLine2() + "\"";
-    json += "}";
-    server.send(200, "application/json", json);
+    _response.clear();
+    _response += '{';
+    _response.json("l1", displayManager.getCurrentLine1().c_str());
+    _response.json("l2", displayManager.getCurrentLine2().c_str());
+    _response += '}';
+    sendResponse("application/json");
 }
 
 void WebServerManager::handleMessage() {
     if (server.hasArg("l1") || server.hasArg("l2")) {
-        String l1 = server.arg("l1");
-        String l2 = server.arg("l2");
-        displayManager.setOverrideMessage(l1, l2, 5000);
+        displayManager.setOverrideMessage(server.arg("l1").c_str(), server.arg("l2").c_str(), 5000);
         server.send(200, "text/plain", "OK");
     } else {
         server.send(400, "text/plain", "Missing args");
     }
 }
 
+void WebServerManager::handleTasks() {
+    _response.clear();
+    taskScheduler.writeStatsJson(_response);
+    sendResponse("application/json");
+}
+
+void WebServerManager::handleState() {
+    _response.clear();
+    stateMachine.writeStatsJson(_response);
+    sendResponse("application/json");
+}
+
+void WebServerManager::handlePower() {
+    _response.clear();
+    powerManager.writeStatsJson(_response);
+    sendResponse("application/json");
+}
+
+void WebServerManager::handleHeap() {
+    _response.clear();
+    heapStats.writeJson(_response);
+    sendResponse("application/json");
+}
+
+void WebServerManager::handleDiag() {
+    _response.clear();
+    stallMonitor.writeJson(_response);
+    sendResponse("application/json");
+}
+
+void WebServerManager::handleSync() {
+    _response.clear();
+    unitSync.writeJson(_response);
+    sendResponse("application/json");
+}
+
+// ?reset=1 starts the histograms over, after a fix or a firmware update
+void WebServerManager::handleTiming() {
+    if (server.arg("reset") == "1") timingStats.reset();
+    _response.clear();
+    timingStats.writeJson(_response);
+    sendResponse("application/json");
+}
+
+static uint8_t daysInMonth(int year, int month) {
+    static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+// Every event from ?from= (default today) for ?days= days, a day per
+// object. Days come out of the scheduler's month cache and go out in
+// chunks, so 62 days need no more than the one buffer.
+void WebServerManager::handleSchedule() {
+    int year, month, day;
+    if (server.hasArg("from")) {
+        if (sscanf(server.arg("from").c_str(), "%d-%d-%d", &year, &month, &day) != 3 ||
+            month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+            server.send(400, "text/plain", "from must be YYYY-MM-DD");
+            return;
+        }
+    } else {
+        struct tm t;
+        if (!getLocalTime(&t, 0)) {
+            server.send(400, "text/plain", "Clock not set; give from=YYYY-MM-DD");
+            return;
+        }
+        year = t.tm_year + 1900;
+        month = t.tm_mon + 1;
+        day = t.tm_mday;
+    }
+    long days = server.hasArg("days") ? server.arg("days").toInt() : SCHEDULE_DEFAULT_DAYS;
+    if (days < 1) days = 1;
+    if (days > SCHEDULE_MAX_DAYS) days = SCHEDULE_MAX_DAYS;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    FixedString<128> head;
+    head.appendf("{\"from\":\"%04d-%02d-%02d\"", year, month, day);
+    head.json("days", days);
+    head.json("sehriOffset", alarmScheduler.getSehriOffset());
+    head.json("iftarOffset", alarmScheduler.getIftarOffset());
+    head.json("preSehri", alarmScheduler.getPreSehriOffset());
+    head.append(",\"schedule\":[");
+    server.send_P(200, "application/json", head.c_str(), head.length());
+
+    FixedString<1024> buf;
+    DayEvents ev;
+    for (long i = 0; i < days; i++) {
+        alarmScheduler.getDayEvents(year, month, day, ev);
+        buf.appendf("%s{\"date\":\"%04d-%02d-%02d\",\"events\":[", i ? "," : "", year, month, day);
+        bool first = true;
+        for (uint8_t e = 0; e < SCHED_EVENT_COUNT; e++) {
+            if (ev.minutes[e] < 0) continue;
+            buf.appendf("%s{\"name\":\"%s\",\"time\":\"%02d:%02d\"}", first ? "" : ",",
+                        scheduleEventName(e), ev.minutes[e] / 60, ev.minutes[e] % 60);
+            first = false;
+        }
+        buf.append("]}");
+        // Room for one more full day
+        if (buf.length() > buf.capacity() - 400) {
+            server.sendContent(buf.c_str(), buf.length());
+            buf.clear();
+            esp_task_wdt_reset();
+        }
+        if (++day > daysInMonth(year, month)) {
+            day = 1;
+            if (++month > 12) {
+                month = 1;
+                year++;
+            }
+        }
+    }
+    buf.append("]}");
+    server.sendContent(buf.c_str(), buf.length());
+    server.sendContent(""); // End of chunked response
+}
+
+static const char* const monthNames[] = { "", "Jan", "Feb", "March", "April", "May", "June",
+                                          "July", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+// The active timetable, a month of days per chunk. JSON comes out in the
+// timetable.txt layout so it can be edited and uploaded again; ?format=csv
+void WebServerManager::handleTimetable() {
+    bool csv = server.arg("format") == "csv";
+    const PrayerTimes& p = timetable.prayers();
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    if (csv) {
+        server.send(200, "text/csv", "date,sehri,iftar\n");
+    } else {
+        FixedString<256> head;
+        head.append('{');
+        head.json("location", timetable.location());
+        head.json("generation", timetable.getGeneration());
+        head.appendf(",\n\"prayer_fixed_times\":{\"fajr\":\"%02u:%02u\",\"zuhr\":\"%02u:%02u\","
+                     "\"asr\":\"%02u:%02u\",\"isha\":\"%02u:%02u\"},\n\"timetable\":[\n",
+                     p.fajrHour, p.fajrMinute, p.zohrHour, p.zohrMinute,
+                     p.asrHour, p.asrMinute, p.ishaHour, p.ishaMinute);
+        server.send_P(200, "application/json", head.c_str(), head.length());
+    }
+
+    FixedString<2048> buf;
+    AlarmEntry e;
+    for (uint16_t i = 0; i < timetable.count() && timetable.entry(i, e); i++) {
+        const char* month = e.month <= 12 ? monthNames[e.month] : "?";
+        if (csv) {
+            buf.appendf("%02u %s,%02u:%02u,%02u:%02u\n", e.day, month,
+                        e.sehriHour, e.sehriMinute, e.iftarHour, e.iftarMinute);
+        } else {
+            buf.appendf("%s  {\"roza\":%u,\"date\":\"%02u %s\",\"sehri\":\"%02u:%02u\",\"iftar\":\"%02u:%02u\"}",
+                        i ? ",\n" : "", i + 1, e.day, month,
+                        e.sehriHour, e.sehriMinute, e.iftarHour, e.iftarMinute);
+        }
+        if (buf.length() > buf.capacity() - 96) {
+            server.sendContent(buf.c_str(), buf.length());
+            buf.clear();
+            esp_task_wdt_reset();
+        }
+    }
+    if (!csv) buf.append("\n]}\n");
+    if (buf.length()) server.sendContent(buf.c_str(), buf.length());
+    server.sendContent(""); // End of chunked response
+}
+
+// Each chunk goes through the parser as it arrives and, when storing,
+// day by day into the flash slot not in use. Nothing is swapped until the
+// whole body has parsed.
+void WebServerManager::handleTimetableUpload(bool store) {
+    esp_task_wdt_reset();
+    HTTPUpload& upload = server.upload();
+    if (upload.status == UPLOAD_FILE_START) {
+        LOG_I("Timetable: %s %s", store ? "upload" : "check", upload.filename.c_str());
+        _ttStoreError = nullptr;
+        if (store && !timetable.beginWrite()) _ttStoreError = "no timetable partition";
+        _ttParser.begin(store ? TimetableStore::addEntry : nullptr, &timetable);
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+        if (!_ttStoreError) _ttParser.feed(upload.buf, upload.currentSize);
+    } else if (upload.status == UPLOAD_FILE_END) {
+        if (!_ttStoreError) _ttParser.finish();
+    }
+}
+
+void WebServerManager::handleTimetableDone(bool store) {
+    const char* error = _ttStoreError ? _ttStoreError : _ttParser.hasError() ? _ttParser.getError() : nullptr;
+    if (!error && store) {
+        // Prayer times and location are optional; keep the current ones
+        const char* location = _ttParser.getLocation()[0] ? _ttParser.getLocation()
+                             : timetable.isBuiltIn() ? "Uploaded" : timetable.location();
+        if (timetable.commit(_ttParser.hasPrayerTimes() ? _ttParser.getPrayerTimes() : timetable.prayers(), location)) {
+            eventLog.append(EVENT_SETTINGS);
+        } else {
+            error = "flash write failed";
+        }
+    }
+
+    const AlarmEntry& first = _ttParser.getFirst();
+    const AlarmEntry& last = _ttParser.getLast();
+    _response.clear();
+    _response.append('{');
+    _response.json("ok", error == nullptr);
+    _response.json("stored", store && !error);
+    _response.json("entries", _ttParser.getEntries());
+    if (_ttParser.getEntries()) {
+        _response.appendf(",\"first\":\"%02u %s\",\"last\":\"%02u %s\"", first.day, monthNames[first.month],
+                          last.day, monthNames[last.month]);
+    }
+    _response.json("prayerTimes", _ttParser.hasPrayerTimes());
+    if (error) {
+        _response.json("error", error);
+        _response.json("line", _ttParser.getErrorLine());
+        LOG_W("Timetable: rejected, %s (line %lu)", error, (unsigned long)_ttParser.getErrorLine());
+    }
+    _response.json("generation", timetable.getGeneration());
+    _response.append('}');
+    server.send_P(error ? 400 : 200, "application/json", _response.c_str(), _response.length());
+    _ttStoreError = "no file in the request"; // Until the next upload starts
+}
+
+// Streams the event log oldest first, a batch of records per chunk, so the
+// whole log never sits in RAM. ?format=csv|json (default json), ?since=seq,
+// ?limit=n
+void WebServerManager::handleEvents() {
+    bool csv = server.arg("format") == "csv";
+    uint32_t since = server.hasArg("since") ? (uint32_t)server.arg("since").toInt() : 0;
+    uint32_t limit = server.hasArg("limit") ? (uint32_t)server.arg("limit").toInt() : UINT32_MAX;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    if (csv) {
+        server.send(200, "text/csv", "seq,time,type,house,detail,durationMs,ackLatencyMs\n");
+    } else {
+        FixedString<64> head;
+        head.appendf("{\"count\":%lu,\"capacity\":%lu,\"events\":[",
+                     (unsigned long)eventLog.getCount(), (unsigned long)eventLog.getCapacity());
+        server.send_P(200, "application/json", head.c_str(), head.length());
+    }
+
+    const uint8_t BATCH = 16;
+    EventRecord recs[BATCH];
+    char buf[BATCH * 120];
+    uint32_t cursor = eventLog.begin();
+    uint32_t sent = 0;
+    uint16_t n;
+    while (sent < limit && (n = eventLog.read(cursor, recs, BATCH)) > 0) {
+        size_t len = 0;
+        for (uint16_t i = 0; i < n && sent < limit; i++) {
+            const EventRecord& r = recs[i];
+            if (r.seq < since) continue;
+            if (csv) {
+                len += snprintf(buf + len, sizeof(buf) - len, "%lu,%lu,%s,%u,%u,%lu,%lu\n",
+                                (unsigned long)r.seq, (unsigned long)r.time, eventTypeName(r.type),
+                                r.house, r.detail, (unsigned long)r.durationDs * 100,
+                                (unsigned long)r.ackLatencyDs * 100);
+            } else {
+                len += snprintf(buf + len, sizeof(buf) - len,
+                                "%s{\"seq\":%lu,\"time\":%lu,\"type\":\"%s\",\"house\":%u,\"detail\":%u,"
+                                "\"durationMs\":%lu,\"ackLatencyMs\":%lu}",
+                                sent ? "," : "", (unsigned long)r.seq, (unsigned long)r.time,
+                                eventTypeName(r.type), r.house, r.detail,
+                                (unsigned long)r.durationDs * 100, (unsigned long)r.ackLatencyDs * 100);
+            }
+            sent++;
+        }
+        if (len) server.sendContent(buf, len);
+        esp_task_wdt_reset();
+    }
+
+    if (!csv) server.sendContent("]}");
+    server.sendContent(""); // End of chunked response
+}
+
+// The log ring, oldest first, in chunks like handleEvents. ?format=text|json
+// (default text), ?since=seq, ?level=e|w|i|d (that level and worse)
+void WebServerManager::handleLog() {
+    bool json = server.arg("format") == "json";
+    uint32_t since = server.hasArg("since") ? (uint32_t)server.arg("since").toInt() : 0;
+    uint8_t maxLevel = LOG_LEVEL_DEBUG;
+    if (server.hasArg("level")) {
+        switch (server.arg("level")[0]) {
+            case 'e': maxLevel = LOG_LEVEL_ERROR; break;
+            case 'w': maxLevel = LOG_LEVEL_WARN; break;
+            case 'i': maxLevel = LOG_LEVEL_INFO; break;
+        }
+    }
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    if (json) {
+        FixedString<64> head;
+        head.appendf("{\"next\":%lu,\"lost\":%lu,\"lines\":[",
+                     (unsigned long)Log::getNextSeq(), (unsigned long)Log::getOverwritten());
+        server.send_P(200, "application/json", head.c_str(), head.length());
+    } else {
+        server.send(200, "text/plain", "");
+    }
+
+    FixedString<1024> buf;
+    LogEntry e;
+    uint32_t pos = Log::begin();
+    bool first = true;
+    while (Log::next(pos, e)) {
+        if (e.seq < since || e.level > maxLevel) continue;
+        if (json) {
+            if (!first) buf.append(',');
+            buf.append('{');
+            buf.json("seq", e.seq);
+            buf.json("ms", e.ms);
+            buf.json("level", Log::levelName(e.level));
+            buf.json("text", e.text);
+            buf.append('}');
+        } else {
+            buf.appendf("%lu [%6lu.%03lu] %c %s\n", (unsigned long)e.seq, (unsigned long)(e.ms / 1000),
+                        (unsigned long)(e.ms % 1000), Log::levelLetter(e.level), e.text);
+        }
+        first = false;
+        // Room for one more worst-case line (every character escaped)
+        if (buf.length() > buf.capacity() - 2 * Log::MAX_LINE - 64) {
+            server.sendContent(buf.c_str(), buf.length());
+            buf.clear();
+            esp_task_wdt_reset();
+        }
+    }
+    if (json) buf.append("]}");
+    if (buf.length()) server.sendContent(buf.c_str(), buf.length());
+    server.sendContent(""); // End of chunked response
+}
+
 void WebServerManager::handleStatus() {
-    String json = "{";
-    json += "\"time\":\"" + networkManager.getFormattedTime() + "\",";
-    json += "\"date\":\"" + networkManager.getFormattedDate() + "\",";
-    json += "\"nextAlarm\":\"" + alarmScheduler.getNextAlarmName() + "\",";
-    json += "\"nextTime\":\"" + alarmScheduler.getNextAlarmTime() + "\",";
+    _response.clear();
+    buildStatusJson(_response);
+    sendResponse("application/json");
+}
+
+void WebServerManager::buildStatusJson(StrBuf& json) {
+    json += '{';
+    json.json("time", networkManager.getFormattedTime().c_str());
+    json.json("date", networkManager.getFormattedDate().c_str());
+    json.json("nextAlarm", alarmScheduler.getNextAlarmName());
+    json.json("nextTime", alarmScheduler.getNextAlarmTime().c_str());
+    json.json("state", stateName(stateMachine.getState()));
     
     unsigned long upSec = millis() / 1000;
-    int upH = upSec / 3600;
-    int upM = (upSec % 3600) / 60;
-    json += "\"uptime\":\"" + String(upH) + "h " + String(upM) + "m\",";
+    FixedString<16> uptime;
+    uptime.appendf("%luh %lum", upSec / 3600, (upSec % 3600) / 60);
+    json.json("uptime", uptime.c_str());
     
     // Last Alarm Duration
-    json += "\"lastDuration\":\"" + alarmScheduler.getLastAlarmDuration() + "\",";
+    json.json("lastDuration", alarmScheduler.getLastAlarmDuration().c_str());
     
     // Switch Status (Active Low: LOW=ON, HIGH=OFF)
     // Actually, "ENABLED" means ready to ring.
     // Since our logic captures state on trigger, 'Status' here just shows physical position
     // Let's show: ON (GND) / OFF (OPEN)
+    json.json("swA", btnHouseA.getState() == LOW);
+    json.json("swB", btnHouseB.getState() == LOW);
     
-    bool swA = (btnHouseA.getState() == LOW);
-    bool swB = (btnHouseB.getState() == LOW);
-    json += "\"swA\":" + String(swA ? "true" : "false") + ",";
-    json += "\"swB\":" + String(swB ? "true" : "false") + ",";
-    
-    // Buzzer Ringing Status
-    bool ringA = buzzerA.getBuzzerState(); // isRinging() checks pattern valid, getBuzzerState checks ON/OFF
-    bool ringB = buzzerB.getBuzzerState(); 
-    // Actually we want to know if pattern is active OR if it's currently making sound
-    // Let's us isRinging() to show "Alarm Active" which is more useful than blinking "ON/OFF"
+    // Buzzer Ringing Status: isRinging() (pattern active) rather than the
+    // blinking ON/OFF of getBuzzerState()
+    json.json("ringA", buzzerA.isRinging());
+    json.json("ringB", buzzerB.isRinging());
     
-    json += "\"ringA\":" + String(buzzerA.isRinging() ? "true" : "false") + ",";
-    json += "\"ringB\":" + String(buzzerB.isRinging() ? "true" : "false") + ",";
+    // LCD bus traffic over the last minute (diffing renderer vs. whole-line redraw),
+    // per backend so panels can be compared
+    json.json("lcdBackend", displayManager.getBackendName());
+    json.json("lcdBytesMin", displayManager.getBusBytesPerMinute());
+    json.json("lcdLegacyBytesMin", displayManager.getLegacyBusBytesPerMinute());
+    // Loop time spent posting frames vs. time the LCD writer task spends on the bus
+    json.json("lcdCallUs", displayManager.getAverageCallMicros());
+    json.json("lcdMaxCallUs", displayManager.getMaxCallMicros());
+    json.json("lcdFlushUs", displayManager.getAverageFlushMicros());
+    json.json("screenRenders", screenRegistry.getRenderCount());
+    json.json("screenSkips", screenRegistry.getSkipCount());
+    json.json("pmMode", powerManager.getModeName());
+    json.json("cpuActivePct", powerManager.getActivePercent());
+    json.json("estMa", powerManager.getEstimatedMilliamps());
+    json.json("freeHeap", ESP.getFreeHeap());
+    json.json("loopAllocs", heapStats.getWindowAllocs()); // Last 10 s, 0 when steady
     
     // Schedule
-    json += "\"schedule\":" + alarmScheduler.getUpcomingScheduleJson();
+    json.jsonKey("schedule");
+    alarmScheduler.writeUpcomingScheduleJson(json);
     
-    json += "}";
-    
-    server.send(200, "application/json", json);
+    json += '}';
 }
 
 void WebServerManager::handleSettings() {
@@ -549,7 +957,8 @@ void WebServerManager::handleSettings() {
     bool sleep = prefs.getBool("sleep", false);
     prefs.end();
 
-    String html = R"rawliteral(
+    // Styles go out as they are; only the form is formatted, into _response
+    static const char head[] PROGMEM = R"rawliteral(
 <!DOCTYPE html>
 <html>
 <head>
@@ -569,41 +978,42 @@ void WebServerManager::handleSettings() {
   </style>
 </head>
 <body>
-  <h1>System Configuration</h1>
+)rawliteral";
+    static const char form[] PROGMEM = R"rawliteral(  <h1>System Configuration</h1>
   <div class="card">
     <form action="/save-settings" method="GET">
       
       <h3>Time Offsets (Minutes)</h3>
       <label>Sehri Offset:</label>
-      <input type="number" name="sehriOffset" value=")rawliteral" + String(sOff) + R"rawliteral(">
+      <input type="number" name="sehriOffset" value="%d">
       <br>
       <label>Iftar Offset:</label>
-      <input type="number" name="iftarOffset" value=")rawliteral" + String(iOff) + R"rawliteral(">
+      <input type="number" name="iftarOffset" value="%d">
       <br>
       <label>Pre-Sehri Offset (Min Before):</label>
-      <input type="number" name="preOff" value=")rawliteral" + String(preOff) + R"rawliteral(">
+      <input type="number" name="preOff" value="%d">
       
       <h3>Power & Display</h3>
       <label>Deep Sleep Mode:</label>
-      <input type="checkbox" name="sleep" )rawliteral" + String(sleep ? "checked" : "") + R"rawliteral(">
+      <input type="checkbox" name="sleep" %s">
       <p style="font-size: 0.7rem; color: #ff5252; margin: 5px 0 15px 0;">Warning: Web UI will be offline during sleep!</p>
       
       <h3>Prayer End Beep Pattern</h3>
       <label>Beep Count:</label>
-      <input type="number" name="pCount" min="1" max="10" value=")rawliteral" + String(pCount) + R"rawliteral(">
+      <input type="number" name="pCount" min="1" max="10" value="%d">
       <br>
       <label>Beep Duration (ms):</label>
-      <input type="number" name="pDur" step="50" min="50" value=")rawliteral" + String(pDur) + R"rawliteral(">
+      <input type="number" name="pDur" step="50" min="50" value="%d">
       <br>
       <label>Gap Duration (ms):</label>
-      <input type="number" name="pGap" step="50" min="50" value=")rawliteral" + String(pGap) + R"rawliteral(">
+      <input type="number" name="pGap" step="50" min="50" value="%d">
 
       <h3>Sehri Alarm Pattern</h3>
       <label>Ring Duration (ms):</label>
-      <input type="number" name="sDur" step="1000" min="1000" value=")rawliteral" + String(sDur) + R"rawliteral(">
+      <input type="number" name="sDur" step="1000" min="1000" value="%d">
       <br>
       <label>Repeat Interval (ms):</label>
-      <input type="number" name="sInt" step="1000" min="1000" value=")rawliteral" + String(sInt) + R"rawliteral(">
+      <input type="number" name="sInt" step="1000" min="1000" value="%d">
 
       <br>
       <input type="submit" value="SAVE CHANGES">
@@ -613,7 +1023,13 @@ void WebServerManager::handleSettings() {
 </body>
 </html>
 )rawliteral";
-    server.send(200, "text/html", html);
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send_P(200, "text/html", head);
+    _response.clear();
+    _response.appendf(form, sOff, iOff, preOff, sleep ? "checked" : "", pCount, pDur, pGap, sDur, sInt);
+    server.sendContent(_response.c_str(), _response.length());
+    server.sendContent(""); // End of chunked response
 }
 
 void WebServerManager::handleSaveSettings() {
@@ -628,6 +1044,7 @@ void WebServerManager::handleSaveSettings() {
         
         alarmScheduler.setOffsets(sOff, iOff);
         alarmScheduler.setPreSehriOffset(preOff);
+        alarmScheduler.rearm(); // New offsets apply today, as from the console
         
         prefs.begin("ramzan", false);
         prefs.putInt("sOff", sOff);
@@ -669,6 +1086,7 @@ void WebServerManager::handleSaveSettings() {
     }
 
     if (updated) {
+        eventLog.append(EVENT_SETTINGS);
         server.sendHeader("Location", "/");
         server.send(303); 
     } else {
@@ -677,7 +1095,7 @@ void WebServerManager::handleSaveSettings() {
 }
 
 void WebServerManager::handleUpdate() {
-    String html = R"rawliteral(
+    static const char html[] PROGMEM = R"rawliteral(
 <!DOCTYPE html>
 <html>
 <head>
@@ -695,7 +1113,7 @@ void WebServerManager::handleUpdate() {
 <body>
   <h1>System Update</h1>
   <div class="card">
-    <p>Upload a new firmware (.bin) file</p>
+    <p>Upload a signed firmware file or delta (ramzan_ota sign / diff)</p>
     <form method='POST' action='/update' enctype='multipart/form-data'>
       <input type='file' name='update'>
       <br>
@@ -706,37 +1124,61 @@ void WebServerManager::handleUpdate() {
 </body>
 </html>
 )rawliteral";
-    server.send(200, "text/html", html);
+    server.send_P(200, "text/html", html);
 }
 
 void WebServerManager::handleUpdateUpload() {
     // Feed the watchdog to prevent timeouts during long upload/write operations
     esp_task_wdt_reset();
+    Breadcrumb crumb(STAGE_OTA_WRITE);
 
+    // Signed image or delta: hashed as it streams, only booted once it checks out
     HTTPUpload& upload = server.upload();
     if (upload.status == UPLOAD_FILE_START) {
-        Serial.printf("Update: %s\n", upload.filename.c_str());
-        // Use totalSize if available for better stability
-        size_t fileSize = (upload.totalSize > 0) ? upload.totalSize : UPDATE_SIZE_UNKNOWN;
-        
-        // Feed before potentially long erase operation
-        esp_task_wdt_reset(); 
-        
-        if (!Update.begin(fileSize)) { 
-            Update.printError(Serial);
+        LOG_I("Update: %s", upload.filename.c_str());
+        _otaOk = false;
+        _otaRefused = nullptr;
+        if (strcmp(OTA_SIGN_KEY, OTA_SIGN_KEY_DEFAULT) == 0) {
+            LOG_E("Update refused: OTA_SIGN_KEY in Config.h is still the default");
+            _otaRefused = "Update Refused: set OTA_SIGN_KEY in Config.h first";
+            _otaRefusedCode = 403;
+            return;
+        }
+        if (!stateMachine.transition(STATE_OTA_MODE)) {
+            LOG_W("Update refused in %s", stateName(stateMachine.getState()));
+            _otaRefused = "Update Refused: busy, try again shortly";
+            _otaRefusedCode = 409;
+            return;
         }
+        _otaOk = otaManager.begin();
+        if (!_otaOk) stateMachine.transition(STATE_ERROR);
+    } else if (_otaRefused) {
+        // Turned away at the start: let the rest of the body drain
     } else if (upload.status == UPLOAD_FILE_WRITE) {
-        if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
-            Update.printError(Serial);
+        if (_otaOk && !otaManager.write(upload.buf, upload.currentSize)) {
+            _otaOk = false;
+            stateMachine.transition(STATE_ERROR);
         }
         // Feed after each chunk write
         esp_task_wdt_reset();
     } else if (upload.status == UPLOAD_FILE_END) {
-        if (Update.end(true)) { 
-            Serial.printf("Update Success: %u\nRebooting...\n", upload.totalSize);
+        if (_otaOk && otaManager.end()) {
+            LOG_I("Update Success: %u bytes. Rebooting...", (unsigned)upload.totalSize);
+            eventLog.append(EVENT_OTA_DONE);
         } else {
-            Update.printError(Serial);
+            if (_otaOk) stateMachine.transition(STATE_ERROR);
+            _otaOk = false;
         }
         esp_task_wdt_reset();
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        if (_otaOk) otaManager.abort("upload aborted");
+        _otaOk = false;
+        stateMachine.transition(STATE_ERROR);
     }
 }
+
+void WebServerManager::handleOta() {
+    _response.clear();
+    otaManager.writeJson(_response);
+    sendResponse("application/json");
+}
@@ -3,15 +3,32 @@
 
 #include <Arduino.h>
 #include <WebServer.h>
+#include "FixedString.h"
+#include "TimetableParser.h"
 
 class WebServerManager {
 public:
     WebServerManager();
     void init();
     void handleClient(); 
+    void buildStatusJson(StrBuf& json); // Body of /status
     
+    static const size_t RESPONSE_SIZE = 3072;
+
 private:
     WebServer server;
+
+    // JSON/HTML bodies are built here instead of in String temporaries;
+    // handlers run one at a time on the loop task
+    FixedString<RESPONSE_SIZE> _response;
+    void sendResponse(const char* contentType);
+
+    // Timetable upload in progress; the body never sits in RAM
+    TimetableParser _ttParser;
+    const char* _ttStoreError = "no file in the request";
+    bool _otaOk = false;        // Firmware upload still good so far
+    const char* _otaRefused = nullptr; // Why the upload was turned away before it started
+    int _otaRefusedCode = 409;
     
     // Handlers
     void handleRoot();
@@ -20,10 +37,24 @@ private:
     void handleSaveSettings();  
     void handleUpdate();       // Web-based OTA Update Page
     void handleUpdateUpload(); // Web-based OTA Binary Upload logic
+    void handleOta();          // Running/boot partition, rollback guard, last update's figures
     
     // New Features
     void handleDisplayJson();
     void handleMessage();
+    void handleTasks();      // Scheduler stats: runs, skips, overruns per task
+    void handleState();      // Current state, time per state, transition history
+    void handlePower();      // Power mode, CPU active share, estimated current
+    void handleEvents();     // Persistent event log, streamed as JSON or CSV
+    void handleHeap();       // Heap allocation counter, free / largest block
+    void handleLog();        // Recent log lines from RAM, text or JSON
+    void handleDiag();       // Reset reason, stage at the last watchdog, max time per stage
+    void handleSync();       // Time leader, offset to it, peers, last group start
+    void handleTiming();     // Alarm start latency and segment accuracy, p50/p99/max
+    void handleSchedule();   // Every event for ?from=YYYY-MM-DD&days=N, offsets applied
+    void handleTimetable();  // Active timetable, streamed as JSON (timetable.txt format) or CSV
+    void handleTimetableUpload(bool store); // Parse (and store) an uploaded timetable as it arrives
+    void handleTimetableDone(bool store);   // Swap it in and report what was read
     
     void handleTest();
     void handleNotFound();
@@ -0,0 +1,177 @@
+// Host benchmarks: boots the firmware on the fake HAL until it is idle, then
+// times the hot paths with the real host clock and counts heap allocations
+// (String buffers + operator new). Then runs the task table as the
+// scheduler does and as a superloop would (loop_scheduler/loop_superloop).
+// Prints a table and writes the JSON.
+//
+//   ramzan_bench [--filter NAME] [--min-ms N] [--json FILE]
+#include <Arduino.h>
+#include "FakeHal.h"
+#include "Benchmarks.h"
+#include "TaskScheduler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+void setup();
+void loop();
+
+extern TaskScheduler taskScheduler;
+
+static uint32_t s_newCount = 0;
+
+void* operator new(size_t size) {
+    s_newCount++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static uint64_t hostClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t hostAllocs() { return s_newCount + String::allocationCount(); }
+
+// Firmware serial output piles up in the fake UART otherwise
+static void dropSerial() { fakehal::serialTakeOutput(); }
+
+// Scheduler vs superloop, the same task table both ways. The scheduler
+// runs what is due and idles until the next task, like loop(). The
+// superloop runs every task on every pass and starts the next pass at
+// once, so simulated time moves by what each pass cost on the host.
+struct LoopRun {
+    uint32_t passes;
+    uint64_t busyNs;    // Host time inside the passes
+    uint64_t maxPassNs; // Longest a buzzer step or button edge waits for its turn
+    uint64_t simUs;     // Simulated time covered
+    uint32_t allocs;
+};
+
+static const uint32_t LOOP_SCHEDULER_SECONDS = 10;
+static const uint32_t LOOP_SUPERLOOP_PASSES = 20000;
+
+static LoopRun runLoop(bool superloop) {
+    LoopRun r = {};
+    uint64_t startUs = fakehal::nowMicros();
+    uint32_t allocsBefore = hostAllocs();
+    taskScheduler.setRunAll(superloop);
+    while (superloop ? r.passes < LOOP_SUPERLOOP_PASSES
+                     : fakehal::nowMicros() - startUs < LOOP_SCHEDULER_SECONDS * 1000000ULL) {
+        uint64_t t0 = hostClock();
+        taskScheduler.run();
+        uint64_t spent = hostClock() - t0;
+        r.passes++;
+        r.busyNs += spent;
+        if (spent > r.maxPassNs) r.maxPassNs = spent;
+        if (superloop) {
+            fakehal::advanceMicros(spent >= 1000 ? spent / 1000 : 1);
+        } else {
+            uint32_t wait = taskScheduler.getMsToNextDue();
+            fakehal::advanceMillis(wait < 1 ? 1 : wait > 1000 ? 1000 : wait);
+        }
+        dropSerial();
+    }
+    taskScheduler.setRunAll(false);
+    r.simUs = fakehal::nowMicros() - startUs;
+    r.allocs = hostAllocs() - allocsBefore;
+    return r;
+}
+
+static BenchResult loopResult(const char* name, const LoopRun& r) {
+    BenchResult b;
+    b.name = name;
+    b.iterations = r.passes;
+    b.nsPerOp = (uint32_t)(r.busyNs / r.passes);
+    b.allocsPerOp = (float)r.allocs / r.passes;
+    b.maxNs = (uint32_t)r.maxPassNs;
+    return b;
+}
+
+static void compareLoops(Benchmarks& bench) {
+    LoopRun sched = runLoop(false);
+    LoopRun superloop = runLoop(true);
+    bench.addResult(loopResult("loop_scheduler", sched));
+    bench.addResult(loopResult("loop_superloop", superloop));
+
+    printf("\n%-16s %10s %12s %10s %12s\n", "loop", "passes/s", "busy us/s", "ns/pass", "max ns/pass");
+    const LoopRun* runs[2] = { &sched, &superloop };
+    for (int i = 0; i < 2; i++) {
+        const LoopRun& r = *runs[i];
+        double simS = r.simUs / 1e6;
+        printf("%-16s %10.0f %12.0f %10llu %12llu\n", i ? "superloop" : "scheduler", r.passes / simS,
+               r.busyNs / 1000.0 / simS, (unsigned long long)(r.busyNs / r.passes),
+               (unsigned long long)r.maxPassNs);
+    }
+}
+
+class FilePrint : public Print {
+public:
+    explicit FilePrint(FILE* f) : _f(f) {}
+    size_t write(uint8_t c) override { return fputc(c, _f) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, _f); }
+private:
+    FILE* _f;
+};
+
+static void usage() {
+    fprintf(stderr, "usage: ramzan_bench [--filter NAME] [--min-ms N] [--json FILE]\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    const char* jsonPath = "bench_results.json";
+    uint32_t minMs = Benchmarks::MIN_BATCH_MS;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--filter") && v) { filter = v; i++; }
+        else if (!strcmp(a, "--min-ms") && v) { minMs = strtoul(v, nullptr, 10); i++; }
+        else if (!strcmp(a, "--json") && v) { jsonPath = v; i++; }
+        else usage();
+    }
+
+    // Mid-Ramzan afternoon: schedule loaded, nothing ringing
+    fakehal::addPartition("evlog", 0x01, 0x40, 0x10000);
+    fakehal::addPartition("ttable", 0x01, 0x41, 0x2000);
+    fakehal::setWifiConnected(true);
+    fakehal::setNtpAvailable(true);
+    fakehal::setLocalTime(2026, 3, 1, 14, 0, 0);
+    setup();
+    uint64_t endUs = fakehal::nowMicros() + 5000000ULL;
+    while (fakehal::nowMicros() < endUs) {
+        uint64_t before = fakehal::nowMicros();
+        loop();
+        if (fakehal::nowMicros() == before) fakehal::advanceMicros(100);
+    }
+    dropSerial();
+
+    Benchmarks bench;
+    bench.setClock(hostClock);
+    bench.setAllocCounter(hostAllocs);
+    bench.setBatchHook(dropSerial);
+    bench.setMinBatchMs(minMs);
+    bench.run(filter);
+    dropSerial();
+    if (!filter || strstr("loop_scheduler loop_superloop", filter)) compareLoops(bench);
+
+    FilePrint out(stdout);
+    bench.printTable(out);
+
+    FILE* f = fopen(jsonPath, "w");
+    if (!f) {
+        perror(jsonPath);
+        return 1;
+    }
+    FilePrint json(f);
+    bench.printJson(json, "host");
+    fclose(f);
+    printf("\nWrote %s\n", jsonPath);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef HOST_ARDUINO_OTA_H
+#define HOST_ARDUINO_OTA_H
+
+#include <Arduino.h>
+#include "Update.h"
+
+typedef enum {
+    OTA_AUTH_ERROR,
+    OTA_BEGIN_ERROR,
+    OTA_CONNECT_ERROR,
+    OTA_RECEIVE_ERROR,
+    OTA_END_ERROR
+} ota_error_t;
+
+class ArduinoOTAClass {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+    typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+    typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+    ArduinoOTAClass& setHostname(const char* hostname) { (void)hostname; return *this; }
+    ArduinoOTAClass& onStart(THandlerFunction fn) { _start = fn; return *this; }
+    ArduinoOTAClass& onEnd(THandlerFunction fn) { _end = fn; return *this; }
+    ArduinoOTAClass& onError(THandlerFunction_Error fn) { _error = fn; return *this; }
+    ArduinoOTAClass& onProgress(THandlerFunction_Progress fn) { _progress = fn; return *this; }
+    void begin() {}
+    void handle() {}
+    int getCommand() { return U_FLASH; }
+
+    THandlerFunction _start, _end;
+    THandlerFunction_Error _error;
+    THandlerFunction_Progress _progress;
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif
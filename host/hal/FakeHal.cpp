@@ -0,0 +1,838 @@
+// Implementation of the host HAL: clock, GPIO, WiFi, NVS, LCD, Serial,
+// WebServer loopback, OTA sink and sleep/watchdog stubs.
+#include "FakeHal.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include <Preferences.h>
+#include <LiquidCrystal.h>
+#include <Wire.h>
+#include <ArduinoOTA.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_task_wdt.h>
+#include <esp_sleep.h>
+#include <soc/gpio_reg.h>
+#include <map>
+
+// ---------------------------------------------------------------- clock
+
+static uint64_t s_nowUs = 0;
+static int64_t s_epochAtZero = 1771459200; // 2026-02-19 00:00:00 UTC
+static long s_gmtOffset = 0;
+static int s_dstOffset = 0;
+static bool s_timeConfigured = false;
+static bool s_ntpAvailable = true;
+static bool s_wifiConnected = true;
+static int8_t s_rssi = -60;
+static uint32_t s_cpuMhz = 240;
+
+static bool s_localPinned = false;
+static int64_t s_clockErrorUs = 0;
+
+// Real time mode: the clock follows CLOCK_MONOTONIC and waiting sleeps
+static bool s_realtime = false;
+static uint64_t s_monoBaseUs = 0;
+
+static uint64_t monoMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static uint64_t clockNow() {
+    if (s_realtime) s_nowUs = monoMicros() - s_monoBaseUs;
+    return s_nowUs;
+}
+
+static void passTime(uint64_t us) {
+    if (!s_realtime) {
+        s_nowUs += us;
+        return;
+    }
+    struct timespec ts = { (time_t)(us / 1000000ULL), (long)(us % 1000000ULL) * 1000 };
+    nanosleep(&ts, nullptr);
+    clockNow();
+}
+
+static int64_t wallMicros() {
+    return s_epochAtZero * 1000000LL + (int64_t)clockNow() + s_clockErrorUs;
+}
+
+namespace fakehal {
+
+uint64_t nowMicros() { return clockNow(); }
+void setMicros(uint64_t us) { s_nowUs = us; }
+void advanceMicros(uint64_t us) { passTime(us); }
+void setRealtime(bool realtime) {
+    s_realtime = realtime;
+    if (realtime) s_monoBaseUs = monoMicros() - s_nowUs;
+}
+uint64_t toMonotonicMicros(uint64_t us) { return us + s_monoBaseUs; }
+void setClockError(int64_t errorUs) { s_clockErrorUs = errorUs; }
+void setEpoch(int64_t epochAtZero) { s_epochAtZero = epochAtZero; s_localPinned = false; }
+void setNtpAvailable(bool available) { s_ntpAvailable = available; }
+
+void setLocalTime(int year, int month, int day, int hour, int minute, int second) {
+    struct tm t = {};
+    t.tm_year = year - 1900;
+    t.tm_mon = month - 1;
+    t.tm_mday = day;
+    t.tm_hour = hour;
+    t.tm_min = minute;
+    t.tm_sec = second;
+    int64_t local = (int64_t)timegm(&t);
+    s_localPinned = true;
+    s_epochAtZero = local - s_gmtOffset - s_dstOffset - (int64_t)(clockNow() / 1000000ULL);
+}
+
+} // namespace fakehal
+
+// 32 bits like the target: micros() wraps every 71.6 min, millis() every 49.7 days
+unsigned long millis() { return (uint32_t)(clockNow() / 1000ULL); }
+unsigned long micros() { return (uint32_t)clockNow(); }
+void delay(uint32_t ms) { passTime((uint64_t)ms * 1000ULL); }
+void delayMicroseconds(uint32_t us) { passTime(us); }
+void yield() {}
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char*, const char*, const char*) {
+    // A wall clock set with setLocalTime() stays put when the firmware
+    // configures its timezone afterwards
+    if (s_localPinned) s_epochAtZero -= (gmtOffset_sec + daylightOffset_sec) - (s_gmtOffset + s_dstOffset);
+    s_gmtOffset = gmtOffset_sec;
+    s_dstOffset = daylightOffset_sec;
+    s_timeConfigured = true;
+}
+
+bool getLocalTime(struct tm* info, uint32_t) {
+    if (!s_timeConfigured || !s_ntpAvailable) return false;
+    time_t t = (time_t)(wallMicros() / 1000000LL + s_gmtOffset + s_dstOffset);
+    gmtime_r(&t, info);
+    return true;
+}
+
+// The firmware's gettimeofday() sees the simulated wall clock (UTC)
+extern "C" int gettimeofday(struct timeval* tv, void*) {
+    int64_t us = wallMicros();
+    tv->tv_sec = (time_t)(us / 1000000LL);
+    tv->tv_usec = (suseconds_t)(us % 1000000LL);
+    return 0;
+}
+
+// Moves the simulated wall clock (the console's "time" command)
+extern "C" int settimeofday(const struct timeval* tv, const struct timezone*) {
+    if (tv) {
+        s_epochAtZero = (int64_t)tv->tv_sec - (int64_t)(clockNow() / 1000000ULL);
+        s_clockErrorUs = 0;
+        s_localPinned = false;
+    }
+    return 0;
+}
+
+#include <esp_sntp.h>
+static sntp_sync_time_cb_t s_sntpCb = nullptr;
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) { s_sntpCb = cb; }
+
+namespace fakehal {
+void ntpSyncNow() {
+    if (!s_sntpCb) return;
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    s_sntpCb(&tv);
+}
+} // namespace fakehal
+
+bool setCpuFrequencyMhz(uint32_t mhz) { s_cpuMhz = mhz; return true; }
+uint32_t getCpuFrequencyMhz() { return s_cpuMhz; }
+
+// ----------------------------------------------------------------- GPIO
+
+struct PinState {
+    uint8_t mode = 0;
+    uint8_t level = HIGH;
+    void (*isr)(void) = nullptr;
+    void (*isrArg)(void*) = nullptr;
+    void* arg = nullptr;
+    int isrMode = 0;
+    // What the pin's interrupt type register holds. attachInterrupt() sets
+    // the edge type; gpio_wakeup_enable() overwrites it with a level
+    gpio_int_type_t intrType = GPIO_INTR_DISABLE;
+    bool intrEnabled = false;
+};
+static PinState s_pins[40];
+static std::vector<fakehal::GpioEdge> s_outputLog;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= 40) return;
+    s_pins[pin].mode = mode;
+    if (mode == INPUT_PULLUP) s_pins[pin].level = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= 40) return;
+    s_pins[pin].level = val ? HIGH : LOW;
+    s_outputLog.push_back({ clockNow(), pin, (uint8_t)(val ? HIGH : LOW) });
+}
+
+int digitalRead(uint8_t pin) { return pin < 40 ? s_pins[pin].level : LOW; }
+
+uint32_t fakehal_reg_read(uint32_t addr) {
+    uint32_t v = 0;
+    int base = (addr == GPIO_IN1_REG) ? 32 : 0;
+    for (int i = 0; i < 32 && base + i < 40; i++) {
+        if (s_pins[base + i].level) v |= (1UL << i);
+    }
+    return v;
+}
+
+static gpio_int_type_t edgeType(int mode) {
+    return mode == RISING ? GPIO_INTR_POSEDGE : mode == FALLING ? GPIO_INTR_NEGEDGE : GPIO_INTR_ANYEDGE;
+}
+
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode) {
+    if (pin >= 40) return;
+    s_pins[pin].isr = fn;
+    s_pins[pin].isrArg = nullptr;
+    s_pins[pin].isrMode = mode;
+    s_pins[pin].intrType = edgeType(mode);
+    s_pins[pin].intrEnabled = true;
+}
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode) {
+    if (pin >= 40) return;
+    s_pins[pin].isr = nullptr;
+    s_pins[pin].isrArg = fn;
+    s_pins[pin].arg = arg;
+    s_pins[pin].isrMode = mode;
+    s_pins[pin].intrType = edgeType(mode);
+    s_pins[pin].intrEnabled = true;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= 40) return;
+    s_pins[pin].isr = nullptr;
+    s_pins[pin].isrArg = nullptr;
+    s_pins[pin].intrEnabled = false;
+}
+
+int gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) {
+    if (pin >= 40) return ESP_ERR_INVALID_ARG;
+    s_pins[pin].intrType = type;
+    return ESP_OK;
+}
+int gpio_intr_enable(gpio_num_t pin) {
+    if (pin >= 40) return ESP_ERR_INVALID_ARG;
+    s_pins[pin].intrEnabled = true;
+    return ESP_OK;
+}
+int gpio_intr_disable(gpio_num_t pin) {
+    if (pin >= 40) return ESP_ERR_INVALID_ARG;
+    s_pins[pin].intrEnabled = false;
+    return ESP_OK;
+}
+
+// A level interrupt fires again as soon as its handler returns, for as
+// long as the level holds. The burst stands in for that retriggering.
+static const int LEVEL_ISR_BURST = 64;
+
+namespace fakehal {
+
+void setInput(uint8_t pin, int level) {
+    if (pin >= 40) return;
+    PinState& p = s_pins[pin];
+    uint8_t old = p.level;
+    p.level = level ? HIGH : LOW;
+    if (old == p.level || !p.intrEnabled) return;
+    bool rising = p.level == HIGH;
+    int fire = 0;
+    switch (p.intrType) {
+        case GPIO_INTR_POSEDGE: fire = rising; break;
+        case GPIO_INTR_NEGEDGE: fire = !rising; break;
+        case GPIO_INTR_ANYEDGE: fire = 1; break;
+        case GPIO_INTR_LOW_LEVEL: fire = rising ? 0 : LEVEL_ISR_BURST; break;
+        case GPIO_INTR_HIGH_LEVEL: fire = rising ? LEVEL_ISR_BURST : 0; break;
+        default: break;
+    }
+    for (int i = 0; i < fire; i++) {
+        if (p.isr) p.isr();
+        if (p.isrArg) p.isrArg(p.arg);
+    }
+}
+
+int pinLevel(uint8_t pin) { return pin < 40 ? s_pins[pin].level : LOW; }
+int pinMode(uint8_t pin) { return pin < 40 ? s_pins[pin].mode : 0; }
+const std::vector<GpioEdge>& outputLog() { return s_outputLog; }
+void clearOutputLog() { s_outputLog.clear(); }
+
+} // namespace fakehal
+
+// ----------------------------------------------------------------- WiFi
+
+WiFiClass WiFi;
+static IPAddress s_localIp(192, 168, 1, 200);
+static std::string s_mac = "24:0A:C4:00:00:01";
+
+namespace fakehal {
+void setWifiConnected(bool connected) { s_wifiConnected = connected; }
+void setRssi(int8_t rssi) { s_rssi = rssi; }
+void setLocalIP(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { s_localIp = IPAddress(a, b, c, d); }
+void setMacAddress(const char* mac) { s_mac = mac; }
+} // namespace fakehal
+
+wl_status_t WiFiClass::begin(const char*, const char*) { return status(); }
+bool WiFiClass::config(IPAddress, IPAddress, IPAddress, IPAddress, IPAddress) { return true; }
+bool WiFiClass::disconnect(bool) { return true; }
+bool WiFiClass::reconnect() { return true; }
+wl_status_t WiFiClass::status() { return s_wifiConnected ? WL_CONNECTED : WL_DISCONNECTED; }
+IPAddress WiFiClass::localIP() { return s_wifiConnected ? s_localIp : IPAddress(); }
+String WiFiClass::SSID() { return s_wifiConnected ? String("host-sim-network") : String(); }
+int8_t WiFiClass::RSSI() { return s_wifiConnected ? s_rssi : 0; }
+String WiFiClass::macAddress() { return String(s_mac.c_str()); }
+static bool s_wifiSleep = true;
+bool WiFiClass::setSleep(bool enabled) { s_wifiSleep = enabled; return true; }
+bool WiFiClass::setSleep(wifi_ps_type_t type) { s_wifiSleep = type != WIFI_PS_NONE; return true; }
+bool WiFiClass::getSleep() { return s_wifiSleep; }
+
+// --------------------------------------------------------------- Serial
+
+HardwareSerial Serial;
+static std::string s_serialIn;
+static std::string s_serialOut;
+static bool s_serialEcho = false;
+
+int HardwareSerial::available() { return (int)s_serialIn.size(); }
+int HardwareSerial::read() {
+    if (s_serialIn.empty()) return -1;
+    int c = (uint8_t)s_serialIn[0];
+    s_serialIn.erase(0, 1);
+    return c;
+}
+int HardwareSerial::peek() { return s_serialIn.empty() ? -1 : (uint8_t)s_serialIn[0]; }
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    s_serialOut.append((const char*)buffer, size);
+    if (s_serialEcho) fwrite(buffer, 1, size, stdout);
+    return size;
+}
+int HardwareSerial::availableForWrite() { return 128; }
+
+namespace fakehal {
+void serialInject(const std::string& text) { s_serialIn += text; }
+std::string serialTakeOutput() { std::string o; o.swap(s_serialOut); return o; }
+void setSerialEcho(bool echo) { s_serialEcho = echo; }
+} // namespace fakehal
+
+// ------------------------------------------------------------------ NVS
+
+struct NvsValue {
+    enum Kind { INT, UINT, BOOL, STR, BYTES } kind;
+    int64_t i = 0;
+    std::string s;
+};
+static std::map<std::string, NvsValue> s_nvs;
+static uint32_t s_nvsReads = 0;
+
+static std::string nvsKey(const char* ns, const char* key) { return std::string(ns) + "/" + key; }
+
+uint32_t Preferences::readCount() { return s_nvsReads; }
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+    strncpy(_ns, name, sizeof(_ns) - 1);
+    _open = true;
+    _readOnly = readOnly;
+    return true;
+}
+void Preferences::end() { _open = false; }
+bool Preferences::clear() {
+    std::string prefix = std::string(_ns) + "/";
+    for (auto it = s_nvs.begin(); it != s_nvs.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) it = s_nvs.erase(it);
+        else ++it;
+    }
+    return true;
+}
+bool Preferences::remove(const char* key) { return s_nvs.erase(nvsKey(_ns, key)) > 0; }
+bool Preferences::isKey(const char* key) { return s_nvs.count(nvsKey(_ns, key)) > 0; }
+
+size_t Preferences::putInt(const char* key, int32_t v) {
+    if (!_open || _readOnly) return 0;
+    NvsValue n{NvsValue::INT}; n.i = v; s_nvs[nvsKey(_ns, key)] = n; return 4;
+}
+size_t Preferences::putUInt(const char* key, uint32_t v) {
+    if (!_open || _readOnly) return 0;
+    NvsValue n{NvsValue::UINT}; n.i = v; s_nvs[nvsKey(_ns, key)] = n; return 4;
+}
+size_t Preferences::putBool(const char* key, bool v) {
+    if (!_open || _readOnly) return 0;
+    NvsValue n{NvsValue::BOOL}; n.i = v; s_nvs[nvsKey(_ns, key)] = n; return 1;
+}
+size_t Preferences::putString(const char* key, const char* v) {
+    if (!_open || _readOnly) return 0;
+    NvsValue n{NvsValue::STR}; n.s = v; s_nvs[nvsKey(_ns, key)] = n; return n.s.size();
+}
+size_t Preferences::putBytes(const char* key, const void* v, size_t len) {
+    if (!_open || _readOnly) return 0;
+    NvsValue n{NvsValue::BYTES}; n.s.assign((const char*)v, len); s_nvs[nvsKey(_ns, key)] = n; return len;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t d) {
+    s_nvsReads++;
+    auto it = s_nvs.find(nvsKey(_ns, key));
+    return it == s_nvs.end() ? d : (int32_t)it->second.i;
+}
+uint32_t Preferences::getUInt(const char* key, uint32_t d) {
+    s_nvsReads++;
+    auto it = s_nvs.find(nvsKey(_ns, key));
+    return it == s_nvs.end() ? d : (uint32_t)it->second.i;
+}
+bool Preferences::getBool(const char* key, bool d) {
+    s_nvsReads++;
+    auto it = s_nvs.find(nvsKey(_ns, key));
+    return it == s_nvs.end() ? d : it->second.i != 0;
+}
+String Preferences::getString(const char* key, const String& d) {
+    s_nvsReads++;
+    auto it = s_nvs.find(nvsKey(_ns, key));
+    return it == s_nvs.end() ? d : String(it->second.s.c_str());
+}
+size_t Preferences::getBytesLength(const char* key) {
+    auto it = s_nvs.find(nvsKey(_ns, key));
+    return it == s_nvs.end() ? 0 : it->second.s.size();
+}
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    s_nvsReads++;
+    auto it = s_nvs.find(nvsKey(_ns, key));
+    if (it == s_nvs.end() || it->second.s.size() > maxLen) return 0;
+    memcpy(buf, it->second.s.data(), it->second.s.size());
+    return it->second.s.size();
+}
+
+// ------------------------------------------------------------------ LCD
+
+static char s_lcd[4][20];
+static uint8_t s_lcdCols = 16, s_lcdRows = 2;
+static uint8_t s_lcdCol = 0, s_lcdRow = 0;
+static uint32_t s_lcdBusBytes = 0;
+
+LiquidCrystal::LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t) {}
+
+void LiquidCrystal::begin(uint8_t cols, uint8_t rows) {
+    s_lcdCols = cols > 20 ? 20 : cols;
+    s_lcdRows = rows > 4 ? 4 : rows;
+    clear();
+}
+void LiquidCrystal::clear() {
+    memset(s_lcd, ' ', sizeof(s_lcd));
+    s_lcdCol = s_lcdRow = 0;
+    s_lcdBusBytes++;
+}
+void LiquidCrystal::home() { s_lcdCol = s_lcdRow = 0; s_lcdBusBytes++; }
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+    s_lcdCol = col;
+    s_lcdRow = row < s_lcdRows ? row : s_lcdRows - 1;
+    s_lcdBusBytes++;
+}
+void LiquidCrystal::command(uint8_t) { s_lcdBusBytes++; }
+size_t LiquidCrystal::write(uint8_t c) {
+    if (s_lcdCol < s_lcdCols) s_lcd[s_lcdRow][s_lcdCol] = (char)c;
+    s_lcdCol++;
+    s_lcdBusBytes++;
+    return 1;
+}
+
+namespace fakehal {
+std::string lcdLine(int row) {
+    if (row < 0 || row >= s_lcdRows) return std::string();
+    return std::string(s_lcd[row], s_lcdCols);
+}
+uint32_t lcdBusBytes() { return s_lcdBusBytes; }
+void resetLcdBusBytes() { s_lcdBusBytes = 0; }
+} // namespace fakehal
+
+// ------------------------------------------------------------ WebServer
+
+static WebServer* s_webServer = nullptr;
+
+WebServer::WebServer(int) { s_webServer = this; }
+WebServer::~WebServer() { if (s_webServer == this) s_webServer = nullptr; }
+WebServer* WebServer::instance() { return s_webServer; }
+
+void WebServer::on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn) { _routes.push_back({ uri.c_str(), method, fn, nullptr }); }
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+    _routes.push_back({ uri.c_str(), method, fn, ufn });
+}
+
+String WebServer::arg(const String& name) {
+    for (auto& a : _args) if (a.first == name.c_str()) return String(a.second.c_str());
+    return String();
+}
+bool WebServer::hasArg(const String& name) {
+    for (auto& a : _args) if (a.first == name.c_str()) return true;
+    return false;
+}
+String WebServer::header(const String& name) {
+    for (auto& h : _reqHeaders) if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return String(h.second.c_str());
+    return String();
+}
+bool WebServer::hasHeader(const String& name) {
+    for (auto& h : _reqHeaders) if (strcasecmp(h.first.c_str(), name.c_str()) == 0) return true;
+    return false;
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    _resp.code = code;
+    if (contentType) _resp.contentType = contentType;
+    _resp.body.append(content.c_str(), content.length());
+}
+void WebServer::sendHeader(const String& name, const String& value, bool) {
+    _resp.headers.push_back({ name.c_str(), value.c_str() });
+}
+void WebServer::sendContent(const char* content, size_t size) { _resp.body.append(content, size); }
+
+static std::string urlDecode(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '+') out += ' ';
+        else if (s[i] == '%' && i + 2 < s.size()) {
+            out += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else out += s[i];
+    }
+    return out;
+}
+
+WebServer::Response WebServer::request(HTTPMethod method, const char* uri, const char* query,
+                                       const std::string& body,
+                                       const std::vector<std::pair<std::string, std::string>>& headers) {
+    _resp = Response();
+    _uri = uri;
+    _method = method;
+    _reqHeaders = headers;
+    _contentLength = CONTENT_LENGTH_UNKNOWN;
+    _args.clear();
+    std::string q = query ? query : "";
+    size_t pos = 0;
+    while (pos < q.size()) {
+        size_t amp = q.find('&', pos);
+        std::string kv = q.substr(pos, amp == std::string::npos ? std::string::npos : amp - pos);
+        size_t eq = kv.find('=');
+        if (!kv.empty()) {
+            if (eq == std::string::npos) _args.push_back({ urlDecode(kv), "" });
+            else _args.push_back({ urlDecode(kv.substr(0, eq)), urlDecode(kv.substr(eq + 1)) });
+        }
+        if (amp == std::string::npos) break;
+        pos = amp + 1;
+    }
+
+    for (auto& r : _routes) {
+        if (r.uri != uri) continue;
+        if (r.method != HTTP_ANY && r.method != method) continue;
+        if (r.ufn) {
+            _upload.filename = "upload.bin";
+            _upload.name = "update";
+            _upload.totalSize = 0;
+            _upload.currentSize = 0;
+            _upload.status = UPLOAD_FILE_START;
+            r.ufn();
+            size_t off = 0;
+            while (off < body.size()) {
+                size_t n = body.size() - off;
+                if (n > HTTP_UPLOAD_BUFLEN) n = HTTP_UPLOAD_BUFLEN;
+                memcpy(_upload.buf, body.data() + off, n);
+                _upload.currentSize = n;
+                _upload.totalSize += n;
+                _upload.status = UPLOAD_FILE_WRITE;
+                r.ufn();
+                off += n;
+            }
+            _upload.currentSize = 0;
+            _upload.status = UPLOAD_FILE_END;
+            r.ufn();
+        }
+        r.fn();
+        return _resp;
+    }
+    if (_notFound) _notFound();
+    return _resp;
+}
+
+// ------------------------------------------------------------ OTA / ESP
+
+ArduinoOTAClass ArduinoOTA;
+UpdateClass Update;
+
+// With app partitions declared the image really goes into the next one,
+// and end() makes it the boot partition, as on the device
+bool UpdateClass::begin(size_t size, int) {
+    _running = true;
+    _error = 0;
+    _size = size;
+    _written = 0;
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (target) {
+        if (size != UPDATE_SIZE_UNKNOWN && size > target->size) { _running = false; _error = 1; return false; }
+        esp_partition_erase_range(target, 0, target->size);
+    }
+    return true;
+}
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+    if (!_running) { _error = 1; return 0; }
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (target) {
+        if (_written == 0 && len && data[0] != 0xE9) { _error = 1; return 0; } // ESP image magic
+        if (esp_partition_write(target, _written, data, len) != ESP_OK) { _error = 1; return 0; }
+    }
+    _written += len;
+    return len;
+}
+bool UpdateClass::end(bool) {
+    bool ok = _running && !_error && _written > 0;
+    _running = false;
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (ok && target) esp_ota_set_boot_partition(target);
+    return ok;
+}
+void UpdateClass::abort() { _running = false; _error = 1; }
+
+static uint32_t s_restarts = 0;
+static uint32_t s_wdtResets = 0;
+static bool s_deepSleep = false;
+static uint64_t s_sleepUs = 0;
+
+EspClass ESP;
+void EspClass::restart() { s_restarts++; }
+uint32_t EspClass::getFreeHeap() { return 200000; }
+uint32_t EspClass::getMinFreeHeap() { return 180000; }
+uint32_t EspClass::getMaxAllocHeap() { return 110000; }
+uint32_t EspClass::getHeapSize() { return 300000; }
+uint64_t EspClass::getEfuseMac() { return 0x0100C40A24ULL; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(clockNow() * s_cpuMhz); }
+
+#include <esp_timer.h>
+int64_t esp_timer_get_time(void) { return (int64_t)clockNow(); }
+
+esp_err_t esp_task_wdt_init(const esp_task_wdt_config_t*) { return ESP_OK; }
+esp_err_t esp_task_wdt_add(void*) { return ESP_OK; }
+esp_err_t esp_task_wdt_reset(void) { s_wdtResets++; return ESP_OK; }
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t, int) { return 0; }
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) { s_sleepUs = us; return 0; }
+void esp_deep_sleep_start(void) { s_deepSleep = true; }
+
+static bool s_lightSleepSupported = false;
+static bool s_gpioWakeup = false;
+static int8_t s_gpioWakeLevel[40] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+static int8_t s_napWakeLevel[40] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void) { s_gpioWakeup = true; return 0; }
+
+// Like the IDF driver, enabling the wakeup rewrites the pin's interrupt
+// type and disabling it leaves that level type behind
+int gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+    if (pin >= 40 || (type != GPIO_INTR_LOW_LEVEL && type != GPIO_INTR_HIGH_LEVEL)) return ESP_ERR_INVALID_ARG;
+    s_gpioWakeLevel[pin] = type == GPIO_INTR_HIGH_LEVEL ? HIGH : LOW;
+    s_pins[pin].intrType = type;
+    return ESP_OK;
+}
+int gpio_wakeup_disable(gpio_num_t pin) {
+    if (pin >= 40) return ESP_ERR_INVALID_ARG;
+    s_gpioWakeLevel[pin] = -1;
+    return ESP_OK;
+}
+
+#include <esp_pm.h>
+esp_err_t esp_pm_configure(const void* config) {
+    const esp_pm_config_t* pm = (const esp_pm_config_t*)config;
+    return pm->light_sleep_enable && !s_lightSleepSupported ? ESP_ERR_NOT_SUPPORTED : ESP_OK;
+}
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+
+namespace fakehal {
+uint32_t restartCount() { return s_restarts; }
+bool deepSleepRequested(uint64_t* sleepUs) {
+    if (sleepUs) *sleepUs = s_sleepUs;
+    return s_deepSleep;
+}
+uint32_t wdtResetCount() { return s_wdtResets; }
+void setLightSleepSupported(bool supported) { s_lightSleepSupported = supported; }
+bool gpioWakeupEnabled() { return s_gpioWakeup; }
+int gpioWakeLevel(uint8_t pin) { return pin < 40 ? s_gpioWakeLevel[pin] : -1; }
+int napWakeLevel(uint8_t pin) { return pin < 40 ? s_napWakeLevel[pin] : -1; }
+} // namespace fakehal
+
+// ------------------------------------------------------------ partitions
+
+#include <esp_partition.h>
+#include <esp_system.h>
+
+struct FakePartition {
+    esp_partition_t info;
+    std::vector<uint8_t> data;
+};
+static std::vector<FakePartition*> s_partitions;
+static esp_reset_reason_t s_resetReason = ESP_RST_POWERON;
+static uint32_t s_flashErases = 0;
+
+esp_reset_reason_t esp_reset_reason(void) { return s_resetReason; }
+
+static FakePartition* findPartition(const esp_partition_t* part) {
+    for (FakePartition* p : s_partitions) if (&p->info == part) return p;
+    return nullptr;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    for (FakePartition* p : s_partitions) {
+        if (p->info.type != type) continue;
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY && p->info.subtype != subtype) continue;
+        if (label && strcmp(label, p->info.label) != 0) continue;
+        return &p->info;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+    FakePartition* p = findPartition(part);
+    if (!p || offset + size > p->data.size()) return ESP_FAIL;
+    memcpy(dst, &p->data[offset], size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+    FakePartition* p = findPartition(part);
+    if (!p || offset + size > p->data.size()) return ESP_FAIL;
+    const uint8_t* in = (const uint8_t*)src;
+    for (size_t i = 0; i < size; i++) p->data[offset + i] &= in[i];
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+    FakePartition* p = findPartition(part);
+    if (!p || offset % 4096 || size % 4096 || offset + size > p->data.size()) return ESP_FAIL;
+    memset(&p->data[offset], 0xFF, size);
+    s_flashErases++;
+    return ESP_OK;
+}
+
+static const esp_partition_t* s_runningApp = nullptr;
+static const esp_partition_t* s_bootApp = nullptr;
+static bool s_appValid = false;
+
+static const esp_partition_t* firstApp(const esp_partition_t* except) {
+    for (FakePartition* p : s_partitions) {
+        if (p->info.type == ESP_PARTITION_TYPE_APP && &p->info != except) return &p->info;
+    }
+    return nullptr;
+}
+
+const esp_partition_t* esp_ota_get_running_partition(void) {
+    if (!s_runningApp) s_runningApp = firstApp(nullptr);
+    return s_runningApp;
+}
+const esp_partition_t* esp_ota_get_boot_partition(void) {
+    return s_bootApp ? s_bootApp : esp_ota_get_running_partition();
+}
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    return running ? firstApp(running) : nullptr;
+}
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    if (!partition || partition->type != ESP_PARTITION_TYPE_APP) return ESP_FAIL;
+    s_bootApp = partition;
+    return ESP_OK;
+}
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void) { s_appValid = true; return ESP_OK; }
+
+namespace fakehal {
+void setRunningPartition(const char* label) {
+    s_runningApp = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, label);
+    s_bootApp = nullptr;
+    s_appValid = false;
+}
+std::string bootPartition() {
+    const esp_partition_t* p = esp_ota_get_boot_partition();
+    return p ? p->label : "";
+}
+bool appMarkedValid() { return s_appValid; }
+void addPartition(const char* label, uint8_t type, uint8_t subtype, uint32_t size) {
+    FakePartition* p = new FakePartition();
+    p->info.type = (esp_partition_type_t)type;
+    p->info.subtype = (esp_partition_subtype_t)subtype;
+    p->info.size = size;
+    strncpy(p->info.label, label, sizeof(p->info.label) - 1);
+    p->data.assign(size, 0xFF);
+    s_partitions.push_back(p);
+}
+std::vector<uint8_t>* partitionData(const char* label) {
+    for (FakePartition* p : s_partitions) if (strcmp(p->info.label, label) == 0) return &p->data;
+    return nullptr;
+}
+uint32_t flashErases() { return s_flashErases; }
+void setResetReason(int reason) { s_resetReason = (esp_reset_reason_t)reason; }
+} // namespace fakehal
+
+// ------------------------------------------------------------- FreeRTOS
+
+#include <freertos/task.h>
+
+static uint32_t s_notifyCount = 0;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+    if (handle) *handle = nullptr;
+    return pdFAIL;
+}
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param, UBaseType_t prio, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack, param, prio, handle, 0);
+}
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return (TaskHandle_t)&s_notifyCount; }
+void vTaskDelay(TickType_t ticks) { passTime((uint64_t)ticks * 1000ULL); }
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(clockNow() / 1000ULL); }
+BaseType_t xTaskNotifyGive(TaskHandle_t) { s_notifyCount++; return pdPASS; }
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) { s_notifyCount++; if (woken) *woken = pdFALSE; }
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    memcpy(s_napWakeLevel, s_gpioWakeLevel, sizeof(s_napWakeLevel));
+    if (s_notifyCount == 0 && ticksToWait != portMAX_DELAY) passTime((uint64_t)ticksToWait * 1000ULL);
+    uint32_t n = s_notifyCount;
+    if (clearOnExit) s_notifyCount = 0;
+    else if (s_notifyCount) s_notifyCount--;
+    return n;
+}
+void vTaskDelete(TaskHandle_t) {}
+
+// ---------------------------------------------------------------- I2C
+
+static bool s_i2cPresent[128];
+static uint32_t s_i2cBytes = 0;
+static uint32_t s_i2cTransactions = 0;
+
+TwoWire Wire;
+
+bool TwoWire::begin(int, int, uint32_t frequency) {
+    if (frequency) _clock = frequency;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    _address = address & 0x7F;
+    _pending = 0;
+}
+
+size_t TwoWire::write(uint8_t) { _pending++; return 1; }
+size_t TwoWire::write(const uint8_t*, size_t len) { _pending += len; return len; }
+
+uint8_t TwoWire::endTransmission(bool) {
+    s_i2cBytes += 1 + _pending;
+    s_i2cTransactions++;
+    _pending = 0;
+    return s_i2cPresent[_address] ? 0 : 2; // 2 = NACK on address
+}
+
+namespace fakehal {
+void setI2cDevicePresent(uint8_t address, bool present) { s_i2cPresent[address & 0x7F] = present; }
+uint32_t i2cBytes() { return s_i2cBytes; }
+uint32_t i2cTransactions() { return s_i2cTransactions; }
+} // namespace fakehal
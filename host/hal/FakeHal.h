@@ -0,0 +1,99 @@
+// Control surface for the host HAL. Tests, benchmarks and the simulator
+// drive the firmware through these calls instead of real hardware.
+#ifndef HOST_FAKE_HAL_H
+#define HOST_FAKE_HAL_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace fakehal {
+
+// --- Clock ---
+// Simulated monotonic clock behind millis()/micros(). delay() advances it.
+uint64_t nowMicros();
+void setMicros(uint64_t us);
+void advanceMicros(uint64_t us);
+inline void advanceMillis(uint64_t ms) { advanceMicros(ms * 1000ULL); }
+// Real time: the clock follows the host's monotonic clock from here on and
+// delays really sleep, for talking to other processes over sockets.
+// toMonotonicMicros() turns a timestamp back into CLOCK_MONOTONIC, which
+// all processes on the machine share.
+void setRealtime(bool realtime);
+uint64_t toMonotonicMicros(uint64_t us);
+
+// Wall clock: epoch seconds (UTC) at simulated t = 0. getLocalTime() fails
+// until the network is connected and NTP is allowed to sync.
+void setEpoch(int64_t epochAtZero);
+void setLocalTime(int year, int month, int day, int hour, int minute, int second);
+void setNtpAvailable(bool available);
+void ntpSyncNow(); // Runs the SNTP sync notification callback
+void setClockError(int64_t errorUs); // Wall clock off by this much (a bad NTP sync)
+
+// --- GPIO ---
+struct GpioEdge {
+    uint64_t timeUs;
+    uint8_t pin;
+    uint8_t level;
+};
+// Drive an input pin (fires any attached interrupt on a matching edge).
+void setInput(uint8_t pin, int level);
+int pinLevel(uint8_t pin);
+int pinMode(uint8_t pin);
+const std::vector<GpioEdge>& outputLog();
+void clearOutputLog();
+
+// --- WiFi ---
+void setWifiConnected(bool connected);
+void setRssi(int8_t rssi);
+void setLocalIP(uint8_t a, uint8_t b, uint8_t c, uint8_t d); // 127.0.0.1 for real sockets
+void setMacAddress(const char* mac);
+
+// --- LCD framebuffer ---
+std::string lcdLine(int row);
+uint32_t lcdBusBytes();
+void resetLcdBusBytes();
+
+// --- I2C ---
+void setI2cDevicePresent(uint8_t address, bool present);
+uint32_t i2cBytes();         // Address + payload bytes ended with endTransmission()
+uint32_t i2cTransactions();
+
+// --- Serial ---
+void serialInject(const std::string& text);
+std::string serialTakeOutput();
+void setSerialEcho(bool echo);
+
+// --- System ---
+uint32_t restartCount();
+bool deepSleepRequested(uint64_t* sleepUs = nullptr);
+uint32_t wdtResetCount();
+// Tickless idle built in: esp_pm_configure() accepts light_sleep_enable
+void setLightSleepSupported(bool supported);
+bool gpioWakeupEnabled();       // esp_sleep_enable_gpio_wakeup() was called
+int gpioWakeLevel(uint8_t pin); // Level gpio_wakeup_enable() armed, -1 = none
+int napWakeLevel(uint8_t pin);  // gpioWakeLevel() while the last ulTaskNotifyTake() blocked
+
+// --- Flash partitions ---
+void addPartition(const char* label, uint8_t type, uint8_t subtype, uint32_t size);
+std::vector<uint8_t>* partitionData(const char* label); // Raw bytes, for power-cut tests
+uint32_t flashErases();
+void setResetReason(int reason);
+// App partitions: which one is running (default: the first added) and which
+// one the next boot would use. Update writes into the other one.
+void setRunningPartition(const char* label);
+std::string bootPartition();
+bool appMarkedValid(); // esp_ota_mark_app_valid_cancel_rollback() was called
+
+// --- Sketch loop ---
+// Runs the sketch's loop() for ms of simulated time, after setup(). A pass
+// that did not block still moves the clock by 100 us. Serial output is
+// dropped; the hook (if set) is called after every pass.
+void runLoop(uint64_t ms);
+void setLoopHook(void (*hook)());
+// Holds an input LOW for holdMs, then releases it and runs 500 ms more
+void press(uint8_t pin, uint64_t holdMs);
+
+} // namespace fakehal
+
+#endif
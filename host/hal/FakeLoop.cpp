@@ -0,0 +1,32 @@
+// Loop driver for tests that boot the whole sketch. Kept out of FakeHal.cpp
+// so only programs that link the sketch pull in the loop() reference.
+#include "FakeHal.h"
+#include <Arduino.h>
+
+void loop();
+
+namespace fakehal {
+
+static void (*s_loopHook)() = nullptr;
+
+void setLoopHook(void (*hook)()) { s_loopHook = hook; }
+
+void runLoop(uint64_t ms) {
+    uint64_t endUs = nowMicros() + ms * 1000ULL;
+    while (nowMicros() < endUs) {
+        uint64_t before = nowMicros();
+        loop();
+        if (nowMicros() == before) advanceMicros(100);
+        if (s_loopHook) s_loopHook();
+        serialTakeOutput();
+    }
+}
+
+void press(uint8_t pin, uint64_t holdMs) {
+    setInput(pin, LOW);
+    runLoop(holdMs);
+    setInput(pin, HIGH);
+    runLoop(500);
+}
+
+} // namespace fakehal
@@ -0,0 +1,34 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+    IPAddress() : _addr{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr{a, b, c, d} {}
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) return false;
+        _addr[0] = a; _addr[1] = b; _addr[2] = c; _addr[3] = d;
+        return true;
+    }
+    bool fromString(const String& s) { return fromString(s.c_str()); }
+    uint8_t operator[](int i) const { return _addr[i]; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _addr[0], _addr[1], _addr[2], _addr[3]);
+        return String(buf);
+    }
+    size_t printTo(Print& p) const override { return p.print(toString()); }
+    bool operator==(const IPAddress& o) const {
+        return _addr[0] == o._addr[0] && _addr[1] == o._addr[1] && _addr[2] == o._addr[2] && _addr[3] == o._addr[3];
+    }
+
+private:
+    uint8_t _addr[4];
+};
+
+#endif
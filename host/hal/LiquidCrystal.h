@@ -0,0 +1,24 @@
+#ifndef HOST_LIQUID_CRYSTAL_H
+#define HOST_LIQUID_CRYSTAL_H
+
+#include <Arduino.h>
+#include "Print.h"
+
+// Framebuffer-backed HD44780: cursor moves and writes land in an in-memory
+// character grid that FakeHal can inspect; bus traffic is counted.
+class LiquidCrystal : public Print {
+public:
+    LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+    void begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void command(uint8_t value);
+    void noDisplay() {}
+    void display() {}
+    void createChar(uint8_t, uint8_t[]) {}
+    size_t write(uint8_t c) override;
+    using Print::write;
+};
+
+#endif
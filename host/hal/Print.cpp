@@ -0,0 +1,61 @@
+#include "Print.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::write(const char* str) {
+    return str ? write((const uint8_t*)str, strlen(str)) : 0;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, format);
+    int len = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+    if (len < 0) return 0;
+    if ((size_t)len >= sizeof(buf)) len = sizeof(buf) - 1;
+    return write((const uint8_t*)buf, len);
+}
+
+size_t Print::print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+size_t Print::print(const char* s) { return write(s); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char n, int base) { return print((unsigned long)n, base); }
+size_t Print::print(int n, int base) { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base) { return print((unsigned long)n, base); }
+// Numbers are formatted on the stack like the real Print, so printing does
+// not show up in the heap allocation counts
+static size_t printNumber(Print& p, unsigned long long n, int base, bool negative) {
+    char buf[66];
+    char* s = buf + sizeof(buf);
+    if (base < 2) base = 10;
+    do {
+        int d = n % base;
+        *--s = d < 10 ? '0' + d : 'A' + d - 10;
+        n /= base;
+    } while (n);
+    if (negative) *--s = '-';
+    return p.write((const uint8_t*)s, buf + sizeof(buf) - s);
+}
+
+size_t Print::print(long n, int base) { return print((long long)n, base); }
+size_t Print::print(unsigned long n, int base) { return printNumber(*this, n, base, false); }
+size_t Print::print(long long n, int base) {
+    if (n < 0 && base == 10) return printNumber(*this, 0ULL - (unsigned long long)n, base, true);
+    return printNumber(*this, (unsigned long long)n, base, false);
+}
+size_t Print::print(unsigned long long n, int base) { return printNumber(*this, n, base, false); }
+size_t Print::print(double n, int digits) {
+    char buf[48];
+    int len = snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write((const uint8_t*)buf, len < (int)sizeof(buf) ? len : sizeof(buf) - 1);
+}
+size_t Print::print(const Printable& p) { return p.printTo(*this); }
+size_t Print::println() { return write((const uint8_t*)"\r\n", 2); }
@@ -0,0 +1,34 @@
+#ifndef HOST_UPDATE_H
+#define HOST_UPDATE_H
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+// Records the image written through the Update API into host memory.
+class UpdateClass {
+public:
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH);
+    size_t write(uint8_t* data, size_t len);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+    bool hasError() { return _error != 0; }
+    uint8_t getError() { return _error; }
+    void printError(Print& out) { out.println(errorString()); }
+    const char* errorString() { return _error ? "Update error" : "No Error"; }
+    bool isRunning() { return _running; }
+    size_t progress() { return _written; }
+    size_t size() { return _size; }
+
+private:
+    bool _running = false;
+    uint8_t _error = 0;
+    size_t _size = 0;
+    size_t _written = 0;
+};
+
+extern UpdateClass Update;
+
+#endif
@@ -0,0 +1,211 @@
+#include "WString.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "esp_heap_caps.h"
+
+static uint32_t s_stringAllocs = 0;
+
+// Firmware may define the real one to count heap allocations
+__attribute__((weak)) void esp_heap_trace_alloc_hook(void*, size_t, uint32_t) {}
+
+uint32_t String::allocationCount() { return s_stringAllocs; }
+
+String::String(const char* cstr) { if (cstr) copy(cstr, strlen(cstr)); }
+String::String(const char* cstr, unsigned int length) { if (cstr) copy(cstr, length); }
+String::String(const String& str) { *this = str; }
+String::String(String&& rval) { move(rval); }
+String::String(char c) { char b[2] = { c, 0 }; copy(b, 1); }
+
+static void formatUnsigned(char* buf, unsigned long long v, unsigned char base) {
+    char tmp[66];
+    int i = 0;
+    if (base < 2) base = 10;
+    do {
+        int d = v % base;
+        tmp[i++] = d < 10 ? '0' + d : 'a' + d - 10;
+        v /= base;
+    } while (v);
+    int j = 0;
+    while (i) buf[j++] = tmp[--i];
+    buf[j] = 0;
+}
+
+static void formatSigned(char* buf, long long v, unsigned char base) {
+    if (v < 0 && base == 10) {
+        buf[0] = '-';
+        formatUnsigned(buf + 1, (unsigned long long)(-(v + 1)) + 1, base);
+    } else {
+        formatUnsigned(buf, (unsigned long long)v, base);
+    }
+}
+
+String::String(unsigned char value, unsigned char base) { char b[66]; formatUnsigned(b, value, base); *this = b; }
+String::String(int value, unsigned char base) { char b[67]; formatSigned(b, value, base); *this = b; }
+String::String(unsigned int value, unsigned char base) { char b[66]; formatUnsigned(b, value, base); *this = b; }
+String::String(long value, unsigned char base) { char b[67]; formatSigned(b, value, base); *this = b; }
+String::String(unsigned long value, unsigned char base) { char b[66]; formatUnsigned(b, value, base); *this = b; }
+String::String(long long value, unsigned char base) { char b[67]; formatSigned(b, value, base); *this = b; }
+String::String(unsigned long long value, unsigned char base) { char b[66]; formatUnsigned(b, value, base); *this = b; }
+String::String(float value, unsigned int decimalPlaces) { char b[48]; snprintf(b, sizeof(b), "%.*f", decimalPlaces, value); *this = b; }
+String::String(double value, unsigned int decimalPlaces) { char b[48]; snprintf(b, sizeof(b), "%.*f", decimalPlaces, value); *this = b; }
+
+String::~String() { free(_buf); }
+
+void String::invalidate() {
+    free(_buf);
+    _buf = nullptr;
+    _cap = _len = 0;
+}
+
+bool String::grow(unsigned int size) {
+    if (_buf && _cap >= size) return true;
+    char* nb = (char*)realloc(_buf, size + 1);
+    if (!nb) return false;
+    s_stringAllocs++;
+    esp_heap_trace_alloc_hook(nb, size + 1, MALLOC_CAP_8BIT);
+    if (!_buf) nb[0] = 0;
+    _buf = nb;
+    _cap = size;
+    return true;
+}
+
+bool String::reserve(unsigned int size) { return grow(size); }
+
+String& String::copy(const char* cstr, unsigned int length) {
+    if (!grow(length)) { invalidate(); return *this; }
+    _len = length;
+    memmove(_buf, cstr, length);
+    _buf[length] = 0;
+    return *this;
+}
+
+void String::move(String& rhs) {
+    if (this == &rhs) return;
+    free(_buf);
+    _buf = rhs._buf; _cap = rhs._cap; _len = rhs._len;
+    rhs._buf = nullptr; rhs._cap = rhs._len = 0;
+}
+
+String& String::operator=(const String& rhs) {
+    if (this == &rhs) return *this;
+    if (rhs._buf) copy(rhs._buf, rhs._len);
+    else invalidate();
+    return *this;
+}
+
+String& String::operator=(const char* cstr) {
+    if (cstr) copy(cstr, strlen(cstr));
+    else invalidate();
+    return *this;
+}
+
+String& String::operator=(String&& rval) { move(rval); return *this; }
+
+bool String::concat(const char* cstr, unsigned int length) {
+    if (!cstr) return false;
+    if (length == 0) return true;
+    unsigned int newLen = _len + length;
+    // Handle self-append: cstr may point into our own buffer.
+    if (_buf && cstr >= _buf && cstr < _buf + _cap + 1) {
+        size_t off = cstr - _buf;
+        if (!grow(newLen)) return false;
+        cstr = _buf + off;
+    } else if (!grow(newLen)) {
+        return false;
+    }
+    memmove(_buf + _len, cstr, length);
+    _len = newLen;
+    _buf[_len] = 0;
+    return true;
+}
+
+bool String::concat(const String& s) { return concat(s.c_str(), s._len); }
+bool String::concat(const char* cstr) { return cstr ? concat(cstr, strlen(cstr)) : false; }
+bool String::concat(char c) { return concat(&c, 1); }
+bool String::concat(int num) { String s(num); return concat(s); }
+bool String::concat(unsigned int num) { String s(num); return concat(s); }
+bool String::concat(long num) { String s(num); return concat(s); }
+bool String::concat(unsigned long num) { String s(num); return concat(s); }
+bool String::concat(float num) { String s(num); return concat(s); }
+bool String::concat(double num) { String s(num); return concat(s); }
+
+StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs); a.concat(rhs); return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, const char* cstr) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs); a.concat(cstr); return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, char c) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs); a.concat(c); return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, int num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs); a.concat(num); return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, unsigned int num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs); a.concat(num); return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, long num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs); a.concat(num); return a;
+}
+StringSumHelper& operator+(const StringSumHelper& lhs, unsigned long num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs); a.concat(num); return a;
+}
+
+bool String::equals(const String& s) const { return _len == s._len && strcmp(c_str(), s.c_str()) == 0; }
+bool String::equals(const char* cstr) const { return strcmp(c_str(), cstr ? cstr : "") == 0; }
+bool String::equalsIgnoreCase(const String& s) const {
+    if (_len != s._len) return false;
+    return strcasecmp(c_str(), s.c_str()) == 0;
+}
+bool String::startsWith(const String& prefix) const {
+    return prefix._len <= _len && strncmp(c_str(), prefix.c_str(), prefix._len) == 0;
+}
+bool String::endsWith(const String& suffix) const {
+    return suffix._len <= _len && strcmp(c_str() + _len - suffix._len, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const { return index < _len ? _buf[index] : 0; }
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _len) { dummy = 0; return dummy; }
+    return _buf[index];
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* p = strchr(_buf + fromIndex, ch);
+    return p ? (int)(p - _buf) : -1;
+}
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* p = strstr(_buf + fromIndex, str.c_str());
+    return p ? (int)(p - _buf) : -1;
+}
+int String::lastIndexOf(char ch) const {
+    if (!_len) return -1;
+    const char* p = strrchr(_buf, ch);
+    return p ? (int)(p - _buf) : -1;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+    if (left > right) { unsigned int t = left; left = right; right = t; }
+    if (left >= _len) return String();
+    if (right > _len) right = _len;
+    return String(_buf + left, right - left);
+}
+
+void String::trim() {
+    if (!_len) return;
+    unsigned int b = 0, e = _len;
+    while (b < e && isspace((unsigned char)_buf[b])) b++;
+    while (e > b && isspace((unsigned char)_buf[e - 1])) e--;
+    _len = e - b;
+    memmove(_buf, _buf + b, _len);
+    _buf[_len] = 0;
+}
+void String::toLowerCase() { for (unsigned int i = 0; i < _len; i++) _buf[i] = tolower((unsigned char)_buf[i]); }
+void String::toUpperCase() { for (unsigned int i = 0; i < _len; i++) _buf[i] = toupper((unsigned char)_buf[i]); }
+long String::toInt() const { return _len ? atol(_buf) : 0; }
+float String::toFloat() const { return _len ? (float)atof(_buf) : 0; }
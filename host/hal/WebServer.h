@@ -0,0 +1,93 @@
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include <Arduino.h>
+#include <vector>
+#include <string>
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS } HTTPMethod;
+typedef enum { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED } HTTPUploadStatus;
+
+#define HTTP_UPLOAD_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+typedef struct {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+} HTTPUpload;
+
+// Loopback web server: requests are injected with request() and the
+// response is captured instead of going out over a socket.
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServer(int port = 80);
+    ~WebServer();
+
+    void begin() {}
+    void handleClient() {}
+    void on(const String& uri, THandlerFunction handler);
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn);
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+
+    String arg(const String& name);
+    bool hasArg(const String& name);
+    int args() { return (int)_args.size(); }
+    String argName(int i) { return _args[i].first.c_str(); }
+    String arg(int i) { return _args[i].second.c_str(); }
+    String uri() { return _uri.c_str(); }
+    HTTPMethod method() { return _method; }
+    String header(const String& name);
+    bool hasHeader(const String& name);
+    void collectHeaders(const char* headerKeys[], size_t count) { (void)headerKeys; (void)count; }
+    HTTPUpload& upload() { return _upload; }
+
+    void send(int code, const char* contentType = nullptr, const String& content = String());
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+    void send_P(int code, const char* contentType, const char* content) { send(code, contentType, String(content)); }
+    void send_P(int code, const char* contentType, const char* content, size_t size) { send(code, contentType, String(content, size)); }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void setContentLength(size_t len) { _contentLength = len; }
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t size);
+
+    struct Response {
+        int code = 0;
+        std::string contentType;
+        std::string body;
+        std::vector<std::pair<std::string, std::string>> headers;
+    };
+
+    // Host-only: dispatch one request. `query` is "a=1&b=2"; `body` is fed
+    // to an upload handler in HTTP_UPLOAD_BUFLEN chunks if one is attached.
+    Response request(HTTPMethod method, const char* uri, const char* query = "",
+                     const std::string& body = std::string(),
+                     const std::vector<std::pair<std::string, std::string>>& headers = {});
+    static WebServer* instance();
+
+private:
+    struct Route {
+        std::string uri;
+        HTTPMethod method;
+        THandlerFunction fn;
+        THandlerFunction ufn;
+    };
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    std::vector<std::pair<std::string, std::string>> _args;
+    std::vector<std::pair<std::string, std::string>> _reqHeaders;
+    std::string _uri;
+    HTTPMethod _method = HTTP_GET;
+    HTTPUpload _upload;
+    Response _resp;
+    size_t _contentLength = CONTENT_LENGTH_UNKNOWN;
+};
+
+#endif
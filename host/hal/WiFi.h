@@ -0,0 +1,37 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include "IPAddress.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+// Simulated station: connection state and RSSI are set through FakeHal.
+class WiFiClass {
+public:
+    wl_status_t begin(const char* ssid, const char* pass);
+    bool config(IPAddress ip, IPAddress gw, IPAddress sn, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    bool disconnect(bool wifioff = false);
+    bool reconnect();
+    wl_status_t status();
+    IPAddress localIP();
+    String SSID();
+    int8_t RSSI();
+    String macAddress();
+    bool setSleep(bool enabled);
+    bool setSleep(wifi_ps_type_t type);
+    bool getSleep();
+};
+
+extern WiFiClass WiFi;
+
+#endif
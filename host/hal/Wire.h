@@ -0,0 +1,25 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+// I2C master that records traffic. No devices answer unless FakeHal says
+// so (fakehal::setI2cDevicePresent).
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void setClock(uint32_t frequency) { _clock = frequency; }
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    size_t write(const uint8_t* data, size_t len);
+    uint8_t endTransmission(bool sendStop = true);
+
+private:
+    uint32_t _clock = 100000;
+    uint8_t _address = 0;
+    size_t _pending = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+typedef enum {
+    GPIO_NUM_0 = 0, GPIO_NUM_2 = 2, GPIO_NUM_4 = 4, GPIO_NUM_5 = 5,
+    GPIO_NUM_13 = 13, GPIO_NUM_16 = 16, GPIO_NUM_17 = 17, GPIO_NUM_18 = 18,
+    GPIO_NUM_19 = 19, GPIO_NUM_21 = 21, GPIO_NUM_22 = 22, GPIO_NUM_23 = 23,
+    GPIO_NUM_25 = 25, GPIO_NUM_26 = 26, GPIO_NUM_MAX = 40
+} gpio_num_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE, GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL, GPIO_INTR_HIGH_LEVEL
+} gpio_int_type_t;
+
+// Light sleep wakeup, level triggered only (see fakehal::gpioWakeLevel)
+int gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type);
+int gpio_wakeup_disable(gpio_num_t gpio_num);
+
+// Interrupt type shared with the wakeup (see fakehal::setInput)
+int gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type);
+int gpio_intr_enable(gpio_num_t gpio_num);
+int gpio_intr_disable(gpio_num_t gpio_num);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The fake String reports its (re)allocations through the same hook the
+// ESP-IDF heap calls when built with CONFIG_HEAP_USE_HOOKS
+#ifndef CONFIG_HEAP_USE_HOOKS
+#define CONFIG_HEAP_USE_HOOKS 1
+#endif
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_ESP_PM_H
+#define HOST_ESP_PM_H
+
+#include "esp_task_wdt.h" // esp_err_t / ESP_OK
+
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_t;
+
+// Behaves like a stock Arduino build: DFS works, light sleep needs
+// CONFIG_FREERTOS_USE_TICKLESS_IDLE and is refused (unless
+// fakehal::setLightSleepSupported(true)).
+esp_err_t esp_pm_configure(const void* config);
+
+#endif
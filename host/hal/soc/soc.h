@@ -0,0 +1,10 @@
+#ifndef HOST_SOC_SOC_H
+#define HOST_SOC_SOC_H
+
+#include <stdint.h>
+
+// Register reads are served from the simulated GPIO input levels.
+uint32_t fakehal_reg_read(uint32_t addr);
+#define REG_READ(addr) fakehal_reg_read((uint32_t)(addr))
+
+#endif
@@ -0,0 +1,226 @@
+// Host side of firmware updates: signs an image for /update with the key
+// in Config.h (or --key), checks a signed one, and makes a signed delta
+// from the image a unit runs to a new one (layout in OtaManager.h).
+//
+//   ramzan_ota sign firmware.bin firmware.signed.bin [--key KEY]
+//   ramzan_ota verify firmware.signed.bin [--key KEY]
+//   ramzan_ota diff running.bin firmware.bin firmware.delta [--key KEY]
+//
+// Images given to diff may be signed or not.
+#include <Arduino.h>
+#include "Config.h"
+#include "OtaManager.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+static void usage() {
+    fprintf(stderr, "usage: ramzan_ota sign IMAGE OUT [--key KEY]\n"
+                    "       ramzan_ota verify SIGNED [--key KEY]\n"
+                    "       ramzan_ota diff BASE IMAGE OUT [--key KEY]\n");
+    exit(2);
+}
+
+static bool readFile(const char* path, std::string& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const char* path, const std::string& data) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static bool isAppImage(const std::string& data) {
+    return !data.empty() && (uint8_t)data[0] == OtaManager::IMAGE_MAGIC;
+}
+
+// The device never writes the trailer, so it is not part of the base
+static void stripTrailer(std::string& data) {
+    OtaTrailer t;
+    if (data.size() < sizeof(t)) return;
+    memcpy(&t, data.data() + data.size() - sizeof(t), sizeof(t));
+    if (t.magic == OtaManager::TRAILER_MAGIC && t.imageSize == data.size() - sizeof(t)) data.resize(t.imageSize);
+}
+
+static void putVarint(std::string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+static const size_t WINDOW = 8;       // Bytes hashed to find copy sources
+static const size_t MAX_TRIES = 16;   // Sources tried per position
+static const size_t MIN_SEEK = 12;    // Shortest copy worth a jump
+static const size_t MIN_STAY = 6;     // Shortest copy that carries on where the last one ended
+
+static uint64_t windowAt(const std::string& s, size_t i) {
+    uint64_t w;
+    memcpy(&w, s.data() + i, WINDOW);
+    return w;
+}
+
+static size_t matchLen(const std::string& a, size_t ai, const std::string& b, size_t bi) {
+    size_t n = 0;
+    while (ai + n < a.size() && bi + n < b.size() && a[ai + n] == b[bi + n]) n++;
+    return n;
+}
+
+// Greedy: copy from the running image wherever a run of the new one is
+// found in it, add the rest. Carrying on in step with the last copy is
+// tried first, so an image where only addresses moved costs a few bytes
+// per change.
+static std::string makeDelta(const std::string& base, const std::string& target) {
+    std::vector<std::pair<uint64_t, uint32_t>> index;
+    for (size_t i = 0; i + WINDOW <= base.size(); i++) index.push_back({ windowAt(base, i), (uint32_t)i });
+    std::sort(index.begin(), index.end());
+
+    std::string out;
+    size_t basePos = 0, addStart = 0, i = 0;
+    auto record = [&](size_t addEnd, size_t from, size_t copy) {
+        putVarint(out, addEnd - addStart);
+        out.append(target, addStart, addEnd - addStart);
+        int32_t seek = (int32_t)from - (int32_t)(basePos + addEnd - addStart);
+        putVarint(out, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31)); // Zigzag
+        putVarint(out, copy);
+        basePos = from + copy;
+    };
+    while (i < target.size()) {
+        size_t stay = basePos + (i - addStart); // Added bytes usually stand in for as many old ones
+        size_t bestLen = stay < base.size() ? matchLen(base, stay, target, i) : 0;
+        size_t bestFrom = stay;
+        if (bestLen < MIN_STAY && i + WINDOW <= target.size()) {
+            bestLen = 0;
+            auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(windowAt(target, i), (uint32_t)0));
+            for (size_t tries = 0; it != index.end() && it->first == windowAt(target, i) && tries < MAX_TRIES; ++it, tries++) {
+                size_t n = matchLen(base, it->second, target, i);
+                if (n > bestLen) {
+                    bestLen = n;
+                    bestFrom = it->second;
+                }
+            }
+            if (bestLen < MIN_SEEK) bestLen = 0;
+        }
+        if (bestLen < MIN_STAY) {
+            i++;
+            continue;
+        }
+        // Take back added bytes that match just before the copy
+        while (i > addStart && bestFrom > 0 && target[i - 1] == base[bestFrom - 1]) {
+            i--;
+            bestFrom--;
+            bestLen++;
+        }
+        record(i, bestFrom, bestLen);
+        i += bestLen;
+        addStart = i;
+    }
+    if (addStart < target.size()) record(target.size(), basePos, 0);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    const char* key = OTA_SIGN_KEY;
+    const char* args[4];
+    int n = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--key") && i + 1 < argc) key = argv[++i];
+        else if (n < 4) args[n++] = argv[i];
+        else usage();
+    }
+    if (n < 2) usage();
+
+    std::string data;
+    if (!readFile(args[1], data)) {
+        fprintf(stderr, "cannot read %s\n", args[1]);
+        return 1;
+    }
+    uint8_t sha[Sha256::HASH_SIZE];
+    char hex[2 * Sha256::HASH_SIZE + 1];
+
+    if (!strcmp(args[0], "sign") && n == 3) {
+        if (!isAppImage(data)) {
+            fprintf(stderr, "%s is not an ESP32 app image\n", args[1]);
+            return 1;
+        }
+        Sha256::hash(data.data(), data.size(), sha);
+        OtaTrailer t;
+        OtaManager::makeTrailer(sha, data.size(), key, t);
+        data.append((const char*)&t, sizeof(t));
+        if (!writeFile(args[2], data)) {
+            fprintf(stderr, "cannot write %s\n", args[2]);
+            return 1;
+        }
+        Sha256::toHex(sha, hex);
+        printf("%s: %zu bytes + %zu byte trailer, sha256 %s\n", args[2], data.size() - sizeof(t), sizeof(t), hex);
+        return 0;
+    }
+
+    if (!strcmp(args[0], "verify") && n == 2) {
+        OtaTrailer t;
+        if (data.size() < sizeof(t)) {
+            fprintf(stderr, "too short\n");
+            return 1;
+        }
+        size_t imageSize = data.size() - sizeof(t);
+        memcpy(&t, data.data() + imageSize, sizeof(t));
+        Sha256::hash(data.data(), imageSize, sha);
+        OtaTrailer expected;
+        OtaManager::makeTrailer(sha, imageSize, key, expected);
+        bool ok = t.magic == OtaManager::TRAILER_MAGIC && t.imageSize == imageSize &&
+                  !memcmp(&t, &expected, sizeof(t));
+        Sha256::toHex(sha, hex);
+        printf("%s: %zu bytes, sha256 %s: %s\n", args[1], imageSize, hex, ok ? "good signature" : "BAD");
+        return ok ? 0 : 1;
+    }
+    if (!strcmp(args[0], "diff") && n == 4) {
+        std::string target;
+        if (!readFile(args[2], target)) {
+            fprintf(stderr, "cannot read %s\n", args[2]);
+            return 1;
+        }
+        stripTrailer(data);
+        stripTrailer(target);
+        if (!isAppImage(data) || !isAppImage(target)) {
+            fprintf(stderr, "both files must be ESP32 app images\n");
+            return 1;
+        }
+        OtaDeltaHeader h;
+        h.magic = OtaManager::DELTA_MAGIC;
+        h.baseSize = data.size();
+        h.targetSize = target.size();
+        Sha256::hash(data.data(), data.size(), h.baseSha256);
+        std::string out((const char*)&h, sizeof(h));
+        size_t records = out.size();
+        out += makeDelta(data, target);
+        records = out.size() - records;
+
+        OtaTrailer t;
+        Sha256::hash(target.data(), target.size(), sha);
+        OtaManager::makeTrailer(sha, target.size(), key, t);
+        out.append((const char*)&t, sizeof(t));
+        if (!writeFile(args[3], out)) {
+            fprintf(stderr, "cannot write %s\n", args[3]);
+            return 1;
+        }
+        Sha256::toHex(h.baseSha256, hex);
+        printf("%s: %zu bytes (%zu of records) for a %zu byte image, %.1f%% of a full upload\n", args[3],
+               out.size(), records, target.size(), 100.0 * out.size() / (target.size() + sizeof(t)));
+        printf("base %zu bytes, sha256 %s\n", data.size(), hex);
+        return 0;
+    }
+    usage();
+}
@@ -0,0 +1,167 @@
+// Host simulator: boots the firmware on the fake HAL, runs loop() on the
+// simulated clock and prints the serial log, the LCD and any web requests.
+//
+//   ramzan_sim [--seconds N] [--date YYYY-MM-DD] [--time HH:MM:SS]
+//              [--no-wifi] [--quiet] [--realtime] [--press PIN@SEC]...
+//              [--type "LINE@SEC"]... [--get /uri?query]... [--post /uri=FILE]...
+//              [--flash LABEL=FILE]...
+//
+// Requests run after the simulated time, in the order given; --post sends
+// FILE as an upload (e.g. --post /api/timetable=timetable.txt). --flash
+// loads a partition before boot, e.g. the running image for a delta update
+// (--flash app0=firmware.bin --post /update=firmware.delta).
+//
+// --realtime runs on the host's clock instead of the simulated one, for
+// talking to real servers (an MQTT broker) that answer on their own schedule.
+#include <Arduino.h>
+#include <WebServer.h>
+#include "FakeHal.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+struct Press {
+    int pin;
+    uint64_t atMs;
+    bool down;
+    bool done;
+};
+
+// A console line typed at a given time
+struct Typed {
+    std::string line;
+    uint64_t atMs;
+};
+
+static void usage() {
+    fprintf(stderr, "usage: ramzan_sim [--seconds N] [--date YYYY-MM-DD] [--time HH:MM:SS]\n"
+                    "                  [--no-wifi] [--quiet] [--realtime] [--press PIN@SEC]...\n"
+                    "                  [--type \"LINE@SEC\"]... [--get /uri?query]... [--post /uri=FILE]...\n"
+                    "                  [--flash LABEL=FILE]...\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    uint64_t seconds = 10;
+    int year = 2026, month = 2, day = 20, hour = 10, minute = 0, second = 0;
+    bool wifi = true;
+    bool quiet = false;
+    bool realtime = false;
+    std::vector<Press> presses;
+    std::vector<Typed> typed;
+    std::vector<std::pair<HTTPMethod, std::string>> requests;
+    std::vector<std::string> flash;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--seconds") && v) { seconds = strtoull(v, nullptr, 10); i++; }
+        else if (!strcmp(a, "--date") && v) { if (sscanf(v, "%d-%d-%d", &year, &month, &day) != 3) usage(); i++; }
+        else if (!strcmp(a, "--time") && v) { if (sscanf(v, "%d:%d:%d", &hour, &minute, &second) != 3) usage(); i++; }
+        else if (!strcmp(a, "--no-wifi")) wifi = false;
+        else if (!strcmp(a, "--quiet")) quiet = true;
+        else if (!strcmp(a, "--realtime")) realtime = true;
+        else if (!strcmp(a, "--press") && v) {
+            Press p;
+            double at = 0;
+            if (sscanf(v, "%d@%lf", &p.pin, &at) != 2) usage();
+            p.atMs = (uint64_t)(at * 1000);
+            p.down = p.done = false;
+            presses.push_back(p);
+            i++;
+        }
+        else if (!strcmp(a, "--type") && v) {
+            std::string s = v;
+            size_t at = s.rfind('@');
+            if (at == std::string::npos) usage();
+            typed.push_back({ s.substr(0, at), (uint64_t)(atof(s.c_str() + at + 1) * 1000) });
+            i++;
+        }
+        else if (!strcmp(a, "--get") && v) { requests.push_back({ HTTP_GET, v }); i++; }
+        else if (!strcmp(a, "--post") && v && strchr(v, '=')) { requests.push_back({ HTTP_POST, v }); i++; }
+        else if (!strcmp(a, "--flash") && v && strchr(v, '=')) { flash.push_back(v); i++; }
+        else usage();
+    }
+
+    // Same layout as partitions.csv
+    fakehal::addPartition("evlog", 0x01, 0x40, 0x10000);
+    fakehal::addPartition("ttable", 0x01, 0x41, 0x2000);
+    fakehal::addPartition("app0", 0x00, 0x10, 0x140000);
+    fakehal::addPartition("app1", 0x00, 0x11, 0x140000);
+    for (const std::string& f : flash) {
+        size_t eq = f.find('=');
+        std::vector<uint8_t>* part = fakehal::partitionData(f.substr(0, eq).c_str());
+        FILE* in = fopen(f.c_str() + eq + 1, "rb");
+        if (!part || !in) { fprintf(stderr, "cannot flash %s\n", f.c_str()); return 1; }
+        size_t n = fread(part->data(), 1, part->size(), in);
+        fclose(in);
+        printf("flashed %zu bytes into %s\n", n, f.substr(0, eq).c_str());
+    }
+    fakehal::setWifiConnected(wifi);
+    fakehal::setNtpAvailable(wifi);
+    fakehal::setLocalTime(year, month, day, hour, minute, second);
+    fakehal::setSerialEcho(!quiet);
+    fakehal::setRealtime(realtime);
+
+    setup();
+
+    // Presses are held for 100 ms
+    uint64_t endUs = fakehal::nowMicros() + seconds * 1000000ULL;
+    uint64_t startUs = fakehal::nowMicros();
+    while (fakehal::nowMicros() < endUs) {
+        uint64_t nowMs = (fakehal::nowMicros() - startUs) / 1000;
+        for (Press& p : presses) {
+            if (!p.down && !p.done && nowMs >= p.atMs) {
+                fakehal::setInput(p.pin, LOW);
+                p.down = true;
+            }
+            if (p.down && nowMs >= p.atMs + 100) {
+                fakehal::setInput(p.pin, HIGH);
+                p.down = false;
+                p.done = true;
+            }
+        }
+        for (Typed& t : typed) {
+            if (nowMs >= t.atMs && !t.line.empty()) {
+                fakehal::serialInject(t.line + "\n");
+                t.line.clear();
+            }
+        }
+        uint64_t before = fakehal::nowMicros();
+        loop();
+        // loop() idles on the simulated clock; make sure a busy pass moves it too
+        if (fakehal::nowMicros() == before) fakehal::advanceMicros(100);
+    }
+    fakehal::serialTakeOutput();
+
+    printf("\n--- LCD after %llu s ---\n[%s]\n[%s]\n", (unsigned long long)seconds,
+           fakehal::lcdLine(0).c_str(), fakehal::lcdLine(1).c_str());
+
+    for (const auto& req : requests) {
+        const std::string& g = req.second;
+        std::string body;
+        std::string target = g;
+        if (req.first == HTTP_POST) {
+            size_t eq = g.find('=');
+            target = g.substr(0, eq);
+            FILE* f = fopen(g.c_str() + eq + 1, "rb");
+            if (!f) { fprintf(stderr, "cannot read %s\n", g.c_str() + eq + 1); return 1; }
+            char chunk[4096];
+            size_t n;
+            while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) body.append(chunk, n);
+            fclose(f);
+        }
+        size_t q = target.find('?');
+        std::string uri = target.substr(0, q);
+        std::string query = (q == std::string::npos) ? "" : target.substr(q + 1);
+        WebServer::Response r = WebServer::instance()->request(req.first, uri.c_str(), query.c_str(), body);
+        printf("\n--- %s %s -> %d %s ---\n%s\n", req.first == HTTP_POST ? "POST" : "GET", target.c_str(),
+               r.code, r.contentType.c_str(), r.body.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,3 @@
+// The .ino is plain C++ once the Arduino IDE's auto-prototypes are not
+// needed (RamzanAlarm.ino declares its own), so compile it as-is.
+#include "../RamzanAlarm.ino"
@@ -0,0 +1,143 @@
+// Multi-unit sync check: forks several firmware instances that find each
+// other over multicast on loopback, lets Sehri trigger on all of them and
+// prints how far apart their house A relays switched on.
+//
+//   ramzan_syncsim [--units N] [--error-ms MS] [--seconds N] [--no-sync] [--verbose]
+//
+// Every unit runs in real time on the shared monotonic clock, with its
+// wall clock off by a different amount (up to --error-ms either way), like
+// units that each got a slightly wrong NTP answer. --no-sync shows what
+// that error does on its own.
+#include <Arduino.h>
+#include "FakeHal.h"
+#include "UnitSync.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+extern UnitSync unitSync;
+
+struct Result {
+    int unit;
+    int64_t errorUs;
+    long long edgeUs;   // CLOCK_MONOTONIC of the relay switching on, -1 = never
+    unsigned long id;
+    unsigned long leader;
+    long offsetUs;
+    long lateUs;
+};
+
+static void usage() {
+    fprintf(stderr, "usage: ramzan_syncsim [--units N] [--error-ms MS] [--seconds N] [--no-sync] [--verbose]\n");
+    exit(2);
+}
+
+static void runUnit(int unit, int64_t errorUs, uint64_t seconds, bool sync, bool verbose, int fd) {
+    char mac[24];
+    snprintf(mac, sizeof(mac), "24:0A:C4:00:00:%02X", 0x10 + unit);
+    fakehal::addPartition("evlog", 0x01, 0x40, 0x10000);
+    fakehal::addPartition("ttable", 0x01, 0x41, 0x2000);
+    fakehal::setMacAddress(mac);
+    fakehal::setLocalIP(127, 0, 0, 1);
+    fakehal::setClockError(errorUs);
+    fakehal::setSerialEcho(verbose);
+
+    setup();
+    unitSync.setEnabled(sync);
+    fakehal::clearOutputLog(); // Relay setup in setup() is not a ring
+
+    uint64_t endUs = fakehal::nowMicros() + seconds * 1000000ULL;
+    long long edgeUs = -1;
+    while (fakehal::nowMicros() < endUs && edgeUs < 0) {
+        loop();
+        for (const fakehal::GpioEdge& e : fakehal::outputLog()) {
+            if (e.pin == PIN_BUZZER_HOUSE_A && e.level == (RELAY_ACTIVE_LOW ? LOW : HIGH)) {
+                edgeUs = (long long)fakehal::toMonotonicMicros(e.timeUs);
+                break;
+            }
+        }
+    }
+
+    Result r = { unit, errorUs, edgeUs, (unsigned long)unitSync.getId(), (unsigned long)unitSync.getLeaderId(),
+                 (long)unitSync.getOffsetUs(), (long)unitSync.getLastStartLateUs() };
+    if (write(fd, &r, sizeof(r)) != sizeof(r)) _exit(1);
+    _exit(0);
+}
+
+int main(int argc, char** argv) {
+    int units = 4;
+    int errorMs = 300;
+    uint64_t seconds = 20;
+    bool sync = true;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--units") && v) { units = atoi(v); i++; }
+        else if (!strcmp(a, "--error-ms") && v) { errorMs = atoi(v); i++; }
+        else if (!strcmp(a, "--seconds") && v) { seconds = strtoull(v, nullptr, 10); i++; }
+        else if (!strcmp(a, "--no-sync")) sync = false;
+        else if (!strcmp(a, "--verbose")) verbose = true;
+        else usage();
+    }
+    if (units < 1 || units > UnitSync::MAX_PEERS + 1) usage();
+
+    // Sehri is 05:42 that day. Set up before forking so every unit starts
+    // from the same true time.
+    fakehal::setWifiConnected(true);
+    fakehal::setNtpAvailable(true);
+    fakehal::setLocalTime(2026, 2, 20, 5, 41, 50);
+    fakehal::setRealtime(true);
+
+    int fds[2];
+    if (pipe(fds) < 0) return 1;
+    std::vector<pid_t> pids;
+    for (int u = 0; u < units; u++) {
+        // Spread evenly over -errorMs..+errorMs; the leader (unit 0) is the slowest clock
+        int64_t errorUs = units > 1 ? ((int64_t)errorMs * 1000 * (2 * u - (units - 1))) / (units - 1) : 0;
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+        if (pid == 0) {
+            close(fds[0]);
+            runUnit(u, errorUs, seconds, sync, verbose, fds[1]);
+        }
+        pids.push_back(pid);
+    }
+    close(fds[1]);
+
+    std::vector<Result> results;
+    Result r;
+    while (read(fds[0], &r, sizeof(r)) == sizeof(r)) results.push_back(r);
+    for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+
+    long long first = -1, last = -1;
+    for (const Result& x : results) {
+        if (x.edgeUs < 0) continue;
+        if (first < 0 || x.edgeUs < first) first = x.edgeUs;
+        if (last < 0 || x.edgeUs > last) last = x.edgeUs;
+    }
+
+    printf("%s, %d units, clock error up to +/-%d ms\n", sync ? "Sync on" : "Sync off", units, errorMs);
+    printf("unit  clock error   id        leader    offset us   late us   relay on (ms after first)\n");
+    for (const Result& x : results) {
+        printf("%4d  %8.1f ms  %08lx  %08lx  %9ld  %8ld   ", x.unit, x.errorUs / 1000.0, x.id, x.leader,
+               x.offsetUs, x.lateUs);
+        if (x.edgeUs < 0) printf("never\n");
+        else printf("%.3f\n", (x.edgeUs - first) / 1000.0);
+    }
+    int rang = 0;
+    for (const Result& x : results) rang += x.edgeUs >= 0;
+    if (rang < units) {
+        printf("%d of %d units did not ring\n", units - rang, units);
+        return 1;
+    }
+    printf("Start skew: %.3f ms\n", (last - first) / 1000.0);
+    return 0;
+}
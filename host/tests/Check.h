@@ -0,0 +1,34 @@
+// Host tests: every test_*.cpp is its own executable and ctest case.
+// CHECK() reports a failed expression and carries on; main() returns
+// checkResult() so ctest sees any failure.
+#ifndef HOST_TEST_CHECK_H
+#define HOST_TEST_CHECK_H
+
+#include <cstdio>
+
+static int s_checkFailures = 0;
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);  \
+            s_checkFailures++;                                                        \
+        }                                                                             \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                \
+    do {                                                                              \
+        long long _a = (long long)(a), _b = (long long)(b);                           \
+        if (_a != _b) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",         \
+                    __FILE__, __LINE__, #a, #b, _a, _b);                              \
+            s_checkFailures++;                                                        \
+        }                                                                             \
+    } while (0)
+
+static inline int checkResult(const char* name) {
+    printf("%s: %s\n", name, s_checkFailures ? "FAILED" : "ok");
+    return s_checkFailures ? 1 : 0;
+}
+
+#endif
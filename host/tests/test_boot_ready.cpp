@@ -0,0 +1,49 @@
+// PowerManager::markReady() (boot-to-ready time for deep sleep planning)
+// must fire on the first IDLE with the clock set, also when an alarm rung
+// during boot took the unit RINGING -> IDLE before NTP had synced.
+#include <Arduino.h>
+#include "FakeHal.h"
+#include "Check.h"
+#include "Config.h"
+#include "PowerManager.h"
+#include "StateMachine.h"
+
+void setup();
+
+extern PowerManager powerManager;
+extern StateMachine stateMachine;
+
+static bool s_rang = false;
+
+static void checkRinging() {
+    if (stateMachine.isRinging()) s_rang = true;
+}
+
+int main() {
+    fakehal::addPartition("evlog", 0x01, 0x40, 0x10000);
+    fakehal::addPartition("ttable", 0x01, 0x41, 0x2000);
+    fakehal::setWifiConnected(false);
+    fakehal::setNtpAvailable(false);
+    fakehal::setLocalTime(2026, 3, 1, 14, 0, 0);
+    setup();
+    fakehal::setLoopHook(checkRinging);
+    fakehal::runLoop(3000);
+    CHECK_EQ(stateMachine.getState(), STATE_WIFI_CONNECTING);
+
+    // NAV hold rings a test Sehri alarm while still looking for WiFi
+    fakehal::press(PIN_BUTTON_NAV, 2500);
+    fakehal::runLoop(2000);
+    CHECK(s_rang);
+    fakehal::press(PIN_BUTTON_HOUSE_A, 100);
+    fakehal::press(PIN_BUTTON_HOUSE_B, 100);
+    fakehal::runLoop(5000);
+    CHECK_EQ(stateMachine.getState(), STATE_IDLE);
+    CHECK(!powerManager.isReady()); // No clock yet
+
+    fakehal::setWifiConnected(true);
+    fakehal::setNtpAvailable(true);
+    fakehal::runLoop(30000);
+    CHECK_EQ(stateMachine.getState(), STATE_IDLE);
+    CHECK(powerManager.isReady());
+    return checkResult("test_boot_ready");
+}
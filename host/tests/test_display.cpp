@@ -0,0 +1,97 @@
+// Render skipping: a carousel screen only re-renders when something it
+// depends on changed, an unchanged frame puts nothing on the LCD bus, and
+// a one-character change writes only that cell.
+#include <Arduino.h>
+#include "FakeHal.h"
+#include "DisplayManager.h"
+#include "ScreenRegistry.h"
+#include "Check.h"
+#include <string>
+
+static int s_renders = 0;
+static void renderClock(char* line1, char* line2) {
+    s_renders++;
+    snprintf(line1, SCREEN_LINE_LEN, "Render %d", s_renders % 100);
+    snprintf(line2, SCREEN_LINE_LEN, "clock screen");
+}
+
+static int s_blinkRenders = 0;
+static void renderBlink(char* line1, char* line2) {
+    s_blinkRenders++;
+    snprintf(line1, SCREEN_LINE_LEN, "blink");
+    line2[0] = '\0';
+}
+
+static void testRegistrySkips() {
+    ScreenRegistry reg;
+    uint8_t clock = reg.add("clock", DEP_CLOCK_MINUTE | DEP_WIFI, renderClock);
+    uint8_t blink = reg.add("blink", DEP_CONFIG, renderBlink, 500);
+
+    CHECK(reg.render(clock)); // First render always happens
+    CHECK_EQ(s_renders, 1);
+    for (int i = 0; i < 10; i++) CHECK(!reg.render(clock));
+    CHECK_EQ(s_renders, 1);
+    CHECK_EQ(reg.getSkipCount(), 10);
+
+    // Data it does not depend on
+    reg.invalidate(DEP_SCHEDULE | DEP_CLOCK_SECOND | DEP_INPUTS);
+    CHECK(!reg.render(clock));
+    CHECK_EQ(s_renders, 1);
+
+    reg.invalidate(DEP_WIFI);
+    CHECK(reg.render(clock));
+    CHECK_EQ(s_renders, 2);
+    CHECK(std::string(reg.line1(clock)) == "Render 2");
+    CHECK(!reg.render(clock));
+
+    // A phased screen re-renders once per phase, not once per call
+    CHECK(reg.render(blink));
+    CHECK(!reg.render(blink));
+    fakehal::advanceMillis(500);
+    CHECK(reg.render(blink));
+    CHECK(!reg.render(blink));
+    CHECK_EQ(s_blinkRenders, 2);
+}
+
+static std::string glass() { return fakehal::lcdLine(0) + "|" + fakehal::lcdLine(1); }
+
+static void testUnchangedFrameSendsNothing() {
+    DisplayManager display;
+    display.init();
+    fakehal::advanceMillis(2100); // Past the boot splash
+
+    display.showMessage("12:30:05 PM", "Iftar in 3h");
+    CHECK(fakehal::lcdLine(0).find("12:30:05 PM") == 0);
+
+    uint32_t before = fakehal::lcdBusBytes();
+    for (int i = 0; i < 50; i++) display.showMessage("12:30:05 PM", "Iftar in 3h");
+    CHECK_EQ(fakehal::lcdBusBytes() - before, 0);
+
+    // One character: one address command at most, plus the character
+    std::string old = glass();
+    before = fakehal::lcdBusBytes();
+    display.showMessage("12:30:06 PM", "Iftar in 3h");
+    uint32_t sent = fakehal::lcdBusBytes() - before;
+    CHECK(sent >= 1 && sent <= 2);
+    std::string now = glass();
+    CHECK_EQ(now.size(), old.size());
+    int changedCells = 0;
+    for (size_t i = 0; i < now.size() && i < old.size(); i++) {
+        if (now[i] != old[i]) {
+            changedCells++;
+            CHECK_EQ(i, 7); // The seconds digit
+        }
+    }
+    CHECK_EQ(changedCells, 1);
+
+    // And again nothing for the same frame
+    before = fakehal::lcdBusBytes();
+    display.showMessage("12:30:06 PM", "Iftar in 3h");
+    CHECK_EQ(fakehal::lcdBusBytes() - before, 0);
+}
+
+int main() {
+    testRegistrySkips();
+    testUnchangedFrameSendsNothing();
+    return checkResult("test_display");
+}
@@ -0,0 +1,214 @@
+// InputManager + ButtonEngine on fake GPIO: injected contact bounce gives
+// one clean event per press, and gestures keep working when micros() wraps,
+// since transitions are stamped in millis().
+#include <Arduino.h>
+#include "FakeHal.h"
+#include "Config.h"
+#include "InputManager.h"
+#include "ButtonEngine.h"
+#include "Check.h"
+#include <vector>
+
+static const uint64_t WRAP_US = 1ULL << 32; // micros() wraps here on the target
+
+static InputManager inputs;
+static ButtonEngine nav(PIN_BUTTON_NAV);
+static ButtonEngine houseA(PIN_BUTTON_HOUSE_A);
+
+struct Seen {
+    ButtonEvent event;
+    unsigned long timeMs;
+};
+static std::vector<Seen> seen;
+
+// The input task, run every millisecond
+static void run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        fakehal::advanceMillis(1);
+        inputs.update();
+        nav.update();
+        houseA.update();
+        for (ButtonEvent e; (e = nav.getEvent()) != BUTTON_NO_EVENT;) seen.push_back({ e, nav.getEventTime() });
+    }
+}
+
+// Press for holdMs, then wait long enough for any gesture to close
+static unsigned long press(uint32_t holdMs) {
+    unsigned long at = millis();
+    fakehal::setInput(PIN_BUTTON_NAV, LOW);
+    run(holdMs);
+    fakehal::setInput(PIN_BUTTON_NAV, HIGH);
+    run(1000);
+    return at;
+}
+
+static void runUntil(uint64_t us) {
+    while (fakehal::nowMicros() < us) run(1);
+}
+
+// Each event settles one debounce window after its edge
+static bool near(unsigned long timeMs, unsigned long edgeMs) {
+    return timeMs >= edgeMs && timeMs - edgeMs <= 60;
+}
+
+// Edges every few hundred microseconds to a few ms, as a worn contact does
+static void bounce(uint8_t pin, int settleLevel, uint32_t edges) {
+    static const uint16_t GAPS_US[] = { 300, 1200, 700, 2500, 400, 1800, 900, 3000 };
+    for (uint32_t i = 0; i < edges; i++) {
+        fakehal::setInput(pin, (i & 1) ? settleLevel : !settleLevel);
+        fakehal::advanceMicros(GAPS_US[i % 8]);
+    }
+    fakehal::setInput(pin, settleLevel);
+}
+
+static size_t count(ButtonEvent e) {
+    size_t n = 0;
+    for (const Seen& s : seen) n += s.event == e;
+    return n;
+}
+
+static void testBouncyPress() {
+    seen.clear();
+    unsigned long at = millis();
+    bounce(PIN_BUTTON_NAV, LOW, 9);
+    run(150);
+    bounce(PIN_BUTTON_NAV, HIGH, 7);
+    run(1000);
+    CHECK_EQ(seen.size(), 2);
+    CHECK_EQ(count(BUTTON_PRESSED), 1);
+    CHECK_EQ(count(BUTTON_RELEASED), 1);
+    // Settles within a debounce window of the bounce ending
+    if (!seen.empty()) CHECK(near(seen[0].timeMs, at + 10));
+}
+
+// Shorter than DEBOUNCE_TICKS scans: never a stable level
+static void testGlitchIgnored() {
+    seen.clear();
+    bounce(PIN_BUTTON_NAV, LOW, 3);
+    run(25);
+    fakehal::setInput(PIN_BUTTON_NAV, HIGH);
+    run(1000);
+    CHECK_EQ(seen.size(), 0);
+    CHECK_EQ(inputs.getLevel(PIN_BUTTON_NAV), HIGH);
+}
+
+// The loop was busy for the whole press: the edge history is replayed
+// and the events carry the times the edges really settled at
+static void testBusyLoopReplay() {
+    seen.clear();
+    unsigned long at = millis();
+    bounce(PIN_BUTTON_NAV, LOW, 5);
+    fakehal::advanceMillis(120);
+    bounce(PIN_BUTTON_NAV, HIGH, 5);
+    fakehal::advanceMillis(500);
+    run(1000);
+    CHECK_EQ(seen.size(), 2);
+    if (seen.size() != 2) return;
+    CHECK_EQ(seen[0].event, BUTTON_PRESSED);
+    CHECK(near(seen[0].timeMs, at));
+    CHECK_EQ(seen[1].event, BUTTON_RELEASED);
+    CHECK(near(seen[1].timeMs, at + 130));
+}
+
+// More edges than the snapshot queue holds: the live level repairs it
+static void testSnapshotOverflow() {
+    seen.clear();
+    uint32_t dropped = inputs.getDroppedSnapshots();
+    for (int i = 0; i < 100; i++) {
+        fakehal::setInput(PIN_BUTTON_NAV, i & 1);
+        fakehal::advanceMicros(50);
+    }
+    fakehal::setInput(PIN_BUTTON_NAV, LOW);
+    run(200);
+    CHECK(inputs.getDroppedSnapshots() > dropped);
+    CHECK_EQ(inputs.getLevel(PIN_BUTTON_NAV), LOW);
+    CHECK_EQ(count(BUTTON_PRESSED), 1);
+    fakehal::setInput(PIN_BUTTON_NAV, HIGH);
+    run(1000);
+}
+
+// Two buttons bouncing at once, from the same register reads
+static void testTwoButtonsTogether() {
+    seen.clear();
+    bounce(PIN_BUTTON_NAV, LOW, 5);
+    bounce(PIN_BUTTON_HOUSE_A, LOW, 8);
+    run(100);
+    CHECK_EQ(count(BUTTON_PRESSED), 1);
+    CHECK_EQ(houseA.getState(), LOW);
+    CHECK_EQ(houseA.getEvent(), BUTTON_PRESSED);
+    fakehal::setInput(PIN_BUTTON_NAV, HIGH);
+    fakehal::setInput(PIN_BUTTON_HOUSE_A, HIGH);
+    run(1000);
+    CHECK_EQ(inputs.getLevel(PIN_BUTTON_HOUSE_A), HIGH);
+    while (houseA.getEvent() != BUTTON_NO_EVENT) {}
+}
+
+static void testShortPressAcrossWrap() {
+    seen.clear();
+    runUntil(WRAP_US - 50000);
+    unsigned long at = press(100); // Released 50 ms after the wrap
+    CHECK_EQ(seen.size(), 2);
+    if (seen.size() != 2) return;
+    CHECK_EQ(seen[0].event, BUTTON_PRESSED);
+    CHECK(near(seen[0].timeMs, at));
+    CHECK_EQ(seen[1].event, BUTTON_RELEASED);
+    CHECK(near(seen[1].timeMs, at + 100));
+}
+
+static void testPressAfterWrap() {
+    seen.clear();
+    runUntil(WRAP_US + 3000000);
+    unsigned long at = press(100);
+    CHECK_EQ(seen.size(), 2);
+    if (seen.size() != 2) return;
+    CHECK_EQ(seen[0].event, BUTTON_PRESSED);
+    CHECK(near(seen[0].timeMs, at));
+    CHECK_EQ(seen[1].event, BUTTON_RELEASED);
+    // Ack latency is measured as getEventTime() against millis()
+    CHECK((long)(millis() - seen[1].timeMs) >= 0);
+}
+
+static void testHoldAcrossWrap() {
+    seen.clear();
+    fakehal::setMicros(2 * WRAP_US - 1000000); // Second wrap, 1 s ahead
+    run(1000);
+    unsigned long at = press(2500);
+    CHECK_EQ(seen.size(), 3);
+    if (seen.size() != 3) return;
+    CHECK_EQ(seen[0].event, BUTTON_PRESSED);
+    CHECK_EQ(seen[1].event, BUTTON_HELD);
+    CHECK(near(seen[1].timeMs, at + 2000));
+    CHECK_EQ(seen[2].event, BUTTON_RELEASED);
+}
+
+static void testDoubleClickAfterWrap() {
+    seen.clear();
+    fakehal::setInput(PIN_BUTTON_NAV, LOW);
+    run(100);
+    fakehal::setInput(PIN_BUTTON_NAV, HIGH);
+    run(150);
+    press(100);
+    CHECK_EQ(seen.size(), 5);
+    if (seen.size() != 5) return;
+    CHECK_EQ(seen[4].event, BUTTON_DOUBLE_CLICK);
+}
+
+int main() {
+    fakehal::setMicros(WRAP_US - 10000000);
+    inputs.init();
+    nav.init(&inputs);
+    houseA.init(&inputs);
+    run(100);
+
+    testBouncyPress();
+    testGlitchIgnored();
+    testBusyLoopReplay();
+    testSnapshotOverflow();
+    testTwoButtonsTogether();
+
+    testShortPressAcrossWrap();
+    testPressAfterWrap();
+    testHoldAcrossWrap();
+    testDoubleClickAfterWrap();
+    return checkResult("test_inputs");
+}
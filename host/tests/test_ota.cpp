@@ -0,0 +1,419 @@
+// Firmware updates on the fake flash: SHA-256/HMAC against the published
+// vectors, signed uploads in any chunking, corrupted trailers, deltas, and
+// the trial of a new image (confirmed by a healthy loop, rolled back on
+// boots, timeout or a crash).
+#include <Arduino.h>
+#include "FakeHal.h"
+#include "Check.h"
+#include "Config.h"
+#include "EventLog.h"
+#include "OtaManager.h"
+#include "Sha256.h"
+#include <esp_system.h>
+#include <cstring>
+#include <random>
+#include <string>
+
+extern EventLog eventLog;
+
+static std::mt19937 s_rng(49);
+
+static bool hashIs(const uint8_t hash[Sha256::HASH_SIZE], const char* hex) {
+    char out[2 * Sha256::HASH_SIZE + 1];
+    Sha256::toHex(hash, out);
+    if (!strcmp(out, hex)) return true;
+    fprintf(stderr, "got %s\nwant %s\n", out, hex);
+    return false;
+}
+
+static void testSha256Vectors() {
+    uint8_t h[Sha256::HASH_SIZE];
+    Sha256::hash("", 0, h);
+    CHECK(hashIs(h, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    Sha256::hash("abc", 3, h);
+    CHECK(hashIs(h, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    const char* two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    Sha256::hash(two, strlen(two), h);
+    CHECK(hashIs(h, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+    std::string million(1000000, 'a');
+    Sha256::hash(million.data(), million.size(), h);
+    CHECK(hashIs(h, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+
+    // RFC 4231 test cases 1-4, 6 and 7 (5 is truncated output)
+    std::string k1(20, '\x0b'), k3(20, '\xaa'), d3(50, '\xdd'), d4(50, '\xcd'), big(131, '\xaa');
+    std::string k4;
+    for (int i = 1; i <= 25; i++) k4 += (char)i;
+    const char* d6 = "Test Using Larger Than Block-Size Key - Hash Key First";
+    const char* d7 = "This is a test using a larger than block-size key and a larger than block-size data. "
+                     "The key needs to be hashed before being used by the HMAC algorithm.";
+    Sha256::hmac(k1.data(), k1.size(), "Hi There", 8, h);
+    CHECK(hashIs(h, "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"));
+    Sha256::hmac("Jefe", 4, "what do ya want for nothing?", 28, h);
+    CHECK(hashIs(h, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"));
+    Sha256::hmac(k3.data(), k3.size(), d3.data(), d3.size(), h);
+    CHECK(hashIs(h, "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe"));
+    Sha256::hmac(k4.data(), k4.size(), d4.data(), d4.size(), h);
+    CHECK(hashIs(h, "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b"));
+    Sha256::hmac(big.data(), big.size(), d6, strlen(d6), h);
+    CHECK(hashIs(h, "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"));
+    Sha256::hmac(big.data(), big.size(), d7, strlen(d7), h);
+    CHECK(hashIs(h, "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2"));
+
+    CHECK(Sha256::equal(h, h, sizeof(h)));
+    uint8_t other[Sha256::HASH_SIZE];
+    memcpy(other, h, sizeof(h));
+    other[31] ^= 1;
+    CHECK(!Sha256::equal(h, other, sizeof(h)));
+}
+
+// Any split into update() calls, down to 1 byte and empty ones, hashes the same
+static void testSha256Chunking() {
+    std::string data;
+    for (int i = 0; i < 10000; i++) data += (char)s_rng();
+    for (size_t len : { 0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 10000 }) {
+        uint8_t whole[Sha256::HASH_SIZE], parts[Sha256::HASH_SIZE];
+        Sha256::hash(data.data(), len, whole);
+        for (int round = 0; round < 20; round++) {
+            Sha256 sha;
+            sha.begin();
+            for (size_t i = 0; i < len;) {
+                size_t n = round == 0 ? 1 : s_rng() % 200; // 0 included
+                if (n > len - i) n = len - i;
+                sha.update(data.data() + i, n);
+                i += n;
+            }
+            sha.finish(parts);
+            CHECK(!memcmp(whole, parts, sizeof(whole)));
+        }
+    }
+}
+
+// --- Images ---
+
+static std::string makeImage(size_t size) {
+    std::string img;
+    img += (char)OtaManager::IMAGE_MAGIC;
+    while (img.size() < size) img += (char)s_rng();
+    return img;
+}
+
+static std::string sign(const std::string& img, const char* key = OTA_SIGN_KEY) {
+    uint8_t sha[Sha256::HASH_SIZE];
+    Sha256::hash(img.data(), img.size(), sha);
+    OtaTrailer t;
+    OtaManager::makeTrailer(sha, img.size(), key, t);
+    return img + std::string((const char*)&t, sizeof(t));
+}
+
+// chunk 0 = one write(), 1 = byte by byte, otherwise random sizes up to chunk
+static bool upload(OtaManager& m, const std::string& body, size_t chunk = 0) {
+    if (!m.begin()) return false;
+    for (size_t i = 0; i < body.size();) {
+        size_t n = chunk == 0 ? body.size() : chunk == 1 ? 1 : 1 + s_rng() % chunk;
+        if (n > body.size() - i) n = body.size() - i;
+        if (!m.write((const uint8_t*)body.data() + i, n)) return false;
+        i += n;
+    }
+    return m.end();
+}
+
+static void flash(const char* label, const std::string& img) {
+    std::vector<uint8_t>* part = fakehal::partitionData(label);
+    std::fill(part->begin(), part->end(), 0xFF);
+    memcpy(part->data(), img.data(), img.size());
+}
+
+static bool holds(const char* label, const std::string& img) {
+    std::vector<uint8_t>* part = fakehal::partitionData(label);
+    return !memcmp(part->data(), img.data(), img.size()) && (*part)[img.size()] == 0xFF; // No trailer
+}
+
+// Forget a pending trial left by an earlier case
+static void clearGuard() {
+    fakehal::setRunningPartition("app0");
+    fakehal::setResetReason(ESP_RST_POWERON);
+    OtaManager m;
+    m.init();
+    while (m.isConfirmPending()) {
+        fakehal::advanceMillis(100);
+        m.update();
+    }
+}
+
+static void testUploadChunkings() {
+    std::string img = makeImage(96 * 1024);
+    std::string body = sign(img);
+    for (int round = 0; round < 12; round++) {
+        fakehal::setRunningPartition("app0");
+        flash("app1", std::string());
+        OtaManager m;
+        size_t chunk = round == 0 ? 1 : round == 1 ? 0 : round < 6 ? 8 : 4096;
+        CHECK(upload(m, body, chunk));
+        CHECK(fakehal::bootPartition() == "app1");
+        CHECK(holds("app1", img));
+        clearGuard();
+    }
+}
+
+static void testCorruptTrailer() {
+    std::string img = makeImage(32 * 1024);
+    std::string body = sign(img);
+    size_t trailer = img.size();
+    size_t positions[] = {
+        1, 1000, img.size() - 1,                                 // Image
+        trailer + offsetof(OtaTrailer, magic),
+        trailer + offsetof(OtaTrailer, imageSize),
+        trailer + offsetof(OtaTrailer, sha256) + 7,
+        trailer + offsetof(OtaTrailer, mac), body.size() - 1,
+    };
+    for (size_t pos : positions) {
+        std::string bad = body;
+        bad[pos] ^= 0x40;
+        fakehal::setRunningPartition("app0");
+        OtaManager m;
+        CHECK(!upload(m, bad, 700));
+        CHECK(fakehal::bootPartition() == "app0");
+        CHECK(strlen(m.getError()) > 0);
+    }
+
+    const std::string cases[] = {
+        body.substr(0, body.size() - 1),  // Short
+        body + "X",                       // One byte too many
+        sign(img, "some-other-key"),      // Not our signature
+        img,                              // Not signed at all
+    };
+    for (const std::string& bad : cases) {
+        fakehal::setRunningPartition("app0");
+        OtaManager m;
+        CHECK(!upload(m, bad, 512));
+        CHECK(fakehal::bootPartition() == "app0");
+        CHECK(strlen(m.getError()) > 0);
+    }
+}
+
+// --- Delta ---
+
+static void putVarint(std::string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+static void record(std::string& out, const std::string& add, int32_t seek, uint32_t copy) {
+    putVarint(out, add.size());
+    out += add;
+    putVarint(out, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31));
+    putVarint(out, copy);
+}
+
+static std::string makeDelta(const std::string& base, const std::string& target, const std::string& records) {
+    OtaDeltaHeader h;
+    h.magic = OtaManager::DELTA_MAGIC;
+    h.baseSize = base.size();
+    h.targetSize = target.size();
+    Sha256::hash(base.data(), base.size(), h.baseSha256);
+    std::string signedTarget = sign(target);
+    return std::string((const char*)&h, sizeof(h)) + records + signedTarget.substr(target.size());
+}
+
+static void testDelta() {
+    std::string base = makeImage(64 * 1024);
+    std::string target = base;
+    for (int i = 1000; i < 1016; i++) target[i] = (char)~target[i];
+    for (int i = 4096; i < 4100; i++) target[i] = (char)~target[i];
+    target += base.substr(100, 512); // Backwards seek
+
+    std::string records;
+    record(records, "", 0, 1000);
+    record(records, target.substr(1000, 16), 0, 4096 - 1016);
+    record(records, target.substr(4096, 4), 0, base.size() - 4100);
+    record(records, "", 100 - (int32_t)base.size(), 512);
+    std::string delta = makeDelta(base, target, records);
+
+    for (size_t chunk : { (size_t)0, (size_t)1, (size_t)300 }) {
+        fakehal::setRunningPartition("app0");
+        flash("app0", base);
+        flash("app1", std::string());
+        OtaManager m;
+        CHECK(upload(m, delta, chunk));
+        CHECK(!m.wantsFullImage());
+        CHECK(fakehal::bootPartition() == "app1");
+        CHECK(holds("app1", target));
+        clearGuard();
+    }
+
+    // Made against another image: refused, full image asked for
+    fakehal::setRunningPartition("app0");
+    flash("app0", makeImage(64 * 1024));
+    OtaManager m;
+    CHECK(!upload(m, delta, 4096));
+    CHECK(m.wantsFullImage());
+    CHECK(fakehal::bootPartition() == "app0");
+
+    // A copy past the end of the base is an error, not a read out of bounds
+    flash("app0", base);
+    std::string overrun;
+    record(overrun, "", 0, base.size() + 1);
+    OtaManager o;
+    CHECK(!upload(o, makeDelta(base, target, overrun), 256));
+    CHECK(fakehal::bootPartition() == "app0");
+}
+
+// --- Trial of a new image ---
+
+static uint8_t lastRollback() {
+    EventRecord recs[32];
+    uint32_t cursor = eventLog.begin();
+    uint8_t reason = 0;
+    uint16_t n;
+    while ((n = eventLog.read(cursor, recs, 32)) > 0) {
+        for (uint16_t i = 0; i < n; i++) {
+            if (recs[i].type == EVENT_OTA_ROLLBACK) reason = recs[i].detail;
+        }
+    }
+    return reason;
+}
+
+// Uploads a good image from app0; the next boot runs it on trial
+static void installOnTrial() {
+    clearGuard();
+    fakehal::setRunningPartition("app0");
+    OtaManager m;
+    CHECK(upload(m, sign(makeImage(8 * 1024))));
+    CHECK(fakehal::bootPartition() == "app1");
+}
+
+// A boot of whatever the boot partition holds, clock from zero
+static void reboot(OtaManager& m, int resetReason = ESP_RST_SW) {
+    fakehal::setRunningPartition(fakehal::bootPartition().c_str());
+    fakehal::setResetReason(resetReason);
+    fakehal::setMicros(0);
+    m.init();
+}
+
+// Runs the ota task every 100 ms for ms
+static void runHealthy(OtaManager& m, uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 100) {
+        fakehal::advanceMillis(100);
+        m.update();
+    }
+}
+
+static void testConfirmedByHealthyLoop() {
+    installOnTrial();
+    OtaManager m;
+    reboot(m);
+    CHECK(m.isConfirmPending());
+    // No WiFi, no NTP, never IDLE: a healthy loop is enough
+    runHealthy(m, OTA_HEALTHY_MS - 1000);
+    CHECK(m.isConfirmPending());
+    runHealthy(m, 1100);
+    CHECK(!m.isConfirmPending());
+    CHECK(fakehal::appMarkedValid());
+    CHECK(fakehal::bootPartition() == "app1");
+
+    OtaManager next;
+    reboot(next);
+    CHECK(!next.isConfirmPending());
+}
+
+static void testStallRestartsHealthyRun() {
+    installOnTrial();
+    OtaManager m;
+    reboot(m);
+    runHealthy(m, OTA_HEALTHY_MS / 2);
+    fakehal::advanceMillis(OTA_LOOP_GAP_MS + 500); // Loop stuck
+    m.update();
+    runHealthy(m, OTA_HEALTHY_MS - 1000);
+    CHECK(m.isConfirmPending());
+    runHealthy(m, 1100);
+    CHECK(!m.isConfirmPending());
+    CHECK(fakehal::bootPartition() == "app1");
+}
+
+static void testRollbackOnTimeout() {
+    installOnTrial();
+    OtaManager m;
+    reboot(m);
+    uint32_t restarts = fakehal::restartCount();
+    // Stalls every few seconds until the deadline
+    while (m.isConfirmPending() && millis() < OTA_CONFIRM_MS + 10000) {
+        fakehal::advanceMillis(OTA_LOOP_GAP_MS + 1000);
+        m.update();
+    }
+    CHECK(!m.isConfirmPending());
+    CHECK(millis() > OTA_CONFIRM_MS);
+    CHECK(fakehal::bootPartition() == "app0");
+    CHECK_EQ(fakehal::restartCount(), restarts + 1);
+    CHECK_EQ(lastRollback(), OtaManager::ROLLBACK_TIMEOUT);
+}
+
+static void testRollbackOnBoots() {
+    installOnTrial();
+    uint32_t restarts = fakehal::restartCount();
+    for (int boot = 1; boot <= OTA_BOOT_TRIES; boot++) {
+        OtaManager m;
+        reboot(m, ESP_RST_POWERON); // Power cut before it settled
+        CHECK(m.isConfirmPending());
+        CHECK(fakehal::bootPartition() == "app1");
+    }
+    OtaManager m;
+    reboot(m, ESP_RST_POWERON);
+    CHECK(!m.isConfirmPending());
+    CHECK(fakehal::bootPartition() == "app0");
+    CHECK_EQ(fakehal::restartCount(), restarts + 1);
+    CHECK_EQ(lastRollback(), OtaManager::ROLLBACK_BOOTS);
+}
+
+static void testRollbackOnCrash() {
+    installOnTrial();
+    OtaManager first;
+    reboot(first);
+    runHealthy(first, 5000);
+    OtaManager second;
+    reboot(second, ESP_RST_TASK_WDT); // The new image hit the watchdog
+    CHECK(!second.isConfirmPending());
+    CHECK(fakehal::bootPartition() == "app0");
+    CHECK_EQ(lastRollback(), OtaManager::ROLLBACK_CRASH);
+}
+
+// The bootloader went back to the old image by itself
+static void testBootloaderFellBack() {
+    installOnTrial();
+    fakehal::setRunningPartition("app0");
+    fakehal::setMicros(0);
+    OtaManager m;
+    m.init();
+    CHECK(!m.isConfirmPending());
+    CHECK_EQ(lastRollback(), OtaManager::ROLLBACK_BOOTLOADER);
+}
+
+static void testPercent() {
+    CHECK_EQ(OtaManager::percent(5, 0), 100);
+    CHECK_EQ(OtaManager::percent(0, 10), 0);
+    CHECK_EQ(OtaManager::percent(3, 7), 42);
+    CHECK_EQ(OtaManager::percent(4000000000u, 4000000000u), 100);
+}
+
+int main() {
+    fakehal::addPartition("app0", 0x00, 0x10, 0x140000);
+    fakehal::addPartition("app1", 0x00, 0x11, 0x140000);
+    fakehal::addPartition("evlog", 0x01, 0x40, 0x10000);
+    eventLog.init();
+
+    testSha256Vectors();
+    testSha256Chunking();
+    testUploadChunkings();
+    testCorruptTrailer();
+    testDelta();
+    testConfirmedByHealthyLoop();
+    testStallRestartsHealthyRun();
+    testRollbackOnTimeout();
+    testRollbackOnBoots();
+    testRollbackOnCrash();
+    testBootloaderFellBack();
+    testPercent();
+    return checkResult("test_ota");
+}
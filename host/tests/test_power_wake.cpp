@@ -0,0 +1,87 @@
+// Light sleep needs a GPIO wakeup for the buttons: the edge interrupts do
+// not run while the chip sleeps. Each pin is armed at the level it is not
+// at, so a house switch left ON does not wake the chip straight away.
+// The wakeup overwrites the pin's interrupt type, so it is only armed for
+// the nap and InputManager's edge interrupt must be back afterwards.
+#include <Arduino.h>
+#include "FakeHal.h"
+#include "Check.h"
+#include "Config.h"
+#include "InputManager.h"
+#include "PowerManager.h"
+
+static void releaseAll() {
+    fakehal::setInput(PIN_BUTTON_NAV, HIGH);
+    fakehal::setInput(PIN_BUTTON_HOUSE_A, HIGH);
+    fakehal::setInput(PIN_BUTTON_HOUSE_B, HIGH);
+}
+
+// Stock Arduino build: DFS only, nothing to arm
+static void testNoLightSleep() {
+    PowerManager pm;
+    pm.init();
+    CHECK_EQ(pm.getMode(), PM_DFS);
+    CHECK(!fakehal::gpioWakeupEnabled());
+    pm.idle(10);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_NAV), -1);
+}
+
+static void testButtonsWake() {
+    fakehal::setLightSleepSupported(true);
+    PowerManager pm;
+    pm.init();
+    CHECK_EQ(pm.getMode(), PM_LIGHT_SLEEP);
+    CHECK(fakehal::gpioWakeupEnabled());
+    CHECK_EQ(fakehal::gpioWakeLevel(PIN_BUTTON_NAV), -1); // Not outside a nap
+
+    pm.idle(10);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_NAV), LOW);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_HOUSE_A), LOW);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_HOUSE_B), LOW);
+    CHECK_EQ(fakehal::gpioWakeLevel(PIN_BUTTON_NAV), -1);
+
+    // House A switched ON: the next nap waits for it to go OFF
+    fakehal::setInput(PIN_BUTTON_HOUSE_A, LOW);
+    pm.idle(10);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_NAV), LOW);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_HOUSE_A), HIGH);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_HOUSE_B), LOW);
+
+    fakehal::setInput(PIN_BUTTON_HOUSE_A, HIGH);
+    pm.idle(10);
+    CHECK_EQ(fakehal::napWakeLevel(PIN_BUTTON_HOUSE_A), LOW);
+}
+
+// After a nap the buttons still raise one snapshot per edge. The press is
+// over before update() runs, so only the edge ISR can have seen it
+static void testEdgesAfterNap() {
+    fakehal::setLightSleepSupported(true);
+    InputManager input;
+    input.init();
+    PowerManager pm;
+    pm.init();
+
+    for (int i = 0; i < 5; i++) pm.idle(10);
+    fakehal::setInput(PIN_BUTTON_NAV, LOW);
+    fakehal::advanceMillis(100);
+    fakehal::setInput(PIN_BUTTON_NAV, HIGH);
+    fakehal::advanceMillis(100);
+    input.update();
+
+    CHECK_EQ(input.getDroppedSnapshots(), 0);
+    int level;
+    unsigned long at;
+    CHECK(input.takeChange(PIN_BUTTON_NAV, &level, &at));
+    CHECK_EQ(level, LOW);
+    CHECK(input.takeChange(PIN_BUTTON_NAV, &level, &at));
+    CHECK_EQ(level, HIGH);
+    CHECK(!input.takeChange(PIN_BUTTON_NAV, &level, &at));
+}
+
+int main() {
+    releaseAll();
+    testNoLightSleep();
+    testButtonsWake();
+    testEdgesAfterNap();
+    return checkResult("test_power_wake");
+}
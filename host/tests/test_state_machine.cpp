@@ -0,0 +1,220 @@
+// Every (from, to) pair against the transition table: a machine walked to
+// `from` accepts `to` exactly when the table lists it, and a rejected
+// transition changes nothing. The table itself is checked against the
+// rows below, so an accidental edit to StateMachine.cpp shows up here.
+// The booted sketch must also find its way back out of ERROR.
+#include <Arduino.h>
+#include "Check.h"
+#include "FakeHal.h"
+#include "StateMachine.h"
+#include "TransitionManager.h"
+#include <cstring>
+
+void setup();
+
+extern StateMachine stateMachine;
+extern TransitionManager transitionManager;
+
+struct Row {
+    SystemState from;
+    SystemState to;
+};
+
+static const Row EXPECTED[] = {
+    { STATE_BOOT, STATE_WIFI_CONNECTING },
+    { STATE_WIFI_CONNECTING, STATE_TIME_SYNC },
+    { STATE_TIME_SYNC, STATE_WIFI_CONNECTING },
+    { STATE_TIME_SYNC, STATE_IDLE },
+    { STATE_WIFI_CONNECTING, STATE_SEHRI_RINGING },
+    { STATE_WIFI_CONNECTING, STATE_IFTAR_RINGING },
+    { STATE_TIME_SYNC, STATE_SEHRI_RINGING },
+    { STATE_TIME_SYNC, STATE_IFTAR_RINGING },
+    { STATE_IDLE, STATE_PRE_SEHRI_RINGING },
+    { STATE_IDLE, STATE_SEHRI_RINGING },
+    { STATE_IDLE, STATE_IFTAR_RINGING },
+    { STATE_IDLE, STATE_PRAYER_BEEP },
+    { STATE_PRE_SEHRI_RINGING, STATE_SEHRI_RINGING },
+    { STATE_PRE_SEHRI_RINGING, STATE_IFTAR_RINGING },
+    { STATE_PRAYER_BEEP, STATE_SEHRI_RINGING },
+    { STATE_PRAYER_BEEP, STATE_IFTAR_RINGING },
+    { STATE_SEHRI_RINGING, STATE_SEHRI_RINGING },
+    { STATE_SEHRI_RINGING, STATE_IFTAR_RINGING },
+    { STATE_IFTAR_RINGING, STATE_IFTAR_RINGING },
+    { STATE_IFTAR_RINGING, STATE_SEHRI_RINGING },
+    { STATE_PRE_SEHRI_RINGING, STATE_IDLE },
+    { STATE_SEHRI_RINGING, STATE_IDLE },
+    { STATE_IFTAR_RINGING, STATE_IDLE },
+    { STATE_PRAYER_BEEP, STATE_IDLE },
+    { STATE_WIFI_CONNECTING, STATE_OTA_MODE },
+    { STATE_TIME_SYNC, STATE_OTA_MODE },
+    { STATE_IDLE, STATE_OTA_MODE },
+    { STATE_PRE_SEHRI_RINGING, STATE_OTA_MODE },
+    { STATE_SEHRI_RINGING, STATE_OTA_MODE },
+    { STATE_IFTAR_RINGING, STATE_OTA_MODE },
+    { STATE_PRAYER_BEEP, STATE_OTA_MODE },
+    { STATE_OTA_MODE, STATE_ERROR },
+    { STATE_ERROR, STATE_IDLE },
+};
+static const uint8_t EXPECTED_COUNT = sizeof(EXPECTED) / sizeof(EXPECTED[0]);
+
+static bool expected(SystemState from, SystemState to) {
+    for (uint8_t i = 0; i < EXPECTED_COUNT; i++) {
+        if (EXPECTED[i].from == from && EXPECTED[i].to == to) return true;
+    }
+    return false;
+}
+
+// Actions see the state being entered/left through getState()
+static StateMachine* s_machine = nullptr;
+static int s_enters[STATE_COUNT];
+static int s_exits[STATE_COUNT];
+static bool s_nest = false;
+
+static void onEnter() {
+    s_enters[s_machine->getState()]++;
+    if (s_nest) s_machine->transition(STATE_ERROR);
+}
+static void onExit() { s_exits[s_machine->getState()]++; }
+
+static void hook(StateMachine& m) {
+    s_machine = &m;
+    for (int s = 0; s < STATE_COUNT; s++) m.setActions((SystemState)s, onEnter, onExit);
+}
+
+// Shortest path from BOOT through the table; false if `to` is unreachable
+static bool pathTo(SystemState to, SystemState* path, int* len) {
+    int prev[STATE_COUNT];
+    for (int s = 0; s < STATE_COUNT; s++) prev[s] = -2;
+    SystemState queue[STATE_COUNT];
+    int head = 0, tail = 0;
+    queue[tail++] = STATE_BOOT;
+    prev[STATE_BOOT] = -1;
+    while (head < tail) {
+        SystemState s = queue[head++];
+        for (uint8_t i = 0; i < StateMachine::getTransitionCount(); i++) {
+            SystemState from, next;
+            StateMachine::getTransition(i, &from, &next);
+            if (from != s || prev[next] != -2) continue;
+            prev[next] = s;
+            queue[tail++] = next;
+        }
+    }
+    if (prev[to] == -2) return false;
+    *len = 0;
+    for (int s = to; s != STATE_BOOT; s = prev[s]) path[(*len)++] = (SystemState)s;
+    for (int i = 0; i < *len / 2; i++) {
+        SystemState t = path[i];
+        path[i] = path[*len - 1 - i];
+        path[*len - 1 - i] = t;
+    }
+    return true;
+}
+
+static void testTableMatchesSpec() {
+    CHECK_EQ(StateMachine::getTransitionCount(), EXPECTED_COUNT);
+    for (uint8_t i = 0; i < StateMachine::getTransitionCount(); i++) {
+        SystemState from, to;
+        StateMachine::getTransition(i, &from, &to);
+        CHECK(expected(from, to));
+    }
+    for (int from = 0; from < STATE_COUNT; from++) {
+        for (int to = 0; to < STATE_COUNT; to++) {
+            CHECK_EQ(StateMachine::isAllowed((SystemState)from, (SystemState)to),
+                     expected((SystemState)from, (SystemState)to));
+        }
+    }
+}
+
+// Nothing enters these yet, so nothing may leave them either
+static void testUnusedStatesUnreachable() {
+    SystemState path[STATE_COUNT];
+    int len;
+    CHECK(!pathTo(STATE_PRE_SEHRI_ARMED, path, &len));
+    CHECK(!pathTo(STATE_PARTIAL_ACK, path, &len));
+    CHECK(!pathTo(STATE_ALL_ACK, path, &len));
+    for (int s = 0; s < STATE_COUNT; s++) {
+        if (s == STATE_PRE_SEHRI_ARMED || s == STATE_PARTIAL_ACK || s == STATE_ALL_ACK) continue;
+        CHECK(pathTo((SystemState)s, path, &len));
+    }
+}
+
+// Walk a fresh machine to each reachable state and try every target
+static void testEveryPair() {
+    for (int from = 0; from < STATE_COUNT; from++) {
+        SystemState path[STATE_COUNT];
+        int len;
+        if (!pathTo((SystemState)from, path, &len)) continue;
+
+        for (int to = 0; to < STATE_COUNT; to++) {
+            StateMachine m;
+            hook(m);
+            for (int i = 0; i < len; i++) CHECK(m.transition(path[i]));
+            CHECK_EQ(m.getState(), from);
+
+            memset(s_enters, 0, sizeof(s_enters));
+            memset(s_exits, 0, sizeof(s_exits));
+            uint32_t rejected = m.getRejectedCount();
+            uint32_t entries = m.getEntryCount((SystemState)to);
+            bool allowed = expected((SystemState)from, (SystemState)to);
+
+            CHECK_EQ(m.canTransition((SystemState)to), allowed);
+            CHECK_EQ(m.transition((SystemState)to), allowed);
+            if (allowed) {
+                CHECK_EQ(m.getState(), to);
+                CHECK_EQ(s_exits[from], 1);
+                CHECK_EQ(s_enters[to], 1);
+                CHECK_EQ(m.getEntryCount((SystemState)to), entries + 1);
+                CHECK_EQ(m.getRejectedCount(), rejected);
+            } else {
+                CHECK_EQ(m.getState(), from);
+                CHECK_EQ(s_exits[from], 0);
+                CHECK_EQ(s_enters[to], 0);
+                CHECK_EQ(m.getEntryCount((SystemState)to), entries);
+                CHECK_EQ(m.getRejectedCount(), rejected + 1);
+            }
+        }
+    }
+}
+
+// An entry action asking for another transition is rejected, not nested
+static void testNestedTransitionRejected() {
+    StateMachine m;
+    hook(m);
+    m.transition(STATE_WIFI_CONNECTING);
+    m.transition(STATE_TIME_SYNC);
+    m.transition(STATE_IDLE);
+    s_nest = true; // OTA_MODE -> ERROR is legal, but not from OTA_MODE's entry action
+    CHECK(m.transition(STATE_OTA_MODE));
+    s_nest = false;
+    CHECK_EQ(m.getState(), STATE_OTA_MODE);
+    CHECK_EQ(m.getRejectedCount(), 1);
+    CHECK(m.transition(STATE_ERROR));
+}
+
+// ERROR is left by the step enterError() queues; a full transition queue
+// must not strand the unit there
+static void testErrorLeftWithFullQueue() {
+    fakehal::addPartition("evlog", 0x01, 0x40, 0x10000);
+    fakehal::addPartition("ttable", 0x01, 0x41, 0x2000);
+    fakehal::setWifiConnected(true);
+    fakehal::setNtpAvailable(true);
+    fakehal::setLocalTime(2026, 3, 1, 14, 0, 0);
+    setup();
+    fakehal::runLoop(5000);
+    CHECK_EQ(stateMachine.getState(), STATE_IDLE);
+
+    while (transitionManager.after(60000, nullptr)) {}
+    CHECK(stateMachine.transition(STATE_OTA_MODE));
+    CHECK(stateMachine.transition(STATE_ERROR));
+    fakehal::runLoop(6000);
+    CHECK_EQ(stateMachine.getState(), STATE_IDLE);
+}
+
+int main() {
+    testTableMatchesSpec();
+    testUnusedStatesUnreachable();
+    testEveryPair();
+    testNestedTransitionRejected();
+    testErrorLeftWithFullQueue();
+    return checkResult("test_state_machine");
+}
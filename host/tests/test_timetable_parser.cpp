@@ -0,0 +1,300 @@
+// TimetableParser: JSON and CSV give the same days, malformed bodies fail
+// with the right message and line, order and limits are enforced, and a
+// fuzz checks that any split of the body into chunks parses exactly like
+// the body in one piece.
+#include <Arduino.h>
+#include "Check.h"
+#include "TimetableParser.h"
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Result {
+    bool ok;
+    std::string error;
+    uint32_t line;
+    std::vector<AlarmEntry> days;
+    std::string location;
+    bool prayers;
+};
+
+static size_t s_maxDays = 1000;
+
+static bool collect(const AlarmEntry& e, void* ctx) {
+    std::vector<AlarmEntry>* days = (std::vector<AlarmEntry>*)ctx;
+    if (days->size() >= s_maxDays) return false;
+    days->push_back(e);
+    return true;
+}
+
+// chunk 0 = the whole body in one feed(), otherwise random sizes up to chunk
+static Result parse(const std::string& body, std::mt19937* rng = nullptr, size_t chunk = 0) {
+    static TimetableParser p;
+    Result r;
+    p.begin(collect, &r.days);
+    for (size_t i = 0; i < body.size();) {
+        size_t n = chunk ? 1 + (*rng)() % chunk : body.size();
+        if (n > body.size() - i) n = body.size() - i;
+        p.feed((const uint8_t*)body.data() + i, n);
+        i += n;
+    }
+    r.ok = p.finish();
+    r.error = p.getError();
+    r.line = p.getErrorLine();
+    r.location = p.getLocation();
+    r.prayers = p.hasPrayerTimes();
+    CHECK_EQ(p.getEntries(), r.days.size());
+    return r;
+}
+
+static bool same(const Result& a, const Result& b) {
+    return a.ok == b.ok && a.error == b.error && a.line == b.line && a.location == b.location &&
+           a.prayers == b.prayers && a.days.size() == b.days.size() &&
+           (a.days.empty() || !memcmp(a.days.data(), b.days.data(), a.days.size() * sizeof(AlarmEntry)));
+}
+
+static const char* const MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+// 30 days from 19 Feb, one per line, with keys the parser has to skip
+static std::string sampleJson() {
+    std::string s = "{\n  \"location\": \"Karachi, PK\",\n  \"source\": {\"name\": \"x\", \"ids\": [1, 2.5e3, -4, true, null]},\n"
+                    "  \"prayer_fixed_times\": {\"fajr\": \"05:50\", \"zuhr\": \"13:15\", \"asr\": \"16:45\", \"isha\": \"20:15\"},\n"
+                    "  \"timetable\": [\n";
+    for (int i = 0; i < 30; i++) {
+        int month = i < 10 ? 2 : 3, day = i < 10 ? 19 + i : i - 9;
+        char line[128];
+        snprintf(line, sizeof(line), "    {\"roza\": %d, \"date\": \"%02d %s\", \"sehri\": \"05:%02d\", \"iftar\": \"18:%02d\"}%s\n",
+                 i + 1, day, MONTHS[month - 1], 42 - i % 30, 13 + i % 40, i < 29 ? "," : "");
+        s += line;
+    }
+    return s + "  ]\n}\n";
+}
+
+static std::string toCsv(const std::vector<AlarmEntry>& days) {
+    std::string s = "\xEF\xBB\xBF# exported\nRoza,Date,Sehri,Iftar\r\n\n";
+    for (size_t i = 0; i < days.size(); i++) {
+        const AlarmEntry& e = days[i];
+        char line[64];
+        snprintf(line, sizeof(line), "%u,2026-%02u-%02u,\"%u:%02u\" , %02u:%02u\r\n", (unsigned)(i + 1) % 1000,
+                 e.month, e.day, e.sehriHour, e.sehriMinute, e.iftarHour, e.iftarMinute);
+        s += line;
+    }
+    return s;
+}
+
+static void testJsonAndCsvAgree() {
+    Result json = parse(sampleJson());
+    CHECK(json.ok);
+    CHECK_EQ(json.days.size(), 30);
+    CHECK(json.location == "Karachi, PK");
+    CHECK(json.prayers);
+    CHECK_EQ(json.days[0].month, 2);
+    CHECK_EQ(json.days[0].day, 19);
+    CHECK_EQ(json.days[29].month, 3);
+    CHECK_EQ(json.days[29].day, 20);
+    CHECK_EQ(json.days[0].sehriMinute, 42);
+
+    Result csv = parse(toCsv(json.days));
+    CHECK(csv.ok);
+    CHECK_EQ(csv.days.size(), json.days.size());
+    CHECK(!memcmp(csv.days.data(), json.days.data(), csv.days.size() * sizeof(AlarmEntry)));
+    CHECK(!csv.prayers);
+
+    // Headerless CSV is date,sehri,iftar
+    Result plain = parse("19 February,5:42,18:13\n20 feb,05:41,18:14");
+    CHECK(plain.ok);
+    CHECK_EQ(plain.days.size(), 2);
+    CHECK_EQ(plain.days[1].iftarMinute, 14);
+}
+
+struct Bad {
+    const char* body;
+    const char* error;
+    uint32_t line;
+};
+
+static const Bad MALFORMED[] = {
+    { "", "empty body", 1 },
+    { " \r\n\n", "empty body", 3 },
+    { "{\"timetable\": []}", "no days in the timetable", 1 },
+    { "[]", "expected a JSON object", 1 },
+    { "{\"timetable\": [{\"date\": \"19 Feb\"", "body ends early", 1 },
+    { "{\"timetable\": [{\"date\": \"19 Feb", "body ends early", 1 },
+    { "{\"a\": 1}}", "text after the end", 1 },
+    { "{\"a\" 1}", "unexpected value", 1 },
+    { "{\"a\": 1 \"b\": 2}", "unexpected string", 1 },
+    { "{\"a\":: 1}", "unexpected ':'", 1 },
+    { "{\"a\": 1,, \"b\": 2}", "unexpected ','", 1 },
+    { "{\"a\": [1,]}", "unexpected '}' or ']'", 1 },
+    { "{\"a\": [1}", "unexpected '}' or ']'", 1 },
+    { "{\"a\" {}}", "unexpected '{' or '['", 1 },
+    { "{\"a\": @}", "unexpected character", 1 },
+    { "{\"a\": tru}", "bad value", 1 },
+    { "{\"a\": 1x}", "bad value", 1 },
+    { "{\"a\": \"x\ty\"}", "control character in a string", 1 },
+    { "{\"a\": \"\\q\"}", "bad escape in a string", 1 },
+    { "{\"a\": \"\\u12g4\"}", "bad \\u escape", 1 },
+    { "{\n\"timetable\": [\n{\"date\": 19, \"sehri\": \"05:42\", \"iftar\": \"18:13\"}]}", "expected a string", 3 },
+    { "{\n\"timetable\": [\n{\"date\": \"31 Feb\", \"sehri\": \"05:42\", \"iftar\": \"18:13\"}]}", "bad date", 3 },
+    { "{\n\"timetable\": [\n{\"date\": \"19 Fe\", \"sehri\": \"05:42\", \"iftar\": \"18:13\"}]}", "bad date", 3 },
+    { "{\n\"timetable\": [\n{\"date\": \"19 Feb\", \"sehri\": \"24:00\", \"iftar\": \"18:13\"}]}", "bad time", 3 },
+    { "{\n\"timetable\": [\n{\"date\": \"19 Feb\", \"sehri\": \"5:4\", \"iftar\": \"18:13\"}]}", "bad time", 3 },
+    { "{\n\"timetable\": [\n{\"date\": \"19 Feb\", \"iftar\": \"18:13\"}]}", "day without date, sehri and iftar", 3 },
+    { "{\"prayer_fixed_times\": {\"fajr\": \"5 am\"}}", "bad time", 1 },
+    { "19 Feb,05:42\n", "missing column", 1 },
+    { "Date,Sehri\n19 Feb,05:42\n", "header needs date, sehri and iftar", 1 },
+    { "date,sehri,iftar\n\"19 Feb,05:42,18:13\n", "unterminated quote", 2 },
+    { "date,sehri,iftar\n19 Feb,05:42,18:13\n2026-02-30,05:41,18:14\n", "bad date", 3 },
+    { "19 Feb,05:42,18:13\n20 Feb,05:41,6:14 pm", "bad time", 2 },
+};
+
+static void testMalformed() {
+    for (const Bad& b : MALFORMED) {
+        Result r = parse(b.body);
+        CHECK(!r.ok);
+        CHECK(r.days.size() <= 1);
+        if (r.error != b.error || r.line != b.line) {
+            fprintf(stderr, "body %s: got \"%s\" line %u, want \"%s\" line %u\n", b.body, r.error.c_str(),
+                    (unsigned)r.line, b.error, (unsigned)b.line);
+            CHECK(false);
+        }
+    }
+}
+
+static void testOrdering() {
+    // Across a month end is fine; a repeat or a step back is not
+    CHECK(parse("28 Feb,05:30,18:20\n29 Feb,05:29,18:21\n01 Mar,05:28,18:22\n").ok);
+    Result repeat = parse("19 Feb,05:42,18:13\n20 Feb,05:41,18:14\n20 Feb,05:40,18:15\n");
+    CHECK(repeat.error == "days out of order or repeated");
+    CHECK_EQ(repeat.line, 3);
+    CHECK_EQ(repeat.days.size(), 2);
+    Result back = parse("{\"timetable\": [\n{\"date\": \"01 Mar\", \"sehri\": \"05:42\", \"iftar\": \"18:13\"},\n"
+                        "{\"date\": \"28 Feb\", \"sehri\": \"05:42\", \"iftar\": \"18:13\"}]}");
+    CHECK(back.error == "days out of order or repeated");
+    CHECK_EQ(back.line, 3);
+
+    // A Ramadan around new year runs on from December into January, once
+    Result wrap = parse("30 Dec,05:30,18:20\n31 Dec,05:30,18:21\n2031-01-01,05:31,18:22\n02 Jan,05:31,18:23\n");
+    CHECK(wrap.ok);
+    CHECK_EQ(wrap.days.size(), 4);
+    Result again = parse("31 Dec,05:30,18:21\n01 Jan,05:31,18:22\n31 Dec,05:30,18:21\n");
+    CHECK(again.error == "days out of order or repeated");
+    CHECK_EQ(again.line, 3);
+    Result lapped = parse("15 Dec,05:30,18:20\n01 Jan,05:31,18:22\n16 Dec,05:30,18:21\n");
+    CHECK(lapped.error == "days out of order or repeated");
+    Result notDec = parse("30 Nov,05:30,18:20\n01 Jan,05:31,18:22\n");
+    CHECK(notDec.error == "days out of order or repeated");
+    CHECK_EQ(notDec.line, 2);
+
+    Result swapped = parse("19 Feb,18:13,05:42\n");
+    CHECK(swapped.error == "sehri not before iftar");
+    Result equal = parse("19 Feb,05:42,05:42\n");
+    CHECK(equal.error == "sehri not before iftar");
+
+    // Field order inside a JSON day does not matter
+    Result fields = parse("{\"timetable\": [{\"iftar\": \"18:13\", \"sehri\": \"05:42\", \"date\": \"2026-02-19\"}]}");
+    CHECK(fields.ok);
+    CHECK_EQ(fields.days.size(), 1);
+}
+
+static void testOverflow() {
+    std::string longText(300, 'x');
+
+    // Long keys and values nobody reads are skipped; long ones we need fail
+    std::string skipped = "{\"" + longText + "\": \"" + longText + "\", \"timetable\": [{\"date\": \"19 Feb\", "
+                          "\"sehri\": \"05:42\", \"iftar\": \"18:13\"}]}";
+    CHECK(parse(skipped).ok);
+    Result longDate = parse("{\"timetable\": [{\"date\": \"19 Feb" + longText + "\"}]}");
+    CHECK(longDate.error == "value too long");
+    Result longNumber = parse("{\"a\": " + std::string(100, '1') + "}");
+    CHECK(longNumber.error == "bad value");
+
+    // Location is cut to LOCATION_MAX
+    Result loc = parse("{\"location\": \"" + longText + "\", \"timetable\": [{\"date\": \"19 Feb\", "
+                       "\"sehri\": \"05:42\", \"iftar\": \"18:13\"}]}");
+    CHECK(loc.ok);
+    CHECK_EQ(loc.location.size(), TimetableParser::LOCATION_MAX);
+
+    // Nesting past MAX_DEPTH
+    std::string deep = "{\"a\": ";
+    for (int i = 0; i < TimetableParser::MAX_DEPTH; i++) deep += "[";
+    Result nested = parse(deep);
+    CHECK(nested.error == "nested too deep");
+
+    // CSV line past CSV_LINE_MAX
+    Result line = parse("19 Feb,05:42,18:13\n20 Feb,05:41,18:14," + longText + "\n");
+    CHECK(line.error == "line too long");
+    CHECK_EQ(line.line, 2);
+    CHECK_EQ(line.days.size(), 1);
+
+    // The store runs out of room
+    s_maxDays = 10;
+    Result full = parse(sampleJson());
+    s_maxDays = 1000;
+    CHECK(full.error == "too many days");
+    CHECK_EQ(full.days.size(), 10);
+}
+
+// Mutated and random bodies: chunked parsing must match one-shot parsing,
+// and anything accepted must still be ordered and in range
+static void testFuzz() {
+    std::mt19937 rng(2026);
+    std::string json = sampleJson();
+    std::string csv = toCsv(parse(json).days);
+    const char* alpha = "{}[]\":,\\ 0123456789abcdefuFebMarch-\n\r\t#";
+    size_t alphaLen = strlen(alpha);
+    int accepted = 0;
+
+    for (int it = 0; it < 20000; it++) {
+        std::string s = (it & 1) ? json : csv;
+        int mutations = 1 + rng() % 4;
+        for (int m = 0; m < mutations; m++) {
+            size_t pos = s.empty() ? 0 : rng() % s.size();
+            switch (rng() % 6) {
+                case 0: if (!s.empty()) s[pos] = alpha[rng() % alphaLen]; break;
+                case 1: s.insert(pos, 1, alpha[rng() % alphaLen]); break;
+                case 2: if (!s.empty()) s.erase(pos, 1 + rng() % 8); break;
+                case 3: s.resize(pos); break;
+                case 4: if (!s.empty()) s[pos] = (char)(rng() & 0xFF); break;
+                case 5: s.insert(pos, std::string(rng() % 200, alpha[rng() % alphaLen])); break;
+            }
+        }
+        if (it % 97 == 0) {
+            s.clear();
+            size_t len = rng() % 300;
+            for (size_t j = 0; j < len; j++) s += (char)(rng() & 0xFF);
+        }
+
+        Result whole = parse(s);
+        Result bytes = parse(s, &rng, 1);
+        Result chunks = parse(s, &rng, 64);
+        if (!same(whole, bytes) || !same(whole, chunks)) {
+            fprintf(stderr, "fuzz %d: chunked parse differs (%s line %u)\n", it, whole.error.c_str(), (unsigned)whole.line);
+            CHECK(false);
+            break;
+        }
+        if (!whole.ok) continue;
+        accepted++;
+        uint16_t key = 0;
+        for (size_t j = 0; j < whole.days.size(); j++) {
+            const AlarmEntry& e = whole.days[j];
+            CHECK(e.month >= 1 && e.month <= 12 && e.day >= 1 && e.day <= 31);
+            CHECK(e.sehriHour * 60 + e.sehriMinute < e.iftarHour * 60 + e.iftarMinute);
+            CHECK(e.iftarHour <= 23 && e.iftarMinute <= 59);
+            key = timetableDateKey(key, whole.days[0].month, e);
+            CHECK(key != 0);
+        }
+    }
+    CHECK(accepted > 0);
+}
+
+int main() {
+    testJsonAndCsvAgree();
+    testMalformed();
+    testOrdering();
+    testOverflow();
+    testFuzz();
+    return checkResult("test_timetable_parser");
+}